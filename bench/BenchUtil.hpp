@@ -0,0 +1,61 @@
+// BenchUtil.hpp
+// Small helpers shared by the benchmark programs in bench/.
+#ifndef BENCH_UTIL_HPP
+#define BENCH_UTIL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace BenchUtil {
+
+inline std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Returns the q-quantile (0..1) of the samples. Sorts in place.
+inline std::int64_t percentile(std::vector<std::int64_t>& samples, double q) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto idx = static_cast<std::size_t>(q * static_cast<double>(samples.size() - 1));
+    return samples[idx];
+}
+
+inline void print_latency_us(const std::string& label, std::vector<std::int64_t>& samples_ns) {
+    std::cout << std::fixed << std::setprecision(1) << label
+              << " samples=" << samples_ns.size()
+              << " p50=" << percentile(samples_ns, 0.50) / 1000.0 << "us"
+              << " p99=" << percentile(samples_ns, 0.99) / 1000.0 << "us"
+              << " p999=" << percentile(samples_ns, 0.999) / 1000.0 << "us"
+              << " max=" << (samples_ns.empty() ? 0 : samples_ns.back()) / 1000.0 << "us"
+              << std::endl;
+}
+
+// Reads "--name=value" style flags; positional arguments are not supported.
+inline std::string flag(int argc, char* argv[], const std::string& name, const std::string& fallback) {
+    const std::string prefix = "--" + name + "=";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind(prefix, 0) == 0) {
+            return arg.substr(prefix.size());
+        }
+    }
+    return fallback;
+}
+
+inline long flag_int(int argc, char* argv[], const std::string& name, long fallback) {
+    return std::atol(flag(argc, argv, name, std::to_string(fallback)).c_str());
+}
+
+} // namespace BenchUtil
+
+#endif // BENCH_UTIL_HPP
@@ -0,0 +1,263 @@
+// chat_loadgen.cpp
+// Load generator for a running websocket-chat-server. Opens many WebSocket
+// connections, has a subset of them send chat messages at a fixed rate and
+// reports delivery throughput and sender round-trip latency (time from a
+// client_send_message write until the sender sees its own broadcast).
+//
+// Example:
+//   chat_loadgen --port=8080 --connections=10000 --senders=20 --rate=50 --duration=30
+//
+// For more than ~28k connections from one host, spread the sockets over
+// several loopback source addresses: --source-addresses=127.0.0.2,127.0.0.3,...
+#include "BenchUtil.hpp"
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+using tcp = net::ip::tcp;
+
+namespace {
+
+struct LoadStats {
+    std::atomic<std::uint64_t> connected{0};
+    std::atomic<std::uint64_t> failed{0};
+    std::atomic<std::uint64_t> sent{0};
+    std::atomic<std::uint64_t> skipped{0};
+    std::atomic<std::uint64_t> received{0};
+    std::atomic<bool> measuring{false};
+    std::mutex latency_mutex;
+    std::vector<std::int64_t> latencies_ns;
+};
+
+class LoadClient : public std::enable_shared_from_this<LoadClient> {
+public:
+    LoadClient(net::io_context& ioc, LoadStats& stats, int id, bool sender, std::int64_t send_interval_ns)
+        : strand_(net::make_strand(ioc))
+        , ws_(strand_)
+        , timer_(strand_)
+        , stats_(stats)
+        , id_(id)
+        , sender_(sender)
+        , send_interval_ns_(send_interval_ns) {}
+
+    void start(const tcp::endpoint& server, const net::ip::address* source) {
+        auto& socket = beast::get_lowest_layer(ws_).socket();
+        beast::error_code ec;
+        socket.open(server.protocol(), ec);
+        if (!ec && source) {
+            socket.bind(tcp::endpoint(*source, 0), ec);
+        }
+        if (ec) {
+            ++stats_.failed;
+            return;
+        }
+        beast::get_lowest_layer(ws_).async_connect(
+            server, beast::bind_front_handler(&LoadClient::on_connect, shared_from_this()));
+    }
+
+    void stop() {
+        net::post(strand_, [self = shared_from_this()] {
+            self->stopped_ = true;
+            self->timer_.cancel();
+            beast::error_code ec;
+            beast::get_lowest_layer(self->ws_).socket().close(ec);
+        });
+    }
+
+private:
+    void on_connect(beast::error_code ec) {
+        if (ec) {
+            ++stats_.failed;
+            return;
+        }
+        beast::get_lowest_layer(ws_).socket().set_option(tcp::no_delay(true), ec);
+        ws_.async_handshake("localhost", "/",
+                            beast::bind_front_handler(&LoadClient::on_handshake, shared_from_this()));
+    }
+
+    void on_handshake(beast::error_code ec) {
+        if (ec) {
+            ++stats_.failed;
+            return;
+        }
+        ++stats_.connected;
+        do_read();
+        if (sender_) {
+            schedule_send();
+        }
+    }
+
+    void do_read() {
+        ws_.async_read(buffer_, beast::bind_front_handler(&LoadClient::on_read, shared_from_this()));
+    }
+
+    void on_read(beast::error_code ec, std::size_t) {
+        if (ec) {
+            return;
+        }
+        if (stats_.measuring) {
+            ++stats_.received;
+            if (sender_) {
+                record_latency();
+            }
+        }
+        buffer_.consume(buffer_.size());
+        do_read();
+    }
+
+    // Our own messages carry "lg:<client id>:<send time ns>" as their text.
+    void record_latency() {
+        auto const data = buffer_.data();
+        beast::string_view msg(static_cast<const char*>(data.data()), data.size());
+        auto const marker = msg.find("\"text\":\"lg:");
+        if (marker == beast::string_view::npos) {
+            return;
+        }
+        std::string tail(msg.substr(marker + 11, 48));
+        int id = -1;
+        long long sent_ns = 0;
+        if (std::sscanf(tail.c_str(), "%d:%lld", &id, &sent_ns) == 2 && id == id_) {
+            std::lock_guard<std::mutex> lock(stats_.latency_mutex);
+            stats_.latencies_ns.push_back(BenchUtil::now_ns() - sent_ns);
+        }
+    }
+
+    void schedule_send() {
+        timer_.expires_after(std::chrono::nanoseconds(send_interval_ns_));
+        timer_.async_wait(beast::bind_front_handler(&LoadClient::on_timer, shared_from_this()));
+    }
+
+    void on_timer(beast::error_code ec) {
+        if (ec || stopped_) {
+            return;
+        }
+        if (writing_) {
+            // The previous message has not been flushed yet; the server (or
+            // the network) is not keeping up with the requested rate.
+            if (stats_.measuring) {
+                ++stats_.skipped;
+            }
+        } else {
+            writing_ = true;
+            std::ostringstream out;
+            out << "{\"type\":\"client_send_message\",\"payload\":{\"text\":\"lg:" << id_ << ':'
+                << BenchUtil::now_ns() << "\"}}";
+            outgoing_ = out.str();
+            ws_.text(true);
+            ws_.async_write(net::buffer(outgoing_),
+                            beast::bind_front_handler(&LoadClient::on_write, shared_from_this()));
+        }
+        schedule_send();
+    }
+
+    void on_write(beast::error_code ec, std::size_t) {
+        writing_ = false;
+        if (!ec && stats_.measuring) {
+            ++stats_.sent;
+        }
+    }
+
+    net::strand<net::io_context::executor_type> strand_;
+    websocket::stream<beast::tcp_stream> ws_;
+    net::steady_timer timer_;
+    beast::flat_buffer buffer_;
+    std::string outgoing_;
+    LoadStats& stats_;
+    int id_;
+    bool sender_;
+    bool writing_ = false;
+    bool stopped_ = false;
+    std::int64_t send_interval_ns_;
+};
+
+std::vector<net::ip::address> parse_addresses(const std::string& list) {
+    std::vector<net::ip::address> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            out.push_back(net::ip::make_address(item));
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const host = BenchUtil::flag(argc, argv, "host", "127.0.0.1");
+    auto const port = static_cast<unsigned short>(BenchUtil::flag_int(argc, argv, "port", 8080));
+    auto const connections = BenchUtil::flag_int(argc, argv, "connections", 1000);
+    auto const senders = std::min(connections, BenchUtil::flag_int(argc, argv, "senders", 10));
+    auto const rate = std::max(1L, BenchUtil::flag_int(argc, argv, "rate", 10));
+    auto const duration_s = BenchUtil::flag_int(argc, argv, "duration", 10);
+    auto const connect_rate = std::max(1L, BenchUtil::flag_int(argc, argv, "connect-rate", 5000));
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", std::thread::hardware_concurrency()));
+    auto const sources = parse_addresses(BenchUtil::flag(argc, argv, "source-addresses", ""));
+
+    net::io_context ioc{static_cast<int>(threads)};
+    auto work = net::make_work_guard(ioc);
+    std::vector<std::thread> pool;
+    for (long i = 0; i < threads; ++i) {
+        pool.emplace_back([&ioc] { ioc.run(); });
+    }
+
+    LoadStats stats;
+    tcp::endpoint const server(net::ip::make_address(host), port);
+    std::int64_t const interval_ns = 1000000000LL / rate;
+    std::vector<std::shared_ptr<LoadClient>> clients;
+    clients.reserve(static_cast<std::size_t>(connections));
+
+    // Pace the connects so the listen backlog is not overrun.
+    auto const batch = std::max(1L, connect_rate / 10);
+    for (long i = 0; i < connections; ++i) {
+        auto client = std::make_shared<LoadClient>(ioc, stats, static_cast<int>(i), i < senders, interval_ns);
+        client->start(server, sources.empty() ? nullptr : &sources[static_cast<std::size_t>(i) % sources.size()]);
+        clients.push_back(std::move(client));
+        if ((i + 1) % batch == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    auto const connect_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (stats.connected + stats.failed < static_cast<std::uint64_t>(connections)
+           && std::chrono::steady_clock::now() < connect_deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    std::cout << "connected=" << stats.connected << " failed=" << stats.failed << std::endl;
+
+    // One second of warm-up before counting.
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    auto const start_ns = BenchUtil::now_ns();
+    stats.measuring = true;
+    std::this_thread::sleep_for(std::chrono::seconds(duration_s));
+    stats.measuring = false;
+    double const elapsed_s = static_cast<double>(BenchUtil::now_ns() - start_ns) / 1e9;
+
+    for (auto& client : clients) {
+        client->stop();
+    }
+    work.reset();
+    ioc.stop();
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    std::cout << "sent=" << stats.sent << " skipped=" << stats.skipped << " delivered=" << stats.received
+              << " elapsed_s=" << elapsed_s << std::endl;
+    std::cout << "sent_per_s=" << static_cast<double>(stats.sent) / elapsed_s
+              << " delivered_per_s=" << static_cast<double>(stats.received) / elapsed_s << std::endl;
+    BenchUtil::print_latency_us("round_trip", stats.latencies_ns);
+    return 0;
+}
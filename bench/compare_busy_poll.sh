@@ -0,0 +1,81 @@
+#!/bin/bash
+# Measures the busy-poll run mode against the default (blocking) one.
+#
+# Usage: bench/compare_busy_poll.sh <server> <chat_loadgen> [configuration names...]
+#
+# Each configuration starts the server with one --busy-poll-us window (and
+# optionally SO_BUSY_POLL on its sockets), runs chat_loadgen against it and
+# prints throughput, the sender round-trip latency percentiles and the CPU
+# the server burned, in cores (user + system time over the run's wall time).
+#
+# Busy polling pays off when I/O threads would otherwise fall asleep between
+# messages, so the defaults use a light load. Pin the server and the load
+# generator to separate cores (SERVER_CPUS, LOADGEN_CPUS; taskset syntax),
+# or they compete for the CPU the server spins on. SO_BUSY_POLL only acts on
+# NIC receive queues, not on loopback: run the load generator on another
+# host against HOST to measure the `sock` configurations.
+set -euo pipefail
+
+SERVER=${1:?server binary}
+LOADGEN=${2:?chat_loadgen binary}
+shift 2
+
+PORT=${PORT:-18083}
+HOST=${HOST:-127.0.0.1}
+THREADS=${THREADS:-2}
+DURATION=${DURATION:-10}
+CONNECTIONS=${CONNECTIONS:-100}
+SENDERS=${SENDERS:-5}
+RATE=${RATE:-20}
+SERVER_CPUS=${SERVER_CPUS:-}
+LOADGEN_CPUS=${LOADGEN_CPUS:-}
+
+declare -A CONFIGS=(
+    [blocking]=""
+    [spin-20us]="--busy-poll-us=20"
+    [spin-100us]="--busy-poll-us=100"
+    [spin-1ms]="--busy-poll-us=1000"
+    [spin-100us-sock]="--busy-poll-us=100 --socket-busy-poll-us=50"
+    [sock]="--socket-busy-poll-us=50"
+)
+ORDER=(blocking spin-20us spin-100us spin-1ms)
+if [ $# -gt 0 ]; then
+    ORDER=("$@")
+fi
+
+pinned() { # pinned <cpus>: command prefix that runs on <cpus>, if given
+    if [ -n "$1" ]; then
+        echo "taskset -c $1"
+    fi
+}
+
+cpu_ticks() { # utime + stime of a process, in clock ticks
+    awk '{ print $14 + $15 }' "/proc/$1/stat"
+}
+
+printf "%-18s %12s %12s %10s %10s %10s %10s\n" config sent_per_s deliv_per_s p50_us p99_us max_us cpu_cores
+for name in "${ORDER[@]}"; do
+    flags=${CONFIGS[$name]?unknown configuration $name}
+    # shellcheck disable=SC2046,SC2086
+    $(pinned "$SERVER_CPUS") "$SERVER" "$PORT" "$THREADS" --address=0.0.0.0 $flags >/dev/null 2>&1 &
+    server_pid=$!
+    sleep 1
+
+    ticks_before=$(cpu_ticks "$server_pid")
+    started=$(date +%s.%N)
+    $(pinned "$LOADGEN_CPUS") "$LOADGEN" --host="$HOST" --port="$PORT" --connections="$CONNECTIONS" \
+        --senders="$SENDERS" --rate="$RATE" --duration="$DURATION" >/tmp/busy_poll.$$ 2>&1 || true
+    cores=$(awk -v t0="$ticks_before" -v t1="$(cpu_ticks "$server_pid")" -v hz="$(getconf CLK_TCK)" \
+        -v s0="$started" -v s1="$(date +%s.%N)" 'BEGIN { printf "%.2f", (t1 - t0) / hz / (s1 - s0) }')
+    kill "$server_pid"
+    wait "$server_pid" 2>/dev/null || true
+
+    value() { # value <line prefix> <key>: "key=<number>" from the first line starting with the prefix
+        awk -v p="$1" -v k="$2" 'index($0, p) == 1 { for (i = 1; i <= NF; i++) if (index($i, k "=") == 1) {
+            v = substr($i, length(k) + 2); sub(/us$/, "", v); print v; exit } }' /tmp/busy_poll.$$
+    }
+    printf "%-18s %12s %12s %10s %10s %10s %10s\n" "$name" "$(value sent_per_s sent_per_s)" \
+        "$(value sent_per_s delivered_per_s)" "$(value round_trip p50)" "$(value round_trip p99)" \
+        "$(value round_trip max)" "$cores"
+done
+rm -f /tmp/busy_poll.$$
@@ -0,0 +1,103 @@
+#!/bin/bash
+# Compares I/O thread placements on a multi-socket (NUMA) machine.
+#
+# Usage: bench/compare_cpu_placement.sh <server> <chat_loadgen> [configuration names...]
+#
+# Each configuration starts the server with one placement, runs chat_loadgen
+# against it and prints throughput, the sender round-trip latency
+# percentiles and how much memory was allocated off the allocating CPU's
+# node during the run (other_node pages, summed over /sys numastat; this is
+# machine-wide, so keep the box otherwise quiet). With `perf` installed the
+# server's node-load-misses (loads served by another node's memory) are
+# counted too.
+#
+# CPUS lists the CPUs to pin to, by default the first THREADS CPUs taken
+# alternately from each node, so pinned threads span every socket; NODES
+# lists the nodes to spread over. Pin the load generator out of the way with
+# LOADGEN_CPUS (taskset syntax). For NIC traffic, run it from another host
+# against HOST and steer the NIC's interrupts with scripts/irq_affinity.sh
+# first; `pinned-reuseport` then accepts each connection on the CPU that
+# handles its packets.
+set -euo pipefail
+
+SERVER=${1:?server binary}
+LOADGEN=${2:?chat_loadgen binary}
+shift 2
+
+PORT=${PORT:-18082}
+HOST=${HOST:-127.0.0.1}
+THREADS=${THREADS:-8}
+DURATION=${DURATION:-20}
+CONNECTIONS=${CONNECTIONS:-5000}
+SENDERS=${SENDERS:-50}
+RATE=${RATE:-50}
+LOADGEN_CPUS=${LOADGEN_CPUS:-}
+
+nodes=$(ls -d /sys/devices/system/node/node[0-9]* | sed 's/.*node//' | sort -n | paste -sd, -)
+if [ -z "${CPUS:-}" ]; then
+    # Round-robin over the nodes' CPU lists
+    CPUS=$(for n in ${nodes//,/ }; do
+        awk -F, '{ for (i = 1; i <= NF; i++) { split($i, r, "-"); last = r[2] == "" ? r[1] : r[2];
+            for (c = r[1]; c <= last; c++) print c } }' "/sys/devices/system/node/node$n/cpulist" | nl -v0
+    done | sort -n -k1,1 -s | awk '{ print $2 }' | head -n "$THREADS" | paste -sd, -)
+fi
+NODES=${NODES:-$nodes}
+
+declare -A CONFIGS=(
+    [shared]="--io-model=shared"
+    [per-thread]="--io-model=per-thread"
+    [pinned]="--io-model=per-thread --cpu-affinity=$CPUS"
+    [pinned-reuseport]="--io-model=per-thread --cpu-affinity=$CPUS --reuseport=on"
+    [nodes]="--io-model=per-thread --numa-nodes=$NODES"
+    [nodes-reuseport]="--io-model=per-thread --numa-nodes=$NODES --reuseport=on"
+)
+ORDER=(shared per-thread pinned pinned-reuseport nodes nodes-reuseport)
+if [ $# -gt 0 ]; then
+    ORDER=("$@")
+fi
+
+other_node() { # Pages allocated off-node, all nodes
+    cat /sys/devices/system/node/node*/numastat | awk '$1 == "other_node" { sum += $2 } END { print sum + 0 }'
+}
+
+echo "nodes: $NODES, pinned CPUs: $CPUS"
+printf "%-18s %12s %12s %10s %10s %10s %12s %14s\n" config sent_per_s deliv_per_s p50_us p99_us max_us \
+    off_node_pg node_ld_miss
+for name in "${ORDER[@]}"; do
+    flags=${CONFIGS[$name]:?unknown configuration $name}
+    # shellcheck disable=SC2086
+    "$SERVER" "$PORT" "$THREADS" --address=0.0.0.0 $flags >/dev/null 2>&1 &
+    server_pid=$!
+    sleep 1
+
+    perf_pid=
+    if command -v perf >/dev/null; then
+        perf stat -x, -e node-load-misses -p "$server_pid" -o /tmp/cpu_placement_perf.$$ 2>/dev/null &
+        perf_pid=$!
+    fi
+    before=$(other_node)
+    loadgen=("$LOADGEN")
+    if [ -n "$LOADGEN_CPUS" ]; then
+        loadgen=(taskset -c "$LOADGEN_CPUS" "$LOADGEN")
+    fi
+    "${loadgen[@]}" --host="$HOST" --port="$PORT" --connections="$CONNECTIONS" --senders="$SENDERS" \
+        --rate="$RATE" --duration="$DURATION" >/tmp/cpu_placement.$$ 2>&1 || true
+    after=$(other_node)
+    misses=-
+    if [ -n "$perf_pid" ]; then
+        kill -INT "$perf_pid" 2>/dev/null || true
+        wait "$perf_pid" 2>/dev/null || true
+        misses=$(awk -F, '$3 ~ /node-load-misses/ { print $1 }' /tmp/cpu_placement_perf.$$)
+    fi
+    kill "$server_pid"
+    wait "$server_pid" 2>/dev/null || true
+
+    value() { # value <line prefix> <key>: "key=<number>" from the first line starting with the prefix
+        awk -v p="$1" -v k="$2" 'index($0, p) == 1 { for (i = 1; i <= NF; i++) if (index($i, k "=") == 1) {
+            v = substr($i, length(k) + 2); sub(/us$/, "", v); print v; exit } }' /tmp/cpu_placement.$$
+    }
+    printf "%-18s %12s %12s %10s %10s %10s %12s %14s\n" "$name" "$(value sent_per_s sent_per_s)" \
+        "$(value sent_per_s delivered_per_s)" "$(value round_trip p50)" "$(value round_trip p99)" \
+        "$(value round_trip max)" "$((after - before))" "${misses:--}"
+done
+rm -f /tmp/cpu_placement.$$ /tmp/cpu_placement_perf.$$
@@ -0,0 +1,73 @@
+#!/bin/bash
+# Compares the epoll and io_uring server builds under the same load.
+#
+# Usage: bench/compare_io_backends.sh <epoll-server> <io_uring-server> <chat_loadgen> [connection counts...]
+#
+# Build the two servers from separate build trees, e.g.
+#   cmake -S . -B build-epoll && cmake --build build-epoll
+#   cmake -S . -B build-uring -DCHAT_ENABLE_IO_URING=ON && cmake --build build-uring
+#
+# For each backend and connection count the script starts the server, runs
+# chat_loadgen against it while counting the server's system calls with
+# `perf stat` (falling back to `strace -c`), and prints syscalls per message
+# (a message is one client write plus its fan-out deliveries), throughput and
+# the round-trip latency percentiles reported by the load generator.
+#
+# 100k connections need raised limits: `ulimit -n 1048576` and several
+# loopback source addresses (see SOURCES below).
+set -euo pipefail
+
+EPOLL_SERVER=${1:?epoll server binary}
+URING_SERVER=${2:?io_uring server binary}
+LOADGEN=${3:?chat_loadgen binary}
+shift 3
+COUNTS=${*:-10000 100000}
+
+PORT=${PORT:-18080}
+THREADS=${THREADS:-$(nproc)}
+DURATION=${DURATION:-20}
+SENDERS=${SENDERS:-10}
+RATE=${RATE:-20}
+SOURCES=${SOURCES:-127.0.0.2,127.0.0.3,127.0.0.4,127.0.0.5}
+
+count_syscalls() {
+    local pid=$1 seconds=$2 out=$3
+    if command -v perf >/dev/null 2>&1; then
+        perf stat -e raw_syscalls:sys_enter -p "$pid" -x, -o "$out" -- sleep "$seconds" >/dev/null 2>&1
+        grep raw_syscalls "$out" | cut -d, -f1
+    else
+        timeout -s INT "$seconds" strace -c -f -p "$pid" -o "$out" >/dev/null 2>&1 || true
+        awk '/^100.00/ {print $4}' "$out"
+    fi
+}
+
+for backend in epoll io_uring; do
+    server=$EPOLL_SERVER
+    [ "$backend" = io_uring ] && server=$URING_SERVER
+    for conns in $COUNTS; do
+        "$server" "$PORT" "$THREADS" --io-backend="$backend" >/dev/null 2>&1 &
+        server_pid=$!
+        sleep 1
+
+        "$LOADGEN" --port="$PORT" --connections="$conns" --senders="$SENDERS" --rate="$RATE" \
+            --duration="$DURATION" --source-addresses="$SOURCES" >/tmp/loadgen.$$ 2>&1 &
+        loadgen_pid=$!
+
+        # Start counting once the connections are up and the load generator
+        # has entered its measurement window.
+        until grep -q '^connected=' /tmp/loadgen.$$; do sleep 0.5; done
+        sleep 1
+        syscalls=$(count_syscalls "$server_pid" "$DURATION" /tmp/syscalls.$$)
+        wait "$loadgen_pid"
+        kill "$server_pid"
+        wait "$server_pid" 2>/dev/null || true
+
+        sent=$(sed -n 's/.*sent=\([0-9]*\).*/\1/p' /tmp/loadgen.$$ | head -1)
+        delivered=$(sed -n 's/.*delivered=\([0-9]*\).*/\1/p' /tmp/loadgen.$$ | head -1)
+        echo "== backend=$backend connections=$conns"
+        cat /tmp/loadgen.$$
+        awk -v s="$syscalls" -v a="$sent" -v b="$delivered" \
+            'BEGIN { if (a + b > 0) printf "syscalls=%d syscalls_per_message=%.3f\n", s, s / (a + b) }'
+    done
+done
+rm -f /tmp/loadgen.$$ /tmp/syscalls.$$
@@ -0,0 +1,63 @@
+#!/bin/bash
+# Measures the effect of each socket-tuning knob on a loopback server.
+#
+# Usage: bench/compare_socket_options.sh <server> <chat_loadgen> [configuration names...]
+#
+# Each configuration starts the server with one set of socket flags, runs
+# chat_loadgen against it and prints delivery throughput and the sender
+# round-trip latency percentiles. The knobs are varied one at a time against
+# the `nagle` baseline (the server's behaviour before socket tuning existed)
+# and against the default (`nodelay`).
+#
+# The defaults use a moderate load so that latency is not dominated by
+# queueing; raise CONNECTIONS/SENDERS/RATE to see the throughput side.
+set -euo pipefail
+
+SERVER=${1:?server binary}
+LOADGEN=${2:?chat_loadgen binary}
+shift 2
+
+PORT=${PORT:-18081}
+THREADS=${THREADS:-$(nproc)}
+DURATION=${DURATION:-10}
+CONNECTIONS=${CONNECTIONS:-200}
+SENDERS=${SENDERS:-10}
+RATE=${RATE:-100}
+
+declare -A CONFIGS=(
+    [nagle]="--tcp-nodelay=off"
+    [nodelay]="--tcp-nodelay=on"
+    [sndbuf-16k]="--send-buffer=16384"
+    [sndbuf-1m]="--send-buffer=1048576"
+    [rcvbuf-16k]="--recv-buffer=16384"
+    [notsent-lowat-16k]="--notsent-lowat=16384"
+    [cork]="--cork-writes=on"
+    [cork-nagle]="--cork-writes=on --tcp-nodelay=off"
+)
+ORDER=(nagle nodelay sndbuf-16k sndbuf-1m rcvbuf-16k notsent-lowat-16k cork cork-nagle)
+if [ $# -gt 0 ]; then
+    ORDER=("$@")
+fi
+
+printf "%-18s %12s %12s %10s %10s %10s\n" config sent_per_s deliv_per_s p50_us p99_us max_us
+for name in "${ORDER[@]}"; do
+    flags=${CONFIGS[$name]:?unknown configuration $name}
+    # shellcheck disable=SC2086
+    "$SERVER" "$PORT" "$THREADS" --address=127.0.0.1 $flags >/dev/null 2>&1 &
+    server_pid=$!
+    sleep 1
+
+    "$LOADGEN" --port="$PORT" --connections="$CONNECTIONS" --senders="$SENDERS" --rate="$RATE" \
+        --duration="$DURATION" >/tmp/socket_options.$$ 2>&1 || true
+    kill "$server_pid"
+    wait "$server_pid" 2>/dev/null || true
+
+    value() { # value <line prefix> <key>: "key=<number>" from the first line starting with the prefix
+        awk -v p="$1" -v k="$2" 'index($0, p) == 1 { for (i = 1; i <= NF; i++) if (index($i, k "=") == 1) {
+            v = substr($i, length(k) + 2); sub(/us$/, "", v); print v; exit } }' /tmp/socket_options.$$
+    }
+    printf "%-18s %12s %12s %10s %10s %10s\n" "$name" "$(value sent_per_s sent_per_s)" \
+        "$(value sent_per_s delivered_per_s)" "$(value round_trip p50)" "$(value round_trip p99)" \
+        "$(value round_trip max)"
+done
+rm -f /tmp/socket_options.$$
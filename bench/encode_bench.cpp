@@ -0,0 +1,130 @@
+// encode_bench.cpp
+// Cost of encoding each server-generated event: building a json::object and
+// serializing it, as the server used to, against MessageEncoder::encode with
+// the schemas in ServerMessages.hpp. Reports ns and heap allocations per
+// event. Presence messages are encoded with --users entries.
+//
+//   encode_bench --events=200000 --users=50
+#include "BenchUtil.hpp"
+#include "MessageEncoder.hpp"
+#include "ServerMessages.hpp"
+#include <boost/json.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+
+namespace json = boost::json;
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+
+std::size_t g_sink = 0; // Keeps the encoded output observable
+
+void run(const std::string& label, long events, const std::function<std::size_t()>& encode) {
+    auto const allocations_before = g_allocations.load();
+    auto const start = BenchUtil::now_ns();
+    for (long i = 0; i < events; ++i) {
+        g_sink += encode();
+    }
+    auto const elapsed = static_cast<double>(BenchUtil::now_ns() - start);
+    auto const allocations = static_cast<double>(g_allocations.load() - allocations_before);
+    std::cout << std::fixed << std::setprecision(1) << label << " ns/event=" << elapsed / static_cast<double>(events)
+              << " allocs/event=" << allocations / static_cast<double>(events) << std::endl;
+}
+
+json::object message(const char* type, json::object payload) {
+    return json::object{{"type", type}, {"payload", std::move(payload)}};
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    auto const events = std::max(1L, BenchUtil::flag_int(argc, argv, "events", 200000));
+    auto const user_count = std::max(0L, BenchUtil::flag_int(argc, argv, "users", 50));
+
+    std::string const user_id = "sess_1f3a9c2e7b4d";
+    std::string const nickname = "User4821";
+    std::string const text = "Are we still meeting at noon? I'll bring the \"usual\" snacks.";
+    std::string const timestamp = "2024-05-17T12:34:56Z";
+    std::string const token = "6f1c0d9e2a7b48c3a5e1f0d2c4b6a8e9";
+    MessageEncoder::UserList users;
+    json::array users_json;
+    for (long i = 0; i < user_count; ++i) {
+        users.emplace_back("sess_" + std::to_string(100000 + i), "User" + std::to_string(i));
+        users_json.push_back(json::array{json::string(users.back().first), json::string(users.back().second)});
+    }
+
+    using namespace ServerMessages;
+    std::cout << "events=" << events << " users=" << user_count << std::endl;
+    run("broadcast_message   dom    ", events, [&] {
+        return json::serialize(message("server_broadcast_message", {{"user_id", user_id},
+                                                                    {"text", text},
+                                                                    {"timestamp", timestamp},
+                                                                    {"nickname", nickname}}))
+            .size();
+    });
+    run("broadcast_message   encode ", events, [&] {
+        return MessageEncoder::encode<broadcast_message>(user_id, text, timestamp, nickname).size();
+    });
+    run("client_connected    dom    ", events, [&] {
+        return json::serialize(message("server_client_connected", {{"user_id", user_id},
+                                                                   {"nickname", nickname},
+                                                                   {"message", "User has connected."},
+                                                                   {"timestamp", timestamp}}))
+            .size();
+    });
+    run("client_connected    encode ", events, [&] {
+        return MessageEncoder::encode<client_connected>(user_id, nickname, "User has connected.", timestamp).size();
+    });
+    run("nickname_changed    dom    ", events, [&] {
+        return json::serialize(message("server_user_nickname_changed", {{"user_id", user_id},
+                                                                        {"old_nickname", nickname},
+                                                                        {"new_nickname", "Renamed"},
+                                                                        {"timestamp", timestamp}}))
+            .size();
+    });
+    run("nickname_changed    encode ", events, [&] {
+        return MessageEncoder::encode<nickname_changed>(user_id, nickname, "Renamed", timestamp).size();
+    });
+    run("session_welcome     dom    ", events, [&] {
+        return json::serialize(message("server_session_welcome", {{"user_id", user_id},
+                                                                  {"nickname", nickname},
+                                                                  {"resume_token", token},
+                                                                  {"seq", std::uint64_t{123456}},
+                                                                  {"resume_grace_ms", 30000}}))
+            .size();
+    });
+    run("session_welcome     shared ", events, [&] {
+        return MessageEncoder::encode_shared<session_welcome>(user_id, nickname, token, std::uint64_t{123456}, 30000)
+            ->size();
+    });
+    run("roster_snapshot     dom    ", events / 10, [&] {
+        return json::serialize(message("server_roster_snapshot", {{"users", users_json}, {"timestamp", timestamp}}))
+            .size();
+    });
+    run("roster_snapshot     encode ", events / 10, [&] {
+        return MessageEncoder::encode<roster_snapshot>(users, timestamp).size();
+    });
+    std::cout << "(checksum " << g_sink << ")" << std::endl;
+    return 0;
+}
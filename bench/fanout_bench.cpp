@@ -0,0 +1,141 @@
+// fanout_bench.cpp
+// Measures how long ChatServer::broadcast takes to reach every recipient, for
+// the shared io_context and the per-thread I/O model. Sessions are real
+// Session objects without sockets; the bench counts a delivery when the
+// message reaches the session's write queue, so the numbers cover the
+// fan-out itself (posting, cross-thread wakeups, strand and queue work) and
+// not socket writes.
+//
+//   fanout_bench --threads=4 --recipients=1000,10000,100000
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include "IoContextPool.hpp"
+#include "Session.hpp"
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> g_remaining{0};
+std::atomic<std::int64_t> g_done_ns{0};
+
+// Drops each message as soon as it is queued and records when the last
+// recipient of the current broadcast got it.
+class BenchSession : public Session {
+public:
+    using Session::Session;
+
+protected:
+    void on_outbound_queued() override {
+        outbound_.clear();
+        if (g_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            g_done_ns.store(BenchUtil::now_ns(), std::memory_order_release);
+        }
+    }
+};
+
+struct Result {
+    std::vector<std::int64_t> complete_ns; // broadcast() call to last delivery
+    std::vector<std::int64_t> caller_ns;   // time spent inside broadcast()
+};
+
+// Registers `recipients` sessions created by `make_session`, then broadcasts
+// `rounds` times, waiting for each broadcast to reach everyone.
+template <typename MakeSession>
+Result run_rounds(ChatServer& server, std::size_t recipients, long rounds, MakeSession make_session) {
+    std::vector<std::shared_ptr<Session>> sessions;
+    sessions.reserve(recipients);
+    for (std::size_t i = 0; i < recipients; ++i) {
+        sessions.push_back(make_session());
+        server.on_client_connect(sessions.back());
+    }
+
+    std::string const message = "{\"type\":\"server_broadcast_message\",\"payload\":{\"text\":\"bench\"}}";
+    Result result;
+    for (long r = 0; r < rounds; ++r) {
+        g_remaining = recipients;
+        auto const start = BenchUtil::now_ns();
+        server.broadcast(message);
+        result.caller_ns.push_back(BenchUtil::now_ns() - start);
+        while (g_remaining.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        result.complete_ns.push_back(g_done_ns.load(std::memory_order_acquire) - start);
+    }
+
+    for (auto const& session : sessions) {
+        server.on_client_disconnect(session);
+    }
+    return result;
+}
+
+void report(const std::string& model, std::size_t recipients, Result& result) {
+    auto const ms = [](std::int64_t ns) { return static_cast<double>(ns) / 1e6; };
+    std::cerr << "io_model=" << model << " recipients=" << recipients << " rounds=" << result.complete_ns.size()
+              << " complete_p50_ms=" << ms(BenchUtil::percentile(result.complete_ns, 0.50))
+              << " complete_max_ms=" << ms(result.complete_ns.back())
+              << " caller_p50_ms=" << ms(BenchUtil::percentile(result.caller_ns, 0.50)) << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 4));
+    auto const models = BenchUtil::flag(argc, argv, "io-model", "shared,per-thread");
+    std::vector<std::size_t> sizes;
+    std::stringstream list(BenchUtil::flag(argc, argv, "recipients", "1000,10000,100000"));
+    for (std::string item; std::getline(list, item, ',');) {
+        sizes.push_back(static_cast<std::size_t>(std::atol(item.c_str())));
+    }
+
+    ServerOptions options;
+    options.num_threads = static_cast<int>(threads);
+    options.presence_tick_ms = 3600 * 1000; // Keep presence traffic out of the measurement
+    tcp::endpoint const endpoint{net::ip::make_address("127.0.0.1"), 0};
+
+    // Per-session logging would dominate the measurement.
+    std::cout.rdbuf(nullptr);
+
+    for (std::size_t recipients : sizes) {
+        // About two million deliveries per configuration, at least five rounds
+        long const rounds = std::max(5L, static_cast<long>(2000000 / std::max<std::size_t>(recipients, 1)));
+
+        if (models.find("shared") != std::string::npos) {
+            net::io_context ioc{static_cast<int>(threads)};
+            auto guard = net::make_work_guard(ioc);
+            std::vector<std::thread> io_threads;
+            for (long i = 0; i < threads; ++i) {
+                io_threads.emplace_back([&ioc] { ioc.run(); });
+            }
+            ChatServer server(ioc, endpoint, options);
+            auto result = run_rounds(server, recipients, rounds, [&] {
+                return std::make_shared<BenchSession>(ioc, tcp::socket(ioc), server);
+            });
+            report("shared", recipients, result);
+            guard.reset();
+            ioc.stop();
+            for (auto& t : io_threads) {
+                t.join();
+            }
+        }
+
+        if (models.find("per-thread") != std::string::npos) {
+            IoContextPool pool(static_cast<std::size_t>(threads));
+            options.io_model = ServerOptions::IoModel::per_thread;
+            ChatServer server(pool, endpoint, options);
+            std::thread pool_thread([&pool] { pool.run(); });
+            auto result = run_rounds(server, recipients, rounds, [&] {
+                net::io_context& context = pool.next();
+                return std::make_shared<BenchSession>(context, tcp::socket(context), server);
+            });
+            report("per-thread", recipients, result);
+            pool.stop();
+            pool_thread.join();
+        }
+    }
+    return 0;
+}
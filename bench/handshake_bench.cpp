@@ -0,0 +1,206 @@
+// handshake_bench.cpp
+// Accept capacity: runs ChatServer in-process and has --concurrency loopback
+// clients connect, complete the WebSocket upgrade and drop the connection,
+// over and over for --duration seconds. Reports completed handshakes per
+// second and the connect-to-upgrade latency seen by the clients.
+//
+//   handshake_bench --concurrency=64 --duration=10
+//   handshake_bench --concurrency=64 --duration=10 --io-model=per-thread --threads=4
+//
+// Dropped connections linger in TIME_WAIT on the client side; long runs may
+// need net.ipv4.tcp_tw_reuse=1 or several --source-addresses.
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include "IoContextPool.hpp"
+#include <boost/beast.hpp>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace websocket = beast::websocket;
+
+namespace {
+
+std::atomic<bool> g_running{true};
+std::atomic<std::uint64_t> g_handshakes{0};
+std::atomic<std::uint64_t> g_failures{0};
+std::string g_first_error;
+std::mutex g_latency_mutex;
+std::vector<std::int64_t> g_latencies_ns;
+
+// One client slot: connect, upgrade, drop, repeat.
+class HandshakeLoop : public std::enable_shared_from_this<HandshakeLoop> {
+public:
+    HandshakeLoop(net::io_context& ioc, tcp::endpoint server, const net::ip::address* source)
+        : ioc_(ioc), server_(server), source_(source) {}
+
+    void start() {
+        ws_.emplace(ioc_);
+        auto& socket = ws_->next_layer();
+        beast::error_code ec;
+        socket.open(server_.protocol(), ec);
+        if (!ec && source_) {
+            socket.bind(tcp::endpoint(*source_, 0), ec);
+        }
+        if (ec) {
+            return fail(ec);
+        }
+        started_ns_ = BenchUtil::now_ns();
+        socket.async_connect(server_, [self = shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                return self->fail(ec);
+            }
+            self->ws_->async_handshake("localhost", "/", [self](beast::error_code ec) {
+                if (ec) {
+                    return self->fail(ec);
+                }
+                auto const elapsed = BenchUtil::now_ns() - self->started_ns_;
+                ++g_handshakes;
+                {
+                    std::lock_guard<std::mutex> lock(g_latency_mutex);
+                    g_latencies_ns.push_back(elapsed);
+                }
+                self->next();
+            });
+        });
+    }
+
+private:
+    void fail(beast::error_code ec) {
+        if (g_failures++ == 0) {
+            std::lock_guard<std::mutex> lock(g_latency_mutex);
+            g_first_error = ec.message();
+        }
+        next();
+    }
+
+    void next() {
+        beast::error_code ignored;
+        ws_->next_layer().close(ignored);
+        if (g_running) {
+            start();
+        }
+    }
+
+    net::io_context& ioc_;
+    tcp::endpoint server_;
+    const net::ip::address* source_;
+    boost::optional<websocket::stream<tcp::socket>> ws_;
+    std::int64_t started_ns_ = 0;
+};
+
+std::vector<net::ip::address> parse_addresses(const std::string& list) {
+    std::vector<net::ip::address> out;
+    std::stringstream ss(list);
+    for (std::string item; std::getline(ss, item, ',');) {
+        if (!item.empty()) {
+            out.push_back(net::ip::make_address(item));
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const concurrency = std::max(1L, BenchUtil::flag_int(argc, argv, "concurrency", 64));
+    auto const duration_s = std::max(1L, BenchUtil::flag_int(argc, argv, "duration", 10));
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 1));
+    auto const client_threads = std::max(1L, BenchUtil::flag_int(argc, argv, "client-threads", 1));
+    auto const io_model = BenchUtil::flag(argc, argv, "io-model", "shared");
+    auto const sources = parse_addresses(BenchUtil::flag(argc, argv, "source-addresses", ""));
+
+    ServerOptions options;
+    options.num_threads = static_cast<int>(threads);
+    tcp::endpoint const endpoint{net::ip::make_address("127.0.0.1"), 0};
+
+    // Per-connection logging (including every dropped connection's read
+    // error) would dominate the measurement.
+    std::streambuf* const console = std::cerr.rdbuf();
+    std::ostream report(console);
+    std::cout.rdbuf(nullptr);
+    std::cerr.rdbuf(nullptr);
+
+    std::unique_ptr<net::io_context> shared_ioc;
+    std::unique_ptr<IoContextPool> pool;
+    std::unique_ptr<ChatServer> server;
+    std::vector<std::thread> server_threads;
+    if (io_model == "per-thread") {
+        options.io_model = ServerOptions::IoModel::per_thread;
+        pool = std::make_unique<IoContextPool>(static_cast<std::size_t>(threads));
+        server = std::make_unique<ChatServer>(*pool, endpoint, options);
+        server->run();
+        server_threads.emplace_back([&pool] { pool->run(); });
+    } else {
+        shared_ioc = std::make_unique<net::io_context>(static_cast<int>(threads));
+        server = std::make_unique<ChatServer>(*shared_ioc, endpoint, options);
+        server->run();
+        for (long i = 0; i < threads; ++i) {
+            server_threads.emplace_back([&shared_ioc] { shared_ioc->run(); });
+        }
+    }
+    tcp::endpoint const server_endpoint{net::ip::make_address("127.0.0.1"), server->local_endpoint().port()};
+
+    net::io_context client_ioc{static_cast<int>(client_threads)};
+    auto client_guard = net::make_work_guard(client_ioc);
+    std::vector<std::shared_ptr<HandshakeLoop>> loops;
+    for (long i = 0; i < concurrency; ++i) {
+        auto const* source = sources.empty() ? nullptr : &sources[static_cast<std::size_t>(i) % sources.size()];
+        loops.push_back(std::make_shared<HandshakeLoop>(client_ioc, server_endpoint, source));
+    }
+    std::vector<std::thread> client_pool;
+    for (long i = 0; i < client_threads; ++i) {
+        client_pool.emplace_back([&client_ioc] { client_ioc.run(); });
+    }
+
+    // One second of warm-up before counting.
+    net::post(client_ioc, [&loops] {
+        for (auto& loop : loops) {
+            loop->start();
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    auto const start_handshakes = g_handshakes.load();
+    {
+        std::lock_guard<std::mutex> lock(g_latency_mutex);
+        g_latencies_ns.clear();
+    }
+    auto const start_ns = BenchUtil::now_ns();
+    std::this_thread::sleep_for(std::chrono::seconds(duration_s));
+    auto const handshakes = g_handshakes.load() - start_handshakes;
+    double const elapsed_s = static_cast<double>(BenchUtil::now_ns() - start_ns) / 1e9;
+    g_running = false;
+
+    std::vector<std::int64_t> latencies;
+    {
+        std::lock_guard<std::mutex> lock(g_latency_mutex);
+        latencies.swap(g_latencies_ns);
+    }
+    client_guard.reset();
+    client_ioc.stop();
+    for (auto& t : client_pool) {
+        t.join();
+    }
+    if (pool) {
+        pool->stop();
+    } else {
+        shared_ioc->stop();
+    }
+    for (auto& t : server_threads) {
+        t.join();
+    }
+
+    report << "io_model=" << io_model << " threads=" << threads << " concurrency=" << concurrency
+           << " handshakes=" << handshakes << " failures=" << g_failures.load()
+           << " handshakes_per_s=" << static_cast<double>(handshakes) / elapsed_s << std::endl;
+    if (g_failures.load() != 0) {
+        report << "first failure: " << g_first_error << std::endl;
+    }
+    std::cout.rdbuf(console); // The server is stopped, nothing else logs now
+    BenchUtil::print_latency_us("handshake", latencies);
+    return 0;
+}
@@ -0,0 +1,177 @@
+// history_query_bench.cpp
+// History query latency (HistoryStore) over a large retained history. Fills
+// a store with --messages synthetic chat messages from --users authors, with
+// words drawn from a Zipf-like distribution over --vocabulary words, then
+// times each kind of query: by author, by common and rare words, both, a
+// time range, and paging through results. The author and rare-word queries
+// are also timed as an unindexed scan of the same history, for comparison.
+//
+//   history_query_bench --messages=10000000 --users=10000 --vocabulary=50000
+//
+// Ten million messages take a couple of GB of memory; pass fewer on smaller
+// machines.
+#include "BenchUtil.hpp"
+#include "HistoryStore.hpp"
+#include "Utils.hpp"
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::int64_t kStartTime = 1700000000;
+constexpr int kMessagesPerSecond = 100;
+
+// Pronounceable made-up words, so lengths and tokenizing resemble chat
+std::string make_word(std::size_t rank) {
+    static const char* const kSyllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo",
+                                             "ba", "de", "fu", "go", "hi", "jo", "pe", "zu"};
+    std::string word;
+    do {
+        word += kSyllables[rank % 16];
+        rank /= 16;
+    } while (rank > 0);
+    return word;
+}
+
+struct Workload {
+    std::vector<std::string> words; // By rank
+    std::vector<double> cdf;        // Zipf s=1 over the ranks
+
+    std::size_t draw(std::mt19937_64& rng) const {
+        double const u = std::uniform_real_distribution<double>(0.0, cdf.back())(rng);
+        return static_cast<std::size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+    }
+};
+
+void time_queries(const std::string& label, const HistoryStore& store, int repeat,
+                  const std::function<HistoryQuery(std::mt19937_64&)>& make) {
+    std::mt19937_64 rng(42);
+    std::vector<std::int64_t> samples;
+    std::size_t results = 0;
+    for (int i = 0; i < repeat; ++i) {
+        auto const query = make(rng);
+        auto const start = BenchUtil::now_ns();
+        results += store.query(query).size();
+        samples.push_back(BenchUtil::now_ns() - start);
+    }
+    BenchUtil::print_latency_us(label + " (avg " + std::to_string(results / std::max(repeat, 1)) + " results)",
+                                samples);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const messages = BenchUtil::flag_int(argc, argv, "messages", 10000000);
+    auto const users = std::max(1L, BenchUtil::flag_int(argc, argv, "users", 10000));
+    auto const vocabulary = std::max(16L, BenchUtil::flag_int(argc, argv, "vocabulary", 50000));
+    int const repeat = static_cast<int>(BenchUtil::flag_int(argc, argv, "queries", 200));
+    int const scan_repeat = static_cast<int>(BenchUtil::flag_int(argc, argv, "scan-queries", 3));
+
+    Workload workload;
+    double total = 0;
+    for (long rank = 0; rank < vocabulary; ++rank) {
+        workload.words.push_back(make_word(static_cast<std::size_t>(rank)));
+        total += 1.0 / static_cast<double>(rank + 1);
+        workload.cdf.push_back(total);
+    }
+
+    auto const rss_before = Utils::residentSetBytes();
+    HistoryStore store(static_cast<std::size_t>(messages));
+    std::mt19937_64 rng(1);
+    std::string text;
+    auto const build_start = BenchUtil::now_ns();
+    for (long seq = 1; seq <= messages; ++seq) {
+        text.clear();
+        for (int w = 4 + static_cast<int>(rng() % 12); w > 0; --w) {
+            text += workload.words[workload.draw(rng)];
+            text += ' ';
+        }
+        auto const user = rng() % static_cast<std::uint64_t>(users);
+        store.append(static_cast<std::uint64_t>(seq), kStartTime + seq / kMessagesPerSecond,
+                     "sess_" + std::to_string(user), "User" + std::to_string(user), text);
+    }
+    auto const build_ns = BenchUtil::now_ns() - build_start;
+    auto const stats = store.stats();
+    std::cout << std::fixed;
+    std::cout << "messages=" << stats.messages << " segments=" << stats.segments
+              << " build=" << std::setprecision(0) << static_cast<double>(messages) * 1e9 / static_cast<double>(build_ns)
+              << " msg/s text=" << stats.text_bytes / (1 << 20) << "MiB index=" << stats.index_bytes / (1 << 20)
+              << "MiB rss_growth=" << (Utils::residentSetBytes() - rss_before) / (1 << 20) << "MiB" << std::endl;
+
+    std::int64_t const end_time = kStartTime + messages / kMessagesPerSecond;
+    auto const any_user = [&](std::mt19937_64& r) { return "sess_" + std::to_string(r() % users); };
+    auto const common_word = [&](std::mt19937_64& r) { return workload.words[r() % 10]; };
+    auto const rare_word = [&](std::mt19937_64& r) {
+        return workload.words[static_cast<std::size_t>(vocabulary / 2 + static_cast<long>(r() % (vocabulary / 4)))];
+    };
+
+    auto const by_user = [&](std::mt19937_64& r) {
+        HistoryQuery q;
+        q.user_id = any_user(r);
+        return q;
+    };
+    auto const by_rare_word = [&](std::mt19937_64& r) {
+        HistoryQuery q;
+        q.text = rare_word(r);
+        return q;
+    };
+    time_queries("user                 ", store, repeat, by_user);
+    time_queries("common word          ", store, repeat, [&](std::mt19937_64& r) {
+        HistoryQuery q;
+        q.text = common_word(r);
+        return q;
+    });
+    time_queries("rare word            ", store, repeat, by_rare_word);
+    time_queries("user + common word   ", store, repeat, [&](std::mt19937_64& r) {
+        HistoryQuery q;
+        q.user_id = any_user(r);
+        q.text = common_word(r);
+        return q;
+    });
+    time_queries("two rare words       ", store, repeat, [&](std::mt19937_64& r) {
+        HistoryQuery q;
+        q.text = rare_word(r) + " " + rare_word(r);
+        return q;
+    });
+    time_queries("common word, last 1h ", store, repeat, [&](std::mt19937_64& r) {
+        HistoryQuery q;
+        q.text = common_word(r);
+        q.since = end_time - 3600;
+        return q;
+    });
+    time_queries("rare word, day-old 1h", store, repeat, [&](std::mt19937_64& r) {
+        HistoryQuery q;
+        q.text = rare_word(r);
+        q.since = end_time - 86400;
+        q.until = q.since + 3600;
+        return q;
+    });
+    time_queries("10th page of a word  ", store, repeat, [&](std::mt19937_64& r) {
+        // Pages 1..9 set the cursor; page 10 is timed with it
+        HistoryQuery q;
+        q.text = workload.words[100 + r() % 100];
+        for (int page = 1; page < 10; ++page) {
+            auto const results = store.query(q);
+            if (results.size() < q.limit) {
+                break;
+            }
+            q.before_seq = results.back().seq;
+        }
+        return q;
+    });
+
+    auto const unindexed = [](std::function<HistoryQuery(std::mt19937_64&)> make) {
+        return [make](std::mt19937_64& r) {
+            auto q = make(r);
+            q.indexed = false;
+            return q;
+        };
+    };
+    time_queries("user (scan)          ", store, scan_repeat, unindexed(by_user));
+    time_queries("rare word (scan)     ", store, scan_repeat, unindexed(by_rare_word));
+    return 0;
+}
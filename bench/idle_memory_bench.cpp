@@ -0,0 +1,181 @@
+// idle_memory_bench.cpp
+// Memory footprint of idle connections. Runs ChatServer in this process and
+// forks a child that opens --clients WebSocket connections to it, has each
+// send one --message-bytes frame (so buffers have grown once, as on a real
+// fleet), then leaves them all idle. Reports the server's resident memory per
+// idle connection and what its sessions still hold in read buffers.
+//
+//   idle_memory_bench --clients=10000 --message-bytes=16384 --low-memory=off
+//   idle_memory_bench --clients=10000 --message-bytes=16384 --low-memory=on
+//
+// Server and clients live in different processes, so each needs
+// `ulimit -n` above --clients. Run one mode per invocation: memory freed by
+// an earlier run would otherwise be reused by the next.
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include "ReadBufferPool.hpp"
+#include "Utils.hpp"
+#include <boost/beast.hpp>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace websocket = beast::websocket;
+
+namespace {
+
+// Connects, sends one frame and then only keeps the connection open.
+class IdleClient : public std::enable_shared_from_this<IdleClient> {
+public:
+    IdleClient(net::io_context& ioc, const std::string& message, std::atomic<long>& ready)
+        : ws_(ioc), message_(message), ready_(ready) {}
+
+    void start(const tcp::endpoint& endpoint) {
+        ws_.next_layer().async_connect(endpoint, [self = shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                std::cerr << "connect: " << ec.message() << std::endl;
+                return;
+            }
+            self->ws_.async_handshake("localhost", "/", [self](beast::error_code ec) {
+                if (ec) {
+                    std::cerr << "handshake: " << ec.message() << std::endl;
+                    return;
+                }
+                if (self->message_.empty()) {
+                    ++self->ready_;
+                    return;
+                }
+                self->ws_.async_write(net::buffer(self->message_), [self](beast::error_code, std::size_t) {
+                    ++self->ready_;
+                });
+            });
+        });
+    }
+
+private:
+    websocket::stream<tcp::socket> ws_;
+    const std::string& message_;
+    std::atomic<long>& ready_;
+};
+
+// Child process: connects everyone, reports on `done_fd` and idles until the
+// parent closes `hold_fd`.
+int run_clients(unsigned short port, long clients, std::size_t message_bytes, int done_fd, int hold_fd) {
+    // A type the server ignores after parsing, so nothing is broadcast
+    std::string message;
+    if (message_bytes > 0) {
+        message = "{\"type\":\"client_idle_bench\",\"pad\":\"";
+        message.append(message_bytes > message.size() + 2 ? message_bytes - message.size() - 2 : 0, 'x');
+        message += "\"}";
+    }
+
+    net::io_context ioc{1};
+    std::atomic<long> ready{0};
+    tcp::endpoint const endpoint{net::ip::make_address("127.0.0.1"), port};
+    std::vector<std::shared_ptr<IdleClient>> all;
+    all.reserve(static_cast<std::size_t>(clients));
+    for (long i = 0; i < clients; ++i) {
+        all.push_back(std::make_shared<IdleClient>(ioc, message, ready));
+        all.back()->start(endpoint);
+    }
+    auto guard = net::make_work_guard(ioc);
+    std::thread io([&ioc] { ioc.run(); });
+    while (ready.load() < clients) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    char const done = 1;
+    if (write(done_fd, &done, 1) != 1) {
+        return 1;
+    }
+    char byte;
+    while (read(hold_fd, &byte, 1) > 0) {
+    }
+    _exit(0); // Skip the orderly teardown of every connection
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const clients = BenchUtil::flag_int(argc, argv, "clients", 10000);
+    auto const message_bytes = static_cast<std::size_t>(BenchUtil::flag_int(argc, argv, "message-bytes", 16384));
+    auto const low_memory = BenchUtil::flag(argc, argv, "low-memory", "on") == "on";
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 1));
+
+    ServerOptions options;
+    options.num_threads = static_cast<int>(threads);
+    options.low_memory = low_memory;
+    options.presence_tick_ms = 3600 * 1000; // Keep presence traffic out of the measurement
+
+    // Per-connection logging would dominate the measurement; the bench frame
+    // type is also reported as unknown once per client.
+    std::ostream report(std::cerr.rdbuf());
+    std::cout.rdbuf(nullptr);
+
+    net::io_context server_ioc{static_cast<int>(threads)};
+    ChatServer server(server_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    server.run();
+    auto const port = server.local_endpoint().port();
+
+    // Fork before any thread exists
+    int done_pipe[2];
+    int hold_pipe[2];
+    if (pipe(done_pipe) != 0 || pipe(hold_pipe) != 0) {
+        std::cerr << "pipe failed" << std::endl;
+        return 1;
+    }
+    pid_t const child = fork();
+    if (child == 0) {
+        close(done_pipe[0]);
+        close(hold_pipe[1]);
+        return run_clients(port, clients, message_bytes, done_pipe[1], hold_pipe[0]);
+    }
+    close(done_pipe[1]);
+    close(hold_pipe[0]);
+    std::cerr.rdbuf(nullptr);
+
+    auto guard = net::make_work_guard(server_ioc);
+    std::vector<std::thread> io_threads;
+    for (long i = 0; i < threads; ++i) {
+        io_threads.emplace_back([&server_ioc] { server_ioc.run(); });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto const rss_before = Utils::residentSetBytes();
+
+    char done = 0;
+    if (read(done_pipe[0], &done, 1) != 1) {
+        report << "client process failed" << std::endl;
+        return 1;
+    }
+    // Let the server finish reading the last frames
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+#if defined(__GLIBC__)
+    // Count what the sessions hold, not freed pages glibc keeps around
+    malloc_trim(0);
+#endif
+    auto const rss_after = Utils::residentSetBytes();
+    auto const buffers = ReadBufferPool::stats();
+
+    report << "low_memory=" << (low_memory ? "on" : "off") << " clients=" << clients
+           << " message_bytes=" << message_bytes
+           << " rss_delta_mb=" << static_cast<double>(rss_after - rss_before) / (1024.0 * 1024.0)
+           << " bytes_per_idle_connection=" << (rss_after - rss_before) / std::max(1L, clients)
+           << " read_buffers_held=" << buffers.held_buffers
+           << " read_buffer_bytes_held=" << buffers.held_bytes
+           << " read_buffers_pooled=" << buffers.pooled_buffers << std::endl;
+
+    close(hold_pipe[1]);
+    waitpid(child, nullptr, 0);
+    guard.reset();
+    server_ioc.stop();
+    for (auto& t : io_threads) {
+        t.join();
+    }
+    return 0;
+}
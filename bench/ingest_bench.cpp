@@ -0,0 +1,146 @@
+// ingest_bench.cpp
+// Ingest throughput for inbound chat frames: the old path (UTF-8 check, then
+// json::parse and a lookup of type and text) against MessageSniffer::sniff
+// with each vector unit the CPU has. Frames are realistic client messages:
+// short and long ASCII chat, non-Latin text with emoji, text with escapes,
+// and a non-chat message for reference.
+//
+//   ingest_bench --frames=2000 --rounds=200
+#include "BenchUtil.hpp"
+#include "MessageSniffer.hpp"
+#include <boost/beast/websocket/detail/utf8_checker.hpp>
+#include <boost/json.hpp>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace json = boost::json;
+
+namespace {
+
+std::string chat_frame(const std::string& text) {
+    return R"({"type":"client_send_message","payload":{"text":")" + text + R"("}})";
+}
+
+std::string words(std::mt19937& rng, std::size_t bytes, const std::vector<std::string>& vocabulary) {
+    std::string out;
+    while (out.size() < bytes) {
+        out += vocabulary[rng() % vocabulary.size()];
+        out += ' ';
+    }
+    return out;
+}
+
+struct Corpus {
+    std::string name;
+    std::vector<std::string> frames;
+    std::size_t bytes = 0;
+};
+
+Corpus make_corpus(const std::string& name, std::size_t count, const std::function<std::string(std::mt19937&)>& make) {
+    Corpus corpus{name, {}, 0};
+    std::mt19937 rng(11);
+    for (std::size_t i = 0; i < count; ++i) {
+        corpus.frames.push_back(make(rng));
+        corpus.bytes += corpus.frames.back().size();
+    }
+    return corpus;
+}
+
+// The handle_message path before the sniffer; Beast checked UTF-8 on read
+std::size_t parse_path(const std::string& frame) {
+    if (!boost::beast::websocket::detail::check_utf8(frame.data(), frame.size())) {
+        return 0;
+    }
+    boost::system::error_code ec;
+    auto const value = json::parse(frame, ec);
+    if (ec || !value.is_object()) {
+        return 0;
+    }
+    auto const& message = value.as_object();
+    auto const* type = message.if_contains("type");
+    if (!type || !type->is_string() || type->as_string() != "client_send_message") {
+        return 1;
+    }
+    auto const* text = message.at("payload").as_object().if_contains("text");
+    return std::string(text->as_string().data(), text->as_string().size()).size();
+}
+
+std::size_t sniff_path(const std::string& frame, std::string& text) {
+    MessageSniffer::Message message;
+    if (MessageSniffer::sniff(frame, message) != MessageSniffer::Result::ok) {
+        return 0;
+    }
+    if (message.type.raw != "client_send_message") {
+        return 1; // Parsed in full in the server
+    }
+    auto const* value = message.member("text");
+    text.assign(value->raw);
+    if (value->escaped) {
+        MessageSniffer::unescape(value->raw, text);
+    }
+    return text.size();
+}
+
+template <typename Ingest>
+void run(const std::string& label, const Corpus& corpus, int rounds, Ingest&& ingest) {
+    std::size_t checksum = 0;
+    auto const start = BenchUtil::now_ns();
+    for (int round = 0; round < rounds; ++round) {
+        for (auto const& frame : corpus.frames) {
+            checksum += ingest(frame);
+        }
+    }
+    auto const elapsed = static_cast<double>(BenchUtil::now_ns() - start);
+    double const frames = static_cast<double>(corpus.frames.size()) * rounds;
+    std::cout << std::fixed << std::setprecision(1) << corpus.name << " " << label
+              << " MB/s=" << static_cast<double>(corpus.bytes) * rounds * 1e3 / elapsed
+              << " ns/frame=" << elapsed / frames << " (checksum " << checksum << ")" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const count = static_cast<std::size_t>(std::max(1L, BenchUtil::flag_int(argc, argv, "frames", 2000)));
+    int const rounds = static_cast<int>(std::max(1L, BenchUtil::flag_int(argc, argv, "rounds", 200)));
+
+    std::vector<std::string> const latin = {"hello", "the", "meeting", "is", "at", "noon", "ok", "thanks",
+                                            "see", "you", "there", "lol", "sounds", "good", "what", "about"};
+    std::vector<std::string> const unicode = {"こんにちは", "会議", "は", "正午", "です", "😀", "👍",
+                                              "привет", "спасибо", "café", "naïve", "🎉"};
+    std::vector<Corpus> const corpora = {
+        make_corpus("short  ", count, [&](std::mt19937& rng) { return chat_frame(words(rng, 40, latin)); }),
+        make_corpus("long   ", count, [&](std::mt19937& rng) { return chat_frame(words(rng, 2000, latin)); }),
+        make_corpus("unicode", count, [&](std::mt19937& rng) { return chat_frame(words(rng, 200, unicode)); }),
+        make_corpus("escaped", count,
+                    [&](std::mt19937& rng) {
+                        return chat_frame(words(rng, 100, latin) + R"(\"quoted\"\nline \u00e9 )" +
+                                          words(rng, 100, latin));
+                    }),
+        make_corpus("nick   ", count,
+                    [&](std::mt19937& rng) {
+                        return R"({"type":"client_set_nickname","payload":{"nickname":"User)" +
+                               std::to_string(rng() % 10000) + R"("}})";
+                    }),
+    };
+
+    std::cout << "frames=" << count << " rounds=" << rounds
+              << " best_isa=" << MessageSniffer::isa_name(MessageSniffer::best_isa()) << std::endl;
+    std::string text;
+    for (auto const& corpus : corpora) {
+        run("parse       ", corpus, rounds, parse_path);
+        for (auto const isa : {MessageSniffer::Isa::scalar, MessageSniffer::Isa::sse2, MessageSniffer::Isa::avx2}) {
+            if (static_cast<int>(isa) > static_cast<int>(MessageSniffer::best_isa())) {
+                continue;
+            }
+            MessageSniffer::use_isa(isa);
+            std::string label = std::string("sniff/") + MessageSniffer::isa_name(isa);
+            label.resize(12, ' ');
+            run(label, corpus, rounds, [&](const std::string& frame) { return sniff_path(frame, text); });
+        }
+        MessageSniffer::use_isa(MessageSniffer::best_isa());
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+// presence_storm_bench.cpp
+// Loopback reconnect storm: runs ChatServer in-process, connects --clients
+// WebSocket clients, then drops every connection at once and reconnects them
+// all, the way a network blip does. Reports how many frames and bytes the
+// server pushed to clients during the storm, for the chosen presence mode.
+//
+//   presence_storm_bench --clients=2000 --presence-tick-ms=200   (coalesced)
+//   presence_storm_bench --clients=2000 --presence-tick-ms=0     (per-event)
+//
+// Each client needs two file descriptors (both ends of the loopback
+// connection), so large runs need `ulimit -n` above twice --clients.
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include <boost/beast.hpp>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace websocket = beast::websocket;
+
+namespace {
+
+std::atomic<std::uint64_t> g_frames{0};
+std::atomic<std::uint64_t> g_bytes{0};
+std::atomic<long> g_handshakes{0};
+
+// Connects, then counts every inbound frame until the connection drops.
+class StormClient : public std::enable_shared_from_this<StormClient> {
+public:
+    explicit StormClient(net::io_context& ioc) : ws_(ioc) {}
+
+    void start(const tcp::endpoint& endpoint) {
+        ws_.next_layer().async_connect(endpoint, [self = shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                std::cerr << "connect: " << ec.message() << std::endl;
+                return;
+            }
+            self->ws_.async_handshake("localhost", "/", [self](beast::error_code ec) {
+                if (ec) {
+                    std::cerr << "handshake: " << ec.message() << std::endl;
+                    return;
+                }
+                ++g_handshakes;
+                self->do_read();
+            });
+        });
+    }
+
+    // Drops the TCP connection without a close handshake.
+    void drop() {
+        beast::error_code ec;
+        ws_.next_layer().close(ec);
+    }
+
+private:
+    void do_read() {
+        ws_.async_read(buffer_, [self = shared_from_this()](beast::error_code ec, std::size_t bytes) {
+            if (ec) {
+                return;
+            }
+            ++g_frames;
+            g_bytes += bytes;
+            self->buffer_.consume(self->buffer_.size());
+            self->do_read();
+        });
+    }
+
+    websocket::stream<tcp::socket> ws_;
+    beast::flat_buffer buffer_;
+};
+
+// Waits until every client is connected and no frame has arrived for `quiet`.
+void wait_until_settled(long handshakes, std::chrono::milliseconds quiet) {
+    auto last_frames = g_frames.load();
+    auto last_change = std::chrono::steady_clock::now();
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto const frames = g_frames.load();
+        auto const now = std::chrono::steady_clock::now();
+        if (frames != last_frames) {
+            last_frames = frames;
+            last_change = now;
+        } else if (g_handshakes >= handshakes && now - last_change >= quiet) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const clients = BenchUtil::flag_int(argc, argv, "clients", 2000);
+    auto const tick_ms = BenchUtil::flag_int(argc, argv, "presence-tick-ms", 200);
+    auto const port = static_cast<unsigned short>(BenchUtil::flag_int(argc, argv, "port", 18091));
+
+    ServerOptions options;
+    options.port = port;
+    options.presence_tick_ms = static_cast<int>(std::max(tick_ms, 0L));
+
+    // Per-connection logging would dominate the measurement.
+    std::cout.rdbuf(nullptr);
+
+    net::io_context server_ioc{1};
+    tcp::endpoint const endpoint{net::ip::make_address("127.0.0.1"), port};
+    ChatServer server(server_ioc, endpoint, options);
+    server.run();
+    std::thread server_thread([&server_ioc] { server_ioc.run(); });
+
+    net::io_context client_ioc{1};
+    auto client_guard = net::make_work_guard(client_ioc);
+    std::thread client_thread([&client_ioc] { client_ioc.run(); });
+
+    auto connect_all = [&] {
+        std::vector<std::shared_ptr<StormClient>> out;
+        for (long i = 0; i < clients; ++i) {
+            out.push_back(std::make_shared<StormClient>(client_ioc));
+        }
+        net::post(client_ioc, [&out, endpoint] {
+            for (auto& c : out) {
+                c->start(endpoint);
+            }
+        });
+        return out;
+    };
+    auto const quiet = std::chrono::milliseconds(std::max(500L, 3 * tick_ms));
+
+    auto first = connect_all();
+    wait_until_settled(clients, quiet);
+
+    g_frames = 0;
+    g_bytes = 0;
+    auto const start_ns = BenchUtil::now_ns();
+    net::post(client_ioc, [&first] {
+        for (auto& c : first) {
+            c->drop();
+        }
+    });
+    auto second = connect_all();
+    wait_until_settled(2 * clients, quiet);
+    auto const elapsed_s = static_cast<double>(BenchUtil::now_ns() - start_ns) / 1e9
+                           - static_cast<double>(quiet.count()) / 1e3;
+
+    auto const frames = g_frames.load();
+    auto const bytes = g_bytes.load();
+    std::cerr << "presence_tick_ms=" << options.presence_tick_ms << " clients=" << clients
+              << " storm_frames=" << frames << " storm_bytes=" << bytes
+              << " frames_per_client=" << static_cast<double>(frames) / static_cast<double>(clients)
+              << " settle_s=" << elapsed_s << std::endl;
+
+    net::post(client_ioc, [&second] {
+        for (auto& c : second) {
+            c->drop();
+        }
+    });
+    client_guard.reset();
+    client_thread.join();
+    server_ioc.stop();
+    server_thread.join();
+    return 0;
+}
@@ -0,0 +1,234 @@
+// publish_bench.cpp
+// Runs ChatServer in-process and measures how fast backends can inject
+// messages, with --readers WebSocket clients receiving every one:
+//   http:      --publishers threads each POST --batches batches of
+//              --batch-size messages to /publish (--format=ndjson|array),
+//              a connection per request as the server closes it.
+//   websocket: the same messages, sent one client_send_message at a time
+//              over one WebSocket per publisher, as backends do without
+//              the endpoint.
+// Reports messages ingested per second (for http, until the last batch was
+// acknowledged) and delivered per second (until every reader saw every
+// message).
+//
+//   publish_bench --readers=10 --publishers=4 --batches=200 --batch-size=100
+//   publish_bench --mode=http --format=array ...   (or websocket; both by default)
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include <boost/beast.hpp>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+
+namespace {
+
+const char* const kToken = "publish-bench";
+
+struct Config {
+    long readers;
+    long publishers;
+    long batches;
+    long batch_size;
+    std::string format;
+};
+
+// Counts frames carrying `marker` until `expected` have been read
+void read_messages(websocket::stream<tcp::socket>& ws, const std::string& marker, long expected) {
+    beast::flat_buffer buffer;
+    long seen = 0;
+    while (seen < expected) {
+        ws.read(buffer);
+        auto const data = buffer.data();
+        beast::string_view text(static_cast<const char*>(data.data()), data.size());
+        if (text.find(marker) != beast::string_view::npos) {
+            ++seen;
+        }
+        buffer.consume(buffer.size());
+    }
+}
+
+std::unique_ptr<websocket::stream<tcp::socket>> connect(net::io_context& ioc, ChatServer& server) {
+    auto ws = std::make_unique<websocket::stream<tcp::socket>>(ioc);
+    ws->next_layer().connect(server.local_endpoint());
+    ws->next_layer().set_option(tcp::no_delay(true));
+    ws->handshake("localhost", "/");
+    return ws;
+}
+
+std::string batch_body(const Config& config, long publisher) {
+    std::string body = config.format == "array" ? "[" : "";
+    for (long m = 0; m < config.batch_size; ++m) {
+        auto const item = "{\"text\":\"bulk-http " + std::to_string(publisher) + "\",\"user_id\":\"backend-"
+                          + std::to_string(publisher) + "\"}";
+        if (config.format == "array") {
+            body += (m ? "," : "") + item;
+        } else {
+            body += item + "\n";
+        }
+    }
+    return config.format == "array" ? body + "]" : body;
+}
+
+void report(const char* mode, long messages, long recipients, std::int64_t start_ns, std::int64_t ingested_ns,
+            std::int64_t delivered_ns) {
+    auto const ingest_s = static_cast<double>(ingested_ns - start_ns) / 1e9;
+    auto const deliver_s = static_cast<double>(delivered_ns - start_ns) / 1e9;
+    std::cerr << mode << " ingested_per_s=" << static_cast<double>(messages) / ingest_s
+              << " delivered_per_s=" << static_cast<double>(messages) / deliver_s
+              << " deliveries_per_s=" << static_cast<double>(messages * recipients) / deliver_s
+              << " elapsed_s=" << deliver_s << std::endl;
+}
+
+void run_http(ChatServer& server, const Config& config) {
+    long const expected = config.publishers * config.batches * config.batch_size;
+    net::io_context client_ioc;
+    std::vector<std::unique_ptr<websocket::stream<tcp::socket>>> readers;
+    for (long r = 0; r < config.readers; ++r) {
+        readers.push_back(connect(client_ioc, server));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300)); // Presence traffic settles
+
+    std::vector<std::thread> reading;
+    for (auto& reader : readers) {
+        reading.emplace_back([&reader, expected] { read_messages(*reader, "bulk-http", expected); });
+    }
+    std::atomic<long> failed{0};
+    std::vector<std::thread> publishing;
+    auto const start = BenchUtil::now_ns();
+    for (long p = 0; p < config.publishers; ++p) {
+        publishing.emplace_back([&, p] {
+            net::io_context ioc;
+            http::request<http::string_body> req{http::verb::post, "/publish", 11};
+            req.set(http::field::host, "localhost");
+            req.set(http::field::authorization, std::string("Bearer ") + kToken);
+            req.set(http::field::content_type, config.format == "array" ? "application/json" : "application/x-ndjson");
+            req.body() = batch_body(config, p);
+            req.prepare_payload();
+            for (long b = 0; b < config.batches; ++b) {
+                tcp::socket socket(ioc);
+                socket.connect(server.local_endpoint());
+                socket.set_option(tcp::no_delay(true));
+                http::write(socket, req);
+                beast::flat_buffer buffer;
+                http::response<http::string_body> res;
+                http::read(socket, buffer, res);
+                if (res.result() != http::status::ok
+                    || res.body().find("\"rejected\":0") == std::string::npos) {
+                    ++failed;
+                }
+            }
+        });
+    }
+    for (auto& t : publishing) {
+        t.join();
+    }
+    auto const ingested = BenchUtil::now_ns();
+    if (failed) {
+        std::cerr << "http: " << failed << " batches failed" << std::endl;
+    }
+    for (auto& t : reading) {
+        t.join();
+    }
+    report("http", expected, config.readers, start, ingested, BenchUtil::now_ns());
+
+    for (auto& reader : readers) {
+        beast::error_code ec;
+        reader->close(websocket::close_code::normal, ec);
+    }
+}
+
+void run_websocket(ChatServer& server, const Config& config) {
+    long const expected = config.publishers * config.batches * config.batch_size;
+    net::io_context client_ioc;
+    std::vector<std::unique_ptr<websocket::stream<tcp::socket>>> clients;
+    for (long c = 0; c < config.readers + config.publishers; ++c) {
+        clients.push_back(connect(client_ioc, server));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    // Publishers read along too: they are sent every message as well
+    std::vector<std::thread> threads;
+    std::atomic<long> written{0};
+    std::atomic<std::int64_t> ingested{0};
+    auto const start = BenchUtil::now_ns();
+    for (long c = 0; c < static_cast<long>(clients.size()); ++c) {
+        threads.emplace_back([&, c] {
+            std::thread writer;
+            if (c >= config.readers) {
+                writer = std::thread([&, c] {
+                    auto const message = "{\"type\":\"client_send_message\",\"payload\":{\"text\":\"bulk-ws "
+                                         + std::to_string(c) + "\"}}";
+                    for (long m = 0; m < config.batches * config.batch_size; ++m) {
+                        clients[c]->write(net::buffer(message));
+                    }
+                    if (written.fetch_add(1) + 1 == config.publishers) {
+                        ingested = BenchUtil::now_ns(); // Written, not acknowledged
+                    }
+                });
+            }
+            read_messages(*clients[c], "bulk-ws", expected);
+            if (writer.joinable()) {
+                writer.join();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    report("websocket", expected, static_cast<long>(clients.size()), start, ingested, BenchUtil::now_ns());
+
+    for (auto& client : clients) {
+        beast::error_code ec;
+        client->close(websocket::close_code::normal, ec);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const mode = BenchUtil::flag(argc, argv, "mode", "both");
+    Config config;
+    config.readers = std::max(1L, BenchUtil::flag_int(argc, argv, "readers", 10));
+    config.publishers = std::max(1L, BenchUtil::flag_int(argc, argv, "publishers", 4));
+    config.batches = std::max(1L, BenchUtil::flag_int(argc, argv, "batches", 200));
+    config.batch_size = std::max(1L, BenchUtil::flag_int(argc, argv, "batch-size", 100));
+    config.format = BenchUtil::flag(argc, argv, "format", "ndjson");
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 1));
+
+    ServerOptions options;
+    options.num_threads = static_cast<int>(threads);
+    options.publish_token = kToken;
+    options.history_retain = 0; // Measure ingestion and fan-out, not history indexing
+
+    // Per-connection logging would dominate the measurement
+    std::cout.rdbuf(nullptr);
+    net::io_context ioc{static_cast<int>(threads)};
+    ChatServer server(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    server.run();
+    std::vector<std::thread> io_threads;
+    for (long i = 0; i < threads; ++i) {
+        io_threads.emplace_back([&ioc] { ioc.run(); });
+    }
+
+    std::cerr << "readers=" << config.readers << " publishers=" << config.publishers
+              << " batches=" << config.batches << " batch_size=" << config.batch_size << " format=" << config.format
+              << " server_threads=" << threads << std::endl;
+    if (mode == "http" || mode == "both") {
+        run_http(server, config);
+    }
+    if (mode == "websocket" || mode == "both") {
+        run_websocket(server, config);
+    }
+
+    ioc.stop();
+    for (auto& t : io_threads) {
+        t.join();
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+// sequencer_bench.cpp
+// Measures the broadcast path's throughput ceiling with each sequencer
+// (--sequencer=lock|ring, see BroadcastSequencer). --producers threads call
+// ChatServer::broadcast as fast as they can, --messages times each, while
+// --clients simulated clients (SimulatedStream, no sockets) read every
+// message and check that sequence numbers only go up. Reports broadcasts
+// per second as the producers saw them (how long the calls held them up),
+// deliveries per second until the last client had everything, and how
+// often a client saw a message out of order (always 0).
+//
+//   sequencer_bench --clients=1000 --producers=4 --messages=5000 --threads=4 --io-model=per-thread
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include "IoContextPool.hpp"
+#include "SimulatedStream.hpp"
+#include <atomic>
+#include <charconv>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Client = websocket::stream<SimulatedStream>;
+
+std::atomic<std::size_t> g_connected{0};
+std::atomic<std::size_t> g_remaining{0}; // Messages still to be read, over all clients
+std::atomic<std::size_t> g_out_of_order{0};
+
+// Reads frames until the link closes, counting the bench's broadcasts
+struct SimClient {
+    explicit SimClient(SimulatedStream&& stream) : ws(std::move(stream)) {}
+
+    void start() {
+        ws.async_handshake("127.0.0.1", "/", [this](beast::error_code ec) {
+            g_connected.fetch_add(1, std::memory_order_release);
+            if (!ec) {
+                read();
+            }
+        });
+    }
+
+    void read() {
+        ws.async_read(buffer, [this](beast::error_code ec, std::size_t) {
+            if (ec) {
+                return;
+            }
+            auto const data = buffer.data();
+            std::string_view frame(static_cast<const char*>(data.data()), data.size());
+            if (frame.find("\"sequencer_bench\"") != std::string_view::npos) {
+                // {"seq":<n>,...
+                std::uint64_t seq = 0;
+                auto const digits = frame.find(':') + 1;
+                std::from_chars(frame.data() + digits, frame.data() + frame.size(), seq);
+                if (seq <= last_seq) {
+                    g_out_of_order.fetch_add(1, std::memory_order_relaxed);
+                }
+                last_seq = seq;
+                g_remaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            buffer.consume(buffer.size());
+            read();
+        });
+    }
+
+    Client ws;
+    beast::flat_buffer buffer;
+    std::uint64_t last_seq = 0;
+};
+
+void wait_for(const std::atomic<std::size_t>& counter, std::size_t target) {
+    while (counter.load(std::memory_order_acquire) != target) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+struct Config {
+    std::size_t clients;
+    long producers;
+    long messages;
+    long threads;
+    bool per_thread;
+    std::size_t slots;
+};
+
+void run(ServerOptions::Sequencer sequencer, const Config& config) {
+    ServerOptions options;
+    options.num_threads = static_cast<int>(config.threads);
+    options.presence_tick_ms = 3600 * 1000; // Keep presence traffic out of the measurement
+    options.sequencer = sequencer;
+    options.sequencer_slots = config.slots;
+
+    // Either I/O model, run by `threads` threads
+    net::io_context shared_ioc{static_cast<int>(config.threads)};
+    auto shared_guard = net::make_work_guard(shared_ioc);
+    IoContextPool pool(static_cast<std::size_t>(config.threads));
+    std::unique_ptr<ChatServer> server;
+    std::vector<std::thread> server_threads;
+    if (config.per_thread) {
+        options.io_model = ServerOptions::IoModel::per_thread;
+        server = std::make_unique<ChatServer>(pool, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+        server_threads.emplace_back([&pool] { pool.run(); });
+    } else {
+        server = std::make_unique<ChatServer>(shared_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                              options);
+        for (long i = 0; i < config.threads; ++i) {
+            server_threads.emplace_back([&shared_ioc] { shared_ioc.run(); });
+        }
+    }
+    net::io_context client_ioc{1};
+    auto client_guard = net::make_work_guard(client_ioc);
+    std::thread client_thread([&client_ioc] { client_ioc.run(); });
+
+    g_connected = 0;
+    std::vector<std::unique_ptr<SimClient>> sims;
+    for (std::size_t i = 0; i < config.clients; ++i) {
+        auto& context = config.per_thread ? pool.next() : shared_ioc;
+        auto ends = SimulatedStream::make_pair(client_ioc.get_executor(), net::make_strand(context));
+        server->connect_simulated(context, std::move(ends.second));
+        sims.push_back(std::make_unique<SimClient>(std::move(ends.first)));
+        net::post(client_ioc, [sim = sims.back().get()] { sim->start(); });
+    }
+    wait_for(g_connected, config.clients);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Welcome messages and the like
+
+    auto const total = static_cast<std::size_t>(config.producers * config.messages);
+    g_remaining = total * config.clients;
+    g_out_of_order = 0;
+    std::vector<std::thread> producers;
+    auto const start = BenchUtil::now_ns();
+    for (long p = 0; p < config.producers; ++p) {
+        producers.emplace_back([&, p] {
+            auto const message = "{\"type\":\"sequencer_bench\",\"producer\":" + std::to_string(p) + "}";
+            for (long m = 0; m < config.messages; ++m) {
+                server->broadcast(message);
+            }
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    auto const produced_ns = BenchUtil::now_ns() - start;
+    wait_for(g_remaining, 0);
+    auto const delivered_ns = BenchUtil::now_ns() - start;
+
+    std::cerr << (sequencer == ServerOptions::Sequencer::ring ? "ring" : "lock")
+              << " broadcasts_per_s=" << static_cast<double>(total) * 1e9 / static_cast<double>(produced_ns)
+              << " deliveries_per_s="
+              << static_cast<double>(total * config.clients) * 1e9 / static_cast<double>(delivered_ns)
+              << " elapsed_s=" << static_cast<double>(delivered_ns) / 1e9
+              << " out_of_order=" << g_out_of_order.load() << std::endl;
+
+    client_guard.reset();
+    client_ioc.stop();
+    client_thread.join();
+    shared_guard.reset();
+    shared_ioc.stop();
+    pool.stop();
+    for (auto& t : server_threads) {
+        t.join();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const sequencer = BenchUtil::flag(argc, argv, "sequencer", "both");
+    Config config;
+    config.clients = static_cast<std::size_t>(std::max(1L, BenchUtil::flag_int(argc, argv, "clients", 1000)));
+    config.producers = std::max(1L, BenchUtil::flag_int(argc, argv, "producers", 4));
+    config.messages = std::max(1L, BenchUtil::flag_int(argc, argv, "messages", 5000));
+    config.threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 4));
+    config.per_thread = BenchUtil::flag(argc, argv, "io-model", "shared") == "per-thread";
+    config.slots = static_cast<std::size_t>(std::max(2L, BenchUtil::flag_int(argc, argv, "slots", 16384)));
+
+    // Per-session logging would dominate the measurement
+    std::cout.rdbuf(nullptr);
+    std::cerr << "clients=" << config.clients << " producers=" << config.producers
+              << " messages=" << config.messages << " threads=" << config.threads
+              << " io_model=" << (config.per_thread ? "per-thread" : "shared") << " slots=" << config.slots
+              << std::endl;
+    if (sequencer == "lock" || sequencer == "both") {
+        run(ServerOptions::Sequencer::lock, config);
+    }
+    if (sequencer == "ring" || sequencer == "both") {
+        run(ServerOptions::Sequencer::ring, config);
+    }
+    return 0;
+}
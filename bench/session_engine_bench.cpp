@@ -0,0 +1,209 @@
+// session_engine_bench.cpp
+// Runs ChatServer in-process with the selected session engine, drives it with
+// blocking WebSocket clients on their own threads and reports heap
+// allocations and CPU time spent on the server's I/O threads per inbound
+// message and per delivered frame. With --batch-window-ms every client
+// negotiates micro-batching, and the frame counts show how many frames (and
+// so server write syscalls) batching saves. With --trace-sample the server
+// traces messages through LatencyTracer and the stage percentiles are
+// printed, so the CPU figures can be compared against an untraced run.
+//
+//   session_engine_bench --engine=callback --clients=50 --senders=5 --messages=2000
+//   session_engine_bench --engine=coroutine ...
+//   session_engine_bench --batch-window-ms=5 ...
+//   session_engine_bench --trace-sample=1 ...   (latency tracing overhead)
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include <boost/beast.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <new>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+namespace websocket = beast::websocket;
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+thread_local bool t_count_allocations = false;
+
+double thread_cpu_seconds(std::thread& t) {
+    clockid_t cid;
+    timespec ts{};
+    if (pthread_getcpuclockid(t.native_handle(), &cid) != 0 || clock_gettime(cid, &ts) != 0) {
+        return 0.0;
+    }
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+} // namespace
+
+// Count every allocation made on a server I/O thread.
+void* operator new(std::size_t size) {
+    if (t_count_allocations) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    auto const engine_name = BenchUtil::flag(argc, argv, "engine", "callback");
+    auto const clients = BenchUtil::flag_int(argc, argv, "clients", 50);
+    auto const senders = std::min(clients, BenchUtil::flag_int(argc, argv, "senders", 5));
+    auto const messages = BenchUtil::flag_int(argc, argv, "messages", 2000);
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 1));
+    auto const port = static_cast<unsigned short>(BenchUtil::flag_int(argc, argv, "port", 18090));
+    auto const batch_window_ms = BenchUtil::flag_int(argc, argv, "batch-window-ms", 0);
+    auto const trace_sample = BenchUtil::flag_int(argc, argv, "trace-sample", 0);
+
+    ServerOptions options;
+    options.port = port;
+    options.num_threads = static_cast<int>(threads);
+    options.batch_window_ms = static_cast<int>(std::max(batch_window_ms, 0L));
+    options.trace_sample = static_cast<int>(std::max(trace_sample, 0L));
+    if (engine_name == "coroutine") {
+        options.session_engine = ServerOptions::SessionEngine::coroutine;
+    } else if (engine_name != "callback") {
+        std::cerr << "Unknown engine: " << engine_name << std::endl;
+        return 1;
+    }
+
+    // Per-message logging would dominate the measurement.
+    std::cout.rdbuf(nullptr);
+
+    net::io_context ioc{static_cast<int>(threads)};
+    ChatServer server(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), port}, options);
+    server.run();
+
+    std::vector<std::thread> io_threads;
+    for (long i = 0; i < threads; ++i) {
+        io_threads.emplace_back([&ioc] {
+            t_count_allocations = true;
+            ioc.run();
+        });
+    }
+
+    // Connect everyone before measuring so presence traffic is excluded.
+    std::atomic<long> connected{0};
+    std::atomic<std::uint64_t> frames{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> client_threads;
+    long const expected = senders * messages;
+    for (long c = 0; c < clients; ++c) {
+        client_threads.emplace_back([&, c] {
+            net::io_context client_ioc;
+            websocket::stream<tcp::socket> ws(client_ioc);
+            ws.next_layer().connect(tcp::endpoint{net::ip::make_address("127.0.0.1"), port});
+            ws.handshake("localhost", "/");
+            if (batch_window_ms > 0) {
+                ws.write(net::buffer("{\"type\":\"client_enable_batching\",\"payload\":{\"window_ms\":"
+                                     + std::to_string(batch_window_ms) + "}}"));
+            }
+            ++connected;
+            while (!go) {
+                std::this_thread::yield();
+            }
+            std::thread writer;
+            if (c < senders) {
+                writer = std::thread([&ws, messages] {
+                    std::string const msg = "{\"type\":\"client_send_message\",\"payload\":{\"text\":\"bench\"}}";
+                    for (long m = 0; m < messages; ++m) {
+                        ws.write(net::buffer(msg));
+                    }
+                });
+            }
+            beast::flat_buffer buffer;
+            long seen = 0;
+            std::uint64_t chat_frames = 0;
+            while (seen < expected) {
+                ws.read(buffer);
+                auto const data = buffer.data();
+                beast::string_view text(static_cast<const char*>(data.data()), data.size());
+                // A batch frame carries several messages.
+                long in_frame = 0;
+                for (auto pos = text.find("\"text\":\"bench\""); pos != beast::string_view::npos;
+                     pos = text.find("\"text\":\"bench\"", pos + 1)) {
+                    ++in_frame;
+                }
+                if (in_frame > 0) {
+                    seen += in_frame;
+                    ++chat_frames;
+                }
+                buffer.consume(buffer.size());
+            }
+            frames += chat_frames;
+            if (writer.joinable()) {
+                writer.join();
+            }
+            beast::error_code ec;
+            ws.next_layer().close(ec);
+        });
+    }
+
+    while (connected < clients) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::vector<double> cpu_before;
+    for (auto& t : io_threads) {
+        cpu_before.push_back(thread_cpu_seconds(t));
+    }
+    g_allocations = 0;
+    auto const start_ns = BenchUtil::now_ns();
+    go = true;
+
+    for (auto& t : client_threads) {
+        t.join();
+    }
+    auto const elapsed_s = static_cast<double>(BenchUtil::now_ns() - start_ns) / 1e9;
+    auto const allocations = g_allocations.load();
+    double cpu = 0.0;
+    for (std::size_t i = 0; i < io_threads.size(); ++i) {
+        cpu += thread_cpu_seconds(io_threads[i]) - cpu_before[i];
+    }
+
+    ioc.stop();
+    for (auto& t : io_threads) {
+        t.join();
+    }
+
+    double const inbound = static_cast<double>(expected);
+    double const deliveries = inbound * static_cast<double>(clients);
+    std::cerr << "engine=" << engine_name << " clients=" << clients << " inbound=" << expected
+              << " deliveries=" << static_cast<std::uint64_t>(deliveries) << " elapsed_s=" << elapsed_s << "\n"
+              << "allocs_per_inbound=" << static_cast<double>(allocations) / inbound
+              << " allocs_per_delivery=" << static_cast<double>(allocations) / deliveries << "\n"
+              << "server_cpu_us_per_inbound=" << cpu * 1e6 / inbound
+              << " server_cpu_us_per_delivery=" << cpu * 1e6 / deliveries << "\n"
+              << "batch_window_ms=" << batch_window_ms << " frames=" << frames.load()
+              << " frames_per_delivery=" << static_cast<double>(frames.load()) / deliveries
+              << " (one server write syscall per frame)" << std::endl;
+    if (trace_sample > 0) {
+        std::cerr << "trace_sample=" << trace_sample;
+        for (int s = 0; s < LatencyTracer::kStageCount; ++s) {
+            auto const stage = static_cast<LatencyTracer::Stage>(s);
+            auto const& h = server.tracer().histogram(stage);
+            std::cerr << "\n  " << LatencyTracer::stage_name(stage) << " count=" << h.count()
+                      << " p50_us=" << static_cast<double>(h.percentile(0.50)) / 1e3
+                      << " p99_us=" << static_cast<double>(h.percentile(0.99)) / 1e3;
+        }
+        std::cerr << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+// simulated_clients_bench.cpp
+// Runs ChatServer with up to 100k clients over SimulatedStream links instead
+// of sockets, and measures chat delivery end to end: the sender's websocket
+// write, the server's read, parse and fan-out, every session's write queue
+// and framing, the simulated link and each client's read. Without sockets
+// the run is not bounded by file descriptors, ephemeral ports or loopback
+// throughput, and --latency-us / --bandwidth give every link a round trip
+// and a rate, so backpressure from slow links shows up as it would on a
+// network.
+//
+//   simulated_clients_bench --clients=100000 --threads=1 --messages=20 --latency-us=500 --bandwidth=1250000
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include "Session.hpp"
+#include "SimulatedStream.hpp"
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Client = websocket::stream<SimulatedStream>;
+
+std::atomic<std::size_t> g_connected{0};
+std::atomic<std::size_t> g_remaining{0};
+std::atomic<std::int64_t> g_sent_ns{0};
+std::atomic<std::int64_t> g_done_ns{0};
+std::vector<std::string> g_markers; // Text of each round's message; fixed before the rounds start
+std::atomic<std::size_t> g_round{0};
+std::vector<std::int64_t> g_latency_ns; // Appended by the client thread only
+
+// One simulated client: reads frames for as long as the link is up and
+// counts the current round's message when it arrives.
+struct SimClient {
+    explicit SimClient(SimulatedStream&& stream) : ws(std::move(stream)) {}
+
+    void start() {
+        ws.async_handshake("127.0.0.1", "/", [this](beast::error_code ec) {
+            g_connected.fetch_add(1, std::memory_order_release);
+            if (!ec) {
+                read();
+            }
+        });
+    }
+
+    void read() {
+        ws.async_read(buffer, [this](beast::error_code ec, std::size_t) {
+            if (ec) {
+                return;
+            }
+            auto const frame = beast::buffers_to_string(buffer.data());
+            buffer.consume(buffer.size());
+            auto const& marker = g_markers[g_round.load(std::memory_order_acquire)];
+            if (frame.find(marker) != std::string::npos) {
+                auto const now = BenchUtil::now_ns();
+                g_latency_ns.push_back(now - g_sent_ns.load(std::memory_order_acquire));
+                if (g_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    g_done_ns.store(now, std::memory_order_release);
+                }
+            }
+            read();
+        });
+    }
+
+    Client ws;
+    beast::flat_buffer buffer;
+};
+
+void wait_for(const std::atomic<std::size_t>& counter, std::size_t target) {
+    while (counter.load(std::memory_order_acquire) != target) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const clients = static_cast<std::size_t>(std::max(1L, BenchUtil::flag_int(argc, argv, "clients", 100000)));
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 1));
+    auto const messages = std::max(1L, BenchUtil::flag_int(argc, argv, "messages", 20));
+    SimulatedStream::Link link;
+    link.latency = std::chrono::microseconds(BenchUtil::flag_int(argc, argv, "latency-us", 0));
+    link.bytes_per_second = static_cast<std::uint64_t>(std::max(0L, BenchUtil::flag_int(argc, argv, "bandwidth", 0)));
+
+    ServerOptions options;
+    options.num_threads = static_cast<int>(threads);
+    options.presence_tick_ms = 3600 * 1000; // Keep presence traffic out of the measurement
+
+    // Per-session logging would dominate the measurement.
+    std::cout.rdbuf(nullptr);
+
+    net::io_context server_ioc{static_cast<int>(threads)};
+    auto server_guard = net::make_work_guard(server_ioc);
+    ChatServer server(server_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    std::vector<std::thread> server_threads;
+    for (long i = 0; i < threads; ++i) {
+        server_threads.emplace_back([&server_ioc] { server_ioc.run(); });
+    }
+    net::io_context client_ioc{1};
+    auto client_guard = net::make_work_guard(client_ioc);
+    std::thread client_thread([&client_ioc] { client_ioc.run(); });
+
+    for (long r = 0; r < messages; ++r) {
+        g_markers.push_back("simulated-bench-" + std::to_string(r));
+    }
+    g_latency_ns.reserve(clients * static_cast<std::size_t>(messages));
+
+    // Connect everyone; the handshakes run concurrently
+    std::vector<std::unique_ptr<SimClient>> sims;
+    sims.reserve(clients);
+    auto const connect_start = BenchUtil::now_ns();
+    for (std::size_t i = 0; i < clients; ++i) {
+        auto ends = SimulatedStream::make_pair(client_ioc.get_executor(), net::make_strand(server_ioc), link);
+        server.connect_simulated(server_ioc, std::move(ends.second));
+        sims.push_back(std::make_unique<SimClient>(std::move(ends.first)));
+        net::post(client_ioc, [sim = sims.back().get()] { sim->start(); });
+    }
+    wait_for(g_connected, clients);
+    auto const connect_ns = BenchUtil::now_ns() - connect_start;
+
+    // Each round one client sends a message, and it must reach all of them
+    std::vector<std::int64_t> complete_ns;
+    for (long r = 0; r < messages; ++r) {
+        g_round.store(static_cast<std::size_t>(r), std::memory_order_release);
+        g_remaining.store(clients, std::memory_order_release);
+        auto text = std::make_shared<std::string>(R"({"type":"client_send_message","payload":{"text":")" +
+                                                  g_markers[static_cast<std::size_t>(r)] + "\"}}");
+        SimClient& sender = *sims[static_cast<std::size_t>(r) % clients];
+        auto const start = BenchUtil::now_ns();
+        g_sent_ns.store(start, std::memory_order_release);
+        net::post(client_ioc, [&sender, text] {
+            sender.ws.async_write(net::buffer(*text), [text](beast::error_code, std::size_t) {});
+        });
+        wait_for(g_remaining, 0);
+        complete_ns.push_back(g_done_ns.load(std::memory_order_acquire) - start);
+    }
+
+    auto const ms = [](std::int64_t ns) { return static_cast<double>(ns) / 1e6; };
+    std::int64_t total_ns = 0;
+    for (auto ns : complete_ns) {
+        total_ns += ns;
+    }
+    std::cerr << "clients=" << clients << " threads=" << threads
+              << " latency_us=" << std::chrono::duration_cast<std::chrono::microseconds>(link.latency).count()
+              << " bandwidth=" << link.bytes_per_second << " connect_ms=" << ms(connect_ns)
+              << " complete_p50_ms=" << ms(BenchUtil::percentile(complete_ns, 0.50))
+              << " complete_max_ms=" << ms(complete_ns.back())
+              << " deliveries_per_s=" << static_cast<double>(g_latency_ns.size()) * 1e9 / static_cast<double>(total_ns)
+              << std::endl;
+    std::cout.rdbuf(std::cerr.rdbuf());
+    BenchUtil::print_latency_us("delivery", g_latency_ns);
+
+    client_guard.reset();
+    client_ioc.stop();
+    client_thread.join();
+    server_guard.reset();
+    server_ioc.stop();
+    for (auto& t : server_threads) {
+        t.join();
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+// uds_vs_tcp_bench.cpp
+// Runs ChatServer in-process, listening on loopback TCP and on a Unix domain
+// socket (--unix-socket), and measures local clients over each transport:
+//   latency:    one client sends a message, waits for its own broadcast and
+//               sends the next; the round trips' percentiles are reported
+//               while the other clients read along.
+//   throughput: --senders clients each write --messages messages as fast as
+//               they can; every client reads every message. Reports inbound
+//               messages and deliveries per second.
+// Each client is a blocking WebSocket client on its own thread.
+//
+//   uds_vs_tcp_bench --clients=20 --senders=4 --messages=5000 --rounds=5000
+//   uds_vs_tcp_bench --transport=uds ...   (or tcp; both by default)
+#include "BenchUtil.hpp"
+#include "ChatServer.hpp"
+#include <boost/beast.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace websocket = beast::websocket;
+using local_stream = net::local::stream_protocol;
+
+namespace {
+
+struct Config {
+    long clients;
+    long senders;
+    long messages;
+    long rounds;
+};
+
+template <typename Socket>
+struct Transport;
+
+template <>
+struct Transport<tcp::socket> {
+    static const char* name() { return "tcp"; }
+    static void connect(tcp::socket& socket, ChatServer& server) {
+        socket.connect(server.local_endpoint());
+        socket.set_option(tcp::no_delay(true));
+    }
+};
+
+template <>
+struct Transport<local_stream::socket> {
+    static const char* name() { return "uds"; }
+    static void connect(local_stream::socket& socket, ChatServer& server) {
+        socket.connect(local_stream::endpoint(server.options().unix_socket));
+    }
+};
+
+std::string chat(const std::string& text) {
+    return "{\"type\":\"client_send_message\",\"payload\":{\"text\":\"" + text + "\"}}";
+}
+
+// Counts frames carrying `marker` until `expected` have been read
+template <typename Stream>
+void read_messages(Stream& ws, const std::string& marker, long expected) {
+    beast::flat_buffer buffer;
+    long seen = 0;
+    while (seen < expected) {
+        ws.read(buffer);
+        auto const data = buffer.data();
+        beast::string_view text(static_cast<const char*>(data.data()), data.size());
+        if (text.find(marker) != beast::string_view::npos) {
+            ++seen;
+        }
+        buffer.consume(buffer.size());
+    }
+}
+
+template <typename Socket>
+void run(ChatServer& server, const Config& config) {
+    using Stream = websocket::stream<Socket>;
+    net::io_context client_ioc;
+    std::vector<std::unique_ptr<Stream>> clients;
+    for (long c = 0; c < config.clients; ++c) {
+        clients.push_back(std::make_unique<Stream>(client_ioc));
+        Transport<Socket>::connect(clients.back()->next_layer(), server);
+        clients.back()->handshake("localhost", "/");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300)); // Presence traffic settles
+
+    // Latency: the other clients read along so the server fans out as usual
+    std::vector<std::thread> readers;
+    for (long c = 1; c < config.clients; ++c) {
+        readers.emplace_back([&, c] { read_messages(*clients[c], "\"ping\"", config.rounds); });
+    }
+    std::vector<std::int64_t> round_trips;
+    round_trips.reserve(static_cast<std::size_t>(config.rounds));
+    auto const ping = chat("ping");
+    for (long r = 0; r < config.rounds; ++r) {
+        auto const start = BenchUtil::now_ns();
+        clients[0]->write(net::buffer(ping));
+        read_messages(*clients[0], "\"ping\"", 1);
+        round_trips.push_back(BenchUtil::now_ns() - start);
+    }
+    for (auto& t : readers) {
+        t.join();
+    }
+    auto* const quiet = std::cout.rdbuf(std::cerr.rdbuf()); // The server is idle now
+    BenchUtil::print_latency_us(std::string(Transport<Socket>::name()) + " round_trip", round_trips);
+    std::cout.rdbuf(quiet);
+
+    // Throughput
+    long const expected = config.senders * config.messages;
+    std::vector<std::thread> threads;
+    auto const start = BenchUtil::now_ns();
+    for (long c = 0; c < config.clients; ++c) {
+        threads.emplace_back([&, c] {
+            std::thread writer;
+            if (c < config.senders) {
+                writer = std::thread([&, c] {
+                    auto const message = chat("flood");
+                    for (long m = 0; m < config.messages; ++m) {
+                        clients[c]->write(net::buffer(message));
+                    }
+                });
+            }
+            read_messages(*clients[c], "\"flood\"", expected);
+            if (writer.joinable()) {
+                writer.join();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto const elapsed_s = static_cast<double>(BenchUtil::now_ns() - start) / 1e9;
+    std::cerr << Transport<Socket>::name() << " throughput inbound_per_s="
+              << static_cast<double>(expected) / elapsed_s
+              << " deliveries_per_s=" << static_cast<double>(expected * config.clients) / elapsed_s
+              << " elapsed_s=" << elapsed_s << std::endl;
+
+    for (auto& client : clients) {
+        beast::error_code ec;
+        client->close(websocket::close_code::normal, ec);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto const transport = BenchUtil::flag(argc, argv, "transport", "both");
+    Config config;
+    config.clients = std::max(2L, BenchUtil::flag_int(argc, argv, "clients", 20));
+    config.senders = std::min(config.clients, BenchUtil::flag_int(argc, argv, "senders", 4));
+    config.messages = BenchUtil::flag_int(argc, argv, "messages", 5000);
+    config.rounds = BenchUtil::flag_int(argc, argv, "rounds", 5000);
+    auto const threads = std::max(1L, BenchUtil::flag_int(argc, argv, "threads", 1));
+
+    ServerOptions options;
+    options.num_threads = static_cast<int>(threads);
+    options.unix_socket = BenchUtil::flag(argc, argv, "unix-socket",
+                                          "/tmp/uds_vs_tcp_bench." + std::to_string(::getpid()) + ".sock");
+    options.history_retain = 0; // Measure the transports, not history indexing
+
+    // Per-connection logging would dominate the measurement
+    std::cout.rdbuf(nullptr);
+    net::io_context ioc{static_cast<int>(threads)};
+    ChatServer server(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    if (!server.unix_socket_listening()) {
+        std::cerr << "Cannot listen on " << options.unix_socket << std::endl;
+        return 1;
+    }
+    server.run();
+    std::vector<std::thread> io_threads;
+    for (long i = 0; i < threads; ++i) {
+        io_threads.emplace_back([&ioc] { ioc.run(); });
+    }
+
+    std::cerr << "clients=" << config.clients << " senders=" << config.senders << " messages=" << config.messages
+              << " rounds=" << config.rounds << " server_threads=" << threads << std::endl;
+    if (transport == "tcp" || transport == "both") {
+        run<tcp::socket>(server, config);
+    }
+    if (transport == "uds" || transport == "both") {
+        run<local_stream::socket>(server, config);
+    }
+
+    ioc.stop();
+    for (auto& t : io_threads) {
+        t.join();
+    }
+    return 0;
+}
@@ -1,4 +1,4 @@
-import React, { useState, useEffect } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
 import './App.css';
 import useWebSocket from './hooks/useWebSocket';
 import StatusIndicator from './components/StatusIndicator';
@@ -7,9 +7,11 @@ import MessageInput from './components/MessageInput';
 
 // Configuration for WebSocket URL
 const WEBSOCKET_URL = 'ws://127.0.0.1:8080'; // Or use environment variable
+// Let the server coalesce busy traffic into batched frames
+const WEBSOCKET_OPTIONS = { batching: true, batchWindowMs: 5 };
 
 function App() {
-  const { messages, readyState, error, sendMessage } = useWebSocket(WEBSOCKET_URL);
+  const { messages, readyState, error, sendMessage } = useWebSocket(WEBSOCKET_URL, WEBSOCKET_OPTIONS);
   const [myNickname, setMyNickname] = useState(localStorage.getItem('chatNickname') || '');
   const [tempNickname, setTempNickname] = useState('');
 
@@ -20,17 +22,24 @@ function App() {
     }
   }, [myNickname]);
 
-  // Effect to update myNickname if a server_user_nickname_changed message is for the current user
+  // Effect to update myNickname if a server_user_nickname_changed message is for the current user.
+  // A batched frame can append several messages at once, so check every new one.
+  const processedCount = useRef(0);
   useEffect(() => {
-    if (messages.length > 0) {
-      const lastMessage = messages[messages.length - 1];
-      if (lastMessage.type === "server_user_nickname_changed" &&
-          lastMessage.payload &&
-          lastMessage.payload.old_nickname === myNickname) {
-        // Ensure the local state myNickname is updated if the change was for this user
-        setMyNickname(lastMessage.payload.new_nickname);
+    let nickname = myNickname;
+    for (let i = processedCount.current; i < messages.length; i++) {
+      const message = messages[i];
+      if (message.type === "server_user_nickname_changed" &&
+          message.payload &&
+          message.payload.old_nickname === nickname) {
+        nickname = message.payload.new_nickname;
       }
     }
+    processedCount.current = messages.length;
+    if (nickname !== myNickname) {
+      // Ensure the local state myNickname is updated if the change was for this user
+      setMyNickname(nickname);
+    }
   }, [messages, myNickname]); // Ensure all dependencies are listed
 
   const handleSetNickname = () => {
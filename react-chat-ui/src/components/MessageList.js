@@ -5,6 +5,13 @@ const MessageList = ({ messages, myNickname }) => { // Added myNickname prop
     return <div className="message-list-empty">No messages yet.</div>;
   }
 
+  // Presence messages can name thousands of users after a reconnect storm.
+  const nameList = (entries, limit = 10) => {
+    const names = (entries || []).map(([userId, nickname]) => nickname || userId);
+    const shown = names.slice(0, limit).join(', ');
+    return names.length > limit ? `${shown} and ${names.length - limit} more` : shown;
+  };
+
   const renderPayload = (msgType, payload) => {
     if (!payload) return 'No payload';
 
@@ -32,6 +39,20 @@ const MessageList = ({ messages, myNickname }) => { // Added myNickname prop
             User {payload.nickname || payload.user_id || 'Someone'} has disconnected. {payload.user_id && payload.nickname ? `(ID: ${payload.user_id})` : ''} <span className="timestamp">{timestamp}</span>
           </em>
         );
+      case 'server_roster_snapshot':
+        return (
+          <em>
+            {payload.users ? payload.users.length : 0} online: {nameList(payload.users)} <span className="timestamp">{timestamp}</span>
+          </em>
+        );
+      case 'server_presence_delta':
+        return (
+          <em>
+            {payload.joined && payload.joined.length > 0 ? `Joined: ${nameList(payload.joined)}. ` : ''}
+            {payload.left && payload.left.length > 0 ? `Left: ${nameList(payload.left)}. ` : ''}
+            ({payload.online} online) <span className="timestamp">{timestamp}</span>
+          </em>
+        );
       case 'server_user_nickname_changed':
         return (
           <em>
@@ -1,7 +1,30 @@
 import { useState, useEffect, useRef, useCallback } from 'react';
 
-const useWebSocket = (url) => {
+const isProtocolMessage = (message) =>
+  typeof message === 'object' && message !== null && 'type' in message && 'payload' in message;
+
+// Reconnect backoff after a dropped connection
+const RECONNECT_MIN_DELAY_MS = 250;
+const RECONNECT_MAX_DELAY_MS = 10000;
+
+// The server hands out a resume token on connect and numbers every room
+// message (`seq`). A reconnect presents both, so the server can continue the
+// same session and replay only what was missed.
+const resumeUrl = (url, resume) => {
+  if (!resume.token) return url;
+  const separator = url.includes('?') ? '&' : '?';
+  return `${url}${separator}resume=${encodeURIComponent(resume.token)}&last_seq=${resume.lastSeq}`;
+};
+
+// options.batching: ask the server to micro-batch outbound messages. Batched
+// frames arrive as a JSON array of ordinary protocol messages.
+// options.batchWindowMs: preferred batching window (the server may shorten it).
+// options.reconnect: reconnect (and resume the session) when the connection
+// drops; on by default.
+const useWebSocket = (url, options = {}) => {
+  const { batching = false, batchWindowMs, reconnect = true } = options;
   const [messages, setMessages] = useState([]);
+  const [batchingStatus, setBatchingStatus] = useState(null);
   const [readyState, setReadyState] = useState(WebSocket.CONNECTING);
   const [error, setError] = useState(null);
   const wsRef = useRef(null);
@@ -9,62 +32,111 @@ const useWebSocket = (url) => {
   useEffect(() => {
     if (!url) return;
 
-    const ws = new WebSocket(url);
-    wsRef.current = ws;
+    // Survives reconnects, not a change of URL
+    const resume = { token: null, lastSeq: 0 };
+    let disposed = false;
+    let attempts = 0;
+    let reconnectTimer = null;
 
-    setReadyState(ws.readyState); // Initial state
+    const connect = () => {
+      const ws = new WebSocket(resumeUrl(url, resume));
+      wsRef.current = ws;
 
-    ws.onopen = () => {
-      console.log('WebSocket Connected');
-      setReadyState(ws.readyState);
-      setError(null);
-    };
+      setReadyState(ws.readyState); // Initial state
 
-    ws.onmessage = (event) => {
-      console.log('WebSocket Message Received:', event.data);
-      try {
-        const parsedMessage = JSON.parse(event.data);
-        // Simple validation for our protocol: expect an object with 'type' and 'payload'
-        if (typeof parsedMessage === 'object' && parsedMessage !== null && 'type' in parsedMessage && 'payload' in parsedMessage) {
-          setMessages((prevMessages) => [...prevMessages, parsedMessage]);
-        } else {
-          console.warn('Received message does not match expected protocol structure:', parsedMessage);
-          // Optionally, add non-protocol messages to a different state or handle them
+      ws.onopen = () => {
+        console.log('WebSocket Connected');
+        attempts = 0;
+        setReadyState(ws.readyState);
+        setError(null);
+        if (batching) {
+          const payload = batchWindowMs ? { window_ms: batchWindowMs } : {};
+          ws.send(JSON.stringify({ type: 'client_enable_batching', payload }));
         }
-      } catch (e) {
-        console.error('Failed to parse JSON message:', e);
-        // Handle non-JSON messages or parsing errors if necessary
-        // For now, we add raw data if it's not JSON, prefixed for clarity
-        setMessages((prevMessages) => [...prevMessages, {type: 'raw_data', payload: {text: event.data, timestamp: new Date().toISOString(), user_id: 'System'}}]);
-      }
-    };
+      };
 
-    ws.onerror = (event) => {
-      console.error('WebSocket Error:', event);
-      // For security reasons, the specific error event doesn't bubble up detailed info to JS
-      // We know an error occurred, but not much more.
-      setError(new Error('WebSocket error occurred. Check console for details.'));
-      setReadyState(ws.readyState);
-    };
+      ws.onmessage = (event) => {
+        console.log('WebSocket Message Received:', event.data);
+        try {
+          const parsedMessage = JSON.parse(event.data);
+          // A batch frame is an array of messages; unpack it in order
+          const received = Array.isArray(parsedMessage) ? parsedMessage : [parsedMessage];
+          const chatMessages = [];
+          received.forEach((message) => {
+            // Simple validation for our protocol: expect an object with 'type' and 'payload'
+            if (!isProtocolMessage(message)) {
+              console.warn('Received message does not match expected protocol structure:', message);
+            } else if (message.type === 'server_batching_status') {
+              setBatchingStatus(message.payload);
+            } else if (message.type === 'server_session_welcome' || message.type === 'server_session_resumed') {
+              resume.token = message.payload.resume_token;
+              if (message.type === 'server_session_welcome') {
+                resume.lastSeq = message.payload.seq;
+              } else if (!message.payload.complete) {
+                chatMessages.push({
+                  type: 'raw_data',
+                  payload: { text: 'Some messages sent while you were disconnected could not be recovered.', timestamp: new Date().toISOString(), user_id: 'System' },
+                });
+              }
+            } else if (typeof message.seq === 'number' && message.seq <= resume.lastSeq) {
+              // Already shown before the connection dropped
+            } else {
+              if (typeof message.seq === 'number') {
+                resume.lastSeq = message.seq;
+              }
+              chatMessages.push(message);
+            }
+          });
+          if (chatMessages.length > 0) {
+            setMessages((prevMessages) => [...prevMessages, ...chatMessages]);
+          }
+        } catch (e) {
+          console.error('Failed to parse JSON message:', e);
+          // Handle non-JSON messages or parsing errors if necessary
+          // For now, we add raw data if it's not JSON, prefixed for clarity
+          setMessages((prevMessages) => [...prevMessages, {type: 'raw_data', payload: {text: event.data, timestamp: new Date().toISOString(), user_id: 'System'}}]);
+        }
+      };
 
-    ws.onclose = (event) => {
-      console.log('WebSocket Disconnected. Code:', event.code, 'Reason:', event.reason);
-      setReadyState(ws.readyState);
-      // Optionally, set an error if the disconnect was unexpected
-      if (!event.wasClean) {
-        setError(new Error(`WebSocket closed uncleanly. Code: ${event.code}, Reason: ${event.reason}`));
-      }
+      ws.onerror = (event) => {
+        console.error('WebSocket Error:', event);
+        // For security reasons, the specific error event doesn't bubble up detailed info to JS
+        // We know an error occurred, but not much more.
+        setError(new Error('WebSocket error occurred. Check console for details.'));
+        setReadyState(ws.readyState);
+      };
+
+      ws.onclose = (event) => {
+        console.log('WebSocket Disconnected. Code:', event.code, 'Reason:', event.reason);
+        if (disposed) return;
+        setReadyState(ws.readyState);
+        // Optionally, set an error if the disconnect was unexpected
+        if (!event.wasClean) {
+          setError(new Error(`WebSocket closed uncleanly. Code: ${event.code}, Reason: ${event.reason}`));
+        }
+        if (reconnect) {
+          const delay = Math.min(RECONNECT_MAX_DELAY_MS, RECONNECT_MIN_DELAY_MS * 2 ** attempts);
+          attempts += 1;
+          console.log(`Reconnecting in ${delay} ms${resume.token ? ' (resuming session)' : ''}`);
+          reconnectTimer = setTimeout(connect, delay);
+        }
+      };
     };
 
+    connect();
+
     return () => {
-      if (ws.readyState === WebSocket.OPEN || ws.readyState === WebSocket.CONNECTING) {
-        ws.close();
+      disposed = true;
+      clearTimeout(reconnectTimer);
+      const ws = wsRef.current;
+      if (ws && (ws.readyState === WebSocket.OPEN || ws.readyState === WebSocket.CONNECTING)) {
+        ws.close(); // A close frame ends the session on the server at once
         console.log('WebSocket connection closed on cleanup.');
       }
       wsRef.current = null;
       setReadyState(WebSocket.CLOSED); // Ensure final state is CLOSED
     };
-  }, [url]); // Re-run effect if URL changes
+  }, [url, batching, batchWindowMs, reconnect]); // Re-run effect if URL or connection preferences change
 
   const sendMessage = useCallback((messageObject) => {
     if (wsRef.current && wsRef.current.readyState === WebSocket.OPEN) {
@@ -81,7 +153,7 @@ const useWebSocket = (url) => {
     }
   }, []); // No dependencies, wsRef.current is managed by useEffect
 
-  return { messages, readyState, error, sendMessage };
+  return { messages, readyState, error, sendMessage, batchingStatus };
 };
 
 export default useWebSocket;
@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# Runs one of the bpftrace scripts in this directory against a running
+# websocket-chat-server built with USDT probes (see src/Probes.hpp).
+#
+# Usage: scripts/bpftrace/run.sh <script.bt> [<pid>]
+#   <pid> defaults to the newest websocket-chat-server process.
+#
+# The scripts attach to usdt:@BINARY@:chat:*; this wrapper substitutes the
+# server's executable path, so they work for any build directory.
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <script.bt> [<pid>]" >&2
+    exit 1
+fi
+
+script=$1
+pid=${2:-$(pgrep -n websocket-chat-server || true)}
+if [ -z "$pid" ]; then
+    echo "No websocket-chat-server process found; pass a pid." >&2
+    exit 1
+fi
+
+binary=$(readlink -f "/proc/$pid/exe")
+if ! readelf -n "$binary" 2>/dev/null | grep -q 'Provider: chat'; then
+    echo "$binary has no chat USDT probes; rebuild with <sys/sdt.h> available (systemtap-sdt-dev)." >&2
+    exit 1
+fi
+
+tmp=$(mktemp --suffix=.bt)
+trap 'rm -f "$tmp"' EXIT
+sed "s|@BINARY@|$binary|g" "$script" > "$tmp"
+bpftrace -p "$pid" "$tmp"
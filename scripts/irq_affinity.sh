@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# Steers a NIC's interrupts onto the CPUs the server's I/O threads are
+# pinned to, one queue per CPU, so a connection's packets are handled on
+# the core whose listener accepts it (--cpu-affinity with --reuseport).
+#
+# Usage: sudo scripts/irq_affinity.sh <interface> <cpus>
+#   <cpus> uses the --cpu-affinity syntax, e.g. 0-7 or 0-3,16-19; the n-th
+#   interrupt of <interface> goes to the n-th CPU, wrapping around.
+#
+# Stop irqbalance first (systemctl stop irqbalance), or it moves the
+# interrupts back. Receive queues are matched to interrupts by name
+# (<interface>-TxRx-<n>, <interface>-rx-<n>, ...), as most drivers list
+# them in /proc/interrupts.
+
+set -e
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 <interface> <cpus>" >&2
+    exit 1
+fi
+
+interface=$1
+cpus=$(echo "$2" | tr ',' '\n' | awk -F- '{ last = NF > 1 ? $2 : $1; for (c = $1; c <= last; c++) print c }')
+if [ -z "$cpus" ]; then
+    echo "No CPUs in '$2'" >&2
+    exit 1
+fi
+
+irqs=$(awk -v nic="$interface" 'index($NF, nic) == 1 { sub(":", "", $1); print $1 }' /proc/interrupts)
+if [ -z "$irqs" ]; then
+    echo "No interrupts named after $interface in /proc/interrupts" >&2
+    exit 1
+fi
+
+count=$(echo "$cpus" | wc -l)
+n=0
+for irq in $irqs; do
+    cpu=$(echo "$cpus" | sed -n "$((n % count + 1))p")
+    echo "$cpu" > "/proc/irq/$irq/smp_affinity_list"
+    echo "irq $irq ($(awk -v irq="$irq:" '$1 == irq { print $NF }' /proc/interrupts)) -> cpu $cpu"
+    n=$((n + 1))
+done
@@ -0,0 +1,288 @@
+// AdminChannel.cpp
+#include "AdminChannel.hpp"
+#include "ChatServer.hpp"
+#include "Profiler.hpp"
+#include "Session.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using local_stream = net::local::stream_protocol;
+
+constexpr std::size_t kMaxCommandBytes = 1024;
+constexpr int kMaxProfileSeconds = 600;
+// How long `sessions` waits for the sessions' strands
+constexpr auto kSessionsDeadline = std::chrono::seconds(2);
+
+const char* const kHelp =
+    "Commands:\n"
+    "  help\n"
+    "  stats\n"
+    "  sessions [<top>]              Write queue depths, top sessions by bytes queued (default 20)\n"
+    "  cpu-profile [<s>] [<hz>]      CPU profile for <s> seconds (default 10) at <hz> (default 100)\n"
+    "  heap-profile [<s>] [<bytes>]  Heap profile for <s> seconds, a sample per <bytes> (default 524288)\n";
+
+// Only the server's user, or root, may use the channel
+bool peer_allowed(local_stream::socket& socket) {
+#if defined(SO_PEERCRED)
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+        return false;
+    }
+    return credentials.uid == 0 || credentials.uid == geteuid();
+#else
+    (void)socket;
+    return true; // The socket file's mode is all there is
+#endif
+}
+
+// Queue depths gathered from the sessions' strands
+struct QueueSurvey {
+    std::mutex mutex;
+    std::vector<Session::QueueDepth> depths;
+    std::size_t asked = 0;
+    bool reported = false;
+};
+
+std::string format_survey(const QueueSurvey& survey, std::size_t top) {
+    std::vector<Session::QueueDepth> depths = survey.depths;
+    std::size_t messages = 0;
+    std::size_t bytes = 0;
+    std::size_t batched = 0;
+    std::array<std::size_t, OutboundLanes::kLanes> lanes{};
+    for (auto const& depth : depths) {
+        messages += depth.messages;
+        bytes += depth.bytes;
+        batched += depth.batched;
+        for (std::size_t lane = 0; lane < lanes.size(); ++lane) {
+            lanes[lane] += depth.lanes[lane];
+        }
+    }
+    std::ostringstream out;
+    out << "sessions: " << survey.asked << " (" << depths.size() << " answered), queued messages: " << messages
+        << ", queued bytes: " << bytes << "\n"
+        << "by lane: control=" << lanes[0] << " presence=" << lanes[1] << " chat=" << lanes[2]
+        << " bulk=" << lanes[3] << ", batched: " << batched << "\n";
+
+    top = std::min(top, depths.size());
+    std::partial_sort(depths.begin(), depths.begin() + static_cast<std::ptrdiff_t>(top), depths.end(),
+                      [](const auto& a, const auto& b) { return a.bytes > b.bytes; });
+    out << "\ntop " << top << " by bytes queued:\n";
+    char line[128];
+    std::snprintf(line, sizeof(line), "%12s %9s %8s %8s %8s %8s %8s  ", "bytes", "messages", "control", "presence",
+                  "chat", "bulk", "batched");
+    out << line << "session\n";
+    for (std::size_t i = 0; i < top; ++i) {
+        auto const& depth = depths[i];
+        std::snprintf(line, sizeof(line), "%12zu %9zu %8zu %8zu %8zu %8zu %8zu  ", depth.bytes, depth.messages,
+                      depth.lanes[0], depth.lanes[1], depth.lanes[2], depth.lanes[3], depth.batched);
+        out << line << depth.id << " (" << depth.nickname << ")" << (depth.writing ? " writing" : "") << "\n";
+    }
+    return out.str();
+}
+
+} // namespace
+
+// One admin client: a command in, a reply out
+class AdminChannel::Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(AdminChannel& channel, local_stream::socket socket)
+        : channel_(channel), socket_(std::move(socket)), timer_(channel.ioc_), input_(kMaxCommandBytes) {}
+
+    void start() {
+        if (!peer_allowed(socket_)) {
+            reply("Permission denied\n");
+            return;
+        }
+        net::async_read_until(socket_, input_, '\n',
+                              [self = shared_from_this()](boost::system::error_code ec, std::size_t) {
+                                  // A command without a newline before end of stream is still a command
+                                  if (!ec || ec == net::error::eof) {
+                                      self->on_command();
+                                  }
+                              });
+    }
+
+private:
+    void on_command() {
+        std::istream input(&input_);
+        std::string line;
+        std::getline(input, line);
+        std::istringstream words(line);
+        std::string command;
+        words >> command;
+
+        if (command == "help" || command.empty()) {
+            reply(kHelp);
+        } else if (command == "stats") {
+            reply(channel_.server_.stats_json() + "\n");
+        } else if (command == "sessions") {
+            std::size_t top = 20;
+            words >> top;
+            survey_sessions(top);
+        } else if (command == "cpu-profile") {
+            int seconds = 10;
+            int hz = 100;
+            words >> seconds >> hz;
+            if (!valid_seconds(seconds)) {
+                return;
+            }
+            if (!CpuProfiler::start(hz)) {
+                reply("Cannot start a CPU profile: one is running, or " + std::to_string(hz) +
+                      " Hz is not within 1..1000\n");
+                return;
+            }
+            after(seconds, [](Connection& self) { self.reply(CpuProfiler::stop()); });
+        } else if (command == "heap-profile") {
+            int seconds = 10;
+            std::size_t sample_bytes = 512 * 1024;
+            words >> seconds >> sample_bytes;
+            if (!valid_seconds(seconds)) {
+                return;
+            }
+            if (!HeapProfiler::hooks_linked()) {
+                reply("Heap profiling needs the allocation hooks (AllocationHooks.cpp) linked in\n");
+                return;
+            }
+            if (!HeapProfiler::start(sample_bytes)) {
+                reply("Cannot start a heap profile: one is running, or the sample interval is 0\n");
+                return;
+            }
+            after(seconds, [](Connection& self) { self.reply(HeapProfiler::stop()); });
+        } else {
+            reply("Unknown command: " + command + "\n" + kHelp);
+        }
+    }
+
+    bool valid_seconds(int seconds) {
+        if (seconds > 0 && seconds <= kMaxProfileSeconds) {
+            return true;
+        }
+        reply("The profile window must be 1.." + std::to_string(kMaxProfileSeconds) + " seconds\n");
+        return false;
+    }
+
+    // Runs `then` on the channel's thread `seconds` from now. The window
+    // closes on time even if the client has gone away.
+    template <typename Then>
+    void after(int seconds, Then then) {
+        timer_.expires_after(std::chrono::seconds(seconds));
+        timer_.async_wait([self = shared_from_this(), then](boost::system::error_code) { then(*self); });
+    }
+
+    void survey_sessions(std::size_t top) {
+        auto survey = std::make_shared<QueueSurvey>();
+        auto sessions = channel_.server_.sessions();
+        survey->asked = sessions.size();
+        auto const finish = [self = shared_from_this(), survey, top] {
+            {
+                std::lock_guard<std::mutex> lock(survey->mutex);
+                if (survey->reported) {
+                    return;
+                }
+                survey->reported = true;
+            }
+            self->timer_.cancel();
+            self->reply(format_survey(*survey, top));
+        };
+        if (sessions.empty()) {
+            finish();
+            return;
+        }
+        for (auto const& session : sessions) {
+            session->inspect_queue([survey, finish, executor = channel_.ioc_.get_executor()](
+                                       Session::QueueDepth depth) {
+                std::lock_guard<std::mutex> lock(survey->mutex);
+                survey->depths.push_back(std::move(depth));
+                if (survey->depths.size() == survey->asked) {
+                    net::post(executor, finish);
+                }
+            });
+        }
+        // Sessions whose strand is stuck are left out of the reply
+        timer_.expires_after(kSessionsDeadline);
+        timer_.async_wait([finish](boost::system::error_code ec) {
+            if (ec != net::error::operation_aborted) {
+                finish();
+            }
+        });
+    }
+
+    void reply(std::string text) {
+        auto body = std::make_shared<std::string>(std::move(text));
+        net::async_write(socket_, net::buffer(*body),
+                         [self = shared_from_this(), body](boost::system::error_code, std::size_t) {
+                             boost::system::error_code ignored;
+                             self->socket_.shutdown(local_stream::socket::shutdown_both, ignored);
+                         });
+    }
+
+    AdminChannel& channel_;
+    local_stream::socket socket_;
+    net::steady_timer timer_;
+    net::streambuf input_;
+};
+
+AdminChannel::AdminChannel(ChatServer& server, std::string path)
+    : server_(server), path_(std::move(path)), acceptor_(ioc_) {
+    boost::system::error_code ec;
+    struct stat existing {};
+    if (::lstat(path_.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        ::unlink(path_.c_str()); // Left behind by an earlier run
+    }
+    acceptor_.open(local_stream(), ec);
+    if (!ec) {
+        acceptor_.bind(local_stream::endpoint(path_), ec);
+    }
+    if (!ec && ::chmod(path_.c_str(), S_IRUSR | S_IWUSR) != 0) {
+        ec.assign(errno, boost::system::system_category());
+    }
+    if (!ec) {
+        acceptor_.listen(net::socket_base::max_listen_connections, ec);
+    }
+    if (ec) {
+        std::cerr << "Admin channel on " << path_ << " failed: " << ec.message() << std::endl;
+        acceptor_.close(ec);
+        return;
+    }
+    do_accept();
+    thread_ = std::thread([this] { ioc_.run(); });
+}
+
+AdminChannel::~AdminChannel() {
+    ioc_.stop();
+    if (thread_.joinable()) {
+        thread_.join();
+        ::unlink(path_.c_str());
+    }
+    // A profile cut short by shutdown still restores the signal handler
+    if (CpuProfiler::running()) {
+        CpuProfiler::stop();
+    }
+    if (HeapProfiler::running()) {
+        HeapProfiler::stop();
+    }
+}
+
+void AdminChannel::do_accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec, local_stream::socket socket) {
+        if (ec) {
+            if (ec != net::error::operation_aborted) {
+                std::cerr << "Admin channel accept failed: " << ec.message() << std::endl;
+                do_accept();
+            }
+            return;
+        }
+        std::make_shared<Connection>(*this, std::move(socket))->start();
+        do_accept();
+    });
+}
@@ -0,0 +1,55 @@
+// AdminChannel.hpp
+#ifndef ADMIN_CHANNEL_HPP
+#define ADMIN_CHANNEL_HPP
+
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+
+class ChatServer;
+
+namespace net = boost::asio;
+
+// Operator commands on a local Unix socket (--admin-socket), for looking into
+// a server that misbehaves without restarting it. Only the server's own user
+// (or root) may connect: the socket file is mode 0600 and every peer's
+// credentials are checked. A client sends one command line, reads the reply
+// and is disconnected:
+//
+//   help                          the commands
+//   stats                         GET /stats
+//   sessions [<top>]              write queue depths: totals, then the <top>
+//                                 sessions with the most bytes queued
+//   cpu-profile [<s>] [<hz>]      CPU profile for <s> seconds (CpuProfiler)
+//   heap-profile [<s>] [<bytes>]  heap profile for <s> seconds, one sample
+//                                 per <bytes> allocated (HeapProfiler)
+//
+// e.g. `echo "cpu-profile 30" | socat - UNIX-CONNECT:/run/chat-admin.sock`.
+// The channel runs on a thread of its own, so it answers even while every
+// I/O thread is busy; only `sessions` needs them, and it reports whatever the
+// sessions' strands answered within a deadline.
+class AdminChannel {
+public:
+    AdminChannel(ChatServer& server, std::string path);
+    ~AdminChannel(); // Stops the thread and removes the socket file
+    AdminChannel(const AdminChannel&) = delete;
+    AdminChannel& operator=(const AdminChannel&) = delete;
+
+    // Whether the socket is listening; see the log otherwise
+    bool listening() const { return acceptor_.is_open(); }
+    const std::string& path() const { return path_; }
+
+private:
+    class Connection;
+
+    void do_accept();
+
+    ChatServer& server_;
+    std::string path_;
+    net::io_context ioc_{1};
+    net::local::stream_protocol::acceptor acceptor_;
+    std::thread thread_;
+};
+
+#endif // ADMIN_CHANNEL_HPP
@@ -0,0 +1,32 @@
+// AllocationHooks.cpp
+// Global operator new and delete for the server binary: they forward to
+// malloc and free and let HeapProfiler see every allocation. Kept out of
+// SERVER_SRC because the tests and benchmarks define their own to count
+// allocations.
+#include "Profiler.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+struct LinkedHooks {
+    LinkedHooks() { HeapProfiler::set_hooks_linked(); }
+} const linked_hooks;
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    HeapProfiler::on_allocation(size);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
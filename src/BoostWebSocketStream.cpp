@@ -29,7 +29,7 @@ void BoostWebSocketStream::handshake(const std::string& host, const std::string&
 
 void BoostWebSocketStream::connect(const tcp::endpoint& ep, beast::error_code& ec) {
     // This connects the underlying TCP socket.
-    ws_.next_layer().connect(ep, ec);
+    ws_.next_layer().next_layer().connect(ep, ec);
 }
 
 void BoostWebSocketStream::write(const net::const_buffer& buffer, beast::error_code& ec) {
@@ -43,3 +43,25 @@ std::size_t BoostWebSocketStream::read(beast::flat_buffer& buffer, beast::error_
 void BoostWebSocketStream::close(beast::websocket::close_code code, beast::error_code& ec) {
     ws_.close(code, ec);
 }
+
+void BoostWebSocketStream::async_read(beast::flat_buffer& buffer, IoHandler handler) {
+    ws_.async_read(buffer, std::move(handler));
+}
+
+void BoostWebSocketStream::async_write(const net::const_buffer& buffer, IoHandler handler) {
+    ws_.text(true);
+    ws_.async_write(buffer, std::move(handler));
+}
+
+void BoostWebSocketStream::async_close(beast::websocket::close_code code,
+                                       std::function<void(beast::error_code)> handler) {
+    ws_.async_close(code, std::move(handler));
+}
+
+void BoostWebSocketStream::begin_batch() {
+    ws_.next_layer().cork();
+}
+
+void BoostWebSocketStream::end_batch() {
+    ws_.next_layer().uncork();
+}
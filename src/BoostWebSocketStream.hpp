@@ -2,6 +2,7 @@
 #define BOOSTWEBSOCKETSTREAM_HPP
 
 #include "IWebSocketStream.hpp"
+#include "CoalescingWriteStream.hpp"
 #include <boost/asio/io_context.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/asio/ip/tcp.hpp> // Required for tcp::socket
@@ -28,6 +29,11 @@ public:
     void write(const net::const_buffer& buffer, beast::error_code& ec) override;
     std::size_t read(beast::flat_buffer& buffer, beast::error_code& ec) override;
     void close(beast::websocket::close_code code, beast::error_code& ec) override;
+    void async_read(beast::flat_buffer& buffer, IoHandler handler) override;
+    void async_write(const net::const_buffer& buffer, IoHandler handler) override;
+    void async_close(beast::websocket::close_code code, std::function<void(beast::error_code)> handler) override;
+    void begin_batch() override;
+    void end_batch() override;
 
     // Helper to expose the underlying stream's next_layer for specific Boost operations if needed
     // This should be used sparingly and ideally not part of IWebSocketStream.
@@ -36,7 +42,9 @@ public:
     // BoostWebSocketStream is concrete, so it can expose this.
 
 private:
-    beast::websocket::stream<tcp::socket> ws_;
+    // Asynchronous writes go through a coalescing layer so a batch of
+    // messages is sent with one socket write (see begin_batch/end_batch).
+    beast::websocket::stream<CoalescingWriteStream<tcp::socket>> ws_;
 };
 
 #endif // BOOSTWEBSOCKETSTREAM_HPP
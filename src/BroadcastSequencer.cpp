@@ -0,0 +1,136 @@
+// BroadcastSequencer.cpp
+#include "BroadcastSequencer.hpp"
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+std::size_t round_up_to_power_of_two(std::size_t n) {
+    std::size_t capacity = 1;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+} // namespace
+
+BroadcastSequencer::BroadcastSequencer(const std::vector<net::io_context*>& contexts, bool owns_sessions,
+                                       std::size_t capacity, std::uint64_t last_seq)
+    : slots_(round_up_to_power_of_two(std::max<std::size_t>(capacity, 2))),
+      mask_(slots_.size() - 1),
+      owns_sessions_(owns_sessions),
+      published_(last_seq) {
+    for (auto* context : contexts) {
+        consumers_.push_back(std::make_unique<Consumer>());
+        consumers_.back()->context = context;
+        consumers_.back()->cursor.store(last_seq, std::memory_order_relaxed);
+    }
+}
+
+void BroadcastSequencer::publish(std::uint64_t seq, std::shared_ptr<const std::string> message) {
+    // The slot still holds message seq - capacity until every consumer has
+    // handed that one out
+    if (seq > slowest() + slots_.size()) {
+        ++writer_drains_;
+        for (auto& consumer : consumers_) {
+            if (seq > consumer->cursor.load(std::memory_order_acquire) + slots_.size()) {
+                drain(*consumer);
+            }
+        }
+    }
+    slots_[seq & mask_] = std::move(message);
+    published_.store(seq, std::memory_order_release);
+}
+
+void BroadcastSequencer::notify() {
+    for (auto& consumer : consumers_) {
+        // A drain that is posted but not started hands this message out too
+        if (consumer->scheduled.exchange(true)) {
+            continue;
+        }
+        net::post(*consumer->context, [this, c = consumer.get()] {
+            // Before reading the published cursor: a message published after
+            // that read finds the flag clear and posts another drain
+            c->scheduled.exchange(false);
+            drain(*c);
+        });
+    }
+}
+
+void BroadcastSequencer::drain(Consumer& consumer) {
+    std::lock_guard<std::mutex> lock(consumer.mutex);
+    auto const from = consumer.cursor.load(std::memory_order_relaxed);
+    auto const to = published_.load(std::memory_order_acquire);
+    if (to <= from) {
+        return;
+    }
+    auto batch = std::make_shared<MessageBatch>();
+    batch->reserve(to - from);
+    for (auto seq = from + 1; seq <= to; ++seq) {
+        batch->push_back(slots_[seq & mask_]);
+    }
+    consumer.cursor.store(to, std::memory_order_release); // The slots may be reused now
+
+    std::shared_ptr<const MessageBatch> all(std::move(batch));
+    bool const on_owner = owns_sessions_ && consumer.context->get_executor().running_in_this_thread();
+    for (auto const& [session, subscriber] : consumer.sessions) {
+        if (subscriber.after_seq >= to) {
+            continue; // Joined after all of these
+        }
+        auto messages = all;
+        if (subscriber.after_seq > from) {
+            messages = std::make_shared<const MessageBatch>(all->begin() + (subscriber.after_seq - from), all->end());
+        }
+        if (on_owner && subscriber.owned) {
+            session->deliver(messages, Lane::chat);
+        } else {
+            session->send(std::move(messages), Lane::chat);
+        }
+    }
+}
+
+void BroadcastSequencer::add(const std::shared_ptr<Session>& session, std::uint64_t after_seq) {
+    Consumer* consumer = consumers_.front().get();
+    if (owns_sessions_) {
+        for (auto& c : consumers_) {
+            if (c->context == &session->context()) {
+                consumer = c.get();
+                break;
+            }
+        }
+    } else {
+        consumer = consumers_[next_consumer_++ % consumers_.size()].get();
+    }
+    std::lock_guard<std::mutex> lock(consumer->mutex);
+    consumer->sessions[session] = Subscriber{after_seq, consumer->context == &session->context()};
+    consumer_of_[session.get()] = consumer;
+}
+
+void BroadcastSequencer::remove(const std::shared_ptr<Session>& session) {
+    auto const it = consumer_of_.find(session.get());
+    if (it == consumer_of_.end()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(it->second->mutex);
+    it->second->sessions.erase(session);
+    consumer_of_.erase(it);
+}
+
+std::uint64_t BroadcastSequencer::slowest() const {
+    auto cursor = std::numeric_limits<std::uint64_t>::max();
+    for (auto const& consumer : consumers_) {
+        cursor = std::min(cursor, consumer->cursor.load(std::memory_order_acquire));
+    }
+    return cursor;
+}
+
+BroadcastSequencer::Stats BroadcastSequencer::stats() const {
+    Stats stats;
+    stats.capacity = slots_.size();
+    stats.published = published_.load(std::memory_order_acquire);
+    stats.lag = stats.published - std::min(stats.published, slowest());
+    stats.writer_drains = writer_drains_;
+    return stats;
+}
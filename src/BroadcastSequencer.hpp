@@ -0,0 +1,98 @@
+// BroadcastSequencer.hpp
+#ifndef BROADCAST_SEQUENCER_HPP
+#define BROADCAST_SEQUENCER_HPP
+
+#include "Session.hpp"
+#include <boost/asio/io_context.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace net = boost::asio;
+
+// Fan-out of room messages through a preallocated ring, in the manner of the
+// LMAX disruptor (--sequencer=ring). ChatServer numbers each message and
+// writes it into the ring slot for its number under the session lock, which
+// makes it the ring's single writer. That is all the lock covers; the
+// fan-out itself happens afterwards, on the consumers.
+//
+// Each consumer serves a share of the sessions on its own io_context. It
+// follows the ring's published cursor and hands each of its sessions
+// everything it has not had yet, as one MessageBatch per drain. Every
+// consumer reads the same ring, so every session sees room messages in
+// sequence order, and a backlog is handed over in one go instead of message
+// by message.
+//
+// A slot is reused only once every consumer has moved past it. A writer that
+// finds the ring full drains the lagging consumers itself. Draining away
+// from a consumer's own thread only posts to sessions' strands, so any
+// thread may do it, and the writer never waits for another thread while it
+// holds the lock.
+class BroadcastSequencer {
+public:
+    struct Stats {
+        std::size_t capacity = 0;
+        std::uint64_t published = 0;     // Last sequence number written
+        std::uint64_t lag = 0;           // Messages the slowest consumer has yet to hand out
+        std::uint64_t writer_drains = 0; // Times a writer found the ring full
+    };
+
+    // A consumer per context. With `owns_sessions`, each context is run by
+    // a single thread that owns the sessions made on it (IoContextPool), so
+    // its consumer queues messages for them directly (Session::deliver)
+    // rather than posting. `capacity` is rounded up to a power of two.
+    // Numbering continues after `last_seq`.
+    BroadcastSequencer(const std::vector<net::io_context*>& contexts, bool owns_sessions, std::size_t capacity,
+                       std::uint64_t last_seq);
+
+    BroadcastSequencer(const BroadcastSequencer&) = delete;
+    BroadcastSequencer& operator=(const BroadcastSequencer&) = delete;
+
+    // The calls below must not run concurrently with each other; ChatServer
+    // makes them under its session lock.
+
+    // Writes message number `seq`, the one after the last published
+    void publish(std::uint64_t seq, std::shared_ptr<const std::string> message);
+    // Wakes the consumers for what was published since the last call
+    void notify();
+    // From now on `session` is sent every message after `after_seq`. With
+    // `owns_sessions` the consumer on the session's context serves it (the
+    // first one, for a context not among them); otherwise they take turns.
+    void add(const std::shared_ptr<Session>& session, std::uint64_t after_seq);
+    void remove(const std::shared_ptr<Session>& session);
+    Stats stats() const;
+
+private:
+    struct Subscriber {
+        std::uint64_t after_seq;
+        bool owned; // Lives on the consumer's context
+    };
+
+    struct alignas(64) Consumer {
+        net::io_context* context = nullptr;
+        std::atomic<std::uint64_t> cursor{0}; // Last sequence number handed out
+        std::atomic<bool> scheduled{false};   // A drain is posted and has not started
+        std::mutex mutex;                     // Serializes drains; guards sessions
+        std::unordered_map<std::shared_ptr<Session>, Subscriber> sessions;
+    };
+
+    // Hands out everything published past the consumer's cursor
+    void drain(Consumer& consumer);
+    std::uint64_t slowest() const;
+
+    std::vector<std::shared_ptr<const std::string>> slots_;
+    std::uint64_t mask_;
+    bool owns_sessions_;
+    alignas(64) std::atomic<std::uint64_t> published_;
+    std::uint64_t writer_drains_ = 0;
+    std::vector<std::unique_ptr<Consumer>> consumers_;
+    std::size_t next_consumer_ = 0;
+    std::unordered_map<Session*, Consumer*> consumer_of_;
+};
+
+#endif // BROADCAST_SEQUENCER_HPP
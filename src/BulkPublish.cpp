@@ -0,0 +1,171 @@
+// BulkPublish.cpp
+#include "BulkPublish.hpp"
+#include "ChatServer.hpp"
+#include <boost/json.hpp>
+
+namespace json = boost::json;
+
+namespace {
+
+const char* const kDefaultUserId = "publisher";
+
+std::string error_json(const char* error) {
+    return json::serialize(json::object{{"error", error}});
+}
+
+// Why `item` is not a message, or empty if it is one
+std::string to_message(const json::value& item, BulkPublish::Message& message) {
+    const json::object* object = item.if_object();
+    if (!object) {
+        return "not a JSON object";
+    }
+    const json::value* text = object->if_contains("text");
+    if (!text || !text->is_string()) {
+        return "missing or invalid \"text\"";
+    }
+    const json::value* user_id = object->if_contains("user_id");
+    if (user_id && (!user_id->is_string() || user_id->as_string().empty())) {
+        return "invalid \"user_id\"";
+    }
+    const json::value* nickname = object->if_contains("nickname");
+    if (nickname && (!nickname->is_string() || nickname->as_string().empty())) {
+        return "invalid \"nickname\"";
+    }
+    message.text.assign(text->as_string().data(), text->as_string().size());
+    if (user_id) {
+        message.user_id.assign(user_id->as_string().data(), user_id->as_string().size());
+    } else {
+        message.user_id = kDefaultUserId;
+    }
+    if (nickname) {
+        message.nickname.assign(nickname->as_string().data(), nickname->as_string().size());
+    } else {
+        message.nickname = message.user_id;
+    }
+    return {};
+}
+
+void add_item(const json::value& item, BulkPublish::Batch& batch) {
+    BulkPublish::Message message;
+    auto error = to_message(item, message);
+    if (error.empty()) {
+        batch.messages.push_back(std::move(message));
+    }
+    batch.errors.push_back(std::move(error));
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+} // namespace
+
+namespace BulkPublish {
+
+bool parse(const std::string& body, Batch& batch, std::string& error) {
+    std::size_t first = 0;
+    while (first < body.size() && is_space(body[first])) {
+        ++first;
+    }
+
+    if (first < body.size() && body[first] == '[') {
+        boost::system::error_code ec;
+        json::value parsed = json::parse(body, ec);
+        if (ec) {
+            error = "invalid JSON array: " + ec.message();
+            return false;
+        }
+        for (auto const& item : parsed.as_array()) {
+            add_item(item, batch);
+        }
+    } else {
+        // NDJSON: an item per line; a malformed line only rejects its item
+        for (std::size_t begin = first; begin < body.size();) {
+            auto end = body.find('\n', begin);
+            if (end == std::string::npos) {
+                end = body.size();
+            }
+            json::string_view line(body.data() + begin, end - begin);
+            begin = end + 1;
+            while (!line.empty() && is_space(line.back())) {
+                line.remove_suffix(1);
+            }
+            if (line.empty()) {
+                continue; // Blank lines are not items
+            }
+            boost::system::error_code ec;
+            json::value item = json::parse(line, ec);
+            if (ec) {
+                batch.errors.push_back("invalid JSON: " + ec.message());
+                continue;
+            }
+            add_item(item, batch);
+        }
+    }
+
+    if (batch.errors.empty()) {
+        error = "no messages";
+        return false;
+    }
+    return true;
+}
+
+bool authorized(const std::string& authorization, const std::string& token) {
+    static const std::string kScheme = "Bearer ";
+    if (token.empty() || authorization.size() != kScheme.size() + token.size()
+        || authorization.compare(0, kScheme.size(), kScheme) != 0) {
+        return false;
+    }
+    // Every byte is looked at, so the time taken does not tell how much of
+    // a guess was right
+    unsigned char difference = 0;
+    for (std::size_t i = 0; i < token.size(); ++i) {
+        difference |= static_cast<unsigned char>(authorization[kScheme.size() + i] ^ token[i]);
+    }
+    return difference == 0;
+}
+
+void respond(ChatServer& server, const http::request<http::string_body>& request,
+             http::response<http::string_body>& response) {
+    response.set(http::field::content_type, "application/json");
+    if (request.method() != http::verb::post) {
+        response.result(http::status::method_not_allowed);
+        response.set(http::field::allow, "POST");
+        response.body() = error_json("use POST");
+        return;
+    }
+    if (!authorized(std::string(request[http::field::authorization]), server.options().publish_token)) {
+        response.result(http::status::unauthorized);
+        response.set(http::field::www_authenticate, "Bearer");
+        response.body() = error_json("missing or wrong bearer token");
+        return;
+    }
+
+    Batch batch;
+    std::string error;
+    if (!parse(request.body(), batch, error)) {
+        response.result(http::status::bad_request);
+        response.body() = error_json(error.c_str());
+        return;
+    }
+    auto const seqs = server.publish_batch(batch.messages);
+
+    json::array results;
+    results.reserve(batch.errors.size());
+    std::size_t published = 0;
+    for (auto const& item_error : batch.errors) {
+        if (item_error.empty()) {
+            results.push_back(json::object{{"seq", seqs[published++]}});
+        } else {
+            results.push_back(json::object{{"error", item_error}});
+        }
+    }
+    response.result(http::status::ok);
+    response.body() = json::serialize(json::object{
+        {"published", published},
+        {"rejected", batch.errors.size() - published},
+        {"results", std::move(results)}
+    });
+}
+
+} // namespace BulkPublish
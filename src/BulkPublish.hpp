@@ -0,0 +1,54 @@
+// BulkPublish.hpp
+#ifndef BULK_PUBLISH_HPP
+#define BULK_PUBLISH_HPP
+
+#include <boost/beast/http.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ChatServer;
+
+namespace http = boost::beast::http;
+
+// POST /publish (--publish-token): backends post a batch of chat messages
+// over plain HTTP instead of sending them one by one over a WebSocket. The
+// body is a JSON array of objects or NDJSON, one object per line:
+//
+//   {"text": "Deploy finished", "user_id": "ci", "nickname": "CI"}
+//
+// `text` is required; `user_id` and `nickname` default to "publisher" and
+// to the user id. Accepted messages are broadcast as
+// server_broadcast_message, in order, and kept for history queries like
+// any chat message. The response lists a result per item, {"seq": <n>} or
+// {"error": "..."}, in the order the items were posted.
+namespace BulkPublish {
+
+struct Message {
+    std::string user_id;
+    std::string nickname;
+    std::string text;
+};
+
+struct Batch {
+    std::vector<Message> messages; // The accepted items, in order
+    // An entry per posted item: empty if it was accepted, else why not
+    std::vector<std::string> errors;
+};
+
+// Parses a request body. Items that are not valid messages are rejected one
+// by one; false (with `error` set) means the body as a whole is unusable:
+// malformed JSON array, or no items at all.
+bool parse(const std::string& body, Batch& batch, std::string& error);
+
+// True if `authorization` is "Bearer <token>", compared in constant time
+bool authorized(const std::string& authorization, const std::string& token);
+
+// Answers a request to /publish: checks the method and token, parses the
+// body, publishes the batch through `server` and fills in `response`.
+void respond(ChatServer& server, const http::request<http::string_body>& request,
+             http::response<http::string_body>& response);
+
+} // namespace BulkPublish
+
+#endif // BULK_PUBLISH_HPP
@@ -0,0 +1,37 @@
+// BusyPoll.cpp
+#include "BusyPoll.hpp"
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CHAT_CPU_RELAX() _mm_pause()
+#else
+#define CHAT_CPU_RELAX() ((void)0)
+#endif
+
+std::size_t BusyPoll::run(net::io_context& ioc, std::chrono::microseconds spin) {
+    if (spin.count() <= 0) {
+        return ioc.run();
+    }
+    using clock = std::chrono::steady_clock;
+    std::size_t handled = 0;
+    while (!ioc.stopped()) {
+        // poll() checks the reactor without waiting; it stops the context
+        // once there is no work left at all, as run() would return
+        auto deadline = clock::now() + spin;
+        while (!ioc.stopped()) {
+            if (std::size_t const n = ioc.poll()) {
+                handled += n;
+                deadline = clock::now() + spin;
+            } else if (clock::now() >= deadline) {
+                break;
+            } else {
+                CHAT_CPU_RELAX(); // Spares the sibling hyperthread
+            }
+        }
+        if (ioc.stopped()) {
+            break;
+        }
+        // Quiet for a whole window: sleep until the next handler
+        handled += ioc.run_one();
+    }
+    return handled;
+}
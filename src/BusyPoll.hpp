@@ -0,0 +1,24 @@
+// BusyPoll.hpp
+#ifndef BUSY_POLL_HPP
+#define BUSY_POLL_HPP
+
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <cstddef>
+
+namespace net = boost::asio;
+
+// The low-latency run mode (--busy-poll-us). An I/O thread that has run out
+// of ready handlers keeps polling its io_context for `spin` before it blocks
+// in the reactor, so a message arriving within that window is picked up
+// without an epoll_wait wakeup. Every handler run restarts the window. The
+// price is a busy CPU per I/O thread for as long as traffic keeps coming.
+namespace BusyPoll {
+
+// Runs `ioc` until it is stopped or out of work, like io_context::run();
+// a `spin` of 0 is exactly run(). Returns the number of handlers run.
+std::size_t run(net::io_context& ioc, std::chrono::microseconds spin);
+
+} // namespace BusyPoll
+
+#endif // BUSY_POLL_HPP
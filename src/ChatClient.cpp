@@ -3,6 +3,7 @@
 #include <boost/asio/ip/tcp.hpp>   // For tcp::resolver
 #include <boost/format.hpp> 
 #include <iostream> 
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
@@ -290,3 +291,148 @@ void ChatClient::run(std::istream& input, std::ostream& output) {
     // Final message to user's output stream
     output << ChatClient::getCurrentTimestamp() << " Disconnected." << std::endl;
 }
+
+// ---------------------------------------------------------------------------
+// Full-duplex asynchronous API
+// ---------------------------------------------------------------------------
+
+net::io_context& ChatClient::io_context() {
+    return ioc_for_stream_;
+}
+
+void ChatClient::set_max_batch(std::size_t max_batch) {
+    max_batch_ = std::max<std::size_t>(1, max_batch);
+}
+
+void ChatClient::start(MessageHandler on_message, ErrorHandler on_error) {
+    on_message_ = std::move(on_message);
+    on_error_ = std::move(on_error);
+    if (!is_connected()) {
+        log("Cannot start read loop: Not connected or stream not initialized.", true);
+        return;
+    }
+    net::post(ioc_for_stream_, [this] { do_read(); });
+}
+
+void ChatClient::post(std::string message) {
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        outbox_.push_back(std::move(message));
+        schedule = !flush_scheduled_;
+        flush_scheduled_ = true;
+    }
+    // One posted flush picks up everything queued until it runs.
+    if (schedule) {
+        net::post(ioc_for_stream_, [this] { do_flush(); });
+    }
+}
+
+void ChatClient::async_close() {
+    net::post(ioc_for_stream_, [this] {
+        if (closing_) {
+            return;
+        }
+        closing_ = true;
+        do_flush(); // Queued messages go out before the close frame
+    });
+}
+
+void ChatClient::do_read() {
+    ws_impl_->async_read(read_buffer_, [this](beast::error_code ec, std::size_t bytes_transferred) {
+        on_read(ec, bytes_transferred);
+    });
+}
+
+void ChatClient::on_read(beast::error_code ec, std::size_t bytes_transferred) {
+    boost::ignore_unused(bytes_transferred);
+    if (ec) {
+        if (closing_ && (ec == websocket::error::closed || ec == net::error::operation_aborted)) {
+            connected_ = false; // Our own close completed
+            return;
+        }
+        fail(ec);
+        return;
+    }
+    std::string message = beast::buffers_to_string(read_buffer_.data());
+    read_buffer_.consume(read_buffer_.size());
+    if (on_message_) {
+        on_message_(message);
+    }
+    do_read();
+}
+
+void ChatClient::do_flush() {
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        flush_scheduled_ = false;
+        for (auto& message : outbox_) {
+            sending_.push_back(std::move(message));
+        }
+        outbox_.clear();
+    }
+    if (!writing_) {
+        write_next();
+    }
+}
+
+void ChatClient::write_next() {
+    if (failed_ || close_sent_) {
+        sending_.clear();
+        return;
+    }
+    if (sending_.empty()) {
+        if (closing_) {
+            do_close();
+        }
+        return;
+    }
+    // Open a batch: the next max_batch_ messages are written back to back and
+    // the stream sends their frames together when the batch ends.
+    if (batch_remaining_ == 0) {
+        batch_remaining_ = std::min(max_batch_, sending_.size());
+        ws_impl_->begin_batch();
+    }
+    writing_ = true;
+    ws_impl_->async_write(net::buffer(sending_.front()), [this](beast::error_code ec, std::size_t bytes_transferred) {
+        on_write(ec, bytes_transferred);
+    });
+}
+
+void ChatClient::on_write(beast::error_code ec, std::size_t bytes_transferred) {
+    boost::ignore_unused(bytes_transferred);
+    writing_ = false;
+    if (ec) {
+        fail(ec);
+        return;
+    }
+    sending_.pop_front();
+    ++messages_sent_;
+    if (--batch_remaining_ == 0) {
+        ws_impl_->end_batch();
+        ++batches_flushed_;
+    }
+    write_next();
+}
+
+void ChatClient::do_close() {
+    close_sent_ = true;
+    ws_impl_->async_close(websocket::close_code::normal, [this](beast::error_code ec) {
+        if (ec) {
+            log("Error during WebSocket close: " + ec.message(), true);
+        }
+        connected_ = false;
+    });
+}
+
+void ChatClient::fail(beast::error_code ec) {
+    if (failed_) {
+        return;
+    }
+    failed_ = true;
+    connected_ = false;
+    log("Connection lost: " + ec.message(), ec != websocket::error::closed);
+    if (on_error_) {
+        on_error_(ec);
+    }
+}
@@ -10,6 +10,10 @@
 #include <boost/asio/connect.hpp> 
 #include <boost/asio/ip/tcp.hpp>  
 #include <memory> // For std::unique_ptr
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include "IWebSocketStream.hpp" // Include the new interface
 
 namespace beast = boost::beast;
@@ -34,6 +38,26 @@ public:
     void run(std::istream& input, std::ostream& output); // New signature
     bool is_connected() const;
 
+    // Full-duplex asynchronous API, for bots and integration tests.
+    // start() arms a read loop that hands every inbound message to
+    // `on_message`; `on_error` is called once if the connection fails or the
+    // server closes it. post() queues an outbound message and may be called
+    // from any thread: queued messages are pipelined back to back, and up to
+    // max_batch of them leave in a single flush. All callbacks run on the
+    // client's io_context, which the caller runs (see io_context()).
+    using MessageHandler = std::function<void(const std::string&)>;
+    using ErrorHandler = std::function<void(beast::error_code)>;
+    void start(MessageHandler on_message, ErrorHandler on_error = nullptr);
+    void post(std::string message);
+    void async_close(); // Sends everything queued, then closes the websocket
+    void set_max_batch(std::size_t max_batch);
+    net::io_context& io_context();
+
+    // Counters for the asynchronous path (read them from the io_context thread
+    // or after it has stopped).
+    std::uint64_t messages_sent() const { return messages_sent_; }
+    std::uint64_t batches_flushed() const { return batches_flushed_; }
+
 private:
     // io_context might be owned by ChatClient or passed in, depending on design.
     // If BoostWebSocketStream needs an io_context, and ChatClient creates it,
@@ -44,11 +68,38 @@ private:
     net::io_context& ioc_for_stream_; // Reference for streams that need an external io_context
 
     std::unique_ptr<IWebSocketStream> ws_impl_;
-    bool connected_;
+    std::atomic<bool> connected_;
     std::string host_; 
     std::string port_;
 
     void log(const std::string& message, bool is_error = false);
+
+    // Asynchronous path; everything below runs on ioc_for_stream_.
+    void do_read();
+    void on_read(beast::error_code ec, std::size_t bytes_transferred);
+    void do_flush();
+    void write_next();
+    void on_write(beast::error_code ec, std::size_t bytes_transferred);
+    void do_close();
+    void fail(beast::error_code ec);
+
+    MessageHandler on_message_;
+    ErrorHandler on_error_;
+    beast::flat_buffer read_buffer_;
+
+    std::mutex outbox_mutex_;
+    std::vector<std::string> outbox_; // Filled by post(), guarded by outbox_mutex_
+    bool flush_scheduled_ = false;    // Guarded by outbox_mutex_
+
+    std::deque<std::string> sending_; // Taken from outbox_, written in order
+    std::size_t batch_remaining_ = 0; // Messages left in the current batch
+    std::size_t max_batch_ = 64;
+    bool writing_ = false;
+    bool closing_ = false;    // async_close() requested
+    bool close_sent_ = false; // Close frame handed to the stream
+    bool failed_ = false;
+    std::uint64_t messages_sent_ = 0;
+    std::uint64_t batches_flushed_ = 0;
 };
 
 #endif // CHATCLIENT_HPP
@@ -1,16 +1,37 @@
 // ChatServer.cpp
 #include "ChatServer.hpp"
+#include "AdminChannel.hpp"
 #include "Session.hpp"
+#include "CoroSession.hpp"
+#include "CpuPlacement.hpp"
+#include "MessageEncoder.hpp"
+#include "Probes.hpp"
+#include "ReadBufferPool.hpp"
+#include "ServerMessages.hpp"
+#include "SocketTuning.hpp"
 #include "Utils.hpp"      // For getCurrentTimestampISO8601
+#include <algorithm>
+#include <ctime>
 #include <iostream>
+#include <iterator>
+#include <random>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <boost/json.hpp> // For Boost.JSON
 
 namespace json = boost::json; // Add json namespace alias
 
-ChatServer::ChatServer(net::io_context& ioc, const tcp::endpoint& endpoint)
-    : ioc_(ioc), acceptor_(ioc) {
+ChatServer::ChatServer(net::io_context& ioc, const tcp::endpoint& endpoint,
+                       const ServerOptions& options)
+    : ioc_(ioc), options_(options), tracer_(static_cast<unsigned>(std::max(options.trace_sample, 0))),
+      acceptor_(ioc), local_acceptor_(ioc), presence_timer_(ioc), history_(options.resume_history), resume_timer_(ioc),
+      history_store_(options.history_retain) {
     beast::error_code ec;
 
+    if (options_.history_retain > 0) {
+        query_pool_ = std::make_unique<net::thread_pool>(static_cast<std::size_t>(std::max(options_.query_threads, 1)));
+    }
+
     // Open the acceptor
     acceptor_.open(endpoint.protocol(), ec);
     if (ec) {
@@ -25,6 +46,14 @@ ChatServer::ChatServer(net::io_context& ioc, const tcp::endpoint& endpoint)
         return;
     }
 
+    if (options_.reuseport) {
+        ec = CpuPlacement::set_reuse_port(acceptor_);
+        if (ec) {
+            std::cerr << "Failed to set SO_REUSEPORT: " << ec.message() << std::endl;
+            return;
+        }
+    }
+
     // Bind to the server address
     acceptor_.bind(endpoint, ec);
     if (ec) {
@@ -38,43 +67,300 @@ ChatServer::ChatServer(net::io_context& ioc, const tcp::endpoint& endpoint)
         std::cerr << "Failed to listen on acceptor: " << ec.message() << std::endl;
         return;
     }
+
+    if (!options_.unix_socket.empty()) {
+        open_local_listener();
+    }
+    if (!options_.admin_socket.empty()) {
+        admin_ = std::make_unique<AdminChannel>(*this, options_.admin_socket);
+    }
+}
+
+ChatServer::~ChatServer() {
+    // Unless another server has taken the path over since
+    struct stat current {};
+    if (local_acceptor_.is_open() && ::stat(options_.unix_socket.c_str(), &current) == 0
+        && current.st_ino == local_socket_inode_) {
+        ::unlink(options_.unix_socket.c_str());
+    }
+}
+
+void ChatServer::open_local_listener() {
+    struct stat existing {};
+    if (::lstat(options_.unix_socket.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        ::unlink(options_.unix_socket.c_str()); // Left behind by an earlier run
+    }
+    beast::error_code ec;
+    local_acceptor_.open(net::local::stream_protocol(), ec);
+    if (!ec) {
+        local_acceptor_.bind(net::local::stream_protocol::endpoint(options_.unix_socket), ec);
+    }
+    if (!ec) {
+        local_acceptor_.listen(net::socket_base::max_listen_connections, ec);
+    }
+    struct stat bound {};
+    if (!ec && ::stat(options_.unix_socket.c_str(), &bound) == 0) {
+        local_socket_inode_ = bound.st_ino;
+    }
+    if (ec) {
+        std::cerr << "Failed to listen on " << options_.unix_socket << ": " << ec.message() << std::endl;
+        local_acceptor_.close(ec);
+    }
+}
+
+ChatServer::ChatServer(IoContextPool& pool, const tcp::endpoint& endpoint, const ServerOptions& options)
+    : ChatServer(pool.get(0), endpoint, options) {
+    pool_ = &pool;
+    if (options_.reuseport && acceptor_.is_open()) {
+        open_listeners();
+    }
+}
+
+void ChatServer::open_listeners() {
+    // The other contexts listen on the port acceptor_ got
+    auto const endpoint = local_endpoint();
+    for (std::size_t i = 1; i < pool_->size(); ++i) {
+        auto listener = std::make_unique<tcp::acceptor>(pool_->get(i));
+        beast::error_code ec;
+        listener->open(endpoint.protocol(), ec);
+        if (!ec) {
+            listener->set_option(net::socket_base::reuse_address(true), ec);
+        }
+        if (!ec) {
+            ec = CpuPlacement::set_reuse_port(*listener);
+        }
+        if (!ec) {
+            listener->bind(endpoint, ec);
+        }
+        if (!ec) {
+            listener->listen(net::socket_base::max_listen_connections, ec);
+        }
+        if (ec) {
+            // acceptor_ alone still serves every connection
+            std::cerr << "Failed to open listener " << i << ": " << ec.message() << std::endl;
+            listeners_.clear();
+            return;
+        }
+        listeners_.push_back(std::move(listener));
+    }
+
+    if (options_.cpu_affinity.empty()) {
+        return;
+    }
+    auto const cpus = CpuPlacement::plan(options_, pool_->size());
+    for (std::size_t i = 0; i < pool_->size(); ++i) {
+        auto& listener = i == 0 ? acceptor_ : *listeners_[i - 1];
+        if (auto const ec = CpuPlacement::set_incoming_cpu(listener, cpus[i].front())) {
+            std::cerr << "Failed to set SO_INCOMING_CPU: " << ec.message() << std::endl;
+        }
+    }
 }
 
 void ChatServer::run() {
     if (acceptor_.is_open()) {
         do_accept();
     }
+    if (local_acceptor_.is_open()) {
+        do_accept_local();
+    }
+}
+
+tcp::endpoint ChatServer::local_endpoint() const {
+    beast::error_code ec;
+    return acceptor_.local_endpoint(ec);
 }
 
 void ChatServer::do_accept() {
+    if (!listeners_.empty()) {
+        // Every context accepts and serves its own connections
+        accept_on(acceptor_, pool_->get(0));
+        for (std::size_t i = 0; i < listeners_.size(); ++i) {
+            accept_on(*listeners_[i], pool_->get(i + 1));
+        }
+        return;
+    }
+    if (pool_) {
+        // The connection lives on the next context in the pool
+        net::io_context& context = pool_->next();
+        acceptor_.async_accept(
+            context,
+            beast::bind_front_handler(
+                &ChatServer::on_accept,
+                this,
+                &context));
+        return;
+    }
+
     // The new connection gets its own strand
     acceptor_.async_accept(
         net::make_strand(ioc_),
         beast::bind_front_handler(
             &ChatServer::on_accept,
-            this)); // Changed from shared_from_this() as ChatServer might not be a shared_ptr
+            this, // Changed from shared_from_this() as ChatServer might not be a shared_ptr
+            &ioc_));
+}
+
+void ChatServer::accept_on(tcp::acceptor& listener, net::io_context& context) {
+    listener.async_accept([this, &listener, &context](beast::error_code ec, tcp::socket socket) {
+        if (ec == net::error::operation_aborted) {
+            return;
+        }
+        accepted(context, ec, std::move(socket));
+        accept_on(listener, context);
+    });
+}
+
+void ChatServer::on_accept(net::io_context* context, beast::error_code ec, tcp::socket socket) {
+    accepted(*context, ec, std::move(socket));
+
+    // Accept another connection
+    do_accept();
 }
 
-void ChatServer::on_accept(beast::error_code ec, tcp::socket socket) {
+void ChatServer::accepted(net::io_context& context, beast::error_code ec, tcp::socket socket) {
     if (ec) {
         std::cerr << "Accept error: " << ec.message() << std::endl;
+        return;
+    }
+    CHAT_PROBE1(accept, socket.native_handle());
+    if (auto const tune_ec = SocketTuning::apply(socket, options_)) {
+        std::cerr << "Socket tuning error: " << tune_ec.message() << std::endl;
+    }
+    serve(context, SessionStream(std::move(socket)));
+}
+
+void ChatServer::do_accept_local() {
+    net::io_context& context = pool_ ? pool_->next() : ioc_;
+    auto handler = beast::bind_front_handler(&ChatServer::on_accept_local, this, &context);
+    if (pool_) {
+        local_acceptor_.async_accept(context, std::move(handler));
     } else {
-        // Create the session and run it, passing ioc_
-        auto new_session = std::make_shared<Session>(ioc_, std::move(socket), *this);
-        on_client_connect(new_session); // Add to set
-        new_session->run(); // Start the session
+        local_acceptor_.async_accept(net::make_strand(ioc_), std::move(handler));
     }
+}
 
-    // Accept another connection
-    do_accept();
+void ChatServer::on_accept_local(net::io_context* context, beast::error_code ec,
+                                 net::local::stream_protocol::socket socket) {
+    if (ec == net::error::operation_aborted) {
+        return;
+    }
+    if (ec) {
+        std::cerr << "Accept error on " << options_.unix_socket << ": " << ec.message() << std::endl;
+    } else {
+        CHAT_PROBE1(accept, socket.native_handle());
+        serve(*context, SessionStream(std::move(socket)));
+    }
+    do_accept_local();
+}
+
+void ChatServer::serve(net::io_context& context, SessionStream&& stream) {
+    if (pool_ && !context.get_executor().running_in_this_thread()) {
+        // Build the session on the thread that serves it, so its memory is
+        // allocated there (and on that thread's NUMA node)
+        net::post(context, [this, &context, stream = std::move(stream)]() mutable {
+            start_session(context, std::move(stream));
+        });
+        return;
+    }
+    start_session(context, std::move(stream));
+}
+
+void ChatServer::connect_simulated(net::io_context& context, SimulatedStream&& stream) {
+    start_session(context, SessionStream(std::move(stream)));
+}
+
+void ChatServer::start_session(net::io_context& context, SessionStream&& stream) {
+    // Create the session of the configured engine and run it
+    std::shared_ptr<Session> new_session;
+#if defined(CHAT_HAS_CORO_SESSION)
+    if (options_.session_engine == ServerOptions::SessionEngine::coroutine) {
+        new_session = std::make_shared<CoroSession>(context, std::move(stream), *this);
+    }
+#endif
+    if (!new_session) {
+        new_session = std::make_shared<Session>(context, std::move(stream), *this);
+    }
+    new_session->run(); // Registers itself once the websocket upgrade succeeds
+}
+
+namespace {
+
+// Resume tokens are 128 bits from the system's entropy source. Session IDs
+// are public and come from a fast per-thread generator whose state could be
+// recovered from enough of them, so tokens must not share it.
+std::string generate_resume_token() {
+    thread_local std::random_device entropy;
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string token(32, '0');
+    for (std::size_t i = 0; i < token.size(); i += 8) {
+        auto bits = entropy();
+        for (std::size_t j = 0; j < 8; ++j, bits >>= 4) {
+            token[i + j] = kHex[bits & 0xf];
+        }
+    }
+    return token;
+}
+
+// Bounds of client_query_history: results per query and per page
+constexpr std::size_t kMaxHistoryQueryLimit = 1000;
+constexpr std::size_t kDefaultHistoryPageSize = 50;
+constexpr std::size_t kMaxHistoryPageSize = 200;
+
+// Most recipients handed to one fan-out task, so that a huge broadcast does
+// not keep an I/O thread away from its own connections for too long.
+constexpr std::size_t kFanOutChunk = 1024;
+
+} // namespace
+
+// With a shared io_context every session is reached through send(), which
+// posts onto that session's strand: one handler per recipient. In the
+// per-thread model the recipients are grouped by the context that owns them
+// and each group travels as one task per chunk to that context's thread,
+// which queues the message for each session directly (Session::deliver).
+// Groups for different threads are processed in parallel; tasks for one
+// thread run in order, so consecutive broadcasts keep their order. A
+// MessageBatch travels the same way, all its messages in one handler.
+template <typename Sessions, typename Message>
+void ChatServer::fan_out(const Sessions& recipients, const Message& message, Lane lane) {
+    CHAT_PROBE1(broadcast_start, recipients.size());
+    if (!pool_) {
+        for (auto const& session_ptr : recipients) {
+            session_ptr->send(message, lane);
+        }
+        CHAT_PROBE1(broadcast_end, recipients.size());
+        return;
+    }
+
+    std::vector<std::vector<std::shared_ptr<Session>>> groups(pool_->size());
+    for (auto const& session_ptr : recipients) {
+        auto const index = pool_->index_of(session_ptr->context());
+        if (index == groups.size()) {
+            session_ptr->send(message, lane); // Not one of ours (e.g. created by a test)
+            continue;
+        }
+        groups[index].push_back(session_ptr);
+    }
+
+    for (std::size_t i = 0; i < groups.size(); ++i) {
+        auto& group = groups[i];
+        for (std::size_t begin = 0; begin < group.size(); begin += kFanOutChunk) {
+            auto const end = std::min(begin + kFanOutChunk, group.size());
+            std::vector<std::shared_ptr<Session>> chunk(std::make_move_iterator(group.begin() + begin),
+                                                        std::make_move_iterator(group.begin() + end));
+            net::post(pool_->get(i), [message, lane, chunk = std::move(chunk)] {
+                for (auto const& session_ptr : chunk) {
+                    session_ptr->deliver(message, lane);
+                }
+            });
+        }
+    }
+    CHAT_PROBE1(broadcast_end, recipients.size());
 }
 
 // Broadcast for system messages (no specific sender context for nickname)
 void ChatServer::broadcast(const std::string& message) {
-    auto const shared_message = std::make_shared<const std::string>(message);
-    for (auto session_ptr : sessions_) {
-        session_ptr->send(shared_message);
-    }
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    fan_out(sessions_, sequence(message), Lane::chat); // Sequenced, so in order with chat
 }
 
 // Broadcast for messages from a specific client, adding their nickname
@@ -82,6 +368,9 @@ void ChatServer::broadcast(const std::string& message_json_str, std::shared_ptr<
     if (!sender_session) return;
 
     std::string final_message_str;
+    bool chat_message = false; // Kept for history queries
+    std::string chat_text;
+    std::string nickname;
     try {
         json::value parsed_message = json::parse(message_json_str);
         json::object& msg_obj = parsed_message.as_object(); // Assuming root is an object
@@ -89,7 +378,12 @@ void ChatServer::broadcast(const std::string& message_json_str, std::shared_ptr<
         if (msg_obj.contains("type") && msg_obj.at("type").as_string() == "server_broadcast_message") {
             if (msg_obj.contains("payload") && msg_obj.at("payload").is_object()) {
                 json::object& payload_obj = msg_obj.at("payload").as_object();
-                payload_obj["nickname"] = sender_session->get_nickname(); // Add nickname
+                nickname = sender_session->get_nickname();
+                payload_obj["nickname"] = nickname; // Add nickname
+                if (auto const* text = payload_obj.if_contains("text"); text && text->is_string()) {
+                    chat_message = true;
+                    chat_text.assign(text->as_string().data(), text->as_string().size());
+                }
             }
         }
         // For other message types originating from a client, if any, we might add nickname too,
@@ -100,50 +394,525 @@ void ChatServer::broadcast(const std::string& message_json_str, std::shared_ptr<
         final_message_str = message_json_str; // Send original if modification fails
     }
 
-    auto const shared_final_message = std::make_shared<const std::string>(final_message_str);
-    for (auto session_ptr : sessions_) {
-        // Send to all sessions, including the sender, so sender also sees their nickname.
-        // If sender should be excluded for some messages, the calling context (e.g., Session::on_read)
-        // would need to use the system broadcast or handle it.
-        session_ptr->send(shared_final_message);
+    publish(final_message_str, *sender_session, chat_message ? &chat_text : nullptr, nickname);
+}
+
+void ChatServer::broadcast_chat(std::shared_ptr<Session> sender, const std::string& text) {
+    if (!sender) return;
+
+    auto const nickname = sender->get_nickname();
+    // Members in the order the overload above ends up with
+    publish(MessageEncoder::encode<ServerMessages::broadcast_message>(sender->get_id(), text,
+                                                                      Utils::getCurrentTimestampISO8601(), nickname),
+            *sender, &text, nickname);
+}
+
+std::vector<std::uint64_t> ChatServer::publish_batch(const std::vector<BulkPublish::Message>& messages) {
+    // Encoded before taking the lock; only numbering has to happen under it
+    auto const timestamp = Utils::getCurrentTimestampISO8601();
+    std::vector<std::string> encoded;
+    encoded.reserve(messages.size());
+    for (auto const& m : messages) {
+        encoded.push_back(
+            MessageEncoder::encode<ServerMessages::broadcast_message>(m.user_id, m.text, timestamp, m.nickname));
+    }
+
+    auto batch = std::make_shared<MessageBatch>();
+    batch->reserve(messages.size());
+    std::vector<std::uint64_t> seqs;
+    seqs.reserve(messages.size());
+    auto const now = static_cast<std::int64_t>(std::time(nullptr));
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    for (std::size_t i = 0; i < messages.size(); ++i) {
+        batch->push_back(sequence(encoded[i]));
+        seqs.push_back(history_.last_seq());
+        history_store_.append(seqs.back(), now, messages[i].user_id, messages[i].nickname, messages[i].text);
+    }
+    ++publish_batches_;
+    published_total_ += messages.size();
+    if (!batch->empty()) {
+        fan_out(sessions_, std::shared_ptr<const MessageBatch>(std::move(batch)), Lane::chat);
     }
+    return seqs;
 }
 
+void ChatServer::share_file(std::shared_ptr<Session> sender, const std::string& name, const std::string& mime,
+                            std::shared_ptr<const StreamedPayload> payload) {
+    if (!sender || !payload) return;
 
-void ChatServer::on_client_connect(std::shared_ptr<Session> session) {
-    sessions_.insert(session);
-    std::cout << "Client '" << session->get_id() << "' (Nick: '" << session->get_nickname() << "') added to active sessions. Total clients: " << sessions_.size() << std::endl;
-
-    // This message is now sent from Session::on_accept using its own session_id and initial nickname
-    // If we want ChatServer to broadcast this, it would look like:
-    json::object connected_json_obj = {
-        {"type", "server_client_connected"},
-        {"payload", {
-            {"user_id", session->get_id()},
-            {"nickname", session->get_nickname()}, // Add nickname here
-            {"message", "User has connected."},
-            {"timestamp", Utils::getCurrentTimestampISO8601()}
+    auto const size = payload->size();
+    // Not a room message: files are neither numbered nor replayed
+    auto const message = StreamedPayload::make_message(
+        MessageEncoder::encode<ServerMessages::file_shared>(sender->get_id(), sender->get_nickname(), name, mime, size,
+                                                            Utils::getCurrentTimestampISO8601()),
+        std::move(payload));
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    std::vector<std::shared_ptr<Session>> recipients;
+    recipients.reserve(sessions_.size());
+    for (auto const& session : sessions_) {
+        if (session != sender) {
+            recipients.push_back(session);
+        }
+    }
+    fan_out(recipients, message, Lane::bulk);
+}
+
+void ChatServer::publish(const std::string& message, Session& sender, const std::string* chat_text,
+                         const std::string& nickname) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    std::shared_ptr<const std::string> shared_final_message;
+    if (const MessageTrace* inbound = sender.inbound_trace()) {
+        // Sampled: the payload carries the stamps to every recipient's writer
+        MessageTrace trace = *inbound;
+        trace.enqueue_ns = LatencyTracer::now_ns();
+        tracer_.record(LatencyTracer::parse_to_enqueue, trace.enqueue_ns - trace.parse_ns);
+        shared_final_message = sequence(message, &trace);
+    } else {
+        shared_final_message = sequence(message);
+    }
+    if (chat_text) {
+        history_store_.append(history_.last_seq(), static_cast<std::int64_t>(std::time(nullptr)), sender.get_id(),
+                              nickname, *chat_text);
+    }
+    // Send to all sessions, including the sender, so sender also sees their nickname.
+    // If sender should be excluded for some messages, the calling context (e.g., Session::on_read)
+    // would need to use the system broadcast or handle it.
+    fan_out(sessions_, shared_final_message, Lane::chat);
+}
+
+// Room messages carry their sequence number as the first member,
+// {"seq":42,"type":...}, so that a client can tell how far it got when it
+// resumes. The numbering happens under the session lock, in the order the
+// messages are fanned out.
+std::shared_ptr<const std::string> ChatServer::sequence(const std::string& message, const MessageTrace* trace) {
+    std::string numbered;
+    if (!message.empty() && message.front() == '{') {
+        auto const seq = std::to_string(history_.next_seq());
+        numbered.reserve(message.size() + seq.size() + 8);
+        numbered += "{\"seq\":";
+        numbered += seq;
+        if (message.size() > 2) {
+            numbered += ',';
+        }
+        numbered.append(message, 1, std::string::npos);
+    } else {
+        numbered = message; // Not a JSON object; numbered but sent as is
+    }
+
+    if (!trace) {
+        auto shared = std::make_shared<const std::string>(std::move(numbered));
+        history_.append(shared);
+        return shared;
+    }
+    // Replays go out without the trace stamps
+    history_.append(std::make_shared<const std::string>(numbered));
+    return LatencyTracer::make_traced(std::move(numbered), *trace);
+}
+
+// Results are serialized like the broadcasts they were, and pages go out as
+// they are ready. The query holds the store's shared lock only: chat
+// messages keep being appended meanwhile, and nothing waits on the I/O
+// threads.
+void ChatServer::query_history(std::shared_ptr<Session> session, const std::string& query_id, HistoryQuery query,
+                               std::size_t page_size) {
+    query.limit = std::clamp<std::size_t>(query.limit, 1, kMaxHistoryQueryLimit);
+    page_size = std::clamp<std::size_t>(page_size ? page_size : kDefaultHistoryPageSize, 1, kMaxHistoryPageSize);
+    if (!query_pool_) {
+        json::object refused = {
+            {"type", "server_history_page"},
+            {"payload", {
+                {"query_id", query_id},
+                {"error", "History is not kept on this server."}
+            }}
+        };
+        session->send(std::make_shared<const std::string>(json::serialize(refused)), Lane::bulk);
+        return;
+    }
+
+    net::post(*query_pool_, [this, session = std::move(session), query_id, query = std::move(query), page_size] {
+        auto const results = history_store_.query(query);
+        // A full result may have more behind it: the client pages on with
+        // before_seq set to the oldest seq it got.
+        json::value next_before_seq = nullptr;
+        if (results.size() == query.limit) {
+            next_before_seq = results.back().seq;
+        }
+        std::size_t page = 0;
+        std::size_t begin = 0;
+        do {
+            auto const end = std::min(begin + page_size, results.size());
+            json::array messages;
+            messages.reserve(end - begin);
+            for (std::size_t i = begin; i < end; ++i) {
+                auto const& entry = results[i];
+                messages.push_back(json::object{
+                    {"seq", entry.seq},
+                    {"type", "server_broadcast_message"},
+                    {"payload", {
+                        {"user_id", entry.user_id},
+                        {"text", entry.text},
+                        {"timestamp", Utils::formatTimestampISO8601(static_cast<std::time_t>(entry.time))},
+                        {"nickname", entry.nickname}
+                    }}
+                });
+            }
+            bool const done = end == results.size();
+            json::object reply = {
+                {"type", "server_history_page"},
+                {"payload", {
+                    {"query_id", query_id},
+                    {"page", page},
+                    {"messages", std::move(messages)},
+                    {"done", done},
+                    {"next_before_seq", done ? next_before_seq : json::value(nullptr)}
+                }}
+            };
+            session->send(std::make_shared<const std::string>(json::serialize(reply)), Lane::bulk);
+            ++page;
+            begin = end;
+        } while (begin < results.size());
+    });
+}
+
+std::string ChatServer::stats_json() {
+    std::size_t sessions = 0;
+    std::size_t parked = 0;
+    std::uint64_t resumed = 0;
+    std::uint64_t last_seq = 0;
+    std::uint64_t publish_batches = 0;
+    std::uint64_t published = 0;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions = sessions_.size();
+        publish_batches = publish_batches_;
+        published = published_total_;
+        parked = parked_.size();
+        resumed = resumed_total_;
+        last_seq = history_.last_seq();
+    }
+    auto const buffers = ReadBufferPool::stats();
+    auto const rss = Utils::residentSetBytes();
+    json::object stats = {
+        {"sessions", sessions},
+        {"latency", tracer_.to_json()},
+        {"memory", {
+            {"low_memory", options_.low_memory},
+            {"rss_bytes", rss},
+            {"rss_bytes_per_session", sessions ? rss / static_cast<std::int64_t>(sessions) : 0},
+            {"read_buffers_held", buffers.held_buffers},
+            {"read_buffer_bytes_held", buffers.held_bytes},
+            {"read_buffers_pooled", buffers.pooled_buffers}
+        }},
+        {"resume", {
+            {"parked", parked},
+            {"resumed", resumed},
+            {"last_seq", last_seq}
         }}
     };
+    if (options_.history_retain > 0) {
+        auto const history = history_store_.stats();
+        stats["history"] = {
+            {"messages", history.messages},
+            {"segments", history.segments},
+            {"text_bytes", history.text_bytes},
+            {"index_bytes", history.index_bytes}
+        };
+    }
+    if (!options_.publish_token.empty()) {
+        stats["publish"] = {
+            {"batches", publish_batches},
+            {"messages", published}
+        };
+    }
+    return json::serialize(stats);
+}
+
+std::vector<std::shared_ptr<Session>> ChatServer::sessions() {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    return std::vector<std::shared_ptr<Session>>(sessions_.begin(), sessions_.end());
+}
+
+void ChatServer::on_client_connect(std::shared_ptr<Session> session) {
+    std::size_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_.insert(session);
+        total = sessions_.size();
+        if (options_.presence_tick_ms > 0) {
+            // Announced with the next presence tick
+            pending_joined_order_.push_back(session);
+            pending_joined_.insert(session);
+            schedule_presence_flush();
+        }
+    }
+    std::cout << "Client '" << session->get_id() << "' (Nick: '" << session->get_nickname() << "') added to active sessions. Total clients: " << total << std::endl;
+    if (options_.presence_tick_ms > 0) {
+        return;
+    }
+
+    // Per-event presence (--presence-tick-ms=0)
     // This broadcast goes to ALL clients, including the new one.
     // The message is constructed here, so it uses the system broadcast.
-    broadcast(json::serialize(connected_json_obj));
+    broadcast(MessageEncoder::encode<ServerMessages::client_connected>(
+        session->get_id(), session->get_nickname(), "User has connected.", Utils::getCurrentTimestampISO8601()));
 }
 
-void ChatServer::on_client_disconnect(std::shared_ptr<Session> session) {
+void ChatServer::on_client_disconnect(std::shared_ptr<Session> session, bool resumable) {
     std::string session_id = session->get_id();
     std::string nickname = session->get_nickname(); // Get nickname before session is invalidated
-    sessions_.erase(session);
-    std::cout << "Client disconnected: " << session_id << " (Nick: '" << nickname << "'). Total clients: " << sessions_.size() << std::endl;
-
-    json::object disconnected_json = {
-        {"type", "server_client_disconnected"},
-        {"payload", {
-            {"user_id", session_id},
-            {"nickname", nickname}, // Add nickname here
-            {"message", "User has disconnected."},
-            {"timestamp", Utils::getCurrentTimestampISO8601()}
-        }}
-    };
-    broadcast(json::serialize(disconnected_json)); // Use system broadcast
+    std::size_t total = 0;
+    bool parked = false;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (sessions_.erase(session) == 0) {
+            return; // Already removed (e.g. both read and accept paths reported it, or it was resumed elsewhere)
+        }
+        total = sessions_.size();
+        CHAT_PROBE2(disconnect, session_id.c_str(), total);
+        pending_resumed_.erase(session);
+        const std::string& token = session->resume_token();
+        auto const live = resume_tokens_.find(token);
+        if (live != resume_tokens_.end() && live->second == session) {
+            resume_tokens_.erase(live);
+            // A client that is still waiting to be announced is not kept
+            if (resumable && options_.resume_grace_ms > 0 && pending_joined_.count(session) == 0) {
+                auto const expires = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.resume_grace_ms);
+                parked_[token] = ParkedSession{session_id, nickname, expires};
+                parked_order_.emplace_back(expires, token);
+                schedule_resume_expiry();
+                parked = true;
+            }
+        }
+        if (!parked && options_.presence_tick_ms > 0) {
+            // Joined and left within the same tick: nobody needs to hear about it
+            if (pending_joined_.erase(session) == 0) {
+                pending_left_.push_back({session_id, nickname});
+                schedule_presence_flush();
+            }
+        }
+    }
+    if (parked) {
+        // Still online for everyone else until the grace period is over
+        std::cout << "Client dropped: " << session_id << " (Nick: '" << nickname << "'), resumable for "
+                  << options_.resume_grace_ms << " ms. Total clients: " << total << std::endl;
+        return;
+    }
+    std::cout << "Client disconnected: " << session_id << " (Nick: '" << nickname << "'). Total clients: " << total << std::endl;
+    if (options_.presence_tick_ms > 0) {
+        return;
+    }
+
+    broadcast(MessageEncoder::encode<ServerMessages::client_disconnected>( // Use system broadcast
+        session_id, nickname, "User has disconnected.", Utils::getCurrentTimestampISO8601()));
+}
+
+void ChatServer::on_client_upgraded(std::shared_ptr<Session> session, const std::string& resume_token,
+                                    std::uint64_t last_seq) {
+    if (options_.resume_grace_ms <= 0) {
+        on_client_connect(session);
+        return;
+    }
+    if (!resume_token.empty() && resume_session(session, resume_token, last_seq)) {
+        return;
+    }
+
+    std::string token = generate_resume_token();
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        session->set_resume_token(token);
+        resume_tokens_[token] = session;
+        // On the session's strand: queued ahead of anything broadcast later
+        session->deliver(MessageEncoder::encode_shared<ServerMessages::session_welcome>(
+                             session->get_id(), session->get_nickname(), token, history_.last_seq(),
+                             options_.resume_grace_ms),
+                         Lane::control);
+    }
+    on_client_connect(session);
+}
+
+// Hands the identity behind `token` to `session`. The client may come back
+// before the server noticed that its old connection is gone; that connection
+// is then closed and quietly replaced.
+bool ChatServer::resume_session(const std::shared_ptr<Session>& session, const std::string& token,
+                                std::uint64_t last_seq) {
+    std::size_t total = 0;
+    std::size_t replayed = 0;
+    bool complete = true;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        std::string user_id;
+        std::string nickname;
+        if (auto live = resume_tokens_.find(token); live != resume_tokens_.end()) {
+            auto old = std::move(live->second);
+            resume_tokens_.erase(live);
+            sessions_.erase(old); // Its own disconnect is then a no-op
+            pending_resumed_.erase(old);
+            if (pending_joined_.erase(old)) {
+                pending_joined_.insert(session);
+                std::replace(pending_joined_order_.begin(), pending_joined_order_.end(), old, session);
+            }
+            user_id = old->get_id();
+            nickname = old->get_nickname();
+            old->drop_connection();
+        } else if (auto parked = parked_.find(token); parked != parked_.end()) {
+            user_id = std::move(parked->second.user_id);
+            nickname = std::move(parked->second.nickname);
+            parked_.erase(parked); // Its parked_order_ entry is skipped on expiry
+        } else {
+            return false; // Unknown or expired: the client starts over
+        }
+
+        session->resume_as(user_id, nickname, token);
+        resume_tokens_[token] = session;
+        sessions_.insert(session);
+        total = sessions_.size();
+        ++resumed_total_;
+
+        std::vector<std::shared_ptr<const std::string>> missed;
+        complete = history_.since(last_seq, missed);
+        replayed = missed.size();
+        // Queued directly on the session's strand, so everything broadcast
+        // from now on follows the replay.
+        session->deliver(MessageEncoder::encode_shared<ServerMessages::session_resumed>(
+                             user_id, nickname, token, history_.last_seq(), replayed, complete),
+                         Lane::control);
+        for (auto& message : missed) {
+            session->deliver(std::move(message), Lane::chat); // Ahead of the live messages that follow
+        }
+        if (options_.presence_tick_ms > 0 && pending_joined_.count(session) == 0) {
+            // Presence deltas are not replayed; the next tick's roster
+            // snapshot brings the client up to date.
+            pending_resumed_.insert(session);
+            schedule_presence_flush();
+        }
+    }
+    std::cout << "Client '" << session->get_id() << "' (Nick: '" << session->get_nickname() << "') resumed, "
+              << replayed << " message(s) replayed" << (complete ? "" : " (history exhausted)")
+              << ". Total clients: " << total << std::endl;
+    return true;
+}
+
+void ChatServer::schedule_resume_expiry() {
+    if (resume_timer_armed_ || parked_order_.empty()) {
+        return;
+    }
+    resume_timer_armed_ = true;
+    resume_timer_.expires_at(parked_order_.front().first);
+    resume_timer_.async_wait([this](beast::error_code ec) {
+        if (!ec) {
+            expire_parked_sessions();
+        }
+    });
+}
+
+// Clients whose grace period ran out leave for good: they are announced
+// like any other disconnect.
+void ChatServer::expire_parked_sessions() {
+    std::vector<ParkedSession> expired;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        resume_timer_armed_ = false;
+        auto const now = std::chrono::steady_clock::now();
+        while (!parked_order_.empty() && parked_order_.front().first <= now) {
+            auto const parked = parked_.find(parked_order_.front().second);
+            if (parked != parked_.end() && parked->second.expires == parked_order_.front().first) {
+                expired.push_back(std::move(parked->second));
+                parked_.erase(parked);
+            }
+            parked_order_.pop_front();
+        }
+        if (options_.presence_tick_ms > 0) {
+            for (auto const& gone : expired) {
+                pending_left_.push_back({gone.user_id, gone.nickname});
+            }
+            if (!expired.empty()) {
+                schedule_presence_flush();
+            }
+        }
+        schedule_resume_expiry();
+    }
+
+    for (auto const& gone : expired) {
+        std::cout << "Client disconnected: " << gone.user_id << " (Nick: '" << gone.nickname
+                  << "'), resume grace period over." << std::endl;
+        if (options_.presence_tick_ms > 0) {
+            continue;
+        }
+        broadcast(MessageEncoder::encode<ServerMessages::client_disconnected>(
+            gone.user_id, gone.nickname, "User has disconnected.", Utils::getCurrentTimestampISO8601()));
+    }
+}
+
+void ChatServer::schedule_presence_flush() {
+    if (presence_timer_armed_) {
+        return;
+    }
+    presence_timer_armed_ = true;
+    presence_timer_.expires_after(std::chrono::milliseconds(options_.presence_tick_ms));
+    presence_timer_.async_wait([this](beast::error_code ec) {
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            presence_timer_armed_ = false;
+        }
+        if (!ec) {
+            flush_presence();
+        }
+    });
+}
+
+void ChatServer::flush_presence() {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    if (pending_joined_.empty() && pending_left_.empty() && pending_resumed_.empty()) {
+        pending_joined_order_.clear();
+        return;
+    }
+
+    auto const timestamp = Utils::getCurrentTimestampISO8601();
+    // Users are [user_id, nickname] pairs to keep large rosters compact.
+
+    // Both messages are serialized once per tick and shared by all recipients.
+    std::shared_ptr<const std::string> delta;
+    bool const changed = !pending_joined_.empty() || !pending_left_.empty();
+    if (changed && sessions_.size() > pending_joined_.size() + pending_resumed_.size()) {
+        MessageEncoder::UserList joined;
+        for (auto const& session : pending_joined_order_) {
+            if (pending_joined_.count(session)) {
+                joined.emplace_back(session->get_id(), session->get_nickname());
+            }
+        }
+        MessageEncoder::UserList left;
+        left.reserve(pending_left_.size());
+        for (auto const& gone : pending_left_) {
+            left.emplace_back(gone.user_id, gone.nickname);
+        }
+        delta = MessageEncoder::encode_shared<ServerMessages::presence_delta>(joined, left, sessions_.size(), timestamp);
+    }
+
+    // Resumed clients get the snapshot too, without being announced
+    std::shared_ptr<const std::string> snapshot;
+    if (!pending_joined_.empty() || !pending_resumed_.empty()) {
+        MessageEncoder::UserList users;
+        users.reserve(sessions_.size());
+        for (auto const& session : sessions_) {
+            users.emplace_back(session->get_id(), session->get_nickname());
+        }
+        snapshot = MessageEncoder::encode_shared<ServerMessages::roster_snapshot>(users, timestamp);
+    }
+
+    std::vector<std::shared_ptr<Session>> joiners;
+    std::vector<std::shared_ptr<Session>> others;
+    for (auto const& session : sessions_) {
+        (pending_joined_.count(session) || pending_resumed_.count(session) ? joiners : others).push_back(session);
+    }
+    if (snapshot) {
+        fan_out(joiners, snapshot, Lane::presence);
+    }
+    if (delta) {
+        fan_out(others, delta, Lane::presence);
+    }
+
+    pending_joined_order_.clear();
+    pending_joined_.clear();
+    pending_resumed_.clear();
+    pending_left_.clear();
 }
@@ -2,13 +2,28 @@
 #ifndef CHAT_SERVER_HPP
 #define CHAT_SERVER_HPP
 
+#include "BulkPublish.hpp"
+#include "HistoryStore.hpp"
+#include "IoContextPool.hpp"
+#include "LatencyTracer.hpp"
+#include "MessageHistory.hpp"
+#include "OutboundLanes.hpp"
+#include "ServerOptions.hpp"
+#include "SessionStream.hpp"
+#include "StreamedPayload.hpp"
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <set>
 #include <memory>
+#include <mutex>
+#include <deque>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-// Forward declaration
+// Forward declarations
+class AdminChannel;
 class Session;
 
 namespace net = boost::asio;
@@ -17,22 +32,157 @@ using tcp = net::ip::tcp;
 
 class ChatServer {
 public:
-    ChatServer(net::io_context& ioc, const tcp::endpoint& endpoint);
+    ChatServer(net::io_context& ioc, const tcp::endpoint& endpoint,
+               const ServerOptions& options = ServerOptions());
+    // Per-thread I/O model: the acceptor runs on the pool's first context and
+    // new connections are spread over all of them.
+    ChatServer(IoContextPool& pool, const tcp::endpoint& endpoint,
+               const ServerOptions& options = ServerOptions());
+    ~ChatServer();
 
     void run();
+    tcp::endpoint local_endpoint() const; // Bound address (useful when binding port 0)
+    bool unix_socket_listening() const { return local_acceptor_.is_open(); } // --unix-socket
+    // Serves a simulated client (benchmarks, tests): `stream` is the server's
+    // end of a SimulatedStream pair, made with a strand of `context` as its
+    // executor, and is handled like an accepted connection on `context`.
+    void connect_simulated(net::io_context& context, SimulatedStream&& stream);
+    const ServerOptions& options() const { return options_; }
+    LatencyTracer& tracer() { return tracer_; }
+    // Body of GET /stats: session count and the latency histograms
+    std::string stats_json();
     // Overload broadcast: one for system messages, one for user messages that require sender info
     void broadcast(const std::string& message); // For system messages (no specific sender)
     void broadcast(const std::string& message, std::shared_ptr<Session> sender_session); // For user messages
+    // A chat message (client_send_message) from `sender`: sent to everyone as
+    // server_broadcast_message, the same message as the overload above
+    // makes, without parsing one first.
+    void broadcast_chat(std::shared_ptr<Session> sender, const std::string& text);
+    // A file from `sender` (client_share_file): every other client is sent
+    // server_file_shared followed by the file as one binary message, in the
+    // bulk lane. They all write the same payload; nothing is copied.
+    void share_file(std::shared_ptr<Session> sender, const std::string& name, const std::string& mime,
+                    std::shared_ptr<const StreamedPayload> payload);
+    // Messages posted to POST /publish: broadcast as server_broadcast_message
+    // in order, like chat from clients with their identities, and recorded
+    // for history queries. They are numbered under one lock and each session
+    // is handed the whole batch at once. Returns their sequence numbers.
+    std::vector<std::uint64_t> publish_batch(const std::vector<BulkPublish::Message>& messages);
+    // The clients connected now, e.g. for the admin channel
+    std::vector<std::shared_ptr<Session>> sessions();
     void on_client_connect(std::shared_ptr<Session> session);
-    void on_client_disconnect(std::shared_ptr<Session> session);
+    // `resumable`: the connection dropped without a close frame. With
+    // --resume-grace-ms the client then stays online for the grace period in
+    // case it comes back (on_client_upgraded).
+    void on_client_disconnect(std::shared_ptr<Session> session, bool resumable = false);
+    // Called by a session once its websocket upgrade succeeded. If
+    // `resume_token` names a session that is live or within its grace period,
+    // `session` takes over its identity, is sent server_session_resumed and
+    // every room message after `last_seq`, and nobody sees presence change.
+    // Otherwise it joins as a new client (on_client_connect) and is sent
+    // server_session_welcome with a fresh token.
+    void on_client_upgraded(std::shared_ptr<Session> session, const std::string& resume_token,
+                            std::uint64_t last_seq);
+
+    // Sends the presence changes gathered since the last tick: one
+    // server_presence_delta to every existing client and one shared
+    // server_roster_snapshot to every client that joined meanwhile. Called by
+    // the presence timer; public so tests can drive ticks deterministically.
+    void flush_presence();
+
+    // Runs `query` on a query thread and sends the results to `session`, as
+    // server_history_page messages of up to `page_size` messages each.
+    // `limit` and `page_size` are clamped to what the server allows.
+    void query_history(std::shared_ptr<Session> session, const std::string& query_id, HistoryQuery query,
+                       std::size_t page_size);
 
 private:
     void do_accept();
-    void on_accept(beast::error_code ec, tcp::socket socket);
+    void on_accept(net::io_context* context, beast::error_code ec, tcp::socket socket);
+    // --reuseport: a listener per pool context, each accepting for its own
+    void open_listeners();
+    void accept_on(tcp::acceptor& listener, net::io_context& context);
+    void accepted(net::io_context& context, beast::error_code ec, tcp::socket socket);
+    // --unix-socket
+    void open_local_listener();
+    void do_accept_local();
+    void on_accept_local(net::io_context* context, beast::error_code ec, net::local::stream_protocol::socket socket);
+    // Starts a session for an accepted connection on `context`'s thread
+    void serve(net::io_context& context, SessionStream&& stream);
+    void start_session(net::io_context& context, SessionStream&& stream);
+    // Queues `message`, a shared string or a MessageBatch, for every session
+    // in `recipients`; see ChatServer.cpp
+    template <typename Sessions, typename Message>
+    void fan_out(const Sessions& recipients, const Message& message, Lane lane);
+    // Numbers, records and fans out a message from `sender`; `chat_text` is
+    // set for chat messages, which are kept for history queries.
+    void publish(const std::string& message, Session& sender, const std::string* chat_text,
+                 const std::string& nickname);
+    void schedule_presence_flush(); // Requires sessions_mutex_
+    bool resume_session(const std::shared_ptr<Session>& session, const std::string& token, std::uint64_t last_seq);
+    // Numbers a room message and keeps it for replay; requires sessions_mutex_
+    std::shared_ptr<const std::string> sequence(const std::string& message, const MessageTrace* trace = nullptr);
+    void schedule_resume_expiry(); // Requires sessions_mutex_
+    void expire_parked_sessions();
 
     net::io_context& ioc_;
+    IoContextPool* pool_ = nullptr; // Set in the per-thread I/O model
+    ServerOptions options_;
+    LatencyTracer tracer_;
     tcp::acceptor acceptor_;
+    // --reuseport: listeners of the pool's contexts 1..n-1 (acceptor_ is
+    // context 0's)
+    std::vector<std::unique_ptr<tcp::acceptor>> listeners_;
+    net::local::stream_protocol::acceptor local_acceptor_; // --unix-socket
+    std::uint64_t local_socket_inode_ = 0; // Of the socket file, removed on shutdown
+
+    // Guards sessions_ and the pending presence state; sessions connect,
+    // disconnect and broadcast from any I/O thread.
+    std::mutex sessions_mutex_;
     std::set<std::shared_ptr<Session>> sessions_;
+
+    // Presence changes not yet sent. A client that joins and leaves within
+    // one tick is dropped from pending_joined_ and never announced.
+    struct PresenceEntry {
+        std::string user_id;
+        std::string nickname;
+    };
+    std::vector<std::shared_ptr<Session>> pending_joined_order_;
+    std::unordered_set<std::shared_ptr<Session>> pending_joined_;
+    std::vector<PresenceEntry> pending_left_;
+    net::steady_timer presence_timer_;
+    bool presence_timer_armed_ = false;
+    // Resumed sessions waiting for the next tick's roster snapshot. They are
+    // not announced to anyone.
+    std::unordered_set<std::shared_ptr<Session>> pending_resumed_;
+
+    // Room messages broadcast so far, the last resume_history of them held
+    // for replay. Guarded by sessions_mutex_.
+    MessageHistory history_;
+    // Resume tokens of live sessions, and the identities of dropped clients
+    // still within their grace period (expiring in parking order).
+    std::unordered_map<std::string, std::shared_ptr<Session>> resume_tokens_;
+    struct ParkedSession {
+        std::string user_id;
+        std::string nickname;
+        std::chrono::steady_clock::time_point expires;
+    };
+    std::unordered_map<std::string, ParkedSession> parked_;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> parked_order_;
+    net::steady_timer resume_timer_;
+    bool resume_timer_armed_ = false;
+    std::uint64_t resumed_total_ = 0;
+    // POST /publish requests served and messages they published
+    std::uint64_t publish_batches_ = 0;
+    std::uint64_t published_total_ = 0;
+
+    // Chat messages for history queries, appended in sequence order under
+    // sessions_mutex_ and queried on query_pool_. The pool and the admin
+    // channel are declared last: their threads are joined before anything
+    // they use is destroyed.
+    HistoryStore history_store_;
+    std::unique_ptr<net::thread_pool> query_pool_;
+    std::unique_ptr<AdminChannel> admin_; // --admin-socket
 };
 
 #endif // CHAT_SERVER_HPP
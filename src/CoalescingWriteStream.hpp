@@ -0,0 +1,191 @@
+// CoalescingWriteStream.hpp
+#ifndef COALESCING_WRITE_STREAM_HPP
+#define COALESCING_WRITE_STREAM_HPP
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/core/role.hpp>
+#include <boost/beast/websocket/teardown.hpp>
+#include <boost/system/error_code.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+
+// Next layer for a websocket::stream that gathers outgoing bytes into one
+// buffer. Asynchronous writes complete as soon as their bytes are copied, and
+// the buffer goes to the socket in a single write once the stream is uncorked
+// and no earlier flush is in flight. Corking around a run of websocket
+// messages therefore sends all of their frames in one syscall. Beast's own
+// control frames (pong, close) pass through the same buffer, so frame order
+// is always preserved.
+//
+// Synchronous operations go straight to the next layer; do not mix them with
+// pending asynchronous writes. All asynchronous use must come from a single
+// thread or strand.
+template <typename NextLayer>
+class CoalescingWriteStream {
+public:
+    using executor_type = typename NextLayer::executor_type;
+    using next_layer_type = NextLayer;
+
+    template <typename... Args>
+    explicit CoalescingWriteStream(Args&&... args)
+        : impl_(std::make_shared<Impl>(std::forward<Args>(args)...)) {}
+
+    executor_type get_executor() noexcept {
+        return impl_->next.get_executor();
+    }
+    next_layer_type& next_layer() noexcept {
+        return impl_->next;
+    }
+    const next_layer_type& next_layer() const noexcept {
+        return impl_->next;
+    }
+
+    // Holds back physical writes until uncork().
+    void cork() {
+        impl_->corked = true;
+    }
+    void uncork() {
+        impl_->corked = false;
+        Impl::maybe_flush(impl_);
+    }
+
+    // Bytes accepted but not yet handed to the next layer.
+    std::size_t pending_bytes() const noexcept {
+        return impl_->pending.size() + impl_->inflight.size();
+    }
+
+    // Calls `handler(ec)` once everything accepted so far has been written.
+    void async_flush(std::function<void(boost::system::error_code)> handler) {
+        if (impl_->error || (impl_->pending.empty() && !impl_->writing)) {
+            net::post(get_executor(), beast::bind_front_handler(std::move(handler), impl_->error));
+            return;
+        }
+        impl_->flush_waiters.push_back(std::move(handler));
+        Impl::maybe_flush(impl_);
+    }
+
+    template <typename MutableBufferSequence>
+    std::size_t read_some(const MutableBufferSequence& buffers) {
+        return impl_->next.read_some(buffers);
+    }
+    template <typename MutableBufferSequence>
+    std::size_t read_some(const MutableBufferSequence& buffers, boost::system::error_code& ec) {
+        return impl_->next.read_some(buffers, ec);
+    }
+    template <typename ConstBufferSequence>
+    std::size_t write_some(const ConstBufferSequence& buffers) {
+        return impl_->next.write_some(buffers);
+    }
+    template <typename ConstBufferSequence>
+    std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec) {
+        return impl_->next.write_some(buffers, ec);
+    }
+
+    template <typename MutableBufferSequence, typename ReadHandler>
+    auto async_read_some(const MutableBufferSequence& buffers, ReadHandler&& handler) {
+        return impl_->next.async_read_some(buffers, std::forward<ReadHandler>(handler));
+    }
+
+    template <typename ConstBufferSequence, typename WriteHandler>
+    auto async_write_some(const ConstBufferSequence& buffers, WriteHandler&& handler) {
+        return net::async_initiate<WriteHandler, void(boost::system::error_code, std::size_t)>(
+            [](auto&& h, std::shared_ptr<Impl> impl, const ConstBufferSequence& b) {
+                std::size_t n = 0;
+                if (!impl->error) {
+                    n = net::buffer_size(b);
+                    std::size_t const offset = impl->pending.size();
+                    impl->pending.resize(offset + n);
+                    net::buffer_copy(net::buffer(&impl->pending[offset], n), b);
+                }
+                auto const ec = impl->error;
+                auto ex = impl->next.get_executor();
+                Impl::maybe_flush(impl);
+                net::post(ex, beast::bind_front_handler(std::move(h), ec, n));
+            },
+            handler, impl_, buffers);
+    }
+
+private:
+    struct Impl {
+        template <typename... Args>
+        explicit Impl(Args&&... args) : next(std::forward<Args>(args)...) {}
+
+        NextLayer next;
+        std::string pending;  // accepted, waiting for the next flush
+        std::string inflight; // currently being written
+        bool corked = false;
+        bool writing = false;
+        boost::system::error_code error; // sticky once a write fails
+        std::vector<std::function<void(boost::system::error_code)>> flush_waiters;
+
+        static void maybe_flush(const std::shared_ptr<Impl>& self) {
+            if (self->writing || self->error) {
+                return;
+            }
+            if (self->pending.empty() || self->corked) {
+                if (self->pending.empty()) {
+                    notify_waiters(*self);
+                }
+                return;
+            }
+            self->writing = true;
+            self->inflight.swap(self->pending);
+            net::async_write(self->next, net::buffer(self->inflight),
+                             [self](boost::system::error_code ec, std::size_t) {
+                                 self->writing = false;
+                                 self->inflight.clear();
+                                 if (ec) {
+                                     self->error = ec;
+                                     self->pending.clear();
+                                     notify_waiters(*self);
+                                     return;
+                                 }
+                                 maybe_flush(self);
+                             });
+        }
+
+        static void notify_waiters(Impl& impl) {
+            auto waiters = std::move(impl.flush_waiters);
+            impl.flush_waiters.clear();
+            for (auto& waiter : waiters) {
+                waiter(impl.error);
+            }
+        }
+    };
+
+    std::shared_ptr<Impl> impl_;
+};
+
+// websocket::stream shuts the transport down through these after a close
+// handshake. Buffered frames (including the close frame) are flushed first.
+template <typename NextLayer>
+void teardown(beast::role_type role, CoalescingWriteStream<NextLayer>& stream, boost::system::error_code& ec) {
+    using beast::websocket::teardown;
+    teardown(role, stream.next_layer(), ec);
+}
+
+template <typename NextLayer, typename TeardownHandler>
+void async_teardown(beast::role_type role, CoalescingWriteStream<NextLayer>& stream, TeardownHandler&& handler) {
+    auto shared_handler = std::make_shared<typename std::decay<TeardownHandler>::type>(
+        std::forward<TeardownHandler>(handler));
+    stream.async_flush([role, &stream, shared_handler](boost::system::error_code ec) {
+        if (ec) {
+            (*shared_handler)(ec);
+            return;
+        }
+        using beast::websocket::async_teardown;
+        async_teardown(role, stream.next_layer(), std::move(*shared_handler));
+    });
+}
+
+#endif // COALESCING_WRITE_STREAM_HPP
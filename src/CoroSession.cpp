@@ -0,0 +1,183 @@
+// CoroSession.cpp
+#include "CoroSession.hpp"
+
+#if defined(CHAT_HAS_CORO_SESSION)
+
+#include "ChatServer.hpp"
+#include "HandlerAllocator.hpp"
+#include "Probes.hpp"
+#include <iostream>
+
+namespace http = beast::http;
+
+namespace {
+
+// Completion token used for every awaited operation: errors are reported
+// through `ec` instead of exceptions, and the operation's handler memory comes
+// from the per-thread handler pool. Coroutine frames themselves are allocated
+// by Asio's awaitable frame operator new, which recycles through its own
+// per-thread cache.
+auto pooled_token(beast::error_code& ec) {
+    return bind_handler_allocator(PooledHandlerAllocator<void>(), net::redirect_error(net::use_awaitable, ec));
+}
+
+} // namespace
+
+CoroSession::CoroSession(net::io_context& ioc, tcp::socket&& socket, ChatServer& server)
+    : CoroSession(ioc, SessionStream(std::move(socket)), server) {}
+
+CoroSession::CoroSession(net::io_context& ioc, SessionStream&& stream, ChatServer& server)
+    : Session(ioc, std::move(stream), server), write_signal_(strand_) {}
+
+void CoroSession::run() {
+    auto self = std::static_pointer_cast<CoroSession>(shared_from_this());
+    net::co_spawn(strand_, reader_loop(self), net::detached);
+}
+
+void CoroSession::send(std::shared_ptr<const std::string> ss, Lane lane) {
+    auto self = std::static_pointer_cast<CoroSession>(shared_from_this());
+    net::post(strand_, bind_handler_allocator(PooledHandlerAllocator<void>(), [self, ss, lane]() {
+                  if (self->closed_) {
+                      return;
+                  }
+                  self->enqueue_outbound(ss, lane);
+              }));
+}
+
+void CoroSession::on_outbound_queued() {
+    write_signal_.cancel(); // Wake the writer if it is parked
+}
+
+net::awaitable<void> CoroSession::reader_loop(std::shared_ptr<CoroSession> self) {
+    beast::error_code ec;
+
+    configure_stream();
+
+    // Plain HTTP requests (GET /stats, POST /publish) are answered here; see Session::on_run
+    beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+    co_await http::async_read(ws_.next_layer(), buffer_, upgrade_request_, pooled_token(ec));
+    if (!ec && !websocket::is_upgrade(upgrade_request_)) {
+        shutdown();
+        respond_http();
+        co_return;
+    }
+    if (!ec) {
+        beast::get_lowest_layer(ws_).expires_never();
+        buffer_.consume(buffer_.size());
+        release_idle_memory();
+        co_await ws_.async_accept(upgrade_request_, pooled_token(ec));
+    }
+    if (ec) {
+        std::cerr << "Session " << session_id_ << " Accept error: " << ec.message() << std::endl;
+        shutdown();
+        server_.on_client_disconnect(self); // Notify server
+        co_return;
+    }
+    std::cout << "Session " << session_id_ << " WebSocket handshake accepted." << std::endl;
+    CHAT_PROBE2(handshake_done, session_id_.c_str(), ws_.next_layer().native_handle());
+    join_server(); // See Session::on_accept
+
+    net::co_spawn(strand_, writer_loop(self), net::detached);
+
+    for (;;) {
+        std::size_t bytes = 0;
+        if (low_memory_ || upload_) {
+            // Borrow a buffer only once a message arrives; see Session::do_read
+            co_await ws_.async_read_some(empty_read_buffer(), pooled_token(ec));
+            if (!ec && upload_) {
+                if (upload_arriving()) {
+                    // An announced file, read straight into its sink
+                    while (!ec && !ws_.is_message_done()) {
+                        auto const read = co_await ws_.async_read_some(upload_->sink.prepare(), pooled_token(ec));
+                        if (!ec) {
+                            upload_->sink.commit(read);
+                        }
+                    }
+                    if (!ec) {
+                        finish_upload();
+                        continue;
+                    }
+                    upload_.reset();
+                } else {
+                    abandon_upload();
+                }
+            }
+            if (!ec && !ws_.is_message_done()) {
+                reading_message_ = true;
+                bytes = co_await ws_.async_read(buffer_, pooled_token(ec));
+            }
+        } else {
+            reading_message_ = true;
+            bytes = co_await ws_.async_read(buffer_, pooled_token(ec));
+        }
+        reading_message_ = false;
+        if (ec == websocket::error::closed || ec == http::error::end_of_stream) {
+            std::cout << "Session " << session_id_ << " closed by client." << std::endl;
+            break;
+        }
+        if (ec) {
+            std::cerr << "Session " << session_id_ << " Read error: " << ec.message() << std::endl;
+            break;
+        }
+
+        trace_read_complete();
+        CHAT_PROBE2(message_received, session_id_.c_str(), bytes);
+        std::string received_msg_str = beast::buffers_to_string(buffer_.data());
+        buffer_.consume(buffer_.size());
+        release_idle_memory();
+        handle_message(received_msg_str);
+    }
+
+    on_close(ec);
+    shutdown();
+    server_.on_client_disconnect(self, ec != websocket::error::closed); // Dropped connections may resume
+}
+
+net::awaitable<void> CoroSession::writer_loop(std::shared_ptr<CoroSession> self) {
+    beast::error_code ec;
+
+    while (!closed_) {
+        if (outbound_.empty()) {
+            uncork_if_drained();
+            release_idle_memory();
+            // Park until send() or shutdown() cancels the wait.
+            write_signal_.expires_at(net::steady_timer::time_point::max());
+            co_await write_signal_.async_wait(pooled_token(ec));
+            continue;
+        }
+
+        if (!ws_.is_open()) {
+            std::cerr << "Session " << session_id_ << " WebSocket is not open. Cannot write." << std::endl;
+            outbound_.clear();
+            break;
+        }
+
+        auto const& msg = start_write();
+        trace_write_start(msg);
+        ws_.text(true);
+        std::size_t written = co_await ws_.async_write(net::buffer(*msg), pooled_token(ec));
+        if (const StreamedPayload* payload = StreamedPayload::of(msg); payload && !ec) {
+            // One fragment per chunk; see Session::write_fragment
+            ws_.binary(true);
+            for (std::size_t i = 0; i < payload->chunk_count() && !ec; ++i) {
+                auto const chunk = payload->chunk(i);
+                written += co_await ws_.async_write_some(i + 1 == payload->chunk_count(),
+                                                         net::buffer(chunk.data(), chunk.size()), pooled_token(ec));
+            }
+        }
+        if (ec) {
+            std::cerr << "Session " << session_id_ << " Write error: " << ec.message() << std::endl;
+            break;
+        }
+        trace_write_complete(msg);
+        writing_.reset();
+        CHAT_PROBE3(write_complete, session_id_.c_str(), written, outbound_.size());
+    }
+}
+
+void CoroSession::shutdown() {
+    closed_ = true;
+    write_signal_.cancel();
+}
+
+#endif // defined(CHAT_HAS_CORO_SESSION)
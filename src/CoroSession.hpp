@@ -0,0 +1,40 @@
+// CoroSession.hpp
+#ifndef CORO_SESSION_HPP
+#define CORO_SESSION_HPP
+
+#include "Session.hpp"
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+    #define CHAT_HAS_CORO_SESSION 1
+#endif
+
+#if defined(CHAT_HAS_CORO_SESSION)
+
+// Alternative session engine written as C++20 coroutines. Each connection
+// runs one reader loop and one writer loop on the session strand instead of
+// re-arming bound handlers after every operation, so there is no per-message
+// shared_from_this() copy. Protocol handling is inherited from Session.
+class CoroSession : public Session {
+public:
+    CoroSession(net::io_context& ioc, tcp::socket&& socket, ChatServer& server);
+    CoroSession(net::io_context& ioc, SessionStream&& stream, ChatServer& server);
+
+    void run() override;
+    void send(std::shared_ptr<const std::string> ss, Lane lane = Lane::chat) override;
+
+protected:
+    void on_outbound_queued() override;
+
+private:
+    net::awaitable<void> reader_loop(std::shared_ptr<CoroSession> self);
+    net::awaitable<void> writer_loop(std::shared_ptr<CoroSession> self);
+    void shutdown();
+
+    // Parked writer waits on this timer; send() cancels it to wake the writer.
+    net::steady_timer write_signal_;
+    bool closed_ = false;
+};
+
+#endif // defined(CHAT_HAS_CORO_SESSION)
+
+#endif // CORO_SESSION_HPP
@@ -0,0 +1,199 @@
+// CpuPlacement.cpp
+#include "CpuPlacement.hpp"
+#include <boost/asio/detail/socket_option.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+#if defined(SO_REUSEPORT)
+using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+#if defined(SO_INCOMING_CPU)
+using incoming_cpu = net::detail::socket_option::integer<SOL_SOCKET, SO_INCOMING_CPU>;
+#endif
+
+int parse_number(const std::string& text, const std::string& list) {
+    if (text.empty() || !std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })
+        || text.size() > 4) {
+        throw std::invalid_argument("Invalid CPU or node list: '" + list + "'");
+    }
+    return std::stoi(text);
+}
+
+std::string read_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+std::string join(const std::vector<int>& values) {
+    std::string out;
+    for (int value : values) {
+        out += (out.empty() ? "" : ",") + std::to_string(value);
+    }
+    return out;
+}
+
+} // namespace
+
+std::vector<int> CpuPlacement::parse_list(const std::string& text) {
+    std::vector<int> values;
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        auto const dash = item.find('-');
+        int const first = parse_number(item.substr(0, dash), text);
+        int const last = dash == std::string::npos ? first : parse_number(item.substr(dash + 1), text);
+        if (last < first) {
+            throw std::invalid_argument("Invalid range in CPU or node list: '" + item + "'");
+        }
+        for (int value = first; value <= last; ++value) {
+            if (std::find(values.begin(), values.end(), value) == values.end()) {
+                values.push_back(value);
+            }
+        }
+    }
+    if (values.empty() || text.back() == ',') {
+        throw std::invalid_argument("Invalid CPU or node list: '" + text + "'");
+    }
+    return values;
+}
+
+std::vector<int> CpuPlacement::node_cpus(int node) {
+    auto const line = read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (line.empty()) {
+        return {}; // No such node, or a node with memory only
+    }
+    return parse_list(line);
+}
+
+int CpuPlacement::node_of_cpu(int cpu) {
+    auto const possible = read_line("/sys/devices/system/node/possible");
+    if (possible.empty()) {
+        return -1;
+    }
+    for (int node : parse_list(possible)) {
+        auto const cpus = node_cpus(node);
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+std::vector<std::vector<int>> CpuPlacement::plan(const ServerOptions& options, std::size_t threads) {
+    std::vector<std::vector<int>> cpus(threads);
+    if (!options.cpu_affinity.empty()) {
+        for (std::size_t i = 0; i < threads; ++i) {
+            cpus[i] = {options.cpu_affinity[i % options.cpu_affinity.size()]};
+        }
+    } else if (!options.numa_nodes.empty()) {
+        for (std::size_t i = 0; i < threads; ++i) {
+            int const node = options.numa_nodes[i % options.numa_nodes.size()];
+            cpus[i] = node_cpus(node);
+            if (cpus[i].empty()) {
+                throw std::invalid_argument("NUMA node " + std::to_string(node) + " does not exist or has no CPUs");
+            }
+        }
+    }
+    return cpus;
+}
+
+boost::system::error_code CpuPlacement::pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return {};
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return boost::system::errc::make_error_code(boost::system::errc::invalid_argument);
+        }
+        CPU_SET(cpu, &set);
+    }
+    // Fails with EINVAL if none of the CPUs is online
+    if (int const error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+        return {error, boost::system::system_category()};
+    }
+    return {};
+#else
+    return boost::system::errc::make_error_code(boost::system::errc::not_supported);
+#endif
+}
+
+int CpuPlacement::current_cpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+boost::system::error_code CpuPlacement::set_reuse_port(tcp::acceptor& acceptor) {
+    boost::system::error_code ec;
+#if defined(SO_REUSEPORT)
+    acceptor.set_option(reuse_port(true), ec);
+#else
+    (void)acceptor;
+    ec = boost::system::errc::make_error_code(boost::system::errc::not_supported);
+#endif
+    return ec;
+}
+
+bool CpuPlacement::incoming_cpu_supported() {
+#if defined(SO_INCOMING_CPU)
+    return true;
+#else
+    return false;
+#endif
+}
+
+boost::system::error_code CpuPlacement::set_incoming_cpu(tcp::acceptor& acceptor, int cpu) {
+    boost::system::error_code ec;
+#if defined(SO_INCOMING_CPU)
+    acceptor.set_option(incoming_cpu(cpu), ec);
+#else
+    (void)acceptor;
+    (void)cpu;
+#endif
+    return ec;
+}
+
+std::string CpuPlacement::describe(const ServerOptions& options, std::size_t threads) {
+    std::string out;
+    if (!options.cpu_affinity.empty()) {
+        auto const cpus = plan(options, threads);
+        std::vector<int> pinned;
+        std::vector<int> nodes;
+        for (auto const& set : cpus) {
+            pinned.push_back(set.front());
+            nodes.push_back(node_of_cpu(set.front()));
+        }
+        out = "I/O threads on CPUs " + join(pinned) + " (nodes " + join(nodes) + ")";
+    } else if (!options.numa_nodes.empty()) {
+        std::vector<int> nodes;
+        for (std::size_t i = 0; i < threads; ++i) {
+            nodes.push_back(options.numa_nodes[i % options.numa_nodes.size()]);
+        }
+        out = "I/O threads on nodes " + join(nodes);
+    } else {
+        out = "I/O threads unpinned";
+    }
+    if (options.reuseport) {
+        out += ", a SO_REUSEPORT listener per thread";
+        if (!options.cpu_affinity.empty() && incoming_cpu_supported()) {
+            out += " with SO_INCOMING_CPU";
+        }
+    }
+    return out;
+}
@@ -0,0 +1,58 @@
+// CpuPlacement.hpp
+#ifndef CPU_PLACEMENT_HPP
+#define CPU_PLACEMENT_HPP
+
+#include "ServerOptions.hpp"
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+// Where the I/O threads run (--cpu-affinity, --numa-nodes) and which thread
+// accepts a connection (--reuseport). Pinned threads keep their sessions'
+// memory on their own NUMA node: sessions are created on the thread that
+// serves them, and the kernel backs pages on the node of the CPU that first
+// touches them. Linux only; elsewhere pinning reports an error and the
+// threads run unpinned.
+namespace CpuPlacement {
+
+// Parses a CPU or node list such as "0-3,8,10-11". Throws
+// std::invalid_argument on malformed input.
+std::vector<int> parse_list(const std::string& text);
+
+// CPUs of NUMA node `node` (sysfs), or none if the node does not exist
+std::vector<int> node_cpus(int node);
+// NUMA node of `cpu`, or -1 if unknown
+int node_of_cpu(int cpu);
+
+// The CPUs each of `threads` I/O threads may run on; an empty set leaves a
+// thread unpinned. Thread i gets the i-th CPU of cpu_affinity, or every CPU
+// of the i-th node of numa_nodes, wrapping around either list. Throws
+// std::invalid_argument for a node without CPUs.
+std::vector<std::vector<int>> plan(const ServerOptions& options, std::size_t threads);
+
+// Restricts the calling thread to `cpus`; does nothing for an empty set
+boost::system::error_code pin_current_thread(const std::vector<int>& cpus);
+// The CPU the calling thread is on, or -1
+int current_cpu();
+
+// SO_REUSEPORT: several listeners bound to one port, the kernel picking one
+// per connection. Set before bind().
+boost::system::error_code set_reuse_port(tcp::acceptor& acceptor);
+// SO_INCOMING_CPU on a SO_REUSEPORT listener: connections whose packets the
+// kernel handles on `cpu` go to this listener first. With the NIC's
+// interrupts steered to the I/O threads' CPUs, a connection is then accepted
+// and served on the core that receives its packets.
+bool incoming_cpu_supported();
+boost::system::error_code set_incoming_cpu(tcp::acceptor& acceptor, int cpu);
+
+// One-line summary for the startup banner
+std::string describe(const ServerOptions& options, std::size_t threads);
+
+} // namespace CpuPlacement
+
+#endif // CPU_PLACEMENT_HPP
@@ -0,0 +1,241 @@
+// HandlerAllocator.hpp
+#ifndef HANDLER_ALLOCATOR_HPP
+#define HANDLER_ALLOCATOR_HPP
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace net = boost::asio;
+
+// Per-thread recycling pool for the small, short-lived blocks Asio allocates
+// for every pending operation (reactor ops, composed-operation state, posted
+// handlers). Freed blocks go onto a free list owned by the freeing thread and
+// are handed out again to the next allocation of the same size class, so a
+// connection in steady state stops calling malloc.
+class ThreadHandlerPool {
+public:
+    static void* allocate(std::size_t size) {
+        std::size_t const index = class_index(size);
+        if (index == kClassCount) {
+            return ::operator new(size);
+        }
+        Cache* c = cache();
+        if (c && c->heads[index]) {
+            FreeBlock* block = c->heads[index];
+            c->heads[index] = block->next;
+            --c->counts[index];
+            return block;
+        }
+        return ::operator new(class_size(index));
+    }
+
+    static void deallocate(void* pointer, std::size_t size) noexcept {
+        std::size_t const index = class_index(size);
+        Cache* c = index == kClassCount ? nullptr : cache();
+        if (!c || c->counts[index] >= kMaxCachedPerClass) {
+            ::operator delete(pointer);
+            return;
+        }
+        auto* block = static_cast<FreeBlock*>(pointer);
+        block->next = c->heads[index];
+        c->heads[index] = block;
+        ++c->counts[index];
+    }
+
+private:
+    static constexpr std::size_t kMinBlock = 64;
+    static constexpr std::size_t kClassCount = 6; // 64, 128, ..., 2048 bytes
+    static constexpr std::size_t kMaxCachedPerClass = 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Cache {
+        FreeBlock* heads[kClassCount] = {};
+        std::size_t counts[kClassCount] = {};
+        bool* alive;
+
+        explicit Cache(bool* flag) : alive(flag) {
+            *alive = true;
+        }
+        ~Cache() {
+            *alive = false;
+            for (FreeBlock* head : heads) {
+                while (head) {
+                    FreeBlock* next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+        }
+    };
+
+    static std::size_t class_size(std::size_t index) {
+        return kMinBlock << index;
+    }
+
+    static std::size_t class_index(std::size_t size) {
+        std::size_t index = 0;
+        while (index < kClassCount && class_size(index) < size) {
+            ++index;
+        }
+        return index;
+    }
+
+    // Returns null once the calling thread's cache has been destroyed (blocks
+    // released during thread shutdown then go straight back to the heap).
+    static Cache* cache() {
+        thread_local bool alive = false;
+        thread_local Cache c(&alive);
+        return alive ? &c : nullptr;
+    }
+};
+
+// Standard allocator drawing from ThreadHandlerPool.
+template <typename T>
+class PooledHandlerAllocator {
+public:
+    using value_type = T;
+
+    PooledHandlerAllocator() noexcept = default;
+    template <typename U>
+    PooledHandlerAllocator(const PooledHandlerAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(ThreadHandlerPool::allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept {
+        ThreadHandlerPool::deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PooledHandlerAllocator<U>&) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const PooledHandlerAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+// Wraps a completion handler or completion token so that Asio sees `Allocator`
+// as its associated allocator. This is a small stand-in for
+// boost::asio::bind_allocator (Boost 1.79+); it also works with use_awaitable,
+// so coroutine-based sessions can route their per-operation memory through the
+// same pools as callback handlers.
+template <typename T, typename Allocator>
+class AllocatorBinder {
+public:
+    using target_type = T;
+    using allocator_type = Allocator;
+
+    template <typename U>
+    AllocatorBinder(const Allocator& allocator, U&& target)
+        : target_(std::forward<U>(target)), allocator_(allocator) {}
+
+    target_type& get() noexcept {
+        return target_;
+    }
+    const target_type& get() const noexcept {
+        return target_;
+    }
+    allocator_type get_allocator() const noexcept {
+        return allocator_;
+    }
+
+    template <typename... Args>
+    auto operator()(Args&&... args) -> decltype(std::declval<T&>()(std::forward<Args>(args)...)) {
+        return target_(std::forward<Args>(args)...);
+    }
+
+private:
+    T target_;
+    Allocator allocator_;
+};
+
+template <typename Allocator, typename T>
+AllocatorBinder<typename std::decay<T>::type, Allocator> bind_handler_allocator(const Allocator& allocator,
+                                                                               T&& target) {
+    return AllocatorBinder<typename std::decay<T>::type, Allocator>(allocator, std::forward<T>(target));
+}
+
+namespace boost {
+namespace asio {
+
+template <typename T, typename Allocator, typename Allocator1>
+struct associated_allocator<AllocatorBinder<T, Allocator>, Allocator1> {
+    using type = Allocator;
+
+    static type get(const AllocatorBinder<T, Allocator>& b, const Allocator1& = Allocator1()) noexcept {
+        return b.get_allocator();
+    }
+};
+
+template <typename T, typename Allocator, typename Executor1>
+struct associated_executor<AllocatorBinder<T, Allocator>, Executor1> {
+    using type = typename associated_executor<T, Executor1>::type;
+
+    static type get(const AllocatorBinder<T, Allocator>& b, const Executor1& e = Executor1()) noexcept {
+        return associated_executor<T, Executor1>::get(b.get(), e);
+    }
+};
+
+namespace detail {
+
+// Tokens such as use_awaitable only implement the initiate() protocol and
+// have no completion_handler_type; plain handlers do.
+template <typename T, typename Signature, typename = void>
+struct binder_completion_handler {
+    using type = void;
+};
+
+template <typename T, typename Signature>
+struct binder_completion_handler<T, Signature,
+                                 std::void_t<typename async_result<T, Signature>::completion_handler_type>> {
+    using type = typename async_result<T, Signature>::completion_handler_type;
+};
+
+} // namespace detail
+
+// Lets an AllocatorBinder wrap a completion token (e.g. use_awaitable): the
+// real handler created for the token is wrapped before the operation starts.
+template <typename T, typename Allocator, typename Signature>
+class async_result<AllocatorBinder<T, Allocator>, Signature> {
+public:
+    using completion_handler_type =
+        AllocatorBinder<typename detail::binder_completion_handler<T, Signature>::type, Allocator>;
+    using return_type = typename async_result<T, Signature>::return_type;
+
+    template <typename Initiation>
+    struct init_wrapper {
+        Initiation initiation;
+        Allocator allocator;
+
+        template <typename Handler, typename... Args>
+        void operator()(Handler&& handler, Args&&... args) {
+            std::move(initiation)(
+                AllocatorBinder<typename std::decay<Handler>::type, Allocator>(allocator,
+                                                                                std::forward<Handler>(handler)),
+                std::forward<Args>(args)...);
+        }
+    };
+
+    template <typename Initiation, typename RawCompletionToken, typename... Args>
+    static return_type initiate(Initiation&& initiation, RawCompletionToken&& token, Args&&... args) {
+        return async_initiate<T, Signature>(
+            init_wrapper<typename std::decay<Initiation>::type>{std::forward<Initiation>(initiation),
+                                                                token.get_allocator()},
+            token.get(), std::forward<Args>(args)...);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // HANDLER_ALLOCATOR_HPP
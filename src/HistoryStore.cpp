@@ -0,0 +1,352 @@
+// HistoryStore.cpp
+#include "HistoryStore.hpp"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+std::uint32_t read_varint(const std::vector<std::uint8_t>& bytes, std::size_t& pos) {
+    std::uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        std::uint8_t const byte = bytes[pos++];
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+} // namespace
+
+void PostingList::append(std::uint32_t id) {
+    if (count_ == 0) {
+        first_ = id;
+    } else if (count_ % kBlockSize == 0) {
+        skips_.push_back({id, static_cast<std::uint32_t>(bytes_.size())});
+    }
+    std::uint32_t gap = count_ == 0 ? id : id - last_;
+    while (gap >= 0x80) {
+        bytes_.push_back(static_cast<std::uint8_t>(gap | 0x80));
+        gap >>= 7;
+    }
+    bytes_.push_back(static_cast<std::uint8_t>(gap));
+    last_ = id;
+    ++count_;
+}
+
+std::size_t PostingList::block_of(std::uint32_t id) const {
+    if (count_ == 0 || id < first_) {
+        return blocks();
+    }
+    auto const after = std::upper_bound(skips_.begin(), skips_.end(), id,
+                                        [](std::uint32_t value, const Skip& s) { return value < s.id; });
+    return static_cast<std::size_t>(after - skips_.begin());
+}
+
+void PostingList::decode_block(std::size_t block, std::uint32_t lo, std::uint32_t hi,
+                               std::vector<std::uint32_t>& out) const {
+    auto const start = skip(block);
+    std::size_t pos = start.offset;
+    read_varint(bytes_, pos); // The gap to the previous block; the skip has the id
+    std::uint32_t id = start.id;
+    std::size_t const n = std::min(kBlockSize, count_ - block * kBlockSize);
+    for (std::size_t i = 0;;) {
+        if (id >= hi) {
+            return;
+        }
+        if (id >= lo) {
+            out.push_back(id);
+        }
+        if (++i == n) {
+            return;
+        }
+        id += read_varint(bytes_, pos);
+    }
+}
+
+void PostingList::decode(std::uint32_t lo, std::uint32_t hi, std::vector<std::uint32_t>& out) const {
+    if (count_ == 0 || last_ < lo) {
+        return;
+    }
+    auto block = block_of(lo);
+    for (block = block == blocks() ? 0 : block; block < blocks() && block_first(block) < hi; ++block) {
+        decode_block(block, lo, hi, out);
+    }
+}
+
+void PostingList::intersect(const std::vector<std::uint32_t>& ids, std::vector<std::uint32_t>& out) const {
+    std::size_t decoded = 0; // Entries read so far
+    std::size_t pos = 0;
+    std::uint32_t id = 0; // The last one read
+    for (auto const target : ids) {
+        if (target > last_) {
+            return;
+        }
+        if (decoded == 0 || id < target) {
+            auto const block = block_of(target);
+            if (block == blocks()) {
+                continue;
+            }
+            if (block * kBlockSize >= decoded) {
+                // Jump ahead to the block that may hold `target`
+                auto const start = skip(block);
+                pos = start.offset;
+                read_varint(bytes_, pos);
+                id = start.id;
+                decoded = block * kBlockSize + 1;
+            }
+            while (id < target) {
+                id += read_varint(bytes_, pos);
+                ++decoded;
+            }
+        }
+        if (id == target) {
+            out.push_back(target);
+        }
+    }
+}
+
+// Entry numbers are local to a segment, so they fit posting lists of 32-bit
+// ids whatever the total history size. Authors are interned per segment.
+struct HistoryStore::Segment {
+    struct Entry {
+        std::int64_t time;
+        std::uint64_t seq;
+        std::uint64_t text_offset;
+        std::uint32_t text_size;
+        std::uint32_t author;
+    };
+    struct Author {
+        std::string user_id;
+        std::string nickname;
+    };
+
+    std::vector<Entry> entries;
+    std::string text; // Every message's text, back to back
+    std::vector<Author> authors;
+    std::unordered_map<std::string, std::uint32_t> author_ids; // user_id '\n' nickname
+    std::unordered_map<std::string, PostingList> users;
+    std::unordered_map<std::string, PostingList> words;
+
+    std::string_view text_of(const Entry& entry) const {
+        return std::string_view(text).substr(entry.text_offset, entry.text_size);
+    }
+};
+
+namespace {
+
+bool is_word_byte(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+// Sorted and free of duplicates, so each posting list gets an id only once
+std::vector<std::string> unique_words(std::string_view text) {
+    std::vector<std::string> words;
+    HistoryStore::tokenize(text, words);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+} // namespace
+
+void HistoryStore::tokenize(std::string_view text, std::vector<std::string>& out) {
+    std::size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !is_word_byte(static_cast<unsigned char>(text[i]))) {
+            ++i;
+        }
+        std::size_t const begin = i;
+        while (i < text.size() && is_word_byte(static_cast<unsigned char>(text[i]))) {
+            ++i;
+        }
+        if (i > begin && i - begin <= kMaxWordBytes) {
+            std::string word(text.substr(begin, i - begin));
+            for (auto& c : word) {
+                if (c >= 'A' && c <= 'Z') {
+                    c = static_cast<char>(c - 'A' + 'a');
+                }
+            }
+            out.push_back(std::move(word));
+        }
+    }
+}
+
+// Segments of about an eighth of the retained history bound what eviction
+// drops at once, within limits: small segments cost a hash map per author
+// and word each, large ones only matter for very long histories.
+HistoryStore::HistoryStore(std::size_t retain, std::size_t segment_size)
+    : retain_(retain),
+      segment_size_(segment_size ? segment_size : std::clamp<std::size_t>(retain / 8, 4096, kMaxSegmentSize)) {}
+
+HistoryStore::~HistoryStore() = default;
+
+void HistoryStore::append(std::uint64_t seq, std::int64_t time, const std::string& user_id,
+                          const std::string& nickname, const std::string& text) {
+    if (retain_ == 0) {
+        return;
+    }
+    // Tokenized before taking the lock; queries only wait for the index updates
+    auto const words = unique_words(text);
+    std::string author_key;
+    author_key.reserve(user_id.size() + nickname.size() + 1);
+    author_key.append(user_id).append(1, '\n').append(nickname);
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (segments_.empty() || segments_.back()->entries.size() >= segment_size_) {
+        segments_.push_back(std::make_unique<Segment>());
+        segments_.back()->entries.reserve(segment_size_);
+    }
+    Segment& segment = *segments_.back();
+
+    auto const [author, added] =
+        segment.author_ids.try_emplace(std::move(author_key), static_cast<std::uint32_t>(segment.authors.size()));
+    if (added) {
+        segment.authors.push_back({user_id, nickname});
+    }
+    last_time_ = std::max(last_time_, time);
+    auto const id = static_cast<std::uint32_t>(segment.entries.size());
+    segment.entries.push_back({last_time_, seq, segment.text.size(), static_cast<std::uint32_t>(text.size()),
+                               author->second});
+    segment.text += text;
+    segment.users[user_id].append(id);
+    for (auto const& word : words) {
+        segment.words[word].append(id);
+    }
+
+    ++messages_;
+    if (segments_.size() > 1 && messages_ - segments_.front()->entries.size() >= retain_) {
+        messages_ -= segments_.front()->entries.size();
+        segments_.pop_front();
+    }
+}
+
+std::vector<HistoryEntry> HistoryStore::query(const HistoryQuery& query) const {
+    std::vector<HistoryEntry> results;
+    if (query.limit == 0) {
+        return results;
+    }
+    auto const words = unique_words(query.text);
+    if (words.empty() && query.text.find_first_not_of(" \t\r\n") != std::string::npos) {
+        return results; // Only punctuation or overlong words: nothing can match
+    }
+    bool const indexed = query.indexed && (!words.empty() || !query.user_id.empty());
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<std::uint32_t> matched;
+    std::vector<std::uint32_t> other;
+    bool older = true; // Whether older segments may still match
+    for (auto it = segments_.rbegin(); older && it != segments_.rend() && results.size() < query.limit; ++it) {
+        const Segment& segment = **it;
+        auto const& entries = segment.entries;
+        using Entry = Segment::Entry;
+
+        // The time range and the paging cursor narrow the entries to [lo, hi)
+        auto lo = entries.begin();
+        auto hi = entries.end();
+        if (query.since > 0) {
+            lo = std::lower_bound(lo, hi, query.since, [](const Entry& e, std::int64_t t) { return e.time < t; });
+            older = lo == entries.begin();
+        }
+        if (query.until > 0) {
+            hi = std::upper_bound(lo, hi, query.until, [](std::int64_t t, const Entry& e) { return t < e.time; });
+        }
+        if (query.before_seq > 0) {
+            hi = std::lower_bound(lo, hi, query.before_seq,
+                                  [](const Entry& e, std::uint64_t seq) { return e.seq < seq; });
+        }
+        if (lo >= hi) {
+            continue;
+        }
+        auto const first = static_cast<std::uint32_t>(lo - entries.begin());
+        auto const last = static_cast<std::uint32_t>(hi - entries.begin());
+
+        auto const take = [&](std::uint32_t id) {
+            const Entry& entry = entries[id];
+            auto const& author = segment.authors[entry.author];
+            results.push_back({entry.seq, entry.time, author.user_id, author.nickname,
+                               std::string(segment.text_of(entry))});
+        };
+
+        if (!indexed) {
+            // Checks every entry in range against the filters directly
+            for (std::uint32_t id = last; id > first && results.size() < query.limit; --id) {
+                const Entry& entry = entries[id - 1];
+                if (!query.user_id.empty() && segment.authors[entry.author].user_id != query.user_id) {
+                    continue;
+                }
+                if (!words.empty()) {
+                    auto const text_words = unique_words(segment.text_of(entry));
+                    if (!std::includes(text_words.begin(), text_words.end(), words.begin(), words.end())) {
+                        continue;
+                    }
+                }
+                take(id - 1);
+            }
+            continue;
+        }
+
+        // Intersects the posting lists of the filters
+        std::vector<const PostingList*> lists;
+        bool missing = false;
+        auto const add_list = [&](const std::unordered_map<std::string, PostingList>& index, const std::string& key) {
+            auto const found = index.find(key);
+            if (found == index.end()) {
+                missing = true;
+            } else {
+                lists.push_back(&found->second);
+            }
+        };
+        if (!query.user_id.empty()) {
+            add_list(segment.users, query.user_id);
+        }
+        for (auto const& word : words) {
+            add_list(segment.words, word);
+        }
+        if (missing) {
+            continue;
+        }
+        std::sort(lists.begin(), lists.end(),
+                  [](const PostingList* a, const PostingList* b) { return a->size() < b->size(); });
+        // The shortest list is read a block at a time from its newest end,
+        // and each block's ids in range are looked up in the others.
+        const PostingList& lead = *lists.front();
+        for (std::size_t block = lead.blocks(); block-- > 0 && results.size() < query.limit;) {
+            if (lead.block_first(block) >= last) {
+                continue;
+            }
+            matched.clear();
+            lead.decode_block(block, first, last, matched);
+            for (std::size_t i = 1; i < lists.size() && !matched.empty(); ++i) {
+                other.clear();
+                lists[i]->intersect(matched, other);
+                matched.swap(other);
+            }
+            for (auto id = matched.rbegin(); id != matched.rend() && results.size() < query.limit; ++id) {
+                take(*id);
+            }
+            if (lead.block_first(block) < first) {
+                break;
+            }
+        }
+    }
+    return results;
+}
+
+HistoryStore::Stats HistoryStore::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    Stats stats{messages_, segments_.size(), 0, 0};
+    for (auto const& segment : segments_) {
+        stats.text_bytes += segment->text.size();
+        stats.index_bytes += segment->entries.capacity() * sizeof(Segment::Entry);
+        for (auto const& [user, list] : segment->users) {
+            stats.index_bytes += list.bytes();
+        }
+        for (auto const& [word, list] : segment->words) {
+            stats.index_bytes += list.bytes();
+        }
+    }
+    return stats;
+}
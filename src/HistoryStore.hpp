@@ -0,0 +1,123 @@
+// HistoryStore.hpp
+#ifndef HISTORY_STORE_HPP
+#define HISTORY_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Ascending message numbers stored as varint-coded gaps: one byte per entry
+// for the dense lists of common words and active users. Every kBlockSize
+// entries a skip entry records where a block starts, so a list can be read
+// from any block and probed without decoding it all.
+class PostingList {
+public:
+    static constexpr std::size_t kBlockSize = 64;
+
+    void append(std::uint32_t id); // Ids must increase
+    std::size_t size() const { return count_; }
+    std::size_t bytes() const { return bytes_.capacity() + skips_.capacity() * sizeof(Skip); }
+    std::size_t blocks() const { return count_ == 0 ? 0 : skips_.size() + 1; }
+    std::uint32_t block_first(std::size_t block) const { return skip(block).id; }
+
+    // Appends the ids in [lo, hi) to `out`: of the whole list, or of one block
+    void decode(std::uint32_t lo, std::uint32_t hi, std::vector<std::uint32_t>& out) const;
+    void decode_block(std::size_t block, std::uint32_t lo, std::uint32_t hi, std::vector<std::uint32_t>& out) const;
+    // Appends the ascending `ids` that are also in this list to `out`,
+    // skipping the blocks in between.
+    void intersect(const std::vector<std::uint32_t>& ids, std::vector<std::uint32_t>& out) const;
+
+private:
+    struct Skip {
+        std::uint32_t id;     // First id of the block
+        std::uint32_t offset; // Its position in bytes_
+    };
+    Skip skip(std::size_t block) const { return block == 0 ? Skip{first_, 0} : skips_[block - 1]; }
+    // Block holding `id` if the list has it; blocks() if `id` is before the list
+    std::size_t block_of(std::uint32_t id) const;
+
+    std::vector<std::uint8_t> bytes_;
+    std::vector<Skip> skips_; // Blocks after the first
+    std::uint32_t first_ = 0;
+    std::uint32_t last_ = 0;
+    std::size_t count_ = 0;
+};
+
+// Filters of client_query_history. Every set filter must match.
+struct HistoryQuery {
+    std::string user_id;          // Author; empty for anyone
+    std::string text;             // Every word must occur (case-insensitive); empty for any text
+    std::int64_t since = 0;       // Unix seconds, inclusive; 0 for no bound
+    std::int64_t until = 0;       // Unix seconds, inclusive; 0 for no bound
+    std::uint64_t before_seq = 0; // Paging cursor: only older messages; 0 starts at the newest
+    std::size_t limit = 100;
+    bool indexed = true;          // false scans every message in range (benchmarks, tests)
+};
+
+struct HistoryEntry {
+    std::uint64_t seq;
+    std::int64_t time; // Unix seconds
+    std::string user_id;
+    std::string nickname;
+    std::string text;
+};
+
+// The last `retain` chat messages with the indexes to query them. Messages
+// are appended in sequence order and kept in segments of up to
+// `segment_size`; the oldest segment is dropped once the rest hold `retain`.
+// Within a segment:
+//  - entries are in time (and sequence) order and point into one text
+//    arena, so a time range or paging cursor is a binary search;
+//  - each author has a posting list of entry numbers;
+//  - each word has a posting list (the inverted index).
+// A query walks the segments newest first, intersects the posting lists of
+// its filters within the time range and stops at `limit` matches.
+//
+// Appends take an exclusive lock, queries a shared one; ChatServer runs
+// queries on their own threads, off the I/O threads.
+class HistoryStore {
+public:
+    static constexpr std::size_t kMaxSegmentSize = std::size_t{1} << 20;
+
+    // A segment_size of 0 picks one from `retain`
+    explicit HistoryStore(std::size_t retain, std::size_t segment_size = 0);
+    ~HistoryStore();
+
+    // `time` earlier than the previous message's is raised to it, which keeps
+    // the time index sorted when clocks step back.
+    void append(std::uint64_t seq, std::int64_t time, const std::string& user_id, const std::string& nickname,
+                const std::string& text);
+    // Matching messages, newest first
+    std::vector<HistoryEntry> query(const HistoryQuery& query) const;
+
+    struct Stats {
+        std::size_t messages;
+        std::size_t segments;
+        std::size_t text_bytes;
+        std::size_t index_bytes; // Posting lists and entries
+    };
+    Stats stats() const;
+
+    // Lower-cased words: runs of ASCII letters and digits, with any byte of
+    // a multi-byte UTF-8 character counting as a letter. Longer words than
+    // kMaxWordBytes are not indexed.
+    static constexpr std::size_t kMaxWordBytes = 64;
+    static void tokenize(std::string_view text, std::vector<std::string>& out);
+
+private:
+    struct Segment;
+
+    std::size_t retain_;
+    std::size_t segment_size_;
+    mutable std::shared_mutex mutex_;
+    std::deque<std::unique_ptr<Segment>> segments_;
+    std::size_t messages_ = 0;
+    std::int64_t last_time_ = 0;
+};
+
+#endif // HISTORY_STORE_HPP
@@ -1,6 +1,7 @@
 #ifndef IWEBSOCKETSTREAM_HPP
 #define IWEBSOCKETSTREAM_HPP
 
+#include <functional>
 #include <string>
 #include <boost/beast/core/flat_buffer.hpp>
 #include <boost/system/error_code.hpp>
@@ -40,6 +41,19 @@ public:
     
     virtual void close(beast::websocket::close_code code, beast::error_code& ec) = 0;
 
+    // Asynchronous counterparts used by ChatClient's full-duplex API. Handlers
+    // run on the stream's io_context; at most one read and one write may be
+    // outstanding at a time.
+    using IoHandler = std::function<void(beast::error_code, std::size_t)>;
+    virtual void async_read(beast::flat_buffer& buffer, IoHandler handler) = 0;
+    virtual void async_write(const net::const_buffer& buffer, IoHandler handler) = 0;
+    virtual void async_close(beast::websocket::close_code code, std::function<void(beast::error_code)> handler) = 0;
+
+    // Brackets a run of async_write calls whose frames may leave in a single
+    // transport write. Streams that cannot coalesce ignore these.
+    virtual void begin_batch() {}
+    virtual void end_batch() {}
+
     // Add next_layer() equivalent if needed for direct socket options,
     // but try to avoid exposing underlying layers in the interface if possible.
     // virtual tcp::socket& next_layer() = 0; // Example, might not be directly mockable or desirable
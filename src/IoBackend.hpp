@@ -0,0 +1,32 @@
+// IoBackend.hpp
+#ifndef IO_BACKEND_HPP
+#define IO_BACKEND_HPP
+
+#include <boost/asio/detail/config.hpp>
+#include <string>
+
+namespace IoBackend {
+
+// Asio picks its socket reactor at compile time. When the build defines
+// BOOST_ASIO_HAS_IO_URING together with BOOST_ASIO_DISABLE_EPOLL (see the
+// CHAT_ENABLE_IO_URING CMake option), socket operations are submitted through
+// io_uring; otherwise they go through the epoll reactor.
+inline const char* compiled() {
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+    return "io_uring";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+    return "epoll";
+#else
+    return "select";
+#endif
+}
+
+// A binary can only run the backend it was compiled for, so a runtime request
+// for a backend is really a check that the right binary is being started.
+inline bool is_available(const std::string& name) {
+    return name == compiled();
+}
+
+} // namespace IoBackend
+
+#endif // IO_BACKEND_HPP
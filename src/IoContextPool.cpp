@@ -0,0 +1,60 @@
+// IoContextPool.cpp
+#include "IoContextPool.hpp"
+#include "BusyPoll.hpp"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+IoContextPool::IoContextPool(std::size_t size) {
+    size = std::max<std::size_t>(size, 1);
+    for (std::size_t i = 0; i < size; ++i) {
+        // Each context is only ever run by one thread
+        contexts_.push_back(std::make_unique<net::io_context>(1));
+        work_.push_back(net::make_work_guard(*contexts_.back()));
+    }
+}
+
+net::io_context& IoContextPool::next() {
+    return *contexts_[next_.fetch_add(1, std::memory_order_relaxed) % contexts_.size()];
+}
+
+std::size_t IoContextPool::index_of(const net::io_context& context) const {
+    for (std::size_t i = 0; i < contexts_.size(); ++i) {
+        if (contexts_[i].get() == &context) {
+            return i;
+        }
+    }
+    return contexts_.size();
+}
+
+void IoContextPool::run(const std::function<void(std::size_t)>& on_thread_start) {
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < contexts_.size(); ++i) {
+        threads.emplace_back([this, context = contexts_[i].get(), i, &on_thread_start] {
+            if (on_thread_start) {
+                on_thread_start(i);
+            }
+            try {
+                BusyPoll::run(*context, busy_poll_);
+            } catch (const std::exception& e) {
+                std::cerr << "Exception in worker thread: " << e.what() << std::endl;
+            }
+        });
+    }
+    if (on_thread_start) {
+        on_thread_start(0);
+    }
+    BusyPoll::run(*contexts_[0], busy_poll_);
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void IoContextPool::stop() {
+    for (auto& guard : work_) {
+        guard.reset();
+    }
+    for (auto& context : contexts_) {
+        context->stop();
+    }
+}
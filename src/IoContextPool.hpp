@@ -0,0 +1,51 @@
+// IoContextPool.hpp
+#ifndef IO_CONTEXT_POOL_HPP
+#define IO_CONTEXT_POOL_HPP
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace net = boost::asio;
+
+// One io_context per I/O thread (--io-model=per-thread). Each connection is
+// bound to one context for its whole life, so all of its handlers run on the
+// same thread and work for many connections can be handed to that thread as
+// a single task.
+class IoContextPool {
+public:
+    explicit IoContextPool(std::size_t size);
+
+    IoContextPool(const IoContextPool&) = delete;
+    IoContextPool& operator=(const IoContextPool&) = delete;
+
+    // Contexts handed out round-robin to new connections
+    net::io_context& next();
+    net::io_context& get(std::size_t index) { return *contexts_[index]; }
+    std::size_t size() const { return contexts_.size(); }
+    // Position of `context` in the pool, or size() if it is not a member
+    std::size_t index_of(const net::io_context& context) const;
+
+    // Runs every context on its own thread; the calling thread runs context
+    // 0. Each thread calls `on_thread_start` with its context's index first
+    // (e.g. to pin itself to a CPU). Blocks until stop() is called and all
+    // threads have finished.
+    void run(const std::function<void(std::size_t)>& on_thread_start = {});
+    void stop();
+    // Threads started by run() busy-poll for `spin` before blocking
+    // (BusyPoll, --busy-poll-us)
+    void set_busy_poll(std::chrono::microseconds spin) { busy_poll_ = spin; }
+
+private:
+    std::vector<std::unique_ptr<net::io_context>> contexts_;
+    std::vector<net::executor_work_guard<net::io_context::executor_type>> work_;
+    std::atomic<std::size_t> next_{0};
+    std::chrono::microseconds busy_poll_{0};
+};
+
+#endif // IO_CONTEXT_POOL_HPP
@@ -0,0 +1,137 @@
+// LatencyTracer.cpp
+#include "LatencyTracer.hpp"
+#include <algorithm>
+
+namespace json = boost::json;
+
+namespace {
+
+// Deleter of traced payloads; std::get_deleter finds the trace through it.
+struct TracedPayloadDeleter {
+    MessageTrace trace;
+    void operator()(const std::string* p) const { delete p; }
+};
+
+int highest_bit(std::uint64_t v) {
+    return 63 - __builtin_clzll(v);
+}
+
+} // namespace
+
+std::size_t LatencyHistogram::bucket_of(std::uint64_t v) {
+    if (v < kSubBuckets) {
+        return static_cast<std::size_t>(v); // Exact below 16
+    }
+    int const shift = highest_bit(v) - static_cast<int>(kSubBucketBits);
+    auto const sub = static_cast<std::size_t>((v >> shift) & (kSubBuckets - 1));
+    return static_cast<std::size_t>(shift + 1) * kSubBuckets + sub;
+}
+
+std::uint64_t LatencyHistogram::bucket_lower(std::size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    auto const shift = index / kSubBuckets - 1;
+    return (kSubBuckets + index % kSubBuckets) << shift;
+}
+
+std::uint64_t LatencyHistogram::bucket_upper(std::size_t index) {
+    if (index < kSubBuckets) {
+        return index + 1;
+    }
+    auto const shift = index / kSubBuckets - 1;
+    return (kSubBuckets + index % kSubBuckets + 1) << shift;
+}
+
+double LatencyHistogram::mean() const {
+    auto const n = count();
+    return n ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(n) : 0.0;
+}
+
+std::uint64_t LatencyHistogram::percentile(double q) const {
+    std::uint64_t total = 0;
+    for (auto const& c : counts_) {
+        total += c.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    auto const rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * static_cast<double>(total) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            auto const lower = bucket_lower(i);
+            auto const mid = lower + (bucket_upper(i) - lower) / 2;
+            return std::min(mid, max());
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::reset() {
+    for (auto& c : counts_) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+bool LatencyTracer::should_sample() const {
+    if (sample_every_ == 0) {
+        return false;
+    }
+    thread_local unsigned t_counter = 0;
+    return ++t_counter % sample_every_ == 0;
+}
+
+void LatencyTracer::reset() {
+    for (auto& h : stages_) {
+        h.reset();
+    }
+}
+
+const char* LatencyTracer::stage_name(Stage stage) {
+    switch (stage) {
+    case read_to_parse:
+        return "read_to_parse";
+    case parse_to_enqueue:
+        return "parse_to_enqueue";
+    case enqueue_to_write_start:
+        return "enqueue_to_write_start";
+    case write_start_to_complete:
+        return "write_start_to_complete";
+    case read_to_write_complete:
+        return "read_to_write_complete";
+    default:
+        return "unknown";
+    }
+}
+
+json::object LatencyTracer::to_json() const {
+    auto const us = [](std::uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+    json::object stages;
+    for (int s = 0; s < kStageCount; ++s) {
+        auto const& h = stages_[s];
+        stages[stage_name(static_cast<Stage>(s))] = json::object{
+            {"count", h.count()},
+            {"mean_us", h.mean() / 1e3},
+            {"p50_us", us(h.percentile(0.50))},
+            {"p90_us", us(h.percentile(0.90))},
+            {"p99_us", us(h.percentile(0.99))},
+            {"p999_us", us(h.percentile(0.999))},
+            {"max_us", us(h.max())}
+        };
+    }
+    return json::object{{"sample_every", sample_every_}, {"stages", std::move(stages)}};
+}
+
+std::shared_ptr<const std::string> LatencyTracer::make_traced(std::string payload, const MessageTrace& trace) {
+    return std::shared_ptr<const std::string>(new std::string(std::move(payload)), TracedPayloadDeleter{trace});
+}
+
+const MessageTrace* LatencyTracer::trace_of(const std::shared_ptr<const std::string>& payload) {
+    auto const* deleter = std::get_deleter<TracedPayloadDeleter>(payload);
+    return deleter ? &deleter->trace : nullptr;
+}
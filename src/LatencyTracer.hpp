@@ -0,0 +1,110 @@
+// LatencyTracer.hpp
+#ifndef LATENCY_TRACER_HPP
+#define LATENCY_TRACER_HPP
+
+#include <boost/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Histogram of non-negative values with HDR-style log-linear buckets: every
+// power-of-two range is split into 16 equal sub-buckets, so any recorded
+// value is reported within 1/16 (6.25%) of its true size. record() is a
+// handful of relaxed atomic operations and never blocks, so it can be called
+// from every I/O thread at once; readers see an approximate but consistent
+// enough snapshot.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 4;
+    static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    void record(std::int64_t value) {
+        auto const v = static_cast<std::uint64_t>(value < 0 ? 0 : value);
+        counts_[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+        auto seen = max_.load(std::memory_order_relaxed);
+        while (v > seen && !max_.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+    // Value at quantile q (0..1): the midpoint of the bucket holding it,
+    // capped at the largest value recorded.
+    std::uint64_t percentile(double q) const;
+    void reset();
+
+    static std::size_t bucket_of(std::uint64_t v);
+    static std::uint64_t bucket_lower(std::size_t index);
+    static std::uint64_t bucket_upper(std::size_t index); // exclusive
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBuckets> counts_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+// Monotonic stamps carried by one sampled chat message.
+struct MessageTrace {
+    std::int64_t read_ns = 0;    // Session::on_read: frame complete
+    std::int64_t parse_ns = 0;   // JSON parsed
+    std::int64_t enqueue_ns = 0; // ChatServer::broadcast hands it to the fan-out
+};
+
+// Per-message latency tracing. A sampled inbound message is stamped at each
+// stage and the time between stages goes into one histogram per stage. The
+// broadcast payload of a sampled message carries its MessageTrace in the
+// shared_ptr's deleter, so every recipient can stamp its own write without a
+// side table or a change to the send() interface.
+class LatencyTracer {
+public:
+    enum Stage {
+        read_to_parse,
+        parse_to_enqueue,
+        enqueue_to_write_start, // per recipient: fan-out and write queueing
+        write_start_to_complete, // per recipient: the socket write
+        read_to_write_complete, // per recipient: end to end
+        kStageCount
+    };
+
+    // sample_every: 0 disables tracing, 1 traces every message, n traces one
+    // inbound message in n (counted per I/O thread).
+    explicit LatencyTracer(unsigned sample_every = 0) : sample_every_(sample_every) {}
+
+    bool enabled() const { return sample_every_ != 0; }
+    unsigned sample_every() const { return sample_every_; }
+    bool should_sample() const;
+
+    void record(Stage stage, std::int64_t ns) { stages_[stage].record(ns); }
+    const LatencyHistogram& histogram(Stage stage) const { return stages_[stage]; }
+    void reset();
+
+    // {"sample_every": n, "stages": {"<stage>": {"count", "mean_us", "p50_us",
+    // "p90_us", "p99_us", "p999_us", "max_us"}, ...}}
+    boost::json::object to_json() const;
+    static const char* stage_name(Stage stage);
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Broadcast payload that carries `trace` to its recipients
+    static std::shared_ptr<const std::string> make_traced(std::string payload, const MessageTrace& trace);
+    // The trace a payload carries, or nullptr for untraced payloads
+    static const MessageTrace* trace_of(const std::shared_ptr<const std::string>& payload);
+
+private:
+    unsigned sample_every_;
+    std::array<LatencyHistogram, kStageCount> stages_;
+};
+
+#endif // LATENCY_TRACER_HPP
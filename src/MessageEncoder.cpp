@@ -0,0 +1,97 @@
+// MessageEncoder.cpp
+#include "MessageEncoder.hpp"
+#include <charconv>
+
+namespace MessageEncoder {
+
+namespace {
+
+// Storage above this is freed after use rather than kept for the thread
+constexpr std::size_t kMaxScratchBytes = 64 * 1024;
+
+bool needs_escape(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+} // namespace
+
+void append_value(std::string& out, std::string_view text) {
+    static char const kHex[] = "0123456789abcdef";
+    out += '"';
+    std::size_t run = 0; // Start of the bytes not yet appended
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        auto const c = static_cast<unsigned char>(text[i]);
+        if (!needs_escape(c)) {
+            continue;
+        }
+        out.append(text.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            out += "\\u00";
+            out += kHex[c >> 4];
+            out += kHex[c & 0xf];
+        }
+    }
+    out.append(text.data() + run, text.size() - run);
+    out += '"';
+}
+
+void append_value(std::string& out, bool value) {
+    out += value ? "true" : "false";
+}
+
+void append_value(std::string& out, std::int64_t value) {
+    char digits[24];
+    auto const end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, static_cast<std::size_t>(end - digits));
+}
+
+void append_value(std::string& out, std::uint64_t value) {
+    char digits[24];
+    auto const end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, static_cast<std::size_t>(end - digits));
+}
+
+void append_value(std::string& out, const UserList& users) {
+    out += '[';
+    for (std::size_t i = 0; i < users.size(); ++i) {
+        out += i == 0 ? "[" : ",[";
+        append_value(out, std::string_view(users[i].first));
+        out += ',';
+        append_value(out, std::string_view(users[i].second));
+        out += ']';
+    }
+    out += ']';
+}
+
+namespace detail {
+
+std::size_t size_hint(const UserList& users) {
+    std::size_t size = 2;
+    for (auto const& user : users) {
+        size += user.first.size() + user.second.size() + 8;
+    }
+    return size;
+}
+
+std::string& scratch(std::size_t size) {
+    thread_local std::string buffer;
+    if (buffer.capacity() > kMaxScratchBytes && size <= kMaxScratchBytes) {
+        std::string().swap(buffer); // Let go of a large message's storage
+    }
+    buffer.clear();
+    buffer.reserve(size);
+    return buffer;
+}
+
+} // namespace detail
+
+} // namespace MessageEncoder
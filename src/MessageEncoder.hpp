@@ -0,0 +1,164 @@
+// MessageEncoder.hpp
+#ifndef MESSAGE_ENCODER_HPP
+#define MESSAGE_ENCODER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Encoder for the messages the server generates, which all have the shape
+// {"type":"<type>","payload":{"<field>":<value>,...}}. Each message type is
+// described once as a Schema (ServerMessages.hpp). The JSON around the
+// values is laid out at compile time; encoding appends those fragments and
+// the escaped values to a buffer owned by the calling thread, with no DOM in
+// between. The output is byte for byte what json::serialize makes of the
+// equivalent json::object.
+namespace MessageEncoder {
+
+template <std::size_t Fields>
+struct Schema {
+    std::string_view type;
+    std::array<std::string_view, Fields> fields; // Payload members, in order
+};
+
+// [user_id, nickname] pairs, encoded as an array of two-element arrays
+using UserList = std::vector<std::pair<std::string, std::string>>;
+
+// Field values, appended as json::serialize writes them
+void append_value(std::string& out, std::string_view text); // Quoted and escaped
+inline void append_value(std::string& out, const std::string& text) { append_value(out, std::string_view(text)); }
+inline void append_value(std::string& out, const char* text) { append_value(out, std::string_view(text)); }
+void append_value(std::string& out, bool value);
+void append_value(std::string& out, std::int64_t value);
+void append_value(std::string& out, std::uint64_t value);
+void append_value(std::string& out, const UserList& users);
+template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+void append_value(std::string& out, T value) {
+    if constexpr (std::is_signed_v<T>) {
+        append_value(out, static_cast<std::int64_t>(value));
+    } else {
+        append_value(out, static_cast<std::uint64_t>(value));
+    }
+}
+
+namespace detail {
+
+// Encoded length of a value when nothing in it needs escaping
+inline std::size_t size_hint(std::string_view text) { return text.size() + 2; }
+inline std::size_t size_hint(const std::string& text) { return text.size() + 2; }
+inline std::size_t size_hint(const char* text) { return std::char_traits<char>::length(text) + 2; }
+inline std::size_t size_hint(bool) { return 5; }
+std::size_t size_hint(const UserList& users);
+template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+std::size_t size_hint(T) {
+    return 20;
+}
+
+// The calling thread's output buffer, emptied and with room for `size`
+std::string& scratch(std::size_t size);
+
+constexpr bool plain_name(std::string_view name) {
+    for (char const c : name) {
+        if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes the JSON around a schema's values to `out`, unless null, and where
+// each value goes to `ends` (the end of the fragment before it; the last
+// entry is the total). Returns the total length.
+template <std::size_t Fields>
+constexpr std::size_t lay_out(const Schema<Fields>& schema, char* out, std::size_t* ends) {
+    std::size_t length = 0;
+    auto const put = [&](std::string_view part) {
+        for (char const c : part) {
+            if (out) {
+                out[length] = c;
+            }
+            ++length;
+        }
+    };
+    put("{\"type\":\"");
+    put(schema.type);
+    put("\",\"payload\":{");
+    for (std::size_t i = 0; i < Fields; ++i) {
+        put(i == 0 ? "\"" : ",\"");
+        put(schema.fields[i]);
+        put("\":");
+        if (ends) {
+            ends[i] = length;
+        }
+    }
+    put("}}");
+    if (ends) {
+        ends[Fields] = length;
+    }
+    return length;
+}
+
+template <const auto& S>
+struct Layout {
+    static constexpr std::size_t kFields = S.fields.size();
+    static constexpr std::size_t kLength = lay_out(S, nullptr, nullptr);
+
+    struct Fragments {
+        std::array<char, kLength> text{};
+        std::array<std::size_t, kFields + 1> ends{};
+    };
+
+    static constexpr bool names_are_plain() {
+        bool plain = plain_name(S.type);
+        for (auto const field : S.fields) {
+            plain = plain && plain_name(field);
+        }
+        return plain;
+    }
+    static_assert(names_are_plain(), "Schema names are copied verbatim and must not need escaping");
+
+    static constexpr Fragments lay_out_fragments() {
+        Fragments fragments;
+        lay_out(S, fragments.text.data(), fragments.ends.data());
+        return fragments;
+    }
+    static constexpr Fragments fragments = lay_out_fragments();
+};
+
+template <const auto& S, typename... Values, std::size_t... I>
+void encode_fields(std::string& out, std::index_sequence<I...>, const Values&... values) {
+    constexpr auto const& fragments = Layout<S>::fragments;
+    out.append(fragments.text.data(), fragments.ends[0]);
+    ((append_value(out, values),
+      out.append(fragments.text.data() + fragments.ends[I], fragments.ends[I + 1] - fragments.ends[I])),
+     ...);
+}
+
+} // namespace detail
+
+// Encodes a message of schema `S` with one value per field, in order. The
+// result is the calling thread's buffer: it stays valid until the next
+// encode() on the same thread, so copy it (broadcast() and the other
+// senders do) before encoding another message.
+template <const auto& S, typename... Values>
+const std::string& encode(const Values&... values) {
+    static_assert(sizeof...(Values) == detail::Layout<S>::kFields, "One value per schema field");
+    std::string& out = detail::scratch(detail::Layout<S>::kLength + (std::size_t{0} + ... + detail::size_hint(values)));
+    detail::encode_fields<S>(out, std::index_sequence_for<Values...>{}, values...);
+    return out;
+}
+
+template <const auto& S, typename... Values>
+std::shared_ptr<const std::string> encode_shared(const Values&... values) {
+    return std::make_shared<const std::string>(encode<S>(values...));
+}
+
+} // namespace MessageEncoder
+
+#endif // MESSAGE_ENCODER_HPP
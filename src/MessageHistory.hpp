@@ -0,0 +1,54 @@
+// MessageHistory.hpp
+#ifndef MESSAGE_HISTORY_HPP
+#define MESSAGE_HISTORY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The last `capacity` messages broadcast to the room, indexed by their
+// sequence number, for replaying to resumed sessions. Sequence numbers start
+// at 1 and are appended without gaps, so message `seq` lives in slot
+// seq % capacity for as long as it is among the last `capacity`. Not
+// thread-safe; ChatServer guards it with its session lock.
+class MessageHistory {
+public:
+    explicit MessageHistory(std::size_t capacity) : slots_(capacity) {}
+
+    std::uint64_t last_seq() const { return last_seq_; }
+
+    // Number the next appended message gets
+    std::uint64_t next_seq() const { return last_seq_ + 1; }
+
+    // Records `message` as number next_seq()
+    void append(std::shared_ptr<const std::string> message) {
+        ++last_seq_;
+        if (!slots_.empty()) {
+            slots_[last_seq_ % slots_.size()] = std::move(message);
+        }
+    }
+
+    // Appends every message after `seq` that is still held to `out`, oldest
+    // first. Returns false if some of them have already been overwritten.
+    bool since(std::uint64_t seq, std::vector<std::shared_ptr<const std::string>>& out) const {
+        if (seq >= last_seq_) {
+            return true;
+        }
+        std::uint64_t const held = std::min<std::uint64_t>(last_seq_, slots_.size());
+        std::uint64_t const oldest = last_seq_ - held + 1;
+        bool const complete = seq + 1 >= oldest;
+        for (std::uint64_t s = complete ? seq + 1 : oldest; s <= last_seq_; ++s) {
+            out.push_back(slots_[s % slots_.size()]);
+        }
+        return complete;
+    }
+
+private:
+    std::vector<std::shared_ptr<const std::string>> slots_;
+    std::uint64_t last_seq_ = 0;
+};
+
+#endif // MESSAGE_HISTORY_HPP
@@ -0,0 +1,576 @@
+// MessageSniffer.cpp
+#include "MessageSniffer.hpp"
+#include <atomic>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define CHAT_SNIFFER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace MessageSniffer {
+
+namespace {
+
+// Kernels: position of the first byte a string scan has to look at (quote,
+// backslash, control or non-ASCII), and of the first non-ASCII byte.
+using FindFn = const char* (*)(const char* p, const char* end);
+
+bool is_special(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20 || c >= 0x80;
+}
+
+const char* find_special_scalar(const char* p, const char* end) {
+    while (p != end && !is_special(static_cast<unsigned char>(*p))) {
+        ++p;
+    }
+    return p;
+}
+
+const char* find_non_ascii_scalar(const char* p, const char* end) {
+    while (p != end && static_cast<unsigned char>(*p) < 0x80) {
+        ++p;
+    }
+    return p;
+}
+
+#if defined(CHAT_SNIFFER_X86)
+
+const char* find_special_sse2(const char* p, const char* end) {
+    __m128i const quote = _mm_set1_epi8('"');
+    __m128i const backslash = _mm_set1_epi8('\\');
+    __m128i const control = _mm_set1_epi8(0x1f);
+    for (; end - p >= 16; p += 16) {
+        __m128i const chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // max(c, 0x1f) == 0x1f exactly for c <= 0x1f; the sign bits are the non-ASCII bytes
+        __m128i const hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                          _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        if (int const mask = _mm_movemask_epi8(hits) | _mm_movemask_epi8(chunk)) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+    return find_special_scalar(p, end);
+}
+
+const char* find_non_ascii_sse2(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        if (int const mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)))) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+    return find_non_ascii_scalar(p, end);
+}
+
+__attribute__((target("avx2"))) const char* find_special_avx2(const char* p, const char* end) {
+    __m256i const quote = _mm256_set1_epi8('"');
+    __m256i const backslash = _mm256_set1_epi8('\\');
+    __m256i const control = _mm256_set1_epi8(0x1f);
+    for (; end - p >= 32; p += 32) {
+        __m256i const chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i const hits =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                            _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control));
+        if (unsigned const mask = static_cast<unsigned>(_mm256_movemask_epi8(hits) | _mm256_movemask_epi8(chunk))) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_special_sse2(p, end);
+}
+
+__attribute__((target("avx2"))) const char* find_non_ascii_avx2(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i const chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        if (unsigned const mask = static_cast<unsigned>(_mm256_movemask_epi8(chunk))) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_non_ascii_sse2(p, end);
+}
+
+#endif // defined(CHAT_SNIFFER_X86)
+
+struct Kernels {
+    FindFn find_special;
+    FindFn find_non_ascii;
+};
+
+Kernels kernels_for(Isa isa) {
+    switch (isa) {
+#if defined(CHAT_SNIFFER_X86)
+    case Isa::avx2:
+        return {find_special_avx2, find_non_ascii_avx2};
+    case Isa::sse2:
+        return {find_special_sse2, find_non_ascii_sse2};
+#endif
+    default:
+        return {find_special_scalar, find_non_ascii_scalar};
+    }
+}
+
+Isa detect_isa() {
+#if defined(CHAT_SNIFFER_X86)
+    __builtin_cpu_init(); // May run before the constructor that would call it
+    return __builtin_cpu_supports("avx2") ? Isa::avx2 : Isa::sse2;
+#else
+    return Isa::scalar;
+#endif
+}
+
+std::atomic<Isa> g_isa{detect_isa()};
+std::atomic<FindFn> g_find_special{kernels_for(g_isa.load()).find_special};
+std::atomic<FindFn> g_find_non_ascii{kernels_for(g_isa.load()).find_non_ascii};
+
+// Length of the valid UTF-8 sequence starting with the non-ASCII byte at
+// `p`, or 0: no overlong forms, surrogates or code points above U+10FFFF.
+std::size_t utf8_sequence(const unsigned char* p, const unsigned char* end) {
+    unsigned char const lead = p[0];
+    std::size_t length = 0;
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        low = lead == 0xe0 ? 0xa0 : 0x80;
+        high = lead == 0xed ? 0x9f : 0xbf;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        low = lead == 0xf0 ? 0x90 : 0x80;
+        high = lead == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return 0;
+    }
+    if (static_cast<std::size_t>(end - p) < length || p[1] < low || p[1] > high) {
+        return 0;
+    }
+    for (std::size_t i = 2; i < length; ++i) {
+        if (p[i] < 0x80 || p[i] > 0xbf) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// The four hex digits of a \u escape at `p`, or -1
+long hex4(const char* p, const char* end) {
+    if (end - p < 4) {
+        return -1;
+    }
+    long value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int const digit = hex_digit(p[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+// Reads the escape sequence after a backslash at `p`. Sets `code_point` to
+// what it stands for and returns the position after it, or nullptr.
+const char* read_escape(const char* p, const char* end, std::uint32_t& code_point) {
+    if (++p == end) {
+        return nullptr;
+    }
+    switch (*p) {
+    case '"': code_point = '"'; return p + 1;
+    case '\\': code_point = '\\'; return p + 1;
+    case '/': code_point = '/'; return p + 1;
+    case 'b': code_point = '\b'; return p + 1;
+    case 'f': code_point = '\f'; return p + 1;
+    case 'n': code_point = '\n'; return p + 1;
+    case 'r': code_point = '\r'; return p + 1;
+    case 't': code_point = '\t'; return p + 1;
+    case 'u': break;
+    default: return nullptr;
+    }
+    long const unit = hex4(p + 1, end);
+    p += 5;
+    if (unit < 0 || (unit >= 0xdc00 && unit <= 0xdfff)) {
+        return nullptr; // Bad digits or a lone trailing surrogate
+    }
+    if (unit < 0xd800 || unit > 0xdbff) {
+        code_point = static_cast<std::uint32_t>(unit);
+        return p;
+    }
+    // A leading surrogate must be followed by a trailing one
+    if (end - p < 6 || p[0] != '\\' || p[1] != 'u') {
+        return nullptr;
+    }
+    long const trail = hex4(p + 2, end);
+    if (trail < 0xdc00 || trail > 0xdfff) {
+        return nullptr;
+    }
+    code_point = 0x10000 + ((static_cast<std::uint32_t>(unit) - 0xd800) << 10) +
+                 (static_cast<std::uint32_t>(trail) - 0xdc00);
+    return p + 6;
+}
+
+bool same_key(const Value& key, std::string_view name) {
+    return !key.escaped && key.raw == name;
+}
+
+// Recursive descent over one frame. Containers are only descended into to
+// check them, except for the top-level object and its payload, whose members
+// are recorded in the Message.
+class Scanner {
+public:
+    Scanner(std::string_view frame, Message& out, FindFn find_special)
+        : p_(frame.data()), end_(frame.data() + frame.size()), out_(out), find_special_(find_special) {}
+
+    Result run() {
+        skip_whitespace();
+        if (p_ == end_) {
+            return Result::malformed;
+        }
+        bool const is_object = *p_ == '{';
+        Value root;
+        if (!value(root, 0, is_object ? Role::top : Role::other)) {
+            return result_;
+        }
+        skip_whitespace();
+        if (p_ != end_) {
+            return Result::malformed; // Trailing garbage
+        }
+        return is_object ? Result::ok : Result::not_object;
+    }
+
+private:
+    enum class Role { top, payload, other };
+
+    bool fail(Result result) {
+        result_ = result;
+        return false;
+    }
+
+    void skip_whitespace() {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+            ++p_;
+        }
+    }
+
+    bool value(Value& out, int depth, Role role) {
+        if (p_ == end_) {
+            return fail(Result::malformed);
+        }
+        switch (*p_) {
+        case '"':
+            return string(out);
+        case '{':
+        case '[': {
+            if (depth >= kMaxDepth) {
+                return fail(Result::malformed);
+            }
+            const char* const begin = p_;
+            bool const ok = *p_ == '{' ? object(depth + 1, role) : array(depth + 1);
+            out.kind = *begin == '{' ? Value::object : Value::array;
+            out.raw = std::string_view(begin, static_cast<std::size_t>(p_ - begin));
+            return ok;
+        }
+        case 't':
+            out.kind = Value::boolean;
+            return literal("true", out);
+        case 'f':
+            out.kind = Value::boolean;
+            return literal("false", out);
+        case 'n':
+            out.kind = Value::null;
+            return literal("null", out);
+        default:
+            return number(out);
+        }
+    }
+
+    bool literal(std::string_view word, Value& out) {
+        if (static_cast<std::size_t>(end_ - p_) < word.size() || std::string_view(p_, word.size()) != word) {
+            return fail(Result::malformed);
+        }
+        out.raw = std::string_view(p_, word.size());
+        p_ += word.size();
+        return true;
+    }
+
+    bool digits() {
+        const char* const begin = p_;
+        while (p_ != end_ && *p_ >= '0' && *p_ <= '9') {
+            ++p_;
+        }
+        return p_ != begin;
+    }
+
+    bool number(Value& out) {
+        const char* const begin = p_;
+        if (*p_ == '-') {
+            ++p_;
+        }
+        if (p_ != end_ && *p_ == '0') {
+            ++p_; // No leading zeros
+        } else if (!digits()) {
+            return fail(Result::malformed);
+        }
+        if (p_ != end_ && *p_ == '.') {
+            ++p_;
+            if (!digits()) {
+                return fail(Result::malformed);
+            }
+        }
+        if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (p_ != end_ && (*p_ == '+' || *p_ == '-')) {
+                ++p_;
+            }
+            if (!digits()) {
+                return fail(Result::malformed);
+            }
+        }
+        out.kind = Value::number;
+        out.raw = std::string_view(begin, static_cast<std::size_t>(p_ - begin));
+        return true;
+    }
+
+    bool string(Value& out) {
+        const char* const begin = ++p_;
+        bool escaped = false;
+        for (;;) {
+            p_ = find_special_(p_, end_);
+            if (p_ == end_) {
+                return fail(Result::malformed); // Unterminated
+            }
+            auto const c = static_cast<unsigned char>(*p_);
+            if (c == '"') {
+                break;
+            }
+            if (c == '\\') {
+                std::uint32_t code_point = 0;
+                p_ = read_escape(p_, end_, code_point);
+                if (!p_) {
+                    return fail(Result::malformed);
+                }
+                escaped = true;
+            } else if (c < 0x20) {
+                return fail(Result::malformed); // Control characters must be escaped
+            } else {
+                auto const length = utf8_sequence(reinterpret_cast<const unsigned char*>(p_),
+                                                  reinterpret_cast<const unsigned char*>(end_));
+                if (length == 0) {
+                    return fail(Result::invalid_utf8);
+                }
+                p_ += length;
+            }
+        }
+        out.kind = Value::string;
+        out.escaped = escaped;
+        out.raw = std::string_view(begin, static_cast<std::size_t>(p_ - begin));
+        ++p_;
+        return true;
+    }
+
+    bool array(int depth) {
+        ++p_;
+        skip_whitespace();
+        if (p_ != end_ && *p_ == ']') {
+            ++p_;
+            return true;
+        }
+        for (;;) {
+            skip_whitespace();
+            Value element;
+            if (!value(element, depth, Role::other)) {
+                return false;
+            }
+            skip_whitespace();
+            if (p_ == end_) {
+                return fail(Result::malformed);
+            }
+            if (*p_ == ']') {
+                ++p_;
+                return true;
+            }
+            if (*p_++ != ',') {
+                return fail(Result::malformed);
+            }
+        }
+    }
+
+    bool object(int depth, Role role) {
+        ++p_;
+        skip_whitespace();
+        if (p_ != end_ && *p_ == '}') {
+            ++p_;
+            return true;
+        }
+        for (;;) {
+            skip_whitespace();
+            Value key;
+            if (p_ == end_ || *p_ != '"') {
+                return fail(Result::malformed);
+            }
+            if (!string(key)) {
+                return false;
+            }
+            skip_whitespace();
+            if (p_ == end_ || *p_++ != ':') {
+                return fail(Result::malformed);
+            }
+            skip_whitespace();
+            bool const is_payload = role == Role::top && same_key(key, "payload");
+            Value member;
+            if (!value(member, depth, is_payload ? Role::payload : Role::other)) {
+                return false;
+            }
+            record(role, key, member);
+            skip_whitespace();
+            if (p_ == end_) {
+                return fail(Result::malformed);
+            }
+            if (*p_ == '}') {
+                ++p_;
+                return true;
+            }
+            if (*p_++ != ',') {
+                return fail(Result::malformed);
+            }
+        }
+    }
+
+    void record(Role role, const Value& key, const Value& member) {
+        if (role == Role::other) {
+            return;
+        }
+        if (key.escaped) {
+            out_.complete = false; // Could spell a routed key
+            return;
+        }
+        if (role == Role::top) {
+            Value* const slot = key.raw == "type" ? &out_.type : key.raw == "payload" ? &out_.payload : nullptr;
+            if (slot) {
+                if (slot->kind != Value::none) {
+                    out_.complete = false;
+                }
+                *slot = member;
+            }
+            return;
+        }
+        if (out_.member(key.raw) || out_.member_count == Message::kMaxMembers) {
+            out_.complete = false;
+        }
+        if (out_.member_count < Message::kMaxMembers) {
+            out_.members[out_.member_count++] = {key.raw, member};
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+    Message& out_;
+    FindFn find_special_;
+    Result result_ = Result::malformed;
+};
+
+} // namespace
+
+const Value* Message::member(std::string_view name) const {
+    for (std::size_t i = member_count; i > 0; --i) {
+        if (members[i - 1].first == name) {
+            return &members[i - 1].second;
+        }
+    }
+    return nullptr;
+}
+
+Result sniff(std::string_view frame, Message& out) {
+    out = Message();
+    return Scanner(frame, out, g_find_special.load(std::memory_order_relaxed)).run();
+}
+
+bool validate_utf8(std::string_view text) {
+    auto const find_non_ascii = g_find_non_ascii.load(std::memory_order_relaxed);
+    const char* p = text.data();
+    const char* const end = p + text.size();
+    while ((p = find_non_ascii(p, end)) != end) {
+        auto const length =
+            utf8_sequence(reinterpret_cast<const unsigned char*>(p), reinterpret_cast<const unsigned char*>(end));
+        if (length == 0) {
+            return false;
+        }
+        p += length;
+    }
+    return true;
+}
+
+bool unescape(std::string_view raw, std::string& out) {
+    out.clear();
+    out.reserve(raw.size());
+    const char* p = raw.data();
+    const char* const end = p + raw.size();
+    while (p != end) {
+        if (*p != '\\') {
+            out += *p++;
+            continue;
+        }
+        std::uint32_t code_point = 0;
+        p = read_escape(p, end, code_point);
+        if (!p) {
+            return false;
+        }
+        // As UTF-8
+        if (code_point < 0x80) {
+            out += static_cast<char>(code_point);
+        } else if (code_point < 0x800) {
+            out += static_cast<char>(0xc0 | (code_point >> 6));
+            out += static_cast<char>(0x80 | (code_point & 0x3f));
+        } else if (code_point < 0x10000) {
+            out += static_cast<char>(0xe0 | (code_point >> 12));
+            out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code_point & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (code_point >> 18));
+            out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code_point & 0x3f));
+        }
+    }
+    return true;
+}
+
+Isa isa() {
+    return g_isa.load(std::memory_order_relaxed);
+}
+
+Isa best_isa() {
+    static Isa const best = detect_isa();
+    return best;
+}
+
+void use_isa(Isa wanted) {
+    Isa const isa = static_cast<int>(wanted) > static_cast<int>(best_isa()) ? best_isa() : wanted;
+    auto const kernels = kernels_for(isa);
+    g_find_special.store(kernels.find_special, std::memory_order_relaxed);
+    g_find_non_ascii.store(kernels.find_non_ascii, std::memory_order_relaxed);
+    g_isa.store(isa, std::memory_order_relaxed);
+}
+
+const char* isa_name(Isa isa) {
+    switch (isa) {
+    case Isa::avx2:
+        return "avx2";
+    case Isa::sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+} // namespace MessageSniffer
@@ -0,0 +1,78 @@
+// MessageSniffer.hpp
+#ifndef MESSAGE_SNIFFER_HPP
+#define MESSAGE_SNIFFER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Ingest stage for inbound frames. One pass over a frame checks that it is
+// well-formed JSON in valid UTF-8 and locates what routing needs: the
+// top-level "type", the "payload" and the payload's members, as spans of the
+// frame. No DOM is built; a session parses a frame in full only for the
+// message types that need more than that.
+//
+// String contents, where chat frames spend nearly all their bytes, are
+// scanned 16 (SSE2) or 32 (AVX2) bytes at a time for the next quote,
+// backslash, control or non-ASCII byte. Multi-byte UTF-8 sequences and
+// everything outside strings are checked byte by byte.
+namespace MessageSniffer {
+
+// A JSON value located in a frame. `raw` is the value's text; for strings,
+// their contents between the quotes, escape sequences and all.
+struct Value {
+    enum Kind : std::uint8_t { none, string, number, boolean, null, object, array };
+    Kind kind = none;
+    bool escaped = false; // A string with escape sequences (see unescape)
+    std::string_view raw;
+};
+
+struct Message {
+    static constexpr std::size_t kMaxMembers = 8;
+
+    Value type;    // Top-level "type"
+    Value payload; // Top-level "payload"
+    // Members of an object payload, in frame order
+    std::array<std::pair<std::string_view, Value>, kMaxMembers> members;
+    std::size_t member_count = 0;
+    // False if the spans above may not tell the whole story: a routed key
+    // has escape sequences, a key repeats or the payload has more members
+    // than kMaxMembers. Such frames should be parsed in full.
+    bool complete = true;
+
+    // Last payload member called `name`, or nullptr
+    const Value* member(std::string_view name) const;
+};
+
+enum class Result {
+    ok,
+    invalid_utf8,
+    malformed,  // Not JSON, or nested deeper than kMaxDepth
+    not_object, // JSON, but not an object
+};
+
+constexpr int kMaxDepth = 32; // Boost.JSON's default limit
+
+// `frame` must outlive the spans in `out`
+Result sniff(std::string_view frame, Message& out);
+
+bool validate_utf8(std::string_view text);
+
+// Decodes the contents of a JSON string (Value::raw) into `out`. Returns
+// false on malformed escape sequences, which sniff() has already ruled out.
+bool unescape(std::string_view raw, std::string& out);
+
+// Vector units used for the scans: the widest the CPU supports, unless
+// narrowed with use_isa() (tests and benchmarks).
+enum class Isa { scalar, sse2, avx2 };
+Isa isa();
+Isa best_isa();
+// Clamped to best_isa(). Not synchronized with running scans.
+void use_isa(Isa isa);
+const char* isa_name(Isa isa);
+
+} // namespace MessageSniffer
+
+#endif // MESSAGE_SNIFFER_HPP
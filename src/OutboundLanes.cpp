@@ -0,0 +1,88 @@
+// OutboundLanes.cpp
+#include "OutboundLanes.hpp"
+#include "StreamedPayload.hpp"
+
+namespace {
+
+// Consumed entries kept before a lane that never drains is compacted
+constexpr std::size_t kCompactAfter = 64;
+
+constexpr std::size_t kFirstWeighted = static_cast<std::size_t>(Lane::presence);
+
+} // namespace
+
+OutboundLanes::Message OutboundLanes::Queue::take() {
+    Message message = std::move(messages[head++]);
+    if (head == messages.size()) {
+        messages.clear();
+        head = 0;
+    } else if (head >= kCompactAfter && head * 2 >= messages.size()) {
+        messages.erase(messages.begin(), messages.begin() + static_cast<std::ptrdiff_t>(head));
+        head = 0;
+    }
+    return message;
+}
+
+void OutboundLanes::push(Lane lane, Message message) {
+    bytes_ += StreamedPayload::wire_size(message);
+    ++size_;
+    queue(lane).messages.push_back(std::move(message));
+}
+
+OutboundLanes::Message OutboundLanes::pop() {
+    Message message;
+    if (!queue(Lane::control).empty()) {
+        message = queue(Lane::control).take();
+    } else {
+        // Deficit round robin: each weighted lane with messages gets its
+        // quantum once per round and writes while the next message fits.
+        // Oversized messages wait for the deficit to build up over rounds.
+        for (;;) {
+            Queue& lane = queues_[turn_];
+            if (lane.empty()) {
+                deficit_[turn_] = 0;
+            } else {
+                if (!granted_) {
+                    deficit_[turn_] += kWeights[turn_] * kQuantumBytes;
+                    granted_ = true;
+                }
+                auto const next = StreamedPayload::wire_size(lane.messages[lane.head]);
+                if (next <= deficit_[turn_]) {
+                    deficit_[turn_] -= next;
+                    message = lane.take();
+                    if (lane.empty()) {
+                        deficit_[turn_] = 0; // An idle lane does not save up
+                    }
+                    break;
+                }
+            }
+            turn_ = turn_ + 1 == kLanes ? kFirstWeighted : turn_ + 1;
+            granted_ = false;
+        }
+    }
+    --size_;
+    bytes_ -= StreamedPayload::wire_size(message);
+    return message;
+}
+
+std::size_t OutboundLanes::size(Lane lane) const {
+    return queues_[static_cast<std::size_t>(lane)].size();
+}
+
+void OutboundLanes::clear() {
+    for (auto& lane : queues_) {
+        lane.messages.clear();
+        lane.head = 0;
+    }
+    deficit_.fill(0);
+    size_ = 0;
+    bytes_ = 0;
+}
+
+void OutboundLanes::shrink_to_fit() {
+    for (auto& lane : queues_) {
+        if (lane.empty()) {
+            lane.messages.shrink_to_fit();
+        }
+    }
+}
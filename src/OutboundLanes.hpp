@@ -0,0 +1,69 @@
+// OutboundLanes.hpp
+#ifndef OUTBOUND_LANES_HPP
+#define OUTBOUND_LANES_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Outbound message classes, highest priority first. Messages within a lane
+// keep their order; across lanes they may be reordered.
+enum class Lane : std::uint8_t {
+    control,  // Session protocol: welcome/resume, batching status, refused files. Jumps the queue
+    presence, // Presence deltas and roster snapshots (not sequenced)
+    chat,     // Sequenced room messages, including resume replays
+    bulk,     // History query pages and shared files
+};
+
+// A session's write queue, split into lanes. Control messages are always
+// written first. The other lanes share the connection by deficit round
+// robin, by bytes, so a long history reply cannot hold up live chat and a
+// chat flood cannot shut out presence or history entirely.
+class OutboundLanes {
+public:
+    using Message = std::shared_ptr<const std::string>;
+
+    static constexpr std::size_t kLanes = 4;
+    // Bytes a weighted lane may write per round, per unit of weight
+    static constexpr std::size_t kQuantumBytes = 4096;
+    static constexpr std::array<std::size_t, kLanes> kWeights = {0, 2, 4, 1}; // control is not weighted
+
+    void push(Lane lane, Message message);
+    // Takes the next message to write; the lanes must not be empty.
+    Message pop();
+
+    bool empty() const { return size_ == 0; }
+    std::size_t size() const { return size_; }
+    std::size_t size(Lane lane) const;
+    std::size_t bytes() const { return bytes_; } // Streamed payloads included
+
+    void clear();
+    // Frees the storage of empty lanes (--low-memory)
+    void shrink_to_fit();
+
+private:
+    // Messages are taken from `head`; the consumed prefix is dropped once it
+    // is half the vector, or when the lane empties.
+    struct Queue {
+        std::vector<Message> messages;
+        std::size_t head = 0;
+
+        bool empty() const { return head == messages.size(); }
+        std::size_t size() const { return messages.size() - head; }
+        Message take();
+    };
+
+    Queue& queue(Lane lane) { return queues_[static_cast<std::size_t>(lane)]; }
+
+    std::array<Queue, kLanes> queues_;
+    std::array<std::size_t, kLanes> deficit_{};
+    std::size_t turn_ = static_cast<std::size_t>(Lane::presence); // Weighted lane whose round it is
+    bool granted_ = false;                                        // turn_ got its quantum this round
+    std::size_t size_ = 0;
+    std::size_t bytes_ = 0;
+};
+
+#endif // OUTBOUND_LANES_HPP
@@ -0,0 +1,44 @@
+// Probes.hpp
+#ifndef PROBES_HPP
+#define PROBES_HPP
+
+// USDT (user-level statically defined tracing) probes for perf and bpftrace,
+// all under the provider "chat". With <sys/sdt.h> (systemtap-sdt-dev) found
+// at configure time (CHAT_ENABLE_USDT, on by default) each probe compiles to
+// a single nop plus an ELF note that a tracer patches when it attaches. The
+// arguments are always computed, so keep them to pointers and sizes that are
+// already at hand. Without <sys/sdt.h> the macros compile to nothing.
+//
+// List them with `bpftrace -l 'usdt:./websocket-chat-server:chat:*'`; the
+// scripts in scripts/bpftrace/ build distributions from them.
+//
+//   accept            (fd)                        new TCP connection accepted
+//   handshake_done    (session_id, fd)            websocket upgrade complete
+//   message_received  (session_id, bytes)         inbound frame read
+//   broadcast_start   (recipients)                fan-out begins
+//   broadcast_end     (recipients)                every recipient has the message queued
+//                                                 (per-thread model: handed to its thread)
+//   enqueue           (session_id, depth, bytes)  outbound message queued; depth after queueing
+//   write_complete    (session_id, bytes, depth)  frame written; depth still queued
+//   disconnect        (session_id, remaining)     session removed from the server
+//
+// session_id arguments are NUL-terminated strings (use str(argN)).
+
+#if defined(CHAT_HAVE_USDT)
+
+#include <sys/sdt.h>
+
+#define CHAT_PROBE1(name, a) DTRACE_PROBE1(chat, name, a)
+#define CHAT_PROBE2(name, a, b) DTRACE_PROBE2(chat, name, a, b)
+#define CHAT_PROBE3(name, a, b, c) DTRACE_PROBE3(chat, name, a, b, c)
+
+#else
+
+// sizeof keeps the arguments "used" without evaluating them
+#define CHAT_PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define CHAT_PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define CHAT_PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+
+#endif
+
+#endif // PROBES_HPP
@@ -0,0 +1,361 @@
+// Profiler.cpp
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <malloc.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <signal.h>
+#include <sstream>
+#include <sys/time.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr int kMaxFrames = 32;
+constexpr std::size_t kMaxSamples = 100000; // About 26 MB while profiling
+constexpr std::size_t kMaxNameChars = 160;   // Asio handler types run to kilobytes
+constexpr std::size_t kStackFrames = 8;      // Frames shown per hot stack
+
+struct Sample {
+    std::uint64_t weight;
+    int depth;
+    void* frames[kMaxFrames];
+};
+
+// Samples for one profile. Writers (signal handlers, allocating threads)
+// claim a slot with one atomic increment and never block; stop() waits for
+// the writers still inside before it reads.
+struct SampleBuffer {
+    explicit SampleBuffer(std::size_t capacity) : samples(new Sample[capacity]), capacity(capacity) {}
+
+    Sample* claim() {
+        auto const index = next.fetch_add(1, std::memory_order_relaxed);
+        return index < capacity ? &samples[index] : nullptr;
+    }
+    std::size_t used() const { return std::min(next.load(), capacity); }
+    std::size_t dropped() const { return next.load() - used(); }
+
+    std::unique_ptr<Sample[]> samples;
+    std::size_t const capacity;
+    std::atomic<std::size_t> next{0};
+};
+
+// Writers inside a SampleBuffer; stop() drains them before reading
+std::atomic<int> g_writers{0};
+
+void drain_writers() {
+    while (g_writers.load() != 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+// "Function" for a return address: the demangled symbol, or module+offset
+std::string symbolize(void* address) {
+    // A return address may point just past its function; look up the call
+    auto const pc = reinterpret_cast<std::uintptr_t>(address) - 1;
+    Dl_info info{};
+    if (dladdr(reinterpret_cast<void*>(pc), &info) == 0) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "0x%lx", static_cast<unsigned long>(pc));
+        return buffer;
+    }
+    if (info.dli_sname == nullptr) {
+        std::string module = info.dli_fname ? info.dli_fname : "?";
+        module = module.substr(module.rfind('/') + 1);
+        char offset[32];
+        std::snprintf(offset, sizeof(offset), "+0x%lx",
+                      static_cast<unsigned long>(pc - reinterpret_cast<std::uintptr_t>(info.dli_fbase)));
+        return module + offset;
+    }
+    int status = 0;
+    std::unique_ptr<char, void (*)(void*)> demangled(abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status),
+                                                     std::free);
+    std::string name = status == 0 && demangled ? demangled.get() : info.dli_sname;
+    if (name.size() > kMaxNameChars) {
+        name = name.substr(0, kMaxNameChars - 3) + "...";
+    }
+    return name;
+}
+
+// Folds the samples into the report described in Profiler.hpp. The first
+// `skip` frames of every sample belong to the profiler itself; with
+// `skip_new`, so do the operator new frames after them (new[] and nothrow
+// new call the hooked operator new).
+std::string report(const SampleBuffer& buffer, int skip, bool skip_new, std::size_t top,
+                   const std::string& heading, const char* unit) {
+    std::unordered_map<void*, std::string> names;
+    auto const name_of = [&names](void* address) -> const std::string& {
+        auto it = names.find(address);
+        if (it == names.end()) {
+            it = names.emplace(address, symbolize(address)).first;
+        }
+        return it->second;
+    };
+
+    struct Weights {
+        std::uint64_t self = 0;
+        std::uint64_t total = 0;
+    };
+    std::unordered_map<std::string, Weights> functions;
+    std::map<std::vector<std::string>, std::uint64_t> stacks;
+    // Identical stacks are folded first, so each is symbolized once
+    std::map<std::vector<void*>, std::uint64_t> raw_stacks;
+    std::size_t const used = buffer.used();
+    for (std::size_t i = 0; i < used; ++i) {
+        Sample const& sample = buffer.samples[i];
+        if (sample.depth > skip) {
+            raw_stacks[std::vector<void*>(sample.frames + skip, sample.frames + sample.depth)] += sample.weight;
+        }
+    }
+
+    std::uint64_t total_weight = 0;
+    for (auto const& [frames, weight] : raw_stacks) {
+        std::vector<std::string> stack;
+        for (void* frame : frames) {
+            auto const& name = name_of(frame);
+            if (stack.empty() && skip_new && name.rfind("operator new", 0) == 0) {
+                continue;
+            }
+            stack.push_back(name);
+        }
+        if (stack.empty()) {
+            continue;
+        }
+        total_weight += weight;
+        functions[stack.front()].self += weight;
+        // Recursion counts once towards a function's total
+        std::vector<const std::string*> seen;
+        for (auto const& name : stack) {
+            if (std::find_if(seen.begin(), seen.end(), [&](const std::string* s) { return *s == name; }) ==
+                seen.end()) {
+                seen.push_back(&name);
+                functions[name].total += weight;
+            }
+        }
+        stack.resize(std::min(stack.size(), kStackFrames));
+        stacks[stack] += weight;
+    }
+
+    std::ostringstream out;
+    out << heading << "samples: " << used << " (" << buffer.dropped() << " dropped)";
+    if (std::string(unit) != "samples") {
+        out << ", " << unit << ": " << total_weight;
+    }
+    out << "\n";
+    auto const percent = [total_weight](std::uint64_t weight) {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%5.1f%%",
+                      total_weight ? 100.0 * static_cast<double>(weight) / static_cast<double>(total_weight) : 0.0);
+        return std::string(buffer);
+    };
+
+    std::vector<std::pair<std::string, Weights>> ranked(functions.begin(), functions.end());
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+        return a.second.self != b.second.self ? a.second.self > b.second.self : a.second.total > b.second.total;
+    });
+    out << "\nBy function (" << unit << "):\n";
+    char line[64];
+    std::snprintf(line, sizeof(line), "%14s %6s %14s %6s  ", "self", "", "total", "");
+    out << line << "function\n";
+    for (std::size_t i = 0; i < std::min(top, ranked.size()); ++i) {
+        auto const& [name, weights] = ranked[i];
+        std::snprintf(line, sizeof(line), "%14llu %s %14llu %s  ", static_cast<unsigned long long>(weights.self),
+                      percent(weights.self).c_str(), static_cast<unsigned long long>(weights.total),
+                      percent(weights.total).c_str());
+        out << line << name << "\n";
+    }
+
+    std::vector<std::pair<std::uint64_t, const std::vector<std::string>*>> hot;
+    for (auto const& [stack, weight] : stacks) {
+        hot.emplace_back(weight, &stack);
+    }
+    std::sort(hot.begin(), hot.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    out << "\nHottest stacks (innermost first, " << kStackFrames << " frames):\n";
+    for (std::size_t i = 0; i < std::min<std::size_t>(10, hot.size()); ++i) {
+        std::snprintf(line, sizeof(line), "%14llu %s\n", static_cast<unsigned long long>(hot[i].first),
+                      percent(hot[i].first).c_str());
+        out << line;
+        for (auto const& name : *hot[i].second) {
+            out << "      " << name << "\n";
+        }
+    }
+    return out.str();
+}
+
+// CPU profile state. The handler reads it; start() and stop() serialize on
+// g_cpu_mutex.
+std::mutex g_cpu_mutex;
+std::unique_ptr<SampleBuffer> g_cpu_samples;
+std::atomic<bool> g_cpu_active{false};
+std::chrono::steady_clock::time_point g_cpu_started;
+int g_cpu_hz = 0;
+struct sigaction g_previous_sigprof;
+
+void on_sigprof(int) {
+    int const saved_errno = errno;
+    g_writers.fetch_add(1);
+    if (g_cpu_active.load()) {
+        if (Sample* sample = g_cpu_samples->claim()) {
+            sample->weight = 1;
+            sample->depth = backtrace(sample->frames, kMaxFrames);
+        }
+    }
+    g_writers.fetch_sub(1);
+    errno = saved_errno;
+}
+
+bool set_profiling_timer(int hz) {
+    itimerval timer{};
+    if (hz > 0) {
+        timer.it_interval.tv_usec = 1000000 / hz;
+        timer.it_value = timer.it_interval;
+    }
+    return setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+}
+
+// Heap profile state
+std::mutex g_heap_mutex;
+std::unique_ptr<SampleBuffer> g_heap_samples;
+std::atomic<std::size_t> g_sample_bytes{0};
+std::chrono::steady_clock::time_point g_heap_started;
+std::size_t g_heap_in_use_at_start = 0;
+std::atomic<bool> g_hooks_linked{false};
+
+thread_local std::int64_t t_until_sample = 0;
+thread_local bool t_recording = false; // backtrace() may allocate
+
+std::size_t heap_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+bool CpuProfiler::start(int hz) {
+    std::lock_guard<std::mutex> lock(g_cpu_mutex);
+    if (g_cpu_samples || hz <= 0 || hz > 1000) {
+        return false;
+    }
+    void* warm_up[1];
+    backtrace(warm_up, 1); // Its first call loads the unwinder, which allocates
+    g_cpu_samples = std::make_unique<SampleBuffer>(kMaxSamples);
+    struct sigaction action {};
+    action.sa_handler = on_sigprof;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &g_previous_sigprof);
+    g_cpu_hz = hz;
+    g_cpu_started = std::chrono::steady_clock::now();
+    g_cpu_active.store(true);
+    if (!set_profiling_timer(hz)) {
+        g_cpu_active.store(false);
+        sigaction(SIGPROF, &g_previous_sigprof, nullptr);
+        g_cpu_samples.reset();
+        return false;
+    }
+    return true;
+}
+
+bool CpuProfiler::running() {
+    return g_cpu_active.load();
+}
+
+std::string CpuProfiler::stop(std::size_t top) {
+    std::lock_guard<std::mutex> lock(g_cpu_mutex);
+    if (!g_cpu_samples) {
+        return "No CPU profile is running\n";
+    }
+    set_profiling_timer(0);
+    g_cpu_active.store(false);
+    drain_writers();
+    sigaction(SIGPROF, &g_previous_sigprof, nullptr);
+
+    auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_cpu_started).count();
+    std::ostringstream heading;
+    heading << "CPU profile: " << seconds << " s at " << g_cpu_hz << " Hz (one sample = " << 1000.0 / g_cpu_hz
+            << " ms of CPU)\n";
+    // Frames 0 and 1 are the handler and the signal trampoline
+    auto result = report(*g_cpu_samples, 2, false, top, heading.str(), "samples");
+    g_cpu_samples.reset();
+    return result;
+}
+
+std::atomic<bool> HeapProfiler::active_{false};
+
+bool HeapProfiler::hooks_linked() {
+    return g_hooks_linked.load();
+}
+
+void HeapProfiler::set_hooks_linked() {
+    g_hooks_linked.store(true);
+}
+
+bool HeapProfiler::start(std::size_t sample_bytes) {
+    std::lock_guard<std::mutex> lock(g_heap_mutex);
+    if (g_heap_samples || !hooks_linked() || sample_bytes == 0) {
+        return false;
+    }
+    void* warm_up[1];
+    backtrace(warm_up, 1);
+    g_heap_samples = std::make_unique<SampleBuffer>(kMaxSamples);
+    g_sample_bytes.store(sample_bytes);
+    g_heap_started = std::chrono::steady_clock::now();
+    g_heap_in_use_at_start = heap_in_use();
+    active_.store(true);
+    return true;
+}
+
+std::string HeapProfiler::stop(std::size_t top) {
+    std::lock_guard<std::mutex> lock(g_heap_mutex);
+    if (!g_heap_samples) {
+        return "No heap profile is running\n";
+    }
+    active_.store(false);
+    drain_writers();
+
+    auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_heap_started).count();
+    std::ostringstream heading;
+    heading << "Heap profile: " << seconds << " s, one sample per " << g_sample_bytes.load()
+            << " bytes allocated\n"
+            << "malloc in use: " << g_heap_in_use_at_start << " bytes at start, " << heap_in_use() << " now\n";
+    // Frames 0 and 1 are record() and operator new
+    auto result = report(*g_heap_samples, 2, true, top, heading.str(), "bytes allocated (estimated)");
+    g_heap_samples.reset();
+    return result;
+}
+
+void HeapProfiler::record(std::size_t size) noexcept {
+    if (t_recording) {
+        return;
+    }
+    t_until_sample -= static_cast<std::int64_t>(size);
+    if (t_until_sample > 0) {
+        return;
+    }
+    auto const interval = g_sample_bytes.load(std::memory_order_relaxed);
+    t_until_sample = static_cast<std::int64_t>(interval);
+    t_recording = true;
+    g_writers.fetch_add(1);
+    if (active_.load()) {
+        if (Sample* sample = g_heap_samples->claim()) {
+            sample->weight = std::max(size, interval); // The bytes this sample stands for
+            sample->depth = backtrace(sample->frames, kMaxFrames);
+        }
+    }
+    g_writers.fetch_sub(1);
+    t_recording = false;
+}
@@ -0,0 +1,57 @@
+// Profiler.hpp
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// Sampling profilers that can be switched on in a running server (see
+// AdminChannel) and cost nothing measurable while off. Both record call
+// stacks with backtrace() into a buffer sized when profiling starts, and
+// stop() folds them into a report by function: samples (or bytes) in the
+// function itself ("self") and in it or anything it called ("total"), then
+// the hottest call stacks. Names come from the dynamic symbol table, so the
+// server is linked with --export-dynamic; frames without a symbol are shown
+// as module+offset, for addr2line.
+
+// CPU profile: a SIGPROF timer (ITIMER_PROF) samples the stack of whichever
+// thread is on the CPU, `hz` times per second of process CPU time.
+class CpuProfiler {
+public:
+    // False if a profile is already running or the timer cannot be set
+    static bool start(int hz = 100);
+    static bool running();
+    // Ends the profile and reports the `top` functions
+    static std::string stop(std::size_t top = 30);
+};
+
+// Heap profile: one allocation per `sample_bytes` allocated, on average, is
+// recorded with its stack and weighted by the bytes it stands for, so the
+// report estimates who allocated how much during the window. Allocations
+// reach it through the global operator new in AllocationHooks.cpp, which is
+// linked into the server only; without it nothing is recorded.
+class HeapProfiler {
+public:
+    static bool hooks_linked();
+    // False if a profile is already running or the hooks are not linked
+    static bool start(std::size_t sample_bytes = 512 * 1024);
+    static bool running() { return active_.load(std::memory_order_relaxed); }
+    static std::string stop(std::size_t top = 30);
+
+    // Called by the allocation hooks for every allocation: one relaxed load
+    // while no profile runs.
+    static void on_allocation(std::size_t size) noexcept {
+        if (active_.load(std::memory_order_relaxed)) {
+            record(size);
+        }
+    }
+    static void set_hooks_linked(); // By AllocationHooks.cpp, at startup
+
+private:
+    static void record(std::size_t size) noexcept;
+
+    static std::atomic<bool> active_;
+};
+
+#endif // PROFILER_HPP
@@ -0,0 +1,85 @@
+// ReadBufferPool.cpp
+#include "ReadBufferPool.hpp"
+#include <atomic>
+#include <vector>
+
+namespace {
+
+std::atomic<std::int64_t> g_held_buffers{0};
+std::atomic<std::int64_t> g_held_bytes{0};
+std::atomic<std::int64_t> g_pooled_buffers{0};
+
+// Buffers a thread has released, ready for the next message that arrives on
+// that thread. Buffers move freely between threads: a session may borrow on
+// one thread and release on another.
+struct ThreadFreeList {
+    std::vector<std::unique_ptr<beast::flat_buffer>> free;
+
+    ~ThreadFreeList() { g_pooled_buffers.fetch_sub(static_cast<std::int64_t>(free.size()), std::memory_order_relaxed); }
+
+    std::unique_ptr<beast::flat_buffer> take() {
+        if (free.empty()) {
+            return std::make_unique<beast::flat_buffer>();
+        }
+        auto storage = std::move(free.back());
+        free.pop_back();
+        g_pooled_buffers.fetch_sub(1, std::memory_order_relaxed);
+        return storage;
+    }
+
+    void give(std::unique_ptr<beast::flat_buffer> storage) {
+        if (free.size() >= ReadBufferPool::kMaxPooledPerThread) {
+            return; // Freed
+        }
+        if (storage->capacity() > ReadBufferPool::kMaxPooledCapacity) {
+            storage->shrink_to_fit(); // Empty, so this frees the storage
+        }
+        free.push_back(std::move(storage));
+        g_pooled_buffers.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+ThreadFreeList& thread_pool() {
+    thread_local ThreadFreeList pool;
+    return pool;
+}
+
+} // namespace
+
+PooledReadBuffer::~PooledReadBuffer() {
+    if (storage_) {
+        // Freed rather than pooled: sessions may outlive their I/O threads
+        g_held_buffers.fetch_sub(1, std::memory_order_relaxed);
+        g_held_bytes.fetch_sub(static_cast<std::int64_t>(storage_->capacity()), std::memory_order_relaxed);
+    }
+}
+
+PooledReadBuffer::mutable_buffers_type PooledReadBuffer::prepare(std::size_t n) {
+    if (!storage_) {
+        storage_ = thread_pool().take();
+        g_held_buffers.fetch_add(1, std::memory_order_relaxed);
+        g_held_bytes.fetch_add(static_cast<std::int64_t>(storage_->capacity()), std::memory_order_relaxed);
+    }
+    auto const before = storage_->capacity();
+    auto buffers = storage_->prepare(n);
+    if (storage_->capacity() != before) {
+        g_held_bytes.fetch_add(static_cast<std::int64_t>(storage_->capacity()) - static_cast<std::int64_t>(before),
+                               std::memory_order_relaxed);
+    }
+    return buffers;
+}
+
+void PooledReadBuffer::release() {
+    if (!storage_ || storage_->size() != 0) {
+        return;
+    }
+    g_held_buffers.fetch_sub(1, std::memory_order_relaxed);
+    g_held_bytes.fetch_sub(static_cast<std::int64_t>(storage_->capacity()), std::memory_order_relaxed);
+    thread_pool().give(std::move(storage_));
+}
+
+ReadBufferPoolStats ReadBufferPool::stats() {
+    return ReadBufferPoolStats{g_held_buffers.load(std::memory_order_relaxed),
+                               g_held_bytes.load(std::memory_order_relaxed),
+                               g_pooled_buffers.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,72 @@
+// ReadBufferPool.hpp
+#ifndef READ_BUFFER_POOL_HPP
+#define READ_BUFFER_POOL_HPP
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+
+// Dynamic buffer for a session's inbound frames whose storage is borrowed
+// lazily: an idle connection holds only a null pointer, the first prepare()
+// (when payload actually arrives) takes a flat_buffer from the calling
+// thread's pool, and release() hands it back once the message has been
+// copied out. Without release() it behaves like a flat_buffer that keeps the
+// storage of the largest message it has seen, which is the default mode.
+class PooledReadBuffer {
+public:
+    using const_buffers_type = net::const_buffer;
+    using mutable_buffers_type = net::mutable_buffer;
+
+    PooledReadBuffer() = default;
+    ~PooledReadBuffer();
+    PooledReadBuffer(const PooledReadBuffer&) = delete;
+    PooledReadBuffer& operator=(const PooledReadBuffer&) = delete;
+
+    std::size_t size() const { return storage_ ? storage_->size() : 0; }
+    std::size_t max_size() const { return (std::numeric_limits<std::size_t>::max)(); }
+    std::size_t capacity() const { return storage_ ? storage_->capacity() : 0; }
+    const_buffers_type data() const { return storage_ ? storage_->data() : const_buffers_type{}; }
+    const_buffers_type cdata() const { return data(); }
+    mutable_buffers_type prepare(std::size_t n);
+    void commit(std::size_t n) { storage_->commit(n); }
+    void consume(std::size_t n) {
+        if (storage_) {
+            storage_->consume(n);
+        }
+    }
+
+    // Returns the storage to this thread's pool. Only when empty; unread
+    // bytes (pipelined frames) keep it.
+    void release();
+    bool holds_storage() const { return storage_ != nullptr; }
+
+private:
+    std::unique_ptr<beast::flat_buffer> storage_;
+};
+
+// Process-wide counters for the stats endpoint and the memory benchmark
+struct ReadBufferPoolStats {
+    std::int64_t held_buffers; // Lent to sessions right now
+    std::int64_t held_bytes;   // Their capacity
+    std::int64_t pooled_buffers; // Idle in the per-thread pools
+};
+
+namespace ReadBufferPool {
+
+// Storage above this is freed rather than pooled, so one huge message does
+// not pin its buffer for the life of the thread.
+constexpr std::size_t kMaxPooledCapacity = 64 * 1024;
+// Buffers kept per thread; the rest are freed.
+constexpr std::size_t kMaxPooledPerThread = 256;
+
+ReadBufferPoolStats stats();
+
+} // namespace ReadBufferPool
+
+#endif // READ_BUFFER_POOL_HPP
@@ -0,0 +1,31 @@
+// ServerMessages.hpp
+#ifndef SERVER_MESSAGES_HPP
+#define SERVER_MESSAGES_HPP
+
+#include "MessageEncoder.hpp"
+
+// Schemas of the messages the server generates on its hot paths, for
+// MessageEncoder::encode. Field order is wire order; see README.md for what
+// each field carries.
+namespace ServerMessages {
+
+using MessageEncoder::Schema;
+
+inline constexpr Schema<4> broadcast_message{"server_broadcast_message", {"user_id", "text", "timestamp", "nickname"}};
+inline constexpr Schema<4> client_connected{"server_client_connected", {"user_id", "nickname", "message", "timestamp"}};
+inline constexpr Schema<4> client_disconnected{"server_client_disconnected",
+                                               {"user_id", "nickname", "message", "timestamp"}};
+inline constexpr Schema<4> nickname_changed{"server_user_nickname_changed",
+                                            {"user_id", "old_nickname", "new_nickname", "timestamp"}};
+inline constexpr Schema<5> session_welcome{"server_session_welcome",
+                                           {"user_id", "nickname", "resume_token", "seq", "resume_grace_ms"}};
+inline constexpr Schema<6> session_resumed{"server_session_resumed",
+                                           {"user_id", "nickname", "resume_token", "seq", "replayed", "complete"}};
+inline constexpr Schema<4> presence_delta{"server_presence_delta", {"joined", "left", "online", "timestamp"}};
+inline constexpr Schema<2> roster_snapshot{"server_roster_snapshot", {"users", "timestamp"}};
+inline constexpr Schema<6> file_shared{"server_file_shared", {"user_id", "nickname", "name", "mime", "size", "timestamp"}};
+inline constexpr Schema<2> file_refused{"server_file_refused", {"name", "reason"}};
+
+} // namespace ServerMessages
+
+#endif // SERVER_MESSAGES_HPP
@@ -0,0 +1,239 @@
+// ServerOptions.cpp
+#include "ServerOptions.hpp"
+#include "CoroSession.hpp"
+#include "CpuPlacement.hpp"
+#include "IoBackend.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+int parse_int(const std::string& name, const std::string& value) {
+    try {
+        std::size_t used = 0;
+        int parsed = std::stoi(value, &used);
+        if (used != value.size()) {
+            throw std::invalid_argument(name);
+        }
+        return parsed;
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid value for " + name + ": '" + value + "'");
+    }
+}
+
+bool parse_bool(const std::string& name, const std::string& value) {
+    if (value == "on" || value == "true" || value == "1") {
+        return true;
+    }
+    if (value == "off" || value == "false" || value == "0") {
+        return false;
+    }
+    throw std::invalid_argument("Invalid value for " + name + ": '" + value + "' (expected on or off)");
+}
+
+int parse_bytes(const std::string& name, const std::string& value) {
+    int bytes = parse_int(name, value);
+    if (bytes < 0) {
+        throw std::invalid_argument("Size must not be negative for " + name + ": " + value);
+    }
+    return bytes;
+}
+
+std::vector<int> parse_list(const std::string& name, const std::string& value) {
+    try {
+        return CpuPlacement::parse_list(value);
+    } catch (const std::invalid_argument& e) {
+        throw std::invalid_argument(std::string(e.what()) + " for " + name);
+    }
+}
+
+} // namespace
+
+std::string ServerOptions::usage() {
+    return "Usage: websocket-chat-server <port> [<num_threads>] [options]\n"
+           "Options:\n"
+           "  --address=<ip>             Listen address (default 0.0.0.0)\n"
+           "  --io-backend=<name>        epoll or io_uring; must match the build\n"
+           "  --session-engine=<name>    callback (default) or coroutine\n"
+           "  --io-model=<name>          shared (default: one io_context for all threads) or per-thread\n"
+           "  --batch-window-ms=<n>      Longest batching window a client may negotiate (default 10, 0 = off)\n"
+           "  --batch-max-bytes=<n>      Largest batch frame a client may negotiate (default 16384)\n"
+           "  --presence-tick-ms=<n>     Presence coalescing interval (default 200, 0 = per-event broadcasts)\n"
+           "  --trace-sample=<n>         Trace one message in n through every stage (default 0 = off), see GET /stats\n"
+           "  --tcp-nodelay=<on|off>     TCP_NODELAY on accepted sockets (default on)\n"
+           "  --send-buffer=<bytes>      SO_SNDBUF for accepted sockets (default 0 = kernel default)\n"
+           "  --recv-buffer=<bytes>      SO_RCVBUF for accepted sockets (default 0 = kernel default)\n"
+           "  --notsent-lowat=<bytes>    TCP_NOTSENT_LOWAT for accepted sockets (default 0 = kernel default)\n"
+           "  --cork-writes=<on|off>     Cork sockets while flushing several queued frames (default off)\n"
+           "  --socket-busy-poll-us=<n>  SO_BUSY_POLL for accepted sockets (default 0 = off)\n"
+           "  --busy-poll-us=<n>         Idle I/O threads spin this long before sleeping (default 0 = off)\n"
+           "  --low-memory=<on|off>      Release per-connection buffers between messages (default off)\n"
+           "  --resume-grace-ms=<n>      How long a dropped client may resume its session (default 30000, 0 = off)\n"
+           "  --resume-history=<n>       Room messages kept for resumed clients to catch up on (default 1024)\n"
+           "  --history-retain=<n>       Chat messages kept for history queries (default 100000, 0 = off)\n"
+           "  --query-threads=<n>        Threads that run history queries (default 1)\n"
+           "  --max-file-bytes=<n>       Largest file a client may share (default 16777216, 0 = off)\n"
+           "  --cpu-affinity=<cpus>      Pin I/O thread i to the i-th CPU of a list such as 0-3,8 (default off)\n"
+           "  --numa-nodes=<nodes>       Spread I/O threads over these NUMA nodes' CPUs (default off)\n"
+           "  --reuseport=<on|off>       A SO_REUSEPORT listener per I/O thread; needs --io-model=per-thread (default off)\n"
+           "  --unix-socket=<path>       Also accept WebSocket clients on this Unix domain socket (default off)\n"
+           "  --publish-token=<secret>   Enable POST /publish for batches of messages, with this bearer token\n"
+           "  --admin-socket=<path>      Unix socket for admin commands: queue depths, profiles (default off)\n";
+}
+
+ServerOptions ServerOptions::parse(int argc, char* argv[]) {
+    ServerOptions options;
+    int positional = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--", 0) != 0) {
+            if (positional == 0) {
+                int port = parse_int("port", arg);
+                if (port <= 0 || port > 65535) {
+                    throw std::invalid_argument("Port out of range: " + arg);
+                }
+                options.port = static_cast<unsigned short>(port);
+            } else if (positional == 1) {
+                options.num_threads = std::max(1, parse_int("num_threads", arg));
+            } else {
+                throw std::invalid_argument("Unexpected argument: " + arg);
+            }
+            ++positional;
+            continue;
+        }
+
+        auto const eq = arg.find('=');
+        std::string name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "address") {
+            options.address = value;
+        } else if (name == "io-backend") {
+            if (value != "epoll" && value != "io_uring") {
+                throw std::invalid_argument("Unknown I/O backend: '" + value + "'");
+            }
+            if (!IoBackend::is_available(value)) {
+                throw std::invalid_argument("I/O backend '" + value + "' requested, but this binary was built for '"
+                                            + IoBackend::compiled() + "'");
+            }
+            options.io_backend = value;
+        } else if (name == "session-engine") {
+            if (value == "callback") {
+                options.session_engine = SessionEngine::callback;
+            } else if (value == "coroutine") {
+#if defined(CHAT_HAS_CORO_SESSION)
+                options.session_engine = SessionEngine::coroutine;
+#else
+                throw std::invalid_argument("The coroutine session engine needs a C++20 build (CHAT_ENABLE_COROUTINES)");
+#endif
+            } else {
+                throw std::invalid_argument("Unknown session engine: '" + value + "'");
+            }
+        } else if (name == "io-model") {
+            if (value == "shared") {
+                options.io_model = IoModel::shared;
+            } else if (value == "per-thread") {
+                options.io_model = IoModel::per_thread;
+            } else {
+                throw std::invalid_argument("Unknown I/O model: '" + value + "'");
+            }
+        } else if (name == "batch-window-ms") {
+            options.batch_window_ms = parse_int(name, value);
+            if (options.batch_window_ms < 0) {
+                throw std::invalid_argument("Batch window must not be negative: " + value);
+            }
+        } else if (name == "batch-max-bytes") {
+            int max_bytes = parse_int(name, value);
+            if (max_bytes <= 0) {
+                throw std::invalid_argument("Batch size limit must be positive: " + value);
+            }
+            options.batch_max_bytes = static_cast<std::size_t>(max_bytes);
+        } else if (name == "presence-tick-ms") {
+            options.presence_tick_ms = parse_int(name, value);
+            if (options.presence_tick_ms < 0) {
+                throw std::invalid_argument("Presence tick must not be negative: " + value);
+            }
+        } else if (name == "trace-sample") {
+            options.trace_sample = parse_int(name, value);
+            if (options.trace_sample < 0) {
+                throw std::invalid_argument("Trace sampling rate must not be negative: " + value);
+            }
+        } else if (name == "tcp-nodelay") {
+            options.tcp_nodelay = parse_bool(name, value);
+        } else if (name == "send-buffer") {
+            options.send_buffer_bytes = parse_bytes(name, value);
+        } else if (name == "recv-buffer") {
+            options.recv_buffer_bytes = parse_bytes(name, value);
+        } else if (name == "notsent-lowat") {
+            options.notsent_lowat_bytes = parse_bytes(name, value);
+        } else if (name == "cork-writes") {
+            options.cork_writes = parse_bool(name, value);
+        } else if (name == "socket-busy-poll-us") {
+            options.socket_busy_poll_us = parse_int(name, value);
+            if (options.socket_busy_poll_us < 0) {
+                throw std::invalid_argument("Socket busy-poll time must not be negative: " + value);
+            }
+        } else if (name == "busy-poll-us") {
+            options.busy_poll_us = parse_int(name, value);
+            if (options.busy_poll_us < 0) {
+                throw std::invalid_argument("Busy-poll time must not be negative: " + value);
+            }
+        } else if (name == "low-memory") {
+            options.low_memory = parse_bool(name, value);
+        } else if (name == "resume-grace-ms") {
+            options.resume_grace_ms = parse_int(name, value);
+            if (options.resume_grace_ms < 0) {
+                throw std::invalid_argument("Resume grace period must not be negative: " + value);
+            }
+        } else if (name == "resume-history") {
+            int history = parse_int(name, value);
+            if (history < 0) {
+                throw std::invalid_argument("Resume history must not be negative: " + value);
+            }
+            options.resume_history = static_cast<std::size_t>(history);
+        } else if (name == "history-retain") {
+            int retain = parse_int(name, value);
+            if (retain < 0) {
+                throw std::invalid_argument("History size must not be negative: " + value);
+            }
+            options.history_retain = static_cast<std::size_t>(retain);
+        } else if (name == "query-threads") {
+            options.query_threads = parse_int(name, value);
+            if (options.query_threads < 1) {
+                throw std::invalid_argument("At least one query thread is needed: " + value);
+            }
+        } else if (name == "max-file-bytes") {
+            options.max_file_bytes = static_cast<std::size_t>(parse_bytes(name, value));
+        } else if (name == "cpu-affinity") {
+            options.cpu_affinity = parse_list(name, value);
+        } else if (name == "numa-nodes") {
+            options.numa_nodes = parse_list(name, value);
+        } else if (name == "reuseport") {
+            options.reuseport = parse_bool(name, value);
+        } else if (name == "unix-socket") {
+            options.unix_socket = value;
+        } else if (name == "publish-token") {
+            options.publish_token = value;
+        } else if (name == "admin-socket") {
+            options.admin_socket = value;
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+
+    if (positional == 0) {
+        throw std::invalid_argument("Missing <port>");
+    }
+    if (!options.cpu_affinity.empty() && !options.numa_nodes.empty()) {
+        throw std::invalid_argument("--cpu-affinity and --numa-nodes cannot be combined");
+    }
+    if (options.reuseport && options.io_model != IoModel::per_thread) {
+        throw std::invalid_argument("--reuseport needs --io-model=per-thread");
+    }
+    if (options.io_backend.empty()) {
+        options.io_backend = IoBackend::compiled();
+    }
+    return options;
+}
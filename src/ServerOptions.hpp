@@ -0,0 +1,136 @@
+// ServerOptions.hpp
+#ifndef SERVER_OPTIONS_HPP
+#define SERVER_OPTIONS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Runtime configuration for the chat server. Positional arguments keep their
+// historical meaning (<port> [<num_threads>]); everything else is passed as
+// --name=value flags after them.
+struct ServerOptions {
+    enum class SessionEngine {
+        callback,  // Session: bound completion handlers (default)
+        coroutine, // CoroSession: reader/writer coroutines (C++20 builds)
+    };
+
+    enum class IoModel {
+        shared,     // One io_context run by every I/O thread (default)
+        per_thread, // IoContextPool: one io_context per I/O thread
+    };
+
+    std::string address = "0.0.0.0";
+    unsigned short port = 0;
+    int num_threads = 1;
+
+    // Socket I/O backend requested on the command line ("epoll" or
+    // "io_uring"). Empty means "whatever this binary was built with".
+    std::string io_backend;
+
+    SessionEngine session_engine = SessionEngine::callback;
+
+    // How the num_threads I/O threads share work. With per_thread, every
+    // connection stays on one thread and broadcasts are handed to each thread
+    // as one task per chunk of recipients instead of one post per recipient.
+    IoModel io_model = IoModel::shared;
+
+    // Upper bounds for negotiated micro-batching (client_enable_batching).
+    // A client may ask for a shorter window or a smaller batch; a window of 0
+    // disables batching on this server.
+    int batch_window_ms = 10;
+    std::size_t batch_max_bytes = 16384;
+
+    // Presence changes (joins/leaves) are coalesced and sent once per tick as
+    // server_presence_delta; new clients get a server_roster_snapshot. A tick
+    // of 0 restores the per-event server_client_connected/disconnected
+    // broadcasts.
+    int presence_tick_ms = 200;
+
+    // Latency tracing (LatencyTracer): 0 = off, 1 = every inbound message,
+    // n = one message in n per I/O thread. Results are served at GET /stats.
+    int trace_sample = 0;
+
+    // Socket options for accepted connections (SocketTuning). Buffer sizes
+    // and the unsent-data low-water mark of 0 keep the kernel defaults.
+    // TCP_NODELAY is on by default: chat frames are small and latency bound,
+    // and Nagle's algorithm would hold them behind the peer's delayed ACK.
+    bool tcp_nodelay = true;
+    int send_buffer_bytes = 0;   // SO_SNDBUF
+    int recv_buffer_bytes = 0;   // SO_RCVBUF
+    int notsent_lowat_bytes = 0; // TCP_NOTSENT_LOWAT
+    // Cork the socket (TCP_CORK) while a session flushes several queued
+    // frames and uncork once its queue is drained.
+    bool cork_writes = false;
+    // SO_BUSY_POLL: how long a read on the socket may poll the NIC's
+    // receive queue before sleeping (needs a NIC driver with busy polling)
+    int socket_busy_poll_us = 0;
+
+    // Low-latency run mode (BusyPoll): an idle I/O thread polls for this
+    // long before blocking in epoll_wait, trading a busy CPU per thread for
+    // no wakeup latency. 0 blocks at once.
+    int busy_poll_us = 0;
+
+    // Low per-connection memory for large idle fleets: sessions give their
+    // read buffer back to a per-thread pool after every message (borrowing
+    // one again when data arrives) and free their write queue storage when
+    // it drains.
+    bool low_memory = false;
+
+    // Resumable sessions. Every client gets a resume token on connect. A
+    // client whose connection drops without a close frame is kept for
+    // resume_grace_ms: if it reconnects with its token in that time, it
+    // carries on as the same user without presence changes and is sent the
+    // room messages it missed, out of the last resume_history. A grace period
+    // of 0 disables resuming.
+    int resume_grace_ms = 30000;
+    std::size_t resume_history = 1024;
+
+    // Chat history for client_query_history: the last history_retain chat
+    // messages, indexed by time, author and words (HistoryStore). Queries
+    // run on query_threads threads of their own, never on the I/O threads.
+    // A history of 0 turns queries off.
+    std::size_t history_retain = 100000;
+    int query_threads = 1;
+
+    // File sharing (client_share_file). A file's binary message is read a
+    // fragment at a time and shared with the other clients by reference,
+    // never held whole in a read buffer. Larger files are refused; 0 turns
+    // sharing off.
+    std::size_t max_file_bytes = 16 * 1024 * 1024;
+
+    // I/O thread placement (CpuPlacement). cpu_affinity pins I/O thread i to
+    // the i-th CPU listed; numa_nodes instead spreads the threads over the
+    // listed nodes, each free to use every CPU of its node. Either keeps a
+    // thread's sessions in its node's memory. Empty leaves placement to the
+    // OS.
+    std::vector<int> cpu_affinity;
+    std::vector<int> numa_nodes;
+    // Per-thread I/O model only: every I/O thread listens on the port itself
+    // (SO_REUSEPORT) and serves the connections it accepts. With
+    // cpu_affinity, each listener asks for the connections whose packets
+    // arrive on its thread's CPU (SO_INCOMING_CPU).
+    bool reuseport = false;
+
+    // A Unix domain socket at this path, besides the TCP port, for clients on
+    // the same host: the same WebSocket protocol, sessions and broadcasts,
+    // without the TCP stack. Who may connect is up to the file's permissions
+    // (the umask) and its directory's. Empty turns it off.
+    std::string unix_socket;
+
+    // Bearer token for POST /publish (BulkPublish), where backends post
+    // batches of chat messages over HTTP. Empty turns the endpoint off.
+    std::string publish_token;
+
+    // Admin channel (AdminChannel): a Unix socket at this path, for the
+    // server's own user, with queue depth dumps and on-demand CPU and heap
+    // profiles. Empty turns it off.
+    std::string admin_socket;
+
+    // Parses argv. Throws std::invalid_argument with a human readable message
+    // on malformed input.
+    static ServerOptions parse(int argc, char* argv[]);
+    static std::string usage();
+};
+
+#endif // SERVER_OPTIONS_HPP
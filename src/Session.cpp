@@ -1,7 +1,14 @@
 // Session.cpp
 #include "Session.hpp"
 #include "ChatServer.hpp" // Required for server_.broadcast and on_client_disconnect
+#include "BulkPublish.hpp"
 #include "Utils.hpp"      // For getCurrentTimestampISO8601
+#include "HandlerAllocator.hpp" // Recycled memory for per-operation handler state
+#include "MessageEncoder.hpp"
+#include "MessageSniffer.hpp"
+#include "Probes.hpp"
+#include "ServerMessages.hpp"
+#include "SocketTuning.hpp"
 #include <iostream>
 #include <boost/json.hpp> // For Boost.JSON
 #include <boost/uuid/uuid.hpp>            // For UUID generation if chosen
@@ -10,6 +17,7 @@
 #include <sstream>      // For string stream, alternative to UUID for simpler ID
 #include <iomanip>      // For std::hex, std::setw, std::setfill
 #include <random>       // For random number generation for ID
+#include <charconv>
 
 
 // Static member initialization
@@ -22,25 +30,39 @@ std::string Session::generate_session_id() {
     // Simple counter based ID
     // return "session_" + std::to_string(++s_id_counter_);
 
-    // More robust / unique ID using random numbers
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, 255);
+    // More robust / unique ID using random numbers. One generator per
+    // thread, seeded once: reading random_device per connection costs a
+    // system call during connection storms.
+    thread_local std::mt19937_64 gen{(std::uint64_t{std::random_device{}()} << 32) ^ std::random_device{}()};
+    static constexpr char kHex[] = "0123456789abcdef";
 
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (int i = 0; i < 8; ++i) { // Generate a 16-character hex ID
-        ss << std::setw(2) << distrib(gen);
+    auto bits = gen();
+    char id[] = "sess_0000000000000000"; // 16-character hex ID
+    for (std::size_t i = sizeof(id) - 2; i >= 5; --i, bits >>= 4) {
+        id[i] = kHex[bits & 0xf];
     }
-    return "sess_" + ss.str();
+    return std::string(id, sizeof(id) - 1);
 }
 
+// Server header of the upgrade response and of plain HTTP replies, built at
+// compile time rather than once per handshake
+static constexpr char kServerHeader[] = BOOST_BEAST_VERSION_STRING " websocket-chat-server-cpp";
+
+// Largest inbound message, as in Beast's default. Shared files are checked
+// against --max-file-bytes instead.
+static constexpr std::uint64_t kMaxMessageBytes = 16 * 1024 * 1024;
+
 
 Session::Session(net::io_context& ioc, tcp::socket&& socket, ChatServer& server)
-    : ws_(std::move(socket)), server_(server), strand_(net::make_strand(ioc.get_executor())) { // Initialized with ioc
+    : Session(ioc, SessionStream(std::move(socket)), server) {}
+
+Session::Session(net::io_context& ioc, SessionStream&& stream, ChatServer& server)
+    : ws_(std::move(stream)), server_(server), context_(ioc), strand_(net::make_strand(ioc.get_executor())), // Initialized with ioc
+      batch_timer_(strand_), cork_writes_(server.options().cork_writes && SocketTuning::cork_supported()),
+      low_memory_(server.options().low_memory) {
     session_id_ = generate_session_id();
     nickname_ = "User" + session_id_; // Initialize nickname
-    std::cout << "Session created with ID: " << session_id_ << " and Nickname: " << nickname_ << std::endl;
+    // Nothing is logged or registered until the upgrade succeeds (on_accept)
 }
 
 std::string Session::get_id() const {
@@ -57,6 +79,71 @@ std::string Session::get_nickname() const {
     return nickname_;
 }
 
+void Session::resume_as(const std::string& user_id, const std::string& nickname, const std::string& token) {
+    std::cout << "Session " << session_id_ << " resumes " << user_id << std::endl;
+    session_id_ = user_id;
+    nickname_ = nickname;
+    resume_token_ = token;
+}
+
+void Session::drop_connection() {
+    // On the stream's executor, like the operations it aborts
+    net::post(ws_.get_executor(), [self = shared_from_this()] {
+        beast::get_lowest_layer(self->ws_).close();
+    });
+}
+
+void Session::inspect_queue(std::function<void(QueueDepth)> done) {
+    net::post(strand_, [self = shared_from_this(), done = std::move(done)] {
+        QueueDepth depth;
+        depth.id = self->session_id_;
+        depth.nickname = self->nickname_;
+        depth.messages = self->outbound_.size();
+        depth.bytes = self->outbound_.bytes();
+        for (std::size_t lane = 0; lane < OutboundLanes::kLanes; ++lane) {
+            depth.lanes[lane] = self->outbound_.size(static_cast<Lane>(lane));
+        }
+        depth.batched = self->batch_.size();
+        depth.writing = self->writing_ != nullptr;
+        done(std::move(depth));
+    });
+}
+
+namespace {
+
+// Value of `name` in the query string of a request target, or empty
+beast::string_view query_param(beast::string_view target, beast::string_view name) {
+    auto const query = target.find('?');
+    if (query == beast::string_view::npos) {
+        return {};
+    }
+    target.remove_prefix(query + 1);
+    while (!target.empty()) {
+        auto const end = std::min(target.find('&'), target.size());
+        auto const pair = target.substr(0, end);
+        if (pair.size() > name.size() && pair.substr(0, name.size()) == name && pair[name.size()] == '=') {
+            return pair.substr(name.size() + 1);
+        }
+        target.remove_prefix(std::min(end + 1, target.size()));
+    }
+    return {};
+}
+
+} // namespace
+
+void Session::join_server() {
+    auto const target = upgrade_request_.target();
+    std::string const token(query_param(target, "resume"));
+    std::uint64_t last_seq = 0;
+    auto const seq = query_param(target, "last_seq");
+    std::from_chars(seq.data(), seq.data() + seq.size(), last_seq); // Stays 0 if malformed
+    upgrade_request_ = {}; // Its fields are no longer needed
+
+    // Registration (and with it presence) waits for a successful upgrade, so
+    // failed or plain HTTP connections never touch the session set.
+    server_.on_client_upgraded(shared_from_this(), token, last_seq);
+}
+
 void Session::run() {
     // We need to be executing within a strand to perform async operations
     // on the websocket stream.
@@ -68,24 +155,118 @@ void Session::run() {
 
 // Moved the initial handshake to on_run to ensure it's on the strand
 void Session::on_run() {
+    configure_stream();
+
+    // Read the HTTP request ourselves so that plain requests (GET /stats,
+    // POST /publish) can be answered on the chat port; upgrades go on to the
+    // websocket handshake.
+    beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+    http::async_read(
+        ws_.next_layer(),
+        buffer_,
+        upgrade_request_,
+        beast::bind_front_handler(
+            &Session::on_http_request,
+            shared_from_this()));
+}
+
+void Session::on_http_request(beast::error_code ec, std::size_t bytes_transferred) {
+    boost::ignore_unused(bytes_transferred);
+
+    if (ec) {
+        std::cerr << "Session " << session_id_ << " Accept error: " << ec.message() << std::endl;
+        server_.on_client_disconnect(shared_from_this()); // Notify server
+        return;
+    }
+    if (!websocket::is_upgrade(upgrade_request_)) {
+        respond_http();
+        return;
+    }
+
+    // The websocket timeouts from configure_stream take over
+    beast::get_lowest_layer(ws_).expires_never();
+    buffer_.consume(buffer_.size());
+    release_idle_memory();
+
+    // Accept the websocket handshake. The handler runs on the strand: the
+    // server queues the first messages for us directly from join_server.
+    ws_.async_accept(
+        upgrade_request_,
+        net::bind_executor(strand_,
+            beast::bind_front_handler(
+                &Session::on_accept,
+                shared_from_this())));
+}
+
+void Session::respond_http() {
+    auto res = std::make_shared<http::response<http::string_body>>();
+    res->version(upgrade_request_.version());
+    res->keep_alive(false);
+    res->set(http::field::server, kServerHeader);
+    if (upgrade_request_.method() == http::verb::get && upgrade_request_.target() == "/stats") {
+        res->result(http::status::ok);
+        res->set(http::field::content_type, "application/json");
+        res->body() = server_.stats_json();
+    } else if (upgrade_request_.target() == "/publish" && !server_.options().publish_token.empty()) {
+        BulkPublish::respond(server_, upgrade_request_, *res);
+    } else {
+        res->result(http::status::not_found);
+        res->set(http::field::content_type, "text/plain");
+        res->body() = "Not found\n";
+    }
+    res->prepare_payload();
+
+    http::async_write(
+        ws_.next_layer(),
+        *res,
+        [self = shared_from_this(), res](beast::error_code, std::size_t) {
+            self->ws_.next_layer().shutdown_send();
+            self->server_.on_client_disconnect(self);
+        });
+}
+
+void Session::trace_read_complete() {
+    inbound_traced_ = server_.tracer().should_sample();
+    if (inbound_traced_) {
+        inbound_trace_ = MessageTrace{};
+        inbound_trace_.read_ns = LatencyTracer::now_ns();
+    }
+}
+
+void Session::trace_write_start(const std::shared_ptr<const std::string>& msg) {
+    write_started_ns_ = 0;
+    if (const MessageTrace* trace = LatencyTracer::trace_of(msg)) {
+        write_started_ns_ = LatencyTracer::now_ns();
+        server_.tracer().record(LatencyTracer::enqueue_to_write_start, write_started_ns_ - trace->enqueue_ns);
+    }
+}
+
+void Session::trace_write_complete(const std::shared_ptr<const std::string>& msg) {
+    if (write_started_ns_ == 0) {
+        return;
+    }
+    if (const MessageTrace* trace = LatencyTracer::trace_of(msg)) {
+        auto const now = LatencyTracer::now_ns();
+        server_.tracer().record(LatencyTracer::write_start_to_complete, now - write_started_ns_);
+        server_.tracer().record(LatencyTracer::read_to_write_complete, now - trace->read_ns);
+    }
+    write_started_ns_ = 0;
+}
+
+// Stream options applied before the handshake, common to all session engines
+void Session::configure_stream() {
     // Set suggested timeout settings for the websocket
     ws_.set_option(
         websocket::stream_base::timeout::suggested(
             beast::role_type::server));
 
+    ws_.read_message_max(kMaxMessageBytes); // Lifted while a shared file is read (begin_upload)
+
     // Set a decorator to change the Server of the handshake
     ws_.set_option(websocket::stream_base::decorator(
         [](websocket::response_type& res) {
-            res.set(http::field::server,
-                std::string(BOOST_BEAST_VERSION_STRING) +
-                    " websocket-chat-server-cpp");
+            res.set(http::field::server, kServerHeader);
         }));
-
-    // Accept the websocket handshake
-    ws_.async_accept(
-        beast::bind_front_handler(
-            &Session::on_accept,
-            shared_from_this()));
 }
 
 
@@ -96,34 +277,107 @@ void Session::on_accept(beast::error_code ec) {
         return;
     }
     std::cout << "Session " << session_id_ << " WebSocket handshake accepted." << std::endl;
-
-    // The server_client_connected message is now sent by ChatServer::on_client_connect,
-    // which has access to the session's nickname.
-    // server_.on_client_connect(shared_from_this()); // This is already called from ChatServer::on_accept
+    CHAT_PROBE2(handshake_done, session_id_.c_str(), ws_.next_layer().native_handle());
+    join_server(); // May queue the welcome or the replay; writes still wait
+    handshake_complete_ = true;
+    do_write(); // Anything queued for us meanwhile (welcome, replay, per-event presence)
 
     // Start reading messages
     do_read();
 }
 
 void Session::do_read() {
+    if (low_memory_ || upload_) {
+        // Wait for the next message without holding a buffer: a read into an
+        // empty buffer completes once a data frame starts arriving (control
+        // frames are handled meanwhile) and leaves its payload in the
+        // stream.
+        ws_.async_read_some(
+            empty_read_buffer(),
+            bind_handler_allocator(PooledHandlerAllocator<void>(),
+                net::bind_executor(strand_,
+                    beast::bind_front_handler(
+                        &Session::on_message_arriving,
+                        shared_from_this()))));
+        return;
+    }
+    read_message();
+}
+
+net::mutable_buffer Session::empty_read_buffer() {
+    // Not a null buffer: Beast's UTF-8 validation of text frames reads
+    // through the data pointer even when the size is zero.
+    static char byte;
+    return net::mutable_buffer(&byte, 0);
+}
+
+void Session::on_message_arriving(beast::error_code ec, std::size_t bytes_transferred) {
+    if (!ec && upload_) {
+        if (upload_arriving()) {
+            read_upload();
+            return;
+        }
+        abandon_upload();
+    }
+    if (ec || ws_.is_message_done()) {
+        on_read(ec, bytes_transferred); // Error, or an empty message
+        return;
+    }
+    read_message();
+}
+
+void Session::read_message() {
+    reading_message_ = true;
     // Read a message into our buffer
     ws_.async_read(
         buffer_,
-        // Ensure this handler is dispatched on the strand
-        net::bind_executor(strand_,
-            beast::bind_front_handler(
-                &Session::on_read,
-                shared_from_this())));
+        // Ensure this handler is dispatched on the strand; operation state is
+        // allocated from the per-thread handler pool instead of the heap
+        bind_handler_allocator(PooledHandlerAllocator<void>(),
+            net::bind_executor(strand_,
+                beast::bind_front_handler(
+                    &Session::on_read,
+                    shared_from_this()))));
+}
+
+// Reads the announced file straight into the sink, one fragment (or part of
+// one) at a time
+void Session::read_upload() {
+    if (ws_.is_message_done()) {
+        finish_upload();
+        do_read();
+        return;
+    }
+    ws_.async_read_some(
+        upload_->sink.prepare(),
+        bind_handler_allocator(PooledHandlerAllocator<void>(),
+            net::bind_executor(strand_,
+                beast::bind_front_handler(
+                    &Session::on_upload_read,
+                    shared_from_this()))));
+}
+
+void Session::on_upload_read(beast::error_code ec, std::size_t bytes_transferred) {
+    if (ec) {
+        upload_.reset();
+        on_read(ec, bytes_transferred);
+        return;
+    }
+    upload_->sink.commit(bytes_transferred);
+    read_upload();
 }
 
 void Session::on_read(beast::error_code ec, std::size_t bytes_transferred) {
     boost::ignore_unused(bytes_transferred);
+    reading_message_ = false;
 
-    // This indicates that the session was closed
+    // This indicates that the session was closed. Only a close frame means
+    // the client is gone for good; a connection that just dropped may be
+    // resumed.
     if (ec == websocket::error::closed || ec == beast::http::error::end_of_stream) { // Fully qualified http error
         std::cout << "Session " << session_id_ << " closed by client." << std::endl;
         on_close(ec);
-        server_.on_client_disconnect(shared_from_this()); // Notify server
+        server_.on_client_disconnect(shared_from_this(), ec != websocket::error::closed); // Notify server
         return;
     }
 
@@ -131,85 +385,107 @@ void Session::on_read(beast::error_code ec, std::size_t bytes_transferred) {
         std::cerr << "Session " << session_id_ << " Read error: " << ec.message() << std::endl;
         // If an error occurs, consider closing the connection
         on_close(ec); // Attempt to close WebSocket gracefully (logs error)
-        server_.on_client_disconnect(shared_from_this()); // Notify server
+        server_.on_client_disconnect(shared_from_this(), true); // Notify server
         return;
     }
 
-    // For now, assume the message is text. Later, parse JSON.
-    std::string received_msg = beast::buffers_to_string(buffer_.data());
-    std::cout << "Session " << session_id_ << " Received: " << received_msg << std::endl;
-
-    // Broadcast the message (or handle as per protocol)
+    trace_read_complete();
+    CHAT_PROBE2(message_received, session_id_.c_str(), bytes_transferred);
     std::string received_msg_str = beast::buffers_to_string(buffer_.data());
     buffer_.consume(buffer_.size()); // Clear the buffer early
+    release_idle_memory();
+
+    handle_message(received_msg_str);
+
+    // Continue reading for next message
+    do_read();
+}
+
+// Dispatches one complete text frame according to the chat protocol.
+// Shared by every session engine so they all speak the same protocol.
+void Session::handle_message(const std::string& received_msg_str) {
+    std::cout << "Session " << session_id_ << " Received: " << received_msg_str << std::endl;
 
     // std::cout << "Session " << session_id_ << " Received raw: " << received_msg_str << std::endl;
 
-    json::value received_json;
-    try {
-        received_json = json::parse(received_msg_str);
-    } catch (const std::exception& e) {
-        std::cerr << "Session " << session_id_ << " JSON parse error: " << e.what() << " from message: " << received_msg_str << std::endl;
+    // One pass validates the frame and finds its type and payload members;
+    // chat messages, nearly all traffic, need nothing more.
+    MessageSniffer::Message sniffed;
+    auto const sniff_result = MessageSniffer::sniff(received_msg_str, sniffed);
+    if (sniff_result == MessageSniffer::Result::malformed || sniff_result == MessageSniffer::Result::invalid_utf8) {
+        std::cerr << "Session " << session_id_ << " JSON parse error: "
+                  << (sniff_result == MessageSniffer::Result::invalid_utf8 ? "invalid UTF-8" : "malformed JSON")
+                  << " from message: " << received_msg_str << std::endl;
         // Optionally, send an error message back to the client or close session
         // For now, just ignore malformed JSON and continue reading
-        do_read();
         return;
     }
+    if (inbound_traced_) {
+        inbound_trace_.parse_ns = LatencyTracer::now_ns();
+        server_.tracer().record(LatencyTracer::read_to_parse, inbound_trace_.parse_ns - inbound_trace_.read_ns);
+    }
 
-    if (!received_json.is_object()) {
+    if (sniff_result == MessageSniffer::Result::not_object) {
         std::cerr << "Session " << session_id_ << " Received JSON is not an object: " << received_msg_str << std::endl;
-        do_read();
         return;
     }
-
-    const json::object& msg_obj = received_json.as_object();
-    if (!msg_obj.contains("type") || !msg_obj.at("type").is_string()) {
+    if (sniffed.complete && sniffed.type.kind != MessageSniffer::Value::string) {
         std::cerr << "Session " << session_id_ << " Received JSON has no/invalid 'type': " << received_msg_str << std::endl;
-        do_read();
         return;
     }
 
-    std::string msg_type = msg_obj.at("type").as_string().c_str();
-
-    if (msg_type == "client_send_message") {
-        if (!msg_obj.contains("payload") || !msg_obj.at("payload").is_object()) {
+    if (sniffed.complete && !sniffed.type.escaped && sniffed.type.raw == "client_send_message") {
+        if (sniffed.payload.kind != MessageSniffer::Value::object) {
             std::cerr << "Session " << session_id_ << " 'client_send_message' has no/invalid 'payload': " << received_msg_str << std::endl;
-            do_read();
             return;
         }
-        const json::object& payload_obj = msg_obj.at("payload").as_object();
-        if (!payload_obj.contains("text") || !payload_obj.at("text").is_string()) {
+        const MessageSniffer::Value* text = sniffed.member("text");
+        if (!text || text->kind != MessageSniffer::Value::string) {
             std::cerr << "Session " << session_id_ << " 'client_send_message' payload has no/invalid 'text': " << received_msg_str << std::endl;
-            do_read();
             return;
         }
-        std::string text_content = payload_obj.at("text").as_string().c_str();
-
-        // server_.broadcast is handled by ChatServer, which will now fetch nickname
-        // Construct the message payload without nickname, ChatServer::broadcast will add it.
-        json::object broadcast_json_obj = {
-            {"type", "server_broadcast_message"},
-            {"payload", {
-                {"user_id", session_id_}, // User ID is still essential
-                // Nickname will be added by ChatServer::broadcast
-                {"text", text_content},
-                {"timestamp", Utils::getCurrentTimestampISO8601()}
-            }}
-        };
-        // Pass the shared_ptr<Session> to broadcast
-        server_.broadcast(json::serialize(broadcast_json_obj), shared_from_this());
+        std::string text_content(text->raw);
+        if (text->escaped) {
+            MessageSniffer::unescape(text->raw, text_content);
+        }
+        server_.broadcast_chat(shared_from_this(), text_content);
+        return;
+    }
 
+    // Every other message type is rare enough to be parsed in full
+    json::value received_json;
+    try {
+        received_json = json::parse(received_msg_str);
+    } catch (const std::exception& e) {
+        std::cerr << "Session " << session_id_ << " JSON parse error: " << e.what() << " from message: " << received_msg_str << std::endl;
+        return;
+    }
+    const json::object& msg_obj = received_json.as_object();
+    const json::value* type = msg_obj.if_contains("type");
+    if (!type || !type->is_string()) {
+        std::cerr << "Session " << session_id_ << " Received JSON has no/invalid 'type': " << received_msg_str << std::endl;
+        return;
+    }
+    std::string msg_type(type->as_string().data(), type->as_string().size());
+
+    if (msg_type == "client_send_message") {
+        // A frame the sniffer could not route on its own (escaped keys and the like)
+        const json::value* payload = msg_obj.if_contains("payload");
+        const json::value* text = payload && payload->is_object() ? payload->as_object().if_contains("text") : nullptr;
+        if (!text || !text->is_string()) {
+            std::cerr << "Session " << session_id_ << " 'client_send_message' has no/invalid 'payload' or 'text': " << received_msg_str << std::endl;
+            return;
+        }
+        server_.broadcast_chat(shared_from_this(), std::string(text->as_string().data(), text->as_string().size()));
 
     } else if (msg_type == "client_set_nickname") {
         if (!msg_obj.contains("payload") || !msg_obj.at("payload").is_object()) {
             std::cerr << "Session " << session_id_ << " 'client_set_nickname' has no/invalid 'payload': " << received_msg_str << std::endl;
-            do_read();
             return;
         }
         const json::object& payload_obj = msg_obj.at("payload").as_object();
         if (!payload_obj.contains("nickname") || !payload_obj.at("nickname").is_string()) {
             std::cerr << "Session " << session_id_ << " 'client_set_nickname' payload has no/invalid 'nickname': " << received_msg_str << std::endl;
-            do_read();
             return;
         }
         std::string new_nickname = payload_obj.at("nickname").as_string().c_str();
@@ -218,43 +494,191 @@ void Session::on_read(beast::error_code ec, std::size_t bytes_transferred) {
         set_nickname(new_nickname); // Update the nickname
 
         // Construct and broadcast the nickname change notification
-        json::object nickname_changed_payload = {
-            {"type", "server_user_nickname_changed"},
-            {"payload", {
-                {"user_id", session_id_},
-                {"old_nickname", old_nickname_val},
-                {"new_nickname", new_nickname}, // This is the same as get_nickname() now
-                {"timestamp", Utils::getCurrentTimestampISO8601()}
-            }}
-        };
-        server_.broadcast(json::serialize(nickname_changed_payload)); // Use system-wide broadcast
+        server_.broadcast(MessageEncoder::encode<ServerMessages::nickname_changed>( // Use system-wide broadcast
+            session_id_, old_nickname_val, new_nickname, Utils::getCurrentTimestampISO8601()));
+
+    } else if (msg_type == "client_enable_batching") {
+        // Payload is optional: {"window_ms": <n>, "max_bytes": <n>}
+        std::int64_t window_ms = 0;
+        std::int64_t max_bytes = 0;
+        if (msg_obj.contains("payload") && msg_obj.at("payload").is_object()) {
+            const json::object& payload_obj = msg_obj.at("payload").as_object();
+            if (payload_obj.contains("window_ms") && payload_obj.at("window_ms").if_int64()) {
+                window_ms = payload_obj.at("window_ms").as_int64();
+            }
+            if (payload_obj.contains("max_bytes") && payload_obj.at("max_bytes").if_int64()) {
+                max_bytes = payload_obj.at("max_bytes").as_int64();
+            }
+        }
+        enable_batching(window_ms, max_bytes);
+
+    } else if (msg_type == "client_query_history") {
+        // Payload fields are all optional: {"query_id", "user_id", "text",
+        // "since", "until", "before_seq", "limit", "page_size"}. Times are
+        // ISO 8601 strings or Unix seconds.
+        HistoryQuery query;
+        std::string query_id;
+        std::int64_t page_size = 0;
+        std::string error;
+        if (msg_obj.contains("payload") && msg_obj.at("payload").is_object()) {
+            const json::object& payload_obj = msg_obj.at("payload").as_object();
+            auto const string_field = [&](const char* name, std::string& out) {
+                if (auto const* value = payload_obj.if_contains(name); value && value->is_string()) {
+                    out = value->as_string().c_str();
+                }
+            };
+            auto const int_field = [&](const char* name, std::int64_t& out) {
+                if (auto const* value = payload_obj.if_contains(name); value && value->if_int64()) {
+                    out = value->as_int64();
+                }
+            };
+            auto const time_field = [&](const char* name, std::int64_t& out) {
+                auto const* value = payload_obj.if_contains(name);
+                if (!value || value->is_null()) {
+                    return;
+                }
+                out = value->is_string() ? Utils::parseTimestampISO8601(value->as_string().c_str())
+                                         : value->if_int64() ? value->as_int64() : -1;
+                if (out < 0) {
+                    error = std::string("Invalid '") + name + "' timestamp.";
+                }
+            };
+            string_field("query_id", query_id);
+            string_field("user_id", query.user_id);
+            string_field("text", query.text);
+            time_field("since", query.since);
+            time_field("until", query.until);
+            std::int64_t before_seq = 0;
+            std::int64_t limit = static_cast<std::int64_t>(query.limit);
+            int_field("before_seq", before_seq);
+            int_field("limit", limit);
+            int_field("page_size", page_size);
+            query.before_seq = static_cast<std::uint64_t>(std::max<std::int64_t>(before_seq, 0));
+            query.limit = static_cast<std::size_t>(std::max<std::int64_t>(limit, 1));
+            page_size = std::max<std::int64_t>(page_size, 0);
+        }
+        if (!error.empty()) {
+            json::object refused = {
+                {"type", "server_history_page"},
+                {"payload", {
+                    {"query_id", query_id},
+                    {"error", error}
+                }}
+            };
+            enqueue_outbound(std::make_shared<const std::string>(json::serialize(refused)), Lane::bulk);
+            return;
+        }
+        server_.query_history(shared_from_this(), query_id, std::move(query), static_cast<std::size_t>(page_size));
+
+    } else if (msg_type == "client_share_file") {
+        // {"name": <string>, "mime": <string, optional>, "size": <bytes>};
+        // the file follows as one binary message
+        const json::value* payload = msg_obj.if_contains("payload");
+        const json::object* payload_obj = payload && payload->is_object() ? &payload->as_object() : nullptr;
+        const json::value* name = payload_obj ? payload_obj->if_contains("name") : nullptr;
+        const json::value* mime = payload_obj ? payload_obj->if_contains("mime") : nullptr;
+        const json::value* size = payload_obj ? payload_obj->if_contains("size") : nullptr;
+        begin_upload(name && name->is_string() ? name->as_string().c_str() : "",
+                     mime && mime->is_string() ? mime->as_string().c_str() : "application/octet-stream",
+                     size && size->if_int64() ? size->as_int64() : -1);
 
     } else {
         std::cerr << "Session " << session_id_ << " Unknown message type: " << msg_type << std::endl;
         // Optionally send an error or ignore
     }
+}
 
-    // Continue reading for next message
-    do_read();
+void Session::begin_upload(const std::string& name, const std::string& mime, std::int64_t size) {
+    auto const max_bytes = server_.options().max_file_bytes;
+    const char* refused = nullptr;
+    if (max_bytes == 0) {
+        refused = "File sharing is off.";
+    } else if (name.empty()) {
+        refused = "The file needs a name.";
+    } else if (size <= 0) {
+        refused = "Invalid file size.";
+    } else if (static_cast<std::uint64_t>(size) > max_bytes) {
+        refused = "File too large.";
+    }
+    if (upload_) {
+        abandon_upload(); // Announced, but its binary message never came
+    }
+    auto const limit = refused ? 0 : static_cast<std::size_t>(size);
+    upload_.reset(new Upload{name, mime, limit, PayloadSink(limit, !refused)});
+    ws_.read_message_max(0); // The sink enforces the limit
+    if (refused) {
+        std::cerr << "Session " << session_id_ << " refused file '" << name << "': " << refused << std::endl;
+        enqueue_outbound(MessageEncoder::encode_shared<ServerMessages::file_refused>(name, refused), Lane::control);
+    }
 }
 
-void Session::send(std::shared_ptr<const std::string> ss) {
+void Session::finish_upload() {
+    std::unique_ptr<Upload> upload = std::move(upload_);
+    ws_.read_message_max(kMaxMessageBytes);
+    if (!upload->sink.kept()) {
+        if (upload->size != 0) {
+            // Over the announced size; a refused file was answered already
+            enqueue_outbound(MessageEncoder::encode_shared<ServerMessages::file_refused>(
+                                 upload->name, "File larger than announced."),
+                             Lane::control);
+        }
+        return;
+    }
+    if (upload->sink.received() != upload->size) {
+        enqueue_outbound(MessageEncoder::encode_shared<ServerMessages::file_refused>(
+                             upload->name, "File smaller than announced."),
+                         Lane::control);
+        return;
+    }
+    std::cout << "Session " << session_id_ << " shared file '" << upload->name << "' (" << upload->size
+              << " bytes)" << std::endl;
+    server_.share_file(shared_from_this(), upload->name, upload->mime, upload->sink.finish());
+}
+
+void Session::abandon_upload() {
+    std::cerr << "Session " << session_id_ << " expected the binary message of file '" << upload_->name << "'"
+              << std::endl;
+    upload_.reset();
+    ws_.read_message_max(kMaxMessageBytes);
+}
+
+void Session::send(std::shared_ptr<const std::string> ss, Lane lane) {
     // Post our work to the strand, this ensures that messages are sent in order
     net::post(
         strand_,
-        beast::bind_front_handler(
-            &Session::on_send,
-            shared_from_this(),
-            ss));
+        bind_handler_allocator(PooledHandlerAllocator<void>(),
+            beast::bind_front_handler(
+                &Session::on_send,
+                shared_from_this(),
+                ss,
+                lane)));
 }
 
 // This function is called on the strand
-void Session::on_send(std::shared_ptr<const std::string> ss) {
-    // Always add to queue
-    write_queue_.push_back(ss);
+void Session::on_send(std::shared_ptr<const std::string> ss, Lane lane) {
+    enqueue_outbound(std::move(ss), lane);
+}
 
+// Called by ChatServer's per-thread fan-out on the thread that owns this session
+void Session::deliver(std::shared_ptr<const std::string> ss, Lane lane) {
+    enqueue_outbound(std::move(ss), lane);
+}
+
+void Session::send(std::shared_ptr<const MessageBatch> batch, Lane lane) {
+    net::post(strand_, bind_handler_allocator(PooledHandlerAllocator<void>(), [self = shared_from_this(), batch, lane] {
+                  self->deliver(batch, lane);
+              }));
+}
+
+void Session::deliver(const std::shared_ptr<const MessageBatch>& batch, Lane lane) {
+    for (auto const& ss : *batch) {
+        deliver(ss, lane);
+    }
+}
+
+void Session::on_outbound_queued() {
     // Are we already writing?
-    if (write_queue_.size() > 1) {
+    if (writing_) {
         return; // We are already writing, just enqueued
     }
 
@@ -262,31 +686,134 @@ void Session::on_send(std::shared_ptr<const std::string> ss) {
     do_write();
 }
 
+const std::shared_ptr<const std::string>& Session::start_write() {
+    cork_if_backlogged();
+    writing_ = outbound_.pop();
+    return writing_;
+}
 
-void Session::do_write() {
-    if (write_queue_.empty()) {
+void Session::enqueue_outbound(std::shared_ptr<const std::string> ss, Lane lane) {
+    if (!batching_ || lane == Lane::control || lane == Lane::bulk) {
+        CHAT_PROBE3(enqueue, session_id_.c_str(), outbound_.size() + 1, ss->size());
+        outbound_.push(lane, std::move(ss));
+        on_outbound_queued();
+        return;
+    }
+
+    batch_bytes_ += ss->size();
+    CHAT_PROBE3(enqueue, session_id_.c_str(), batch_.size() + 1, ss->size());
+    batch_.push_back(std::move(ss));
+    if (batch_bytes_ >= batch_max_bytes_) {
+        flush_batch();
+        return;
+    }
+    // The window starts with the first message of a batch. A timer that is
+    // still armed after a size-triggered flush simply closes the next batch
+    // early.
+    if (!batch_timer_armed_) {
+        batch_timer_armed_ = true;
+        batch_timer_.expires_after(batch_window_);
+        batch_timer_.async_wait(
+            bind_handler_allocator(PooledHandlerAllocator<void>(),
+                [self = shared_from_this()](beast::error_code ec) {
+                    self->batch_timer_armed_ = false;
+                    if (!ec) {
+                        self->flush_batch();
+                    }
+                }));
+    }
+}
+
+// Turns the pending batch into one frame: a lone message is sent as is,
+// several become a JSON array of the original message objects.
+void Session::flush_batch() {
+    if (batch_.empty()) {
         return;
     }
+    std::shared_ptr<const std::string> frame;
+    if (batch_.size() == 1) {
+        frame = std::move(batch_.front());
+    } else {
+        std::string joined;
+        joined.reserve(batch_bytes_ + batch_.size() + 1);
+        joined += '[';
+        for (std::size_t i = 0; i < batch_.size(); ++i) {
+            if (i) {
+                joined += ',';
+            }
+            joined += *batch_[i];
+        }
+        joined += ']';
+        frame = std::make_shared<const std::string>(std::move(joined));
+    }
+    batch_.clear();
+    batch_bytes_ = 0;
+    outbound_.push(Lane::chat, std::move(frame));
+    on_outbound_queued();
+}
+
+// Handles client_enable_batching: clamps the request to the server limits,
+// acknowledges with server_batching_status (sent unbatched) and switches the
+// outbound path over.
+void Session::enable_batching(std::int64_t window_ms, std::int64_t max_bytes) {
+    const ServerOptions& options = server_.options();
+    bool const enabled = options.batch_window_ms > 0;
+    std::int64_t const server_max_bytes = static_cast<std::int64_t>(options.batch_max_bytes);
+    if (window_ms <= 0 || window_ms > options.batch_window_ms) {
+        window_ms = options.batch_window_ms;
+    }
+    if (max_bytes <= 0 || max_bytes > server_max_bytes) {
+        max_bytes = server_max_bytes;
+    }
+
+    json::object status = {
+        {"type", "server_batching_status"},
+        {"payload", {
+            {"enabled", enabled},
+            {"window_ms", enabled ? window_ms : 0},
+            {"max_bytes", enabled ? max_bytes : 0}
+        }}
+    };
+    flush_batch(); // Anything gathered under earlier settings goes first
+    batching_ = false;
+    enqueue_outbound(std::make_shared<const std::string>(json::serialize(status)), Lane::control);
+
+    if (enabled) {
+        batching_ = true;
+        batch_window_ = std::chrono::milliseconds(window_ms);
+        batch_max_bytes_ = static_cast<std::size_t>(max_bytes);
+    }
+    std::cout << "Session " << session_id_ << " batching " << (enabled ? "enabled" : "refused")
+              << " (window " << window_ms << " ms, max " << max_bytes << " bytes)" << std::endl;
+}
+
+
+void Session::do_write() {
+    if (outbound_.empty() || !handshake_complete_) {
+        return; // Messages queued before the handshake wait for on_accept
+    }
 
     // Check if WebSocket is open before writing
     if (!ws_.is_open()) {
         std::cerr << "Session " << session_id_ << " WebSocket is not open. Cannot write." << std::endl;
-        write_queue_.clear(); // Clear queue as we can't send
+        outbound_.clear(); // Clear queue as we can't send
         return;
     }
 
-    // Get the message from the queue
-    auto msg = write_queue_.front();
+    // Get the next message from the lanes
+    auto const& msg = start_write();
+    trace_write_start(msg);
 
     // Send the message
     ws_.text(true); // Assuming text messages
     ws_.async_write(
         net::buffer(*msg),
-        // Ensure this handler is dispatched on the strand
-        net::bind_executor(strand_,
-            beast::bind_front_handler(
-                &Session::on_write,
-                shared_from_this())));
+        // Ensure this handler is dispatched on the strand (pooled memory as in do_read)
+        bind_handler_allocator(PooledHandlerAllocator<void>(),
+            net::bind_executor(strand_,
+                beast::bind_front_handler(
+                    &Session::on_write,
+                    shared_from_this()))));
 }
 
 void Session::on_write(beast::error_code ec, std::size_t bytes_transferred) {
@@ -299,14 +826,71 @@ void Session::on_write(beast::error_code ec, std::size_t bytes_transferred) {
         return;
     }
 
-    // Remove the message from the queue
-    if (!write_queue_.empty()) {
-        write_queue_.erase(write_queue_.begin());
+    // Done with the message in flight
+    if (writing_) {
+        if (write_fragment()) {
+            return; // More of its streamed payload to go
+        }
+        trace_write_complete(writing_);
+        writing_.reset();
+        CHAT_PROBE3(write_complete, session_id_.c_str(), bytes_transferred, outbound_.size());
     }
 
     // If there are more messages, send the next one
-    if (!write_queue_.empty()) {
+    if (!outbound_.empty()) {
         do_write();
+    } else {
+        uncork_if_drained();
+        release_idle_memory();
+    }
+}
+
+// A streamed payload follows its announcement as one binary message, one
+// chunk per fragment. Each fragment is its own write, so the chunks are
+// written from the shared payload as they are and the connection's I/O
+// thread serves other sessions between fragments.
+bool Session::write_fragment() {
+    const StreamedPayload* payload = StreamedPayload::of(writing_);
+    if (!payload || fragment_ == payload->chunk_count()) {
+        fragment_ = 0;
+        return false;
+    }
+    auto const chunk = payload->chunk(fragment_++);
+    ws_.binary(true);
+    ws_.async_write_some(
+        fragment_ == payload->chunk_count(), // fin
+        net::buffer(chunk.data(), chunk.size()),
+        bind_handler_allocator(PooledHandlerAllocator<void>(),
+            net::bind_executor(strand_,
+                beast::bind_front_handler(
+                    &Session::on_write,
+                    shared_from_this()))));
+    return true;
+}
+
+void Session::cork_if_backlogged() {
+    if (cork_writes_ && !corked_ && outbound_.size() > 1) {
+        corked_ = !SocketTuning::set_cork(beast::get_lowest_layer(ws_).socket(), true);
+    }
+}
+
+void Session::release_idle_memory() {
+    if (!low_memory_) {
+        return;
+    }
+    if (!reading_message_) {
+        buffer_.release(); // Otherwise the reader releases it once done
+    }
+    outbound_.shrink_to_fit();
+    if (batch_.empty()) {
+        batch_.shrink_to_fit();
+    }
+}
+
+void Session::uncork_if_drained() {
+    if (corked_ && outbound_.empty() && !writing_) {
+        corked_ = false;
+        SocketTuning::set_cork(beast::get_lowest_layer(ws_).socket(), false);
     }
 }
 
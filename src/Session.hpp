@@ -2,8 +2,16 @@
 #ifndef SESSION_HPP
 #define SESSION_HPP
 
+#include "LatencyTracer.hpp"
+#include "OutboundLanes.hpp"
+#include "ReadBufferPool.hpp"
+#include "SessionStream.hpp"
+#include "StreamedPayload.hpp"
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
+#include <array>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -17,38 +25,181 @@ namespace beast = boost::beast;
 namespace websocket = beast::websocket;
 using tcp = net::ip::tcp;
 
+// Messages queued together, e.g. a batch from POST /publish
+using MessageBatch = std::vector<std::shared_ptr<const std::string>>;
+
 class Session : public std::enable_shared_from_this<Session> {
 public:
     // Constructor now takes io_context&
     Session(net::io_context& ioc, tcp::socket&& socket, ChatServer& server);
+    // Over any SessionStream, e.g. a simulated connection
+    Session(net::io_context& ioc, SessionStream&& stream, ChatServer& server);
     virtual ~Session() = default; // Add virtual destructor for inheritance
 
-    void run();
-    virtual void send(std::shared_ptr<const std::string> ss); // Made virtual
+    virtual void run();
+    // Queues a message for the client, in `lane` (see OutboundLanes)
+    virtual void send(std::shared_ptr<const std::string> ss, Lane lane = Lane::chat); // Made virtual
+    // Queues a message without posting to the strand. Only for code already
+    // running on the session's strand, or for the thread that runs this
+    // session's io_context when that context has a single thread
+    // (--io-model=per-thread), which already serializes every handler of the
+    // session.
+    virtual void deliver(std::shared_ptr<const std::string> ss, Lane lane = Lane::chat);
+    // Queue every message of `batch` in order: with one post to the strand,
+    // or, for deliver, directly as above
+    void send(std::shared_ptr<const MessageBatch> batch, Lane lane = Lane::chat);
+    void deliver(const std::shared_ptr<const MessageBatch>& batch, Lane lane = Lane::chat);
+    net::io_context& context() const { return context_; } // Owning io_context
+    // Stamps of the inbound message being handled, if it was sampled for
+    // latency tracing; valid while handle_message runs.
+    const MessageTrace* inbound_trace() const { return inbound_traced_ ? &inbound_trace_ : nullptr; }
     std::string get_id() const; // Added get_id() method
     void set_nickname(const std::string& new_nickname);
     std::string get_nickname() const;
 
-private:
-    void on_accept(beast::error_code ec);
-    void do_read();
-    void on_read(beast::error_code ec, std::size_t bytes_transferred);
-    void do_write();
-    void on_write(beast::error_code ec, std::size_t bytes_transferred);
+    // Resumable sessions (see ChatServer::on_client_upgraded). Called by the
+    // server under its session lock.
+    const std::string& resume_token() const { return resume_token_; }
+    void set_resume_token(const std::string& token) { resume_token_ = token; }
+    // Takes over the identity of the session this connection resumes
+    void resume_as(const std::string& user_id, const std::string& nickname, const std::string& token);
+    // Closes the connection without a close frame, e.g. because the client
+    // has resumed the session on a new one.
+    void drop_connection();
+
+    // Write queue of one session, for the admin channel's `sessions`
+    struct QueueDepth {
+        std::string id;
+        std::string nickname;
+        std::size_t messages = 0; // In outbound_
+        std::size_t bytes = 0;    // In outbound_, streamed payloads included
+        std::array<std::size_t, OutboundLanes::kLanes> lanes{};
+        std::size_t batched = 0;  // Held in the pending micro-batch
+        bool writing = false;     // A write is in flight
+    };
+    // Calls `done` with this session's QueueDepth, from its strand
+    void inspect_queue(std::function<void(QueueDepth)> done);
+
+protected:
+    // Helpers shared with alternative session engines (see CoroSession)
+    void configure_stream();
+    void handle_message(const std::string& received_msg_str);
     void on_close(beast::error_code ec); // Not strictly in design but good for handling closure
-    void on_run(); // Added declaration
-    void on_send(std::shared_ptr<const std::string> ss); // Added declaration
+    // Answers a plain HTTP request read instead of a websocket upgrade
+    // (GET /stats, POST /publish), then closes the connection.
+    void respond_http();
+    // Once upgraded: registers with the server, resuming an earlier session
+    // if the upgrade request asked for it (/?resume=<token>&last_seq=<n>).
+    // Call on the strand.
+    void join_server();
+
+    // Latency tracing stages (see LatencyTracer); cheap no-ops unless the
+    // message was sampled.
+    void trace_read_complete();
+    void trace_write_start(const std::shared_ptr<const std::string>& msg);
+    void trace_write_complete(const std::shared_ptr<const std::string>& msg);
+
+    // Outbound path shared by the session engines; call on the strand.
+    // Queues the message for writing, or adds it to the pending batch when
+    // the client negotiated micro-batching (chat and presence lanes only;
+    // batches go out in the chat lane).
+    void enqueue_outbound(std::shared_ptr<const std::string> ss, Lane lane = Lane::chat);
+    // Called after outbound_ gained an entry; starts or wakes the writer.
+    virtual void on_outbound_queued();
+    // Moves the next message from outbound_ to writing_; outbound_ must not
+    // be empty.
+    const std::shared_ptr<const std::string>& start_write();
+
+    // --cork-writes: cork before writing when more than one frame is queued,
+    // uncork (and so flush) once the queue is empty. Call on the strand.
+    void cork_if_backlogged();
+    void uncork_if_drained();
+
+    // File sharing: client_share_file announces a file, and the binary
+    // message that follows is read into upload_ a fragment at a time. A
+    // refused file is still read, and discarded, so that it never lands in
+    // the read buffer.
+    void begin_upload(const std::string& name, const std::string& mime, std::int64_t size);
+    // The announced binary message has been read: shares the file
+    void finish_upload();
+    // The next message was not the announced binary message
+    void abandon_upload();
+    // Whether the next message is read into upload_; call once a data frame
+    // has started arriving (a zero-length read), so its type is known.
+    bool upload_arriving() const { return upload_ && ws_.got_binary(); }
 
-    websocket::stream<beast::tcp_stream> ws_;
-    beast::flat_buffer buffer_;
+    // --low-memory: hands the read buffer back to the pool and frees the
+    // storage of empty queues. Call on the strand whenever the session may
+    // have gone idle.
+    void release_idle_memory();
+    // Zero-length target for waiting on the next message without a buffer
+    static net::mutable_buffer empty_read_buffer();
+
+    websocket::stream<SessionStream> ws_;
+    PooledReadBuffer buffer_; // Storage borrowed only while a message is being read
     ChatServer& server_; // Reference to ChatServer for broadcasting
-    std::vector<std::shared_ptr<const std::string>> write_queue_;
+    net::io_context& context_;
+    OutboundLanes outbound_; // Messages waiting to be written
+    std::shared_ptr<const std::string> writing_; // The message being written, if any
+    std::size_t fragment_ = 0; // Next chunk of writing_'s streamed payload
     std::string session_id_; // For identifying sessions
     std::string nickname_; // For storing user's nickname
+    std::string resume_token_; // Issued by the server; empty if resuming is off
 
     // Strand to ensure sequential execution of handlers for this session
     net::strand<net::io_context::executor_type> strand_; // Reverted to io_context::executor_type
 
+    bool handshake_complete_ = false; // Writes are held until the upgrade is done
+    beast::http::request<beast::http::string_body> upgrade_request_;
+
+    MessageTrace inbound_trace_;
+    bool inbound_traced_ = false;
+    std::int64_t write_started_ns_ = 0; // Set while a traced message is being written
+
+    bool cork_writes_ = false; // ServerOptions::cork_writes
+    bool corked_ = false;
+    bool low_memory_ = false; // ServerOptions::low_memory
+    // A message is being read into buffer_: its storage may be prepared but
+    // not yet committed, so it must not go back to the pool.
+    bool reading_message_ = false;
+
+    struct Upload {
+        std::string name;
+        std::string mime;
+        std::size_t size;
+        PayloadSink sink;
+    };
+    std::unique_ptr<Upload> upload_; // Announced file whose binary message is next
+
+    // Micro-batching state (see enable_batching). Messages collected within
+    // batch_window_ are written as a single JSON array frame.
+    bool batching_ = false;
+    std::chrono::milliseconds batch_window_{0};
+    std::size_t batch_max_bytes_ = 0;
+    std::vector<std::shared_ptr<const std::string>> batch_;
+    std::size_t batch_bytes_ = 0;
+    net::steady_timer batch_timer_;
+    bool batch_timer_armed_ = false;
+
+private:
+    void on_http_request(beast::error_code ec, std::size_t bytes_transferred);
+    void on_accept(beast::error_code ec);
+    void do_read();
+    void on_message_arriving(beast::error_code ec, std::size_t bytes_transferred); // --low-memory
+    void read_message();
+    void on_read(beast::error_code ec, std::size_t bytes_transferred);
+    void read_upload();
+    void on_upload_read(beast::error_code ec, std::size_t bytes_transferred);
+    void do_write();
+    void on_write(beast::error_code ec, std::size_t bytes_transferred);
+    // Writes the next chunk of writing_'s streamed payload as a fragment;
+    // false once the whole message is written.
+    bool write_fragment();
+    void on_run(); // Added declaration
+    void on_send(std::shared_ptr<const std::string> ss, Lane lane); // Added declaration
+    void enable_batching(std::int64_t window_ms, std::int64_t max_bytes); // Values the client asked for
+    void flush_batch();
+
     // Helper to generate a simple unique ID
     static std::atomic<int> s_id_counter_;
     static std::string generate_session_id();
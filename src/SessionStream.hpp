@@ -0,0 +1,134 @@
+// SessionStream.hpp
+#ifndef SESSION_STREAM_HPP
+#define SESSION_STREAM_HPP
+
+#include "SimulatedStream.hpp"
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket/teardown.hpp>
+#include <memory>
+#include <utility>
+
+// The byte stream under a session's websocket: an accepted TCP connection, a
+// connection on the server's Unix domain socket (--unix-socket) or, in
+// benchmarks and tests, one end of a SimulatedStream. Each operation is
+// forwarded to whichever it is, with the caller's handler unchanged, so the
+// TCP path costs two branches and no type erasure.
+class SessionStream {
+public:
+    using executor_type = boost::beast::tcp_stream::executor_type;
+    using local_stream = boost::beast::basic_stream<boost::asio::local::stream_protocol, executor_type>;
+
+    explicit SessionStream(boost::asio::ip::tcp::socket&& socket) : tcp_(std::move(socket)) {}
+    explicit SessionStream(boost::asio::local::stream_protocol::socket&& socket)
+        : tcp_(socket.get_executor()), local_(std::make_unique<local_stream>(std::move(socket))) {}
+    explicit SessionStream(SimulatedStream&& simulated)
+        : tcp_(simulated.get_executor()), simulated_(std::make_unique<SimulatedStream>(std::move(simulated))) {}
+
+    executor_type get_executor() noexcept { return simulated_ ? simulated_->get_executor() : tcp_.get_executor(); }
+    bool simulated() const { return simulated_ != nullptr; }
+    bool local() const { return local_ != nullptr; }
+
+    // The TCP socket; never opened for local and simulated connections, so
+    // socket options on it fail harmlessly.
+    boost::asio::ip::tcp::socket& socket() { return tcp_.socket(); }
+    // The connection's file descriptor, -1 for simulated connections
+    int native_handle() {
+        return local_ ? local_->socket().native_handle() : static_cast<int>(tcp_.socket().native_handle());
+    }
+    // Timeouts apply to socket connections only
+    template <typename Duration>
+    void expires_after(Duration duration) {
+        if (local_) {
+            local_->expires_after(duration);
+        } else if (!simulated_) {
+            tcp_.expires_after(duration);
+        }
+    }
+    void expires_never() {
+        if (local_) {
+            local_->expires_never();
+        }
+        tcp_.expires_never();
+    }
+    void shutdown_send() {
+        boost::system::error_code ignored;
+        if (local_) {
+            local_->socket().shutdown(boost::asio::socket_base::shutdown_send, ignored);
+        } else if (!simulated_) {
+            tcp_.socket().shutdown(boost::asio::socket_base::shutdown_send, ignored);
+        }
+    }
+    void close() {
+        if (simulated_) {
+            simulated_->close();
+        } else if (local_) {
+            local_->close();
+        } else {
+            tcp_.close();
+        }
+    }
+
+    template <typename MutableBufferSequence, typename ReadToken>
+    auto async_read_some(const MutableBufferSequence& buffers, ReadToken&& token) {
+        return boost::asio::async_initiate<ReadToken, void(boost::system::error_code, std::size_t)>(
+            [this](auto handler, const MutableBufferSequence& buffers) {
+                if (simulated_) {
+                    simulated_->async_read_some(buffers, std::move(handler));
+                } else if (local_) {
+                    local_->async_read_some(buffers, std::move(handler));
+                } else {
+                    tcp_.async_read_some(buffers, std::move(handler));
+                }
+            },
+            token, buffers);
+    }
+
+    template <typename ConstBufferSequence, typename WriteToken>
+    auto async_write_some(const ConstBufferSequence& buffers, WriteToken&& token) {
+        return boost::asio::async_initiate<WriteToken, void(boost::system::error_code, std::size_t)>(
+            [this](auto handler, const ConstBufferSequence& buffers) {
+                if (simulated_) {
+                    simulated_->async_write_some(buffers, std::move(handler));
+                } else if (local_) {
+                    local_->async_write_some(buffers, std::move(handler));
+                } else {
+                    tcp_.async_write_some(buffers, std::move(handler));
+                }
+            },
+            token, buffers);
+    }
+
+    // For beast::close_socket(), which websocket timeouts call
+    friend void beast_close_socket(SessionStream& stream) { stream.close(); }
+
+    friend void teardown(boost::beast::role_type role, SessionStream& stream, boost::system::error_code& ec) {
+        using boost::beast::websocket::teardown;
+        if (stream.simulated_) {
+            teardown(role, *stream.simulated_, ec);
+        } else if (stream.local_) {
+            teardown(role, *stream.local_, ec);
+        } else {
+            teardown(role, stream.tcp_, ec);
+        }
+    }
+
+    template <typename TeardownHandler>
+    friend void async_teardown(boost::beast::role_type role, SessionStream& stream, TeardownHandler&& handler) {
+        using boost::beast::websocket::async_teardown;
+        if (stream.simulated_) {
+            async_teardown(role, *stream.simulated_, std::forward<TeardownHandler>(handler));
+        } else if (stream.local_) {
+            async_teardown(role, *stream.local_, std::forward<TeardownHandler>(handler));
+        } else {
+            async_teardown(role, stream.tcp_, std::forward<TeardownHandler>(handler));
+        }
+    }
+
+private:
+    boost::beast::tcp_stream tcp_;
+    std::unique_ptr<local_stream> local_;
+    std::unique_ptr<SimulatedStream> simulated_;
+};
+
+#endif // SESSION_STREAM_HPP
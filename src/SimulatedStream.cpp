@@ -0,0 +1,39 @@
+// SimulatedStream.cpp
+#include "SimulatedStream.hpp"
+
+std::pair<SimulatedStream, SimulatedStream> SimulatedStream::make_pair(executor_type first, executor_type second,
+                                                                       const Link& link) {
+    auto to_second = std::make_shared<Pipe>(second, link);
+    auto to_first = std::make_shared<Pipe>(first, link);
+    return {SimulatedStream(to_first, to_second, std::move(first)),
+            SimulatedStream(std::move(to_second), std::move(to_first), std::move(second))};
+}
+
+SimulatedStream::~SimulatedStream() {
+    if (in_) {
+        close(); // The peer sees end of stream, as with a socket
+    }
+}
+
+bool SimulatedStream::is_open() const {
+    std::lock_guard<std::mutex> lock(out_->mutex);
+    return !out_->closed;
+}
+
+void SimulatedStream::close() {
+    // Parked operations hold their pipe; waking them also breaks that cycle
+    for (auto const& pipe : {in_, out_}) {
+        std::unique_lock<std::mutex> lock(pipe->mutex);
+        pipe->closed = true;
+        auto reader = std::move(pipe->reader);
+        auto writer = std::move(pipe->writer);
+        lock.unlock();
+        Pipe::wake(std::move(reader));
+        Pipe::wake(std::move(writer));
+    }
+}
+
+void teardown(boost::beast::role_type, SimulatedStream& stream, boost::system::error_code& ec) {
+    stream.close();
+    ec = {};
+}
@@ -0,0 +1,242 @@
+// SimulatedStream.hpp
+#ifndef SIMULATED_STREAM_HPP
+#define SIMULATED_STREAM_HPP
+
+#include <boost/asio.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/core/buffers_suffix.hpp>
+#include <boost/beast/core/role.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// One end of an in-memory connection. ChatServer can serve simulated clients
+// over these (ChatServer::connect_simulated), so a single process can run
+// 100k sessions without sockets or kernel limits, and benchmarks of the
+// broadcast, queueing and backpressure paths are not at the mercy of the
+// network stack.
+//
+// Each direction models a link. A write lands at the far end `latency`
+// after it has been sent, and with a `bytes_per_second` limit it takes its
+// size over that rate to send, one write after another. At most
+// `buffer_bytes` may be in flight or unread, like a socket's buffers: a
+// writer that finds the link full waits for the reader, so a slow reader
+// pushes back on the server the way a slow TCP peer does.
+class SimulatedStream {
+public:
+    using executor_type = boost::asio::any_io_executor;
+    using clock = std::chrono::steady_clock;
+
+    struct Link {
+        std::chrono::nanoseconds latency{0};
+        std::uint64_t bytes_per_second = 0; // 0 = unlimited
+        std::size_t buffer_bytes = 256 * 1024;
+    };
+
+    // A connected pair: what one end writes, the other reads. The operations
+    // of each end complete on its executor; the ends may be used from
+    // different threads.
+    static std::pair<SimulatedStream, SimulatedStream> make_pair(executor_type first, executor_type second,
+                                                                 const Link& link);
+    static std::pair<SimulatedStream, SimulatedStream> make_pair(executor_type first, executor_type second) {
+        return make_pair(std::move(first), std::move(second), Link{});
+    }
+
+    SimulatedStream(SimulatedStream&&) = default;
+    SimulatedStream& operator=(SimulatedStream&&) = default;
+    ~SimulatedStream();
+
+    executor_type get_executor() const noexcept { return executor_; }
+    bool is_open() const;
+    // Ends both directions. Each end still reads what was in flight, then
+    // gets end of stream; writes fail.
+    void close();
+
+    template <typename MutableBufferSequence, typename ReadToken>
+    auto async_read_some(const MutableBufferSequence& buffers, ReadToken&& token) {
+        return boost::asio::async_compose<ReadToken, void(boost::system::error_code, std::size_t)>(
+            ReadOp<MutableBufferSequence>{in_, buffers}, token, executor_);
+    }
+
+    template <typename ConstBufferSequence, typename WriteToken>
+    auto async_write_some(const ConstBufferSequence& buffers, WriteToken&& token) {
+        return boost::asio::async_compose<WriteToken, void(boost::system::error_code, std::size_t)>(
+            WriteOp<ConstBufferSequence>{out_, buffers}, token, executor_);
+    }
+
+private:
+    // One direction of the connection
+    struct Pipe {
+        // An operation parked until the other end reads or writes
+        struct Waiter {
+            virtual ~Waiter() = default;
+            virtual void resume() = 0;
+        };
+        template <typename Self>
+        struct ParkedOp : Waiter {
+            explicit ParkedOp(Self&& self) : self(std::move(self)) {}
+            void resume() override { boost::asio::post(std::move(self)); }
+            Self self;
+        };
+        struct Segment {
+            clock::time_point ready; // When it has crossed the link
+            std::string bytes;
+            std::size_t consumed = 0;
+        };
+
+        Pipe(executor_type reader, const Link& link) : link(link), timer(reader) {}
+
+        // Call without holding the mutex
+        static void wake(std::unique_ptr<Waiter> waiter) {
+            if (waiter) {
+                waiter->resume();
+            }
+        }
+
+        std::mutex mutex;
+        Link const link;
+        std::deque<Segment> segments;
+        std::size_t buffered = 0; // Bytes in segments
+        clock::time_point busy_until{}; // The link sends one write after another
+        bool closed = false;
+        std::unique_ptr<Waiter> reader;
+        std::unique_ptr<Waiter> writer;
+        boost::asio::steady_timer timer; // The reader waits on it for data in flight
+    };
+
+    template <typename Buffers>
+    struct ReadOp {
+        std::shared_ptr<Pipe> pipe;
+        Buffers buffers;
+        bool started = false;
+
+        template <typename Self>
+        void operator()(Self& self, boost::system::error_code = {}) {
+            if (!started) {
+                started = true; // Never complete inside the initiating call
+                boost::asio::post(std::move(self));
+                return;
+            }
+            auto const wanted = boost::asio::buffer_size(buffers);
+            std::unique_lock<std::mutex> lock(pipe->mutex);
+            if (wanted == 0) {
+                lock.unlock();
+                self.complete({}, 0);
+                return;
+            }
+            if (pipe->segments.empty()) {
+                if (pipe->closed) {
+                    lock.unlock();
+                    self.complete(boost::asio::error::eof, 0);
+                    return;
+                }
+                auto& parked = pipe->reader; // Before self, and pipe with it, is moved from
+                parked = std::make_unique<Pipe::ParkedOp<Self>>(std::move(self));
+                return;
+            }
+            auto const now = clock::now();
+            if (pipe->segments.front().ready > now) {
+                auto& timer = pipe->timer;
+                timer.expires_at(pipe->segments.front().ready);
+                lock.unlock();
+                timer.async_wait(std::move(self));
+                return;
+            }
+            std::size_t read = 0;
+            while (read < wanted && !pipe->segments.empty() && pipe->segments.front().ready <= now) {
+                auto& segment = pipe->segments.front();
+                boost::beast::buffers_suffix<Buffers> rest(buffers);
+                rest.consume(read);
+                auto const copied = boost::asio::buffer_copy(rest, boost::asio::buffer(segment.bytes) + segment.consumed);
+                read += copied;
+                segment.consumed += copied;
+                if (segment.consumed == segment.bytes.size()) {
+                    pipe->segments.pop_front();
+                }
+            }
+            pipe->buffered -= read;
+            auto writer = std::move(pipe->writer);
+            lock.unlock();
+            Pipe::wake(std::move(writer));
+            self.complete({}, read);
+        }
+    };
+
+    template <typename Buffers>
+    struct WriteOp {
+        std::shared_ptr<Pipe> pipe;
+        Buffers buffers;
+        bool started = false;
+
+        template <typename Self>
+        void operator()(Self& self) {
+            if (!started) {
+                started = true;
+                boost::asio::post(std::move(self));
+                return;
+            }
+            auto const size = boost::asio::buffer_size(buffers);
+            std::unique_lock<std::mutex> lock(pipe->mutex);
+            if (pipe->closed) {
+                lock.unlock();
+                self.complete(boost::asio::error::broken_pipe, 0);
+                return;
+            }
+            if (size == 0) {
+                lock.unlock();
+                self.complete({}, 0);
+                return;
+            }
+            if (pipe->buffered >= pipe->link.buffer_bytes) {
+                auto& parked = pipe->writer;
+                parked = std::make_unique<Pipe::ParkedOp<Self>>(std::move(self));
+                return;
+            }
+            typename Pipe::Segment segment;
+            segment.bytes.resize(std::min(size, pipe->link.buffer_bytes - pipe->buffered));
+            boost::asio::buffer_copy(boost::asio::buffer(segment.bytes), buffers);
+            auto sent = std::max(clock::now(), pipe->busy_until);
+            if (pipe->link.bytes_per_second != 0) {
+                sent += std::chrono::nanoseconds(segment.bytes.size() * 1000000000ull / pipe->link.bytes_per_second);
+            }
+            pipe->busy_until = sent;
+            segment.ready = sent + pipe->link.latency;
+            auto const written = segment.bytes.size();
+            pipe->buffered += written;
+            pipe->segments.push_back(std::move(segment));
+            auto reader = std::move(pipe->reader);
+            lock.unlock();
+            Pipe::wake(std::move(reader));
+            self.complete({}, written);
+        }
+    };
+
+    SimulatedStream(std::shared_ptr<Pipe> in, std::shared_ptr<Pipe> out, executor_type executor)
+        : in_(std::move(in)), out_(std::move(out)), executor_(std::move(executor)) {}
+
+    std::shared_ptr<Pipe> in_;
+    std::shared_ptr<Pipe> out_;
+    executor_type executor_;
+};
+
+// For beast::close_socket(), which websocket timeouts call
+inline void beast_close_socket(SimulatedStream& stream) {
+    stream.close();
+}
+
+// Websocket teardown (closing handshake) for simulated connections
+void teardown(boost::beast::role_type role, SimulatedStream& stream, boost::system::error_code& ec);
+
+template <typename TeardownHandler>
+void async_teardown(boost::beast::role_type, SimulatedStream& stream, TeardownHandler&& handler) {
+    stream.close();
+    boost::asio::post(stream.get_executor(),
+                      boost::beast::bind_front_handler(std::forward<TeardownHandler>(handler), boost::system::error_code{}));
+}
+
+#endif // SIMULATED_STREAM_HPP
@@ -0,0 +1,80 @@
+// SocketTuning.cpp
+#include "SocketTuning.hpp"
+#include <boost/asio/detail/socket_option.hpp>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace {
+
+template <typename Option>
+void set(tcp::socket& socket, const Option& option, boost::system::error_code& first_error) {
+    boost::system::error_code ec;
+    socket.set_option(option, ec);
+    if (ec && !first_error) {
+        first_error = ec;
+    }
+}
+
+#if defined(TCP_NOTSENT_LOWAT)
+using notsent_lowat = net::detail::socket_option::integer<IPPROTO_TCP, TCP_NOTSENT_LOWAT>;
+#endif
+#if defined(SO_BUSY_POLL)
+using busy_poll = net::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>;
+#endif
+#if defined(TCP_CORK)
+using cork = net::detail::socket_option::boolean<IPPROTO_TCP, TCP_CORK>;
+#endif
+
+} // namespace
+
+boost::system::error_code SocketTuning::apply(tcp::socket& socket, const ServerOptions& options) {
+    boost::system::error_code first_error;
+    set(socket, tcp::no_delay(options.tcp_nodelay), first_error);
+    if (options.send_buffer_bytes > 0) {
+        set(socket, net::socket_base::send_buffer_size(options.send_buffer_bytes), first_error);
+    }
+    if (options.recv_buffer_bytes > 0) {
+        set(socket, net::socket_base::receive_buffer_size(options.recv_buffer_bytes), first_error);
+    }
+#if defined(TCP_NOTSENT_LOWAT)
+    if (options.notsent_lowat_bytes > 0) {
+        set(socket, notsent_lowat(options.notsent_lowat_bytes), first_error);
+    }
+#endif
+#if defined(SO_BUSY_POLL)
+    if (options.socket_busy_poll_us > 0) {
+        set(socket, busy_poll(options.socket_busy_poll_us), first_error);
+    }
+#endif
+    return first_error;
+}
+
+bool SocketTuning::cork_supported() {
+#if defined(TCP_CORK)
+    return true;
+#else
+    return false;
+#endif
+}
+
+boost::system::error_code SocketTuning::set_cork(tcp::socket& socket, bool corked) {
+    boost::system::error_code ec;
+#if defined(TCP_CORK)
+    socket.set_option(cork(corked), ec);
+#else
+    (void)socket;
+    (void)corked;
+#endif
+    return ec;
+}
+
+std::string SocketTuning::describe(const ServerOptions& options) {
+    auto const bytes = [](int n) { return n > 0 ? std::to_string(n) : std::string("default"); };
+    return std::string("nodelay=") + (options.tcp_nodelay ? "on" : "off")
+        + " sndbuf=" + bytes(options.send_buffer_bytes)
+        + " rcvbuf=" + bytes(options.recv_buffer_bytes)
+        + " notsent_lowat=" + bytes(options.notsent_lowat_bytes)
+        + " cork=" + (options.cork_writes ? "on" : "off")
+        + " busy_poll_us=" + (options.socket_busy_poll_us > 0 ? std::to_string(options.socket_busy_poll_us) : "off");
+}
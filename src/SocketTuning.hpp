@@ -0,0 +1,34 @@
+// SocketTuning.hpp
+#ifndef SOCKET_TUNING_HPP
+#define SOCKET_TUNING_HPP
+
+#include "ServerOptions.hpp"
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp>
+#include <string>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+// Socket options applied to every accepted connection, taken from the
+// --tcp-nodelay, --send-buffer, --recv-buffer, --notsent-lowat and
+// --socket-busy-poll-us flags. Options the platform lacks (TCP_NOTSENT_LOWAT,
+// TCP_CORK and SO_BUSY_POLL outside Linux) are skipped.
+namespace SocketTuning {
+
+// Applies the configured options. A failing option does not stop the others;
+// the first error is returned so the caller can log it and keep the
+// connection.
+boost::system::error_code apply(tcp::socket& socket, const ServerOptions& options);
+
+// TCP_CORK: while corked the kernel only sends full segments, so a burst of
+// small frames leaves as few packets; uncorking flushes the remainder.
+bool cork_supported();
+boost::system::error_code set_cork(tcp::socket& socket, bool corked);
+
+// One-line summary for the startup banner
+std::string describe(const ServerOptions& options);
+
+} // namespace SocketTuning
+
+#endif // SOCKET_TUNING_HPP
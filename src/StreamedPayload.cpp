@@ -0,0 +1,76 @@
+// StreamedPayload.cpp
+#include "StreamedPayload.hpp"
+#include <algorithm>
+
+namespace {
+
+// Deleter of messages followed by a streamed payload; std::get_deleter finds
+// the payload through it.
+struct StreamedMessageDeleter {
+    std::shared_ptr<const StreamedPayload> payload;
+    void operator()(const std::string* p) const { delete p; }
+};
+
+} // namespace
+
+std::string_view StreamedPayload::chunk(std::size_t index) const {
+    auto const offset = index * kChunkBytes;
+    return std::string_view(chunks_[index].get(), std::min(kChunkBytes, size_ - offset));
+}
+
+std::size_t StreamedPayload::chunk_count() const {
+    return (size_ + kChunkBytes - 1) / kChunkBytes; // A trailing chunk may be allocated but empty
+}
+
+std::shared_ptr<const std::string> StreamedPayload::make_message(std::string announcement,
+                                                                 std::shared_ptr<const StreamedPayload> payload) {
+    return std::shared_ptr<const std::string>(new std::string(std::move(announcement)),
+                                              StreamedMessageDeleter{std::move(payload)});
+}
+
+const StreamedPayload* StreamedPayload::of(const std::shared_ptr<const std::string>& message) {
+    auto const* deleter = std::get_deleter<StreamedMessageDeleter>(message);
+    return deleter ? deleter->payload.get() : nullptr;
+}
+
+std::size_t StreamedPayload::wire_size(const std::shared_ptr<const std::string>& message) {
+    const StreamedPayload* payload = of(message);
+    return message->size() + (payload ? payload->size() : 0);
+}
+
+PayloadSink::PayloadSink(std::size_t limit, bool keep)
+    : payload_(std::make_shared<StreamedPayload>()), limit_(limit), keep_(keep) {}
+
+boost::asio::mutable_buffer PayloadSink::prepare() {
+    auto& chunks = payload_->chunks_;
+    if (chunks.empty() || (keep_ && used_ == StreamedPayload::kChunkBytes)) {
+        chunks.emplace_back(new char[StreamedPayload::kChunkBytes]); // Not zeroed: it is read over
+        used_ = 0;
+    }
+    return boost::asio::mutable_buffer(chunks.back().get() + used_, StreamedPayload::kChunkBytes - used_);
+}
+
+void PayloadSink::commit(std::size_t bytes) {
+    received_ += bytes;
+    if (!keep_) {
+        return; // The one chunk is read over again
+    }
+    if (received_ > limit_) {
+        keep_ = false;
+        auto& chunks = payload_->chunks_;
+        chunks.erase(chunks.begin(), chunks.end() - 1);
+        payload_->size_ = 0;
+        used_ = 0;
+        return;
+    }
+    used_ += bytes;
+    payload_->size_ += bytes;
+}
+
+std::shared_ptr<const StreamedPayload> PayloadSink::finish() {
+    if (!keep_) {
+        payload_.reset();
+        return nullptr;
+    }
+    return std::move(payload_);
+}
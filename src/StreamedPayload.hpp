@@ -0,0 +1,70 @@
+// StreamedPayload.hpp
+#ifndef STREAMED_PAYLOAD_HPP
+#define STREAMED_PAYLOAD_HPP
+
+#include <boost/asio/buffer.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A large binary message (a shared file) held as fixed-size chunks, so it is
+// never in one contiguous buffer. It is read in fragment by fragment
+// (PayloadSink) and written out one chunk per frame. Recipients share the
+// one payload: a broadcast queues it by reference, never a copy.
+class StreamedPayload {
+public:
+    static constexpr std::size_t kChunkBytes = 64 * 1024;
+
+    std::size_t size() const { return size_; }
+    std::size_t chunk_count() const;
+    std::string_view chunk(std::size_t index) const;
+
+    // Outbound queue entry for Session::send(): the text frame
+    // `announcement`, followed by `payload` as one binary message. Like a
+    // traced message (LatencyTracer::make_traced), the payload travels in the
+    // shared_ptr's deleter, so the queues and send() need no second message
+    // type.
+    static std::shared_ptr<const std::string> make_message(std::string announcement,
+                                                           std::shared_ptr<const StreamedPayload> payload);
+    // The binary message that follows `message`, or nullptr for plain frames
+    static const StreamedPayload* of(const std::shared_ptr<const std::string>& message);
+    // Bytes `message` puts on the wire, payload included
+    static std::size_t wire_size(const std::shared_ptr<const std::string>& message);
+
+private:
+    friend class PayloadSink;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::size_t size_ = 0;
+};
+
+// Receives one inbound binary message, fragment by fragment, straight into
+// the chunks of a StreamedPayload. Up to `limit` bytes are kept. A sink that
+// does not keep (a refused upload), or that is sent more than `limit`, reads
+// the rest into a single chunk it reuses and only counts it.
+class PayloadSink {
+public:
+    PayloadSink(std::size_t limit, bool keep);
+
+    // Space for the next read; commit() what was read into it
+    boost::asio::mutable_buffer prepare();
+    void commit(std::size_t bytes);
+
+    std::size_t received() const { return received_; }
+    // Holds every byte received so far
+    bool kept() const { return keep_; }
+
+    // The payload received, if it was kept; the sink is spent afterwards
+    std::shared_ptr<const StreamedPayload> finish();
+
+private:
+    std::shared_ptr<StreamedPayload> payload_;
+    std::size_t limit_;
+    bool keep_;
+    std::size_t received_ = 0;
+    std::size_t used_ = 0; // Of the last chunk
+};
+
+#endif // STREAMED_PAYLOAD_HPP
@@ -4,17 +4,20 @@
 
 #include <string>
 #include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
 #include <iomanip>
 #include <sstream>
 #include <time.h> // For strftime with gmtime
+#ifndef _WIN32
+#include <unistd.h> // For sysconf
+#endif
 
 namespace Utils {
 
-// Generates an ISO 8601 timestamp string in UTC
-inline std::string getCurrentTimestampISO8601() {
-    auto now = std::chrono::system_clock::now();
-    auto itt = std::chrono::system_clock::to_time_t(now);
-
+// Formats Unix time as an ISO 8601 timestamp string in UTC
+inline std::string formatTimestampISO8601(std::time_t itt) {
     std::ostringstream ss;
     // Use gmtime_r for thread-safety if available and on POSIX, otherwise gmtime
     // For C++20, std::format would be an option.
@@ -32,6 +35,47 @@ inline std::string getCurrentTimestampISO8601() {
     return ss.str();
 }
 
+// Generates an ISO 8601 timestamp string in UTC
+inline std::string getCurrentTimestampISO8601() {
+    return formatTimestampISO8601(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+}
+
+// Parses a UTC timestamp in the format above ("2023-10-27T10:30:00Z", the
+// 'Z' optional) into Unix time. Returns -1 if `text` is not one.
+inline std::int64_t parseTimestampISO8601(const std::string& text) {
+    std::tm buf{};
+    std::istringstream ss(text);
+    ss >> std::get_time(&buf, "%Y-%m-%dT%H:%M:%S");
+    if (ss.fail()) {
+        return -1;
+    }
+    char zone = 0;
+    if (ss >> zone && (zone != 'Z' || ss.peek() != std::char_traits<char>::eof())) {
+        return -1;
+    }
+    #ifdef _WIN32
+        return static_cast<std::int64_t>(_mkgmtime(&buf));
+    #else
+        return static_cast<std::int64_t>(timegm(&buf));
+    #endif
+}
+
+// Resident set size of this process in bytes, or 0 where /proc is not
+// available
+inline std::int64_t residentSetBytes() {
+    std::ifstream statm("/proc/self/statm");
+    std::int64_t size_pages = 0;
+    std::int64_t resident_pages = 0;
+    if (!(statm >> size_pages >> resident_pages)) {
+        return 0;
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return resident_pages * static_cast<std::int64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
 } // namespace Utils
 
 #endif // UTILS_HPP
@@ -1,5 +1,10 @@
 // #include "ChatClient.hpp" // Commented out old client
+#include "BusyPoll.hpp"
 #include "ChatServer.hpp"
+#include "CpuPlacement.hpp"
+#include "IoContextPool.hpp"
+#include "ServerOptions.hpp"
+#include "SocketTuning.hpp"
 #include <iostream>
 #include <string>
 #include <vector> // For thread list
@@ -13,19 +18,46 @@ using tcp = net::ip::tcp;
 // Main function to run the chat server
 int main(int argc, char* argv[]) {
     try {
-        // Check command line arguments.
-        if (argc < 2) {
-            std::cerr << "Usage: websocket-chat-server <port> [<num_threads>]\n";
+        ServerOptions options;
+        try {
+            options = ServerOptions::parse(argc, argv);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << "\n" << ServerOptions::usage();
             return 1;
         }
 
-        auto const address = net::ip::make_address("0.0.0.0");
-        auto const port = static_cast<unsigned short>(std::atoi(argv[1]));
-        int num_threads = 1;
-        if (argc == 3) {
-            num_threads = std::max<int>(1, std::atoi(argv[2]));
+        auto const address = net::ip::make_address(options.address);
+        auto const port = options.port;
+        int num_threads = options.num_threads;
+        std::cout << "Accepted sockets: " << SocketTuning::describe(options) << std::endl;
+
+        // CPUs for each I/O thread; a thread that cannot be pinned runs anywhere
+        auto const placement = CpuPlacement::plan(options, static_cast<std::size_t>(num_threads));
+        auto const place_thread = [&placement](std::size_t index) {
+            if (auto const ec = CpuPlacement::pin_current_thread(placement[index])) {
+                std::cerr << "Cannot pin I/O thread " << index << ": " << ec.message() << std::endl;
+            }
+        };
+        std::cout << "Placement: " << CpuPlacement::describe(options, placement.size()) << std::endl;
+        std::chrono::microseconds const busy_poll(options.busy_poll_us);
+        if (busy_poll.count() > 0) {
+            std::cout << "Run mode: I/O threads busy-poll for " << options.busy_poll_us << " us before sleeping"
+                      << std::endl;
         }
 
+        if (options.io_model == ServerOptions::IoModel::per_thread) {
+            // One io_context per thread; each connection stays on one of them
+            IoContextPool pool(static_cast<std::size_t>(num_threads));
+            pool.set_busy_poll(busy_poll);
+            ChatServer server(pool, tcp::endpoint{address, port}, options);
+            server.run();
+            std::cout << "WebSocket Chat Server started on address " << address.to_string()
+                      << " port " << port << " with " << num_threads << " thread(s), one io_context each,"
+                      << " on the " << options.io_backend << " backend." << std::endl;
+            pool.run(place_thread);
+            std::cout << "Server shutting down." << std::endl;
+            return 0;
+        }
 
         // The io_context is required for all I/O
         net::io_context ioc{num_threads};
@@ -35,20 +67,22 @@ int main(int argc, char* argv[]) {
         // rely on shared_from_this patterns indirectly, or if Sessions need to keep ChatServer alive.
         // For now, ChatServer itself doesn't use enable_shared_from_this, but Sessions it creates do.
         // Storing it as a shared_ptr is safer for lifetime management with async operations.
-        auto server = std::make_shared<ChatServer>(ioc, tcp::endpoint{address, port});
+        auto server = std::make_shared<ChatServer>(ioc, tcp::endpoint{address, port}, options);
         server->run(); // This typically calls do_accept()
 
         std::cout << "WebSocket Chat Server started on address " << address.to_string()
-                  << " port " << port << " with " << num_threads << " thread(s)." << std::endl;
+                  << " port " << port << " with " << num_threads << " thread(s)"
+                  << " on the " << options.io_backend << " backend." << std::endl;
 
         // Run the I/O service on the requested number of threads
         std::vector<std::thread> v;
         v.reserve(num_threads > 0 ? num_threads -1 : 0); // Ensure num_threads-1 is not negative
         for(auto i = num_threads - 1; i > 0; --i) { // Only create threads if num_threads > 1
             v.emplace_back(
-                [&ioc] {
+                [&ioc, &place_thread, busy_poll, i] {
+                    place_thread(static_cast<std::size_t>(i));
                     try {
-                        ioc.run();
+                        BusyPoll::run(ioc, busy_poll);
                     } catch (const std::exception& e_thread) {
                         std::cerr << "Exception in worker thread: " << e_thread.what() << std::endl;
                     }
@@ -57,7 +91,8 @@ int main(int argc, char* argv[]) {
 
         // Main thread also runs ioc.run() if num_threads >= 1
         if (num_threads > 0) {
-            ioc.run();
+            place_thread(0);
+            BusyPoll::run(ioc, busy_poll);
         } else { // Should not happen with std::max(1, ...) but as a safeguard
             std::cerr << "Error: Number of threads must be at least 1." << std::endl;
             return 1;
@@ -26,6 +26,11 @@ public:
     MOCK_METHOD(void, write, (const net::const_buffer& buffer, beast::error_code& ec), (override));
     MOCK_METHOD(std::size_t, read, (beast::flat_buffer& buffer, beast::error_code& ec), (override));
     MOCK_METHOD(void, close, (beast::websocket::close_code code, beast::error_code& ec), (override));
+    MOCK_METHOD(void, async_read, (beast::flat_buffer& buffer, IoHandler handler), (override));
+    MOCK_METHOD(void, async_write, (const net::const_buffer& buffer, IoHandler handler), (override));
+    MOCK_METHOD(void, async_close, (beast::websocket::close_code code, std::function<void(beast::error_code)> handler), (override));
+    MOCK_METHOD(void, begin_batch, (), (override));
+    MOCK_METHOD(void, end_batch, (), (override));
 };
 
 #endif // MOCKWEBSOCKETSTREAM_HPP
@@ -0,0 +1,177 @@
+#include "gtest/gtest.h"
+#include "AdminChannel.hpp"
+#include "ChatServer.hpp"
+#include "Profiler.hpp"
+#include "Session.hpp"
+#include "SimulatedStream.hpp"
+#include <boost/asio/use_future.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Outside the anonymous namespace, so the profiles can name them from the
+// dynamic symbol table.
+__attribute__((noinline)) void AdminTestBusyLoop(const std::atomic<bool>& stop) {
+    volatile std::uint64_t x = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        x = x * 31 + 7;
+    }
+}
+
+__attribute__((noinline)) void AdminTestAllocate(const std::atomic<bool>& stop) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        auto block = std::make_unique<std::vector<char>>(4096);
+        (*block)[0] = 1;
+    }
+}
+
+namespace {
+
+class AdminChannelTest : public ::testing::Test {
+protected:
+    using Client = websocket::stream<SimulatedStream>;
+
+    void SetUp() override {
+        options_.presence_tick_ms = 0;
+        options_.admin_socket = "/tmp/chat-admin-test-" + std::to_string(::getpid()) + ".sock";
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+        client_thread_ = std::thread([this] { client_ioc_.run(); });
+    }
+
+    void TearDown() override {
+        clients_.clear();
+        client_guard_.reset();
+        client_ioc_.stop();
+        client_thread_.join();
+        server_guard_.reset();
+        server_ioc_.stop();
+        server_thread_.join();
+        server_.reset(); // Removes the socket file
+        std::cout.rdbuf(cout_buf_);
+        std::cerr.rdbuf(cerr_buf_);
+    }
+
+    // Sends one admin command and returns the whole reply
+    std::string command(const std::string& line) {
+        net::io_context ioc;
+        net::local::stream_protocol::socket socket(ioc);
+        socket.connect(net::local::stream_protocol::endpoint(options_.admin_socket));
+        net::write(socket, net::buffer(line + "\n"));
+        std::string reply;
+        boost::system::error_code ec;
+        net::read(socket, net::dynamic_buffer(reply), ec);
+        EXPECT_EQ(ec, net::error::eof);
+        return reply;
+    }
+
+    // A simulated client whose link holds `link_bytes`; it reads nothing
+    // after the handshake, so its session's queue fills up.
+    Client& connect(std::size_t link_bytes) {
+        SimulatedStream::Link link;
+        link.buffer_bytes = link_bytes;
+        auto ends = SimulatedStream::make_pair(client_ioc_.get_executor(), net::make_strand(server_ioc_), link);
+        server_->connect_simulated(server_ioc_, std::move(ends.second));
+        clients_.push_back(std::make_unique<Client>(std::move(ends.first)));
+        clients_.back()->async_handshake("127.0.0.1", "/", net::use_future).get();
+        return *clients_.back();
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::streambuf* cerr_buf_ = std::cerr.rdbuf(nullptr);
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> client_guard_ = net::make_work_guard(client_ioc_);
+    std::thread client_thread_;
+    std::vector<std::unique_ptr<Client>> clients_;
+};
+
+std::size_t number_after(const std::string& text, const std::string& label) {
+    auto const at = text.find(label);
+    return at == std::string::npos ? 0 : std::stoul(text.substr(at + label.size()));
+}
+
+} // namespace
+
+TEST_F(AdminChannelTest, SocketIsForTheServersUserOnly) {
+    struct stat info {};
+    ASSERT_EQ(::stat(options_.admin_socket.c_str(), &info), 0);
+    EXPECT_TRUE(S_ISSOCK(info.st_mode));
+    EXPECT_EQ(info.st_mode & 0777, 0600u);
+    server_.reset();
+    EXPECT_NE(::stat(options_.admin_socket.c_str(), &info), 0); // Removed on shutdown
+}
+
+TEST_F(AdminChannelTest, AnswersHelpAndRejectsUnknownCommands) {
+    EXPECT_NE(command("help").find("cpu-profile"), std::string::npos);
+    auto const reply = command("reboot now");
+    EXPECT_NE(reply.find("Unknown command: reboot"), std::string::npos) << reply;
+    EXPECT_NE(command("stats").find("\"sessions\""), std::string::npos);
+    EXPECT_NE(command("cpu-profile 0").find("must be"), std::string::npos);
+}
+
+TEST_F(AdminChannelTest, SessionsReportsQueueDepths) {
+    EXPECT_NE(command("sessions").find("sessions: 0 (0 answered)"), std::string::npos);
+
+    constexpr int kMessages = 20;
+    auto& sender = connect(1024);
+    connect(1024);
+    connect(1024);
+    std::string const text(2000, 'q');
+    for (int i = 0; i < kMessages; ++i) {
+        sender.async_write(net::buffer(R"({"type":"client_send_message","payload":{"text":")" + text + "\"}}"),
+                           net::use_future)
+            .get();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Let the server queue everything
+
+    auto const reply = command("sessions 2");
+    EXPECT_NE(reply.find("sessions: 3 (3 answered)"), std::string::npos) << reply;
+    // Each client can take in about one message; the rest waits in its queue
+    EXPECT_GE(number_after(reply, "queued messages: "), 3u * (kMessages - 3)) << reply;
+    EXPECT_GE(number_after(reply, "queued bytes: "), 3u * (kMessages - 3) * text.size()) << reply;
+    EXPECT_GE(number_after(reply, " chat="), 3u * (kMessages - 3)) << reply;
+    EXPECT_NE(reply.find("top 2 by bytes queued"), std::string::npos) << reply;
+}
+
+TEST_F(AdminChannelTest, CpuProfileFindsTheBusyFunction) {
+    std::atomic<bool> stop{false};
+    std::thread busy([&stop] { AdminTestBusyLoop(stop); });
+    auto const reply = command("cpu-profile 1 250");
+    stop = true;
+    busy.join();
+    EXPECT_NE(reply.find("CPU profile: "), std::string::npos) << reply;
+    EXPECT_GT(number_after(reply, "samples: "), 0u) << reply;
+    EXPECT_NE(reply.find("AdminTestBusyLoop"), std::string::npos) << reply;
+    EXPECT_FALSE(CpuProfiler::running());
+}
+
+TEST_F(AdminChannelTest, HeapProfileFindsTheAllocatingFunction) {
+    ASSERT_TRUE(HeapProfiler::hooks_linked());
+    std::atomic<bool> stop{false};
+    std::thread allocating([&stop] { AdminTestAllocate(stop); });
+    auto const reply = command("heap-profile 1 262144");
+    stop = true;
+    allocating.join();
+    EXPECT_NE(reply.find("Heap profile: "), std::string::npos) << reply;
+    EXPECT_GT(number_after(reply, "samples: "), 0u) << reply;
+    EXPECT_NE(reply.find("AdminTestAllocate"), std::string::npos) << reply;
+    EXPECT_FALSE(HeapProfiler::running());
+}
+
+TEST_F(AdminChannelTest, OneProfileAtATime) {
+    ASSERT_TRUE(CpuProfiler::start(100));
+    EXPECT_NE(command("cpu-profile 1").find("Cannot start a CPU profile"), std::string::npos);
+    EXPECT_NE(CpuProfiler::stop().find("CPU profile: "), std::string::npos);
+}
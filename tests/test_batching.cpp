@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include "ChatClient.hpp"
+#include "ChatServer.hpp"
+#include <boost/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace json = boost::json;
+
+namespace {
+
+// Records every frame a client receives, split into the protocol messages it
+// carries (a batch frame is a JSON array of messages).
+struct FrameLog {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t frames = 0;
+    std::size_t batch_frames = 0;
+    std::vector<json::object> messages;
+
+    void on_frame(const std::string& frame) {
+        auto const value = json::parse(frame);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++frames;
+        if (value.is_array()) {
+            ++batch_frames;
+            for (auto const& item : value.as_array()) {
+                messages.push_back(item.as_object());
+            }
+        } else {
+            messages.push_back(value.as_object());
+        }
+        cv.notify_all();
+    }
+
+    // Waits until `count` messages of `type` have arrived.
+    bool wait_for(const std::string& type, std::size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(10), [&] { return of_type(type).size() >= count; });
+    }
+
+    std::vector<json::object> of_type(const std::string& type) const {
+        std::vector<json::object> out;
+        for (auto const& m : messages) {
+            if (m.at("type").as_string() == type.c_str()) {
+                out.push_back(m);
+            }
+        }
+        return out;
+    }
+};
+
+class BatchingTest : public ::testing::Test {
+protected:
+    void start_server(int window_ms, std::size_t max_bytes) {
+        options_.batch_window_ms = window_ms;
+        options_.batch_max_bytes = max_bytes;
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+    }
+
+    ChatClient* connect(FrameLog& log) {
+        clients_.push_back(
+            std::make_unique<ChatClient>("127.0.0.1", std::to_string(server_->local_endpoint().port())));
+        ChatClient* client = clients_.back().get();
+        EXPECT_TRUE(client->is_connected());
+        client->start([&log](const std::string& frame) { log.on_frame(frame); });
+        client_threads_.emplace_back([client] { client->io_context().run(); });
+        return client;
+    }
+
+    void TearDown() override {
+        for (auto& client : clients_) {
+            client->async_close();
+        }
+        for (auto& t : client_threads_) {
+            t.join();
+        }
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+    }
+
+    static std::string chat(int i) {
+        return "{\"type\":\"client_send_message\",\"payload\":{\"text\":\"m" + std::to_string(i) + "\"}}";
+    }
+
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    FrameLog receiver_log_;
+    FrameLog sender_log_;
+    std::vector<std::unique_ptr<ChatClient>> clients_;
+    std::vector<std::thread> client_threads_;
+};
+
+} // namespace
+
+TEST_F(BatchingTest, NegotiatedBatchesCarryEveryMessageInOrder) {
+    start_server(50, 16384);
+    ChatClient* receiver = connect(receiver_log_);
+    ChatClient* sender = connect(sender_log_);
+
+    receiver->post("{\"type\":\"client_enable_batching\",\"payload\":{\"window_ms\":40}}");
+    ASSERT_TRUE(receiver_log_.wait_for("server_batching_status", 1));
+    {
+        std::lock_guard<std::mutex> lock(receiver_log_.mutex);
+        auto const status = receiver_log_.of_type("server_batching_status").front().at("payload").as_object();
+        EXPECT_TRUE(status.at("enabled").as_bool());
+        EXPECT_EQ(status.at("window_ms").as_int64(), 40);
+        EXPECT_EQ(status.at("max_bytes").as_int64(), 16384);
+    }
+
+    constexpr int kMessages = 50;
+    for (int i = 0; i < kMessages; ++i) {
+        sender->post(chat(i));
+    }
+    ASSERT_TRUE(receiver_log_.wait_for("server_broadcast_message", kMessages));
+    ASSERT_TRUE(sender_log_.wait_for("server_broadcast_message", kMessages));
+
+    std::lock_guard<std::mutex> lock(receiver_log_.mutex);
+    auto const chats = receiver_log_.of_type("server_broadcast_message");
+    for (int i = 0; i < kMessages; ++i) {
+        EXPECT_EQ(chats[i].at("payload").as_object().at("text").as_string(), ("m" + std::to_string(i)).c_str());
+    }
+    EXPECT_GT(receiver_log_.batch_frames, 0u);
+    EXPECT_LT(receiver_log_.frames, receiver_log_.messages.size());
+
+    // The sender never opted in, so it still gets one frame per message.
+    std::lock_guard<std::mutex> sender_lock(sender_log_.mutex);
+    EXPECT_EQ(sender_log_.batch_frames, 0u);
+}
+
+TEST_F(BatchingTest, RequestIsClampedToServerLimits) {
+    start_server(5, 1024);
+    ChatClient* client = connect(receiver_log_);
+
+    client->post("{\"type\":\"client_enable_batching\",\"payload\":{\"window_ms\":500,\"max_bytes\":1000000}}");
+    ASSERT_TRUE(receiver_log_.wait_for("server_batching_status", 1));
+    std::lock_guard<std::mutex> lock(receiver_log_.mutex);
+    auto const status = receiver_log_.of_type("server_batching_status").front().at("payload").as_object();
+    EXPECT_EQ(status.at("window_ms").as_int64(), 5);
+    EXPECT_EQ(status.at("max_bytes").as_int64(), 1024);
+}
+
+TEST_F(BatchingTest, ServerWithoutBatchingRefuses) {
+    start_server(0, 16384);
+    ChatClient* client = connect(receiver_log_);
+
+    client->post("{\"type\":\"client_enable_batching\"}");
+    client->post(chat(1));
+    ASSERT_TRUE(receiver_log_.wait_for("server_broadcast_message", 1));
+    std::lock_guard<std::mutex> lock(receiver_log_.mutex);
+    auto const status = receiver_log_.of_type("server_batching_status");
+    ASSERT_EQ(status.size(), 1u);
+    EXPECT_FALSE(status.front().at("payload").as_object().at("enabled").as_bool());
+    EXPECT_EQ(receiver_log_.batch_frames, 0u);
+}
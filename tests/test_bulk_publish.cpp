@@ -0,0 +1,216 @@
+#include "gtest/gtest.h"
+#include "BulkPublish.hpp"
+#include "ChatServer.hpp"
+#include "CoroSession.hpp"
+#include "Session.hpp"
+#include <boost/json.hpp>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace json = boost::json;
+
+ServerOptions parse(std::vector<std::string> args) {
+    std::vector<char*> argv;
+    for (auto& a : args) {
+        argv.push_back(a.data());
+    }
+    return ServerOptions::parse(static_cast<int>(argv.size()), argv.data());
+}
+
+class BulkPublishTest : public ::testing::TestWithParam<ServerOptions::SessionEngine> {
+protected:
+    using Client = websocket::stream<tcp::socket>;
+
+    void SetUp() override {
+        options_.presence_tick_ms = 0;
+        options_.session_engine = GetParam();
+        options_.publish_token = "s3cret";
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+    }
+
+    void TearDown() override {
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+        server_.reset();
+        std::cout.rdbuf(cout_buf_);
+        std::cerr.rdbuf(cerr_buf_);
+    }
+
+    std::unique_ptr<Client> connect() {
+        auto client = std::make_unique<Client>(client_ioc_);
+        client->next_layer().connect(server_->local_endpoint());
+        client->handshake("127.0.0.1", "/");
+        return client;
+    }
+
+    http::response<http::string_body> request(http::verb method, const std::string& body,
+                                              const std::string& authorization = "Bearer s3cret") {
+        tcp::socket socket(client_ioc_);
+        socket.connect(server_->local_endpoint());
+        http::request<http::string_body> req{method, "/publish", 11};
+        req.set(http::field::host, "127.0.0.1");
+        if (!authorization.empty()) {
+            req.set(http::field::authorization, authorization);
+        }
+        req.body() = body;
+        req.prepare_payload();
+        http::write(socket, req);
+        beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res);
+        return res;
+    }
+
+    // Reads frames until one contains `text`
+    static std::string read_until(Client& client, const std::string& text) {
+        for (;;) {
+            beast::flat_buffer buffer;
+            client.read(buffer);
+            auto frame = beast::buffers_to_string(buffer.data());
+            if (frame.find(text) != std::string::npos) {
+                return frame;
+            }
+        }
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::streambuf* cerr_buf_ = std::cerr.rdbuf(nullptr);
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+};
+
+} // namespace
+
+TEST(BulkPublishParseTest, ReadsNdjsonAndArrays) {
+    BulkPublish::Batch ndjson;
+    std::string error;
+    ASSERT_TRUE(BulkPublish::parse("{\"text\":\"one\"}\r\n\n{\"text\":\"two\",\"user_id\":\"ci\",\"nickname\":\"CI\"}\n"
+                                   "not json\n[1]\n{\"text\":3}\n",
+                                   ndjson, error));
+    ASSERT_EQ(ndjson.messages.size(), 2u);
+    EXPECT_EQ(ndjson.messages[0].user_id, "publisher");
+    EXPECT_EQ(ndjson.messages[0].nickname, "publisher");
+    EXPECT_EQ(ndjson.messages[0].text, "one");
+    EXPECT_EQ(ndjson.messages[1].user_id, "ci");
+    EXPECT_EQ(ndjson.messages[1].nickname, "CI");
+    ASSERT_EQ(ndjson.errors.size(), 5u); // The blank line is not an item
+    EXPECT_TRUE(ndjson.errors[0].empty());
+    EXPECT_TRUE(ndjson.errors[1].empty());
+    EXPECT_NE(ndjson.errors[2].find("invalid JSON"), std::string::npos);
+    EXPECT_EQ(ndjson.errors[3], "not a JSON object");
+    EXPECT_EQ(ndjson.errors[4], "missing or invalid \"text\"");
+
+    BulkPublish::Batch array;
+    ASSERT_TRUE(BulkPublish::parse(" [{\"text\":\"a\"}, {\"text\":\"b\",\"nickname\":\"\"}]", array, error));
+    ASSERT_EQ(array.messages.size(), 1u);
+    EXPECT_EQ(array.errors[1], "invalid \"nickname\"");
+
+    BulkPublish::Batch rejected;
+    EXPECT_FALSE(BulkPublish::parse("[{\"text\":\"a\"}", rejected, error));
+    EXPECT_NE(error.find("invalid JSON array"), std::string::npos);
+    EXPECT_FALSE(BulkPublish::parse(" \n\n", rejected, error));
+    EXPECT_EQ(error, "no messages");
+}
+
+TEST(BulkPublishParseTest, ChecksTheBearerToken) {
+    EXPECT_TRUE(BulkPublish::authorized("Bearer s3cret", "s3cret"));
+    EXPECT_FALSE(BulkPublish::authorized("Bearer s3creT", "s3cret"));
+    EXPECT_FALSE(BulkPublish::authorized("Bearer s3cret2", "s3cret"));
+    EXPECT_FALSE(BulkPublish::authorized("Basic s3cret", "s3cret"));
+    EXPECT_FALSE(BulkPublish::authorized("Bearer ", ""));
+
+    EXPECT_TRUE(parse({"server", "8080"}).publish_token.empty());
+    EXPECT_EQ(parse({"server", "8080", "--publish-token=abc"}).publish_token, "abc");
+}
+
+TEST_P(BulkPublishTest, PublishesABatchInOrder) {
+    auto client = connect();
+    auto const res = request(http::verb::post,
+                             "{\"text\":\"bulk one\",\"user_id\":\"ci\",\"nickname\":\"CI\"}\n"
+                             "{\"text\":\"bulk two\"}\n{\"text\":\"bulk three\"}\n");
+    ASSERT_EQ(res.result(), http::status::ok) << res.body();
+    auto const body = json::parse(res.body()).as_object();
+    EXPECT_EQ(body.at("published").as_int64(), 3);
+    EXPECT_EQ(body.at("rejected").as_int64(), 0);
+    auto const& results = body.at("results").as_array();
+    ASSERT_EQ(results.size(), 3u);
+    auto const first = results[0].as_object().at("seq").as_int64();
+    EXPECT_EQ(results[1].as_object().at("seq").as_int64(), first + 1);
+    EXPECT_EQ(results[2].as_object().at("seq").as_int64(), first + 2);
+
+    // Clients see them in order, as chat from the posted identities
+    auto const one = json::parse(read_until(*client, "bulk")).as_object();
+    EXPECT_EQ(one.at("seq").as_int64(), first);
+    EXPECT_EQ(one.at("type").as_string(), "server_broadcast_message");
+    EXPECT_EQ(one.at("payload").as_object().at("text").as_string(), "bulk one");
+    EXPECT_EQ(one.at("payload").as_object().at("nickname").as_string(), "CI");
+    auto const two = json::parse(read_until(*client, "bulk")).as_object();
+    EXPECT_EQ(two.at("payload").as_object().at("text").as_string(), "bulk two");
+    EXPECT_EQ(two.at("payload").as_object().at("user_id").as_string(), "publisher");
+    auto const three = json::parse(read_until(*client, "bulk")).as_object();
+    EXPECT_EQ(three.at("seq").as_int64(), first + 2);
+
+    auto const stats = json::parse(server_->stats_json()).as_object();
+    EXPECT_EQ(stats.at("publish").as_object().at("messages").as_int64(), 3);
+    client->close(websocket::close_code::normal);
+}
+
+TEST_P(BulkPublishTest, ReportsRejectedItemsOfAnArray) {
+    auto client = connect();
+    auto const res = request(http::verb::post, "[{\"text\":\"kept\"}, {\"nickname\":\"x\"}, 7, {\"text\":\"also kept\"}]");
+    ASSERT_EQ(res.result(), http::status::ok) << res.body();
+    auto const body = json::parse(res.body()).as_object();
+    EXPECT_EQ(body.at("published").as_int64(), 2);
+    EXPECT_EQ(body.at("rejected").as_int64(), 2);
+    auto const& results = body.at("results").as_array();
+    ASSERT_EQ(results.size(), 4u);
+    EXPECT_TRUE(results[0].as_object().contains("seq"));
+    EXPECT_EQ(results[1].as_object().at("error").as_string(), "missing or invalid \"text\"");
+    EXPECT_EQ(results[2].as_object().at("error").as_string(), "not a JSON object");
+    EXPECT_EQ(results[3].as_object().at("seq").as_int64(), results[0].as_object().at("seq").as_int64() + 1);
+
+    read_until(*client, "\"kept\"");
+    read_until(*client, "also kept");
+    client->close(websocket::close_code::normal);
+}
+
+TEST_P(BulkPublishTest, RejectsBadRequests) {
+    EXPECT_EQ(request(http::verb::post, "{\"text\":\"x\"}", "").result(), http::status::unauthorized);
+    EXPECT_EQ(request(http::verb::post, "{\"text\":\"x\"}", "Bearer wrong").result(), http::status::unauthorized);
+    EXPECT_EQ(request(http::verb::get, "").result(), http::status::method_not_allowed);
+    auto const malformed = request(http::verb::post, "[{\"text\":");
+    EXPECT_EQ(malformed.result(), http::status::bad_request);
+    EXPECT_NE(malformed.body().find("invalid JSON array"), std::string::npos);
+    EXPECT_EQ(request(http::verb::post, "").result(), http::status::bad_request);
+
+    auto const stats = json::parse(server_->stats_json()).as_object();
+    EXPECT_EQ(stats.at("publish").as_object().at("batches").as_int64(), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, BulkPublishTest,
+                         ::testing::Values(ServerOptions::SessionEngine::callback
+#if defined(CHAT_HAS_CORO_SESSION)
+                                           ,
+                                           ServerOptions::SessionEngine::coroutine
+#endif
+                                           ),
+                         [](const ::testing::TestParamInfo<ServerOptions::SessionEngine>& info) {
+                             return std::string(info.param == ServerOptions::SessionEngine::callback ? "callback"
+                                                                                                      : "coroutine");
+                         });
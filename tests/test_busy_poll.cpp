@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+#include "BusyPoll.hpp"
+#include "ServerOptions.hpp"
+#include "SocketTuning.hpp"
+#include <boost/asio.hpp>
+#include <boost/asio/detail/socket_option.hpp>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+ServerOptions parse(std::vector<std::string> args) {
+    std::vector<char*> argv;
+    for (auto& a : args) {
+        argv.push_back(a.data());
+    }
+    return ServerOptions::parse(static_cast<int>(argv.size()), argv.data());
+}
+
+std::chrono::nanoseconds thread_cpu_time() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+}
+
+} // namespace
+
+TEST(BusyPollTest, ReturnsOnceOutOfWorkLikeRun) {
+    net::io_context ioc;
+    int ran = 0;
+    for (int i = 0; i < 10; ++i) {
+        net::post(ioc, [&ran, &ioc] {
+            // Handlers posted by handlers run in the same call
+            net::post(ioc, [&ran] { ++ran; });
+            ++ran;
+        });
+    }
+    EXPECT_EQ(BusyPoll::run(ioc, std::chrono::microseconds(200)), 20u);
+    EXPECT_EQ(ran, 20);
+    EXPECT_TRUE(ioc.stopped());
+}
+
+TEST(BusyPollTest, RunsWorkPostedFromOtherThreadsUntilStopped) {
+    net::io_context ioc;
+    auto guard = net::make_work_guard(ioc);
+    std::thread loop([&ioc] { BusyPoll::run(ioc, std::chrono::microseconds(500)); });
+
+    for (int i = 0; i < 50; ++i) {
+        std::promise<std::thread::id> ran_on;
+        net::post(ioc, [&ran_on] { ran_on.set_value(std::this_thread::get_id()); });
+        EXPECT_EQ(ran_on.get_future().get(), loop.get_id());
+        // Alternate between the spinning window and the blocking wait
+        std::this_thread::sleep_for(std::chrono::microseconds(i % 2 ? 50 : 2000));
+    }
+    ioc.stop();
+    loop.join();
+}
+
+TEST(BusyPollTest, SleepsOnceTheWindowPasses) {
+    net::io_context ioc;
+    auto guard = net::make_work_guard(ioc);
+    std::chrono::nanoseconds cpu{};
+    std::thread loop([&ioc, &cpu] {
+        auto const start = thread_cpu_time();
+        BusyPoll::run(ioc, std::chrono::milliseconds(2));
+        cpu = thread_cpu_time() - start;
+    });
+    net::post(ioc, [] {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ioc.stop();
+    loop.join();
+    // About 2 ms of spinning after the handler, then asleep in the reactor
+    EXPECT_LT(cpu, std::chrono::milliseconds(100));
+}
+
+TEST(BusyPollTest, ParsesBusyPollFlags) {
+    auto const defaults = parse({"server", "8080"});
+    EXPECT_EQ(defaults.busy_poll_us, 0);
+    EXPECT_EQ(defaults.socket_busy_poll_us, 0);
+
+    auto const polling = parse({"server", "8080", "--busy-poll-us=50", "--socket-busy-poll-us=25"});
+    EXPECT_EQ(polling.busy_poll_us, 50);
+    EXPECT_EQ(polling.socket_busy_poll_us, 25);
+    EXPECT_NE(SocketTuning::describe(polling).find("busy_poll_us=25"), std::string::npos);
+
+    EXPECT_THROW(parse({"server", "8080", "--busy-poll-us=-1"}), std::invalid_argument);
+    EXPECT_THROW(parse({"server", "8080", "--socket-busy-poll-us=x"}), std::invalid_argument);
+}
+
+#if defined(SO_BUSY_POLL)
+TEST(BusyPollTest, AppliesSoBusyPollToAcceptedSockets) {
+    net::io_context ioc;
+    tcp::acceptor acceptor(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0});
+    tcp::socket client(ioc);
+    client.connect(acceptor.local_endpoint());
+    tcp::socket accepted = acceptor.accept();
+
+    ServerOptions options;
+    options.socket_busy_poll_us = 25;
+    auto const ec = SocketTuning::apply(accepted, options);
+    if (ec == boost::system::errc::operation_not_permitted) {
+        GTEST_SKIP() << "Raising SO_BUSY_POLL above net.core.busy_read needs CAP_NET_ADMIN";
+    }
+    ASSERT_FALSE(ec) << ec.message();
+    net::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL> busy_poll;
+    accepted.get_option(busy_poll);
+    EXPECT_EQ(busy_poll.value(), 25);
+}
+#endif
@@ -0,0 +1,182 @@
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "ChatClient.hpp"
+#include "ChatServer.hpp"
+#include "MockWebSocketStream.hpp"
+#include <boost/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace json = boost::json;
+
+// Test fixture for the asynchronous API over a mocked stream
+class ChatClientAsyncMockedTest : public ::testing::Test {
+protected:
+    NiceMock<MockWebSocketStream>* raw_mock_stream_ptr;
+    net::io_context test_ioc;
+    std::unique_ptr<ChatClient> client;
+
+    void SetUp() override {
+        auto unique_mock_stream = std::make_unique<NiceMock<MockWebSocketStream>>();
+        raw_mock_stream_ptr = unique_mock_stream.get();
+        ON_CALL(*raw_mock_stream_ptr, is_open()).WillByDefault(Return(true));
+        client = std::make_unique<ChatClient>(std::move(unique_mock_stream), test_ioc);
+        ASSERT_TRUE(client->is_connected());
+    }
+};
+
+TEST_F(ChatClientAsyncMockedTest, ReadLoopDeliversEveryInboundMessage) {
+    IWebSocketStream::IoHandler pending_read;
+    beast::flat_buffer* read_buffer = nullptr;
+    EXPECT_CALL(*raw_mock_stream_ptr, async_read(_, _))
+        .Times(3)
+        .WillRepeatedly(Invoke([&](beast::flat_buffer& buffer, IWebSocketStream::IoHandler handler) {
+            read_buffer = &buffer;
+            pending_read = std::move(handler);
+        }));
+
+    std::vector<std::string> received;
+    client->start([&](const std::string& message) { received.push_back(message); });
+    test_ioc.run();
+
+    for (std::string const text : {"first", "second"}) {
+        ASSERT_TRUE(pending_read);
+        auto handler = std::move(pending_read);
+        auto const n = net::buffer_copy(read_buffer->prepare(text.size()), net::buffer(text));
+        read_buffer->commit(n);
+        handler({}, n);
+    }
+
+    EXPECT_EQ(received, (std::vector<std::string>{"first", "second"}));
+}
+
+TEST_F(ChatClientAsyncMockedTest, ServerCloseIsReportedOnce) {
+    EXPECT_CALL(*raw_mock_stream_ptr, async_read(_, _))
+        .WillOnce(Invoke([](beast::flat_buffer&, IWebSocketStream::IoHandler handler) {
+            handler(beast::websocket::error::closed, 0);
+        }));
+
+    std::vector<beast::error_code> errors;
+    client->start([](const std::string&) {}, [&](beast::error_code ec) { errors.push_back(ec); });
+    test_ioc.run();
+
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_EQ(errors.front(), beast::websocket::error::closed);
+    EXPECT_FALSE(client->is_connected());
+}
+
+TEST_F(ChatClientAsyncMockedTest, QueuedMessagesArePipelinedInBatches) {
+    std::vector<std::string> written;
+    std::vector<std::string> calls;
+    ON_CALL(*raw_mock_stream_ptr, begin_batch()).WillByDefault(Invoke([&] { calls.push_back("begin"); }));
+    ON_CALL(*raw_mock_stream_ptr, end_batch()).WillByDefault(Invoke([&] { calls.push_back("end"); }));
+    EXPECT_CALL(*raw_mock_stream_ptr, async_write(_, _))
+        .Times(5)
+        .WillRepeatedly(Invoke([&](const net::const_buffer& buffer, IWebSocketStream::IoHandler handler) {
+            written.emplace_back(static_cast<const char*>(buffer.data()), buffer.size());
+            calls.push_back("write");
+            handler({}, buffer.size());
+        }));
+
+    client->set_max_batch(2);
+    for (int i = 0; i < 5; ++i) {
+        client->post("m" + std::to_string(i));
+    }
+    test_ioc.run();
+
+    EXPECT_EQ(written, (std::vector<std::string>{"m0", "m1", "m2", "m3", "m4"}));
+    EXPECT_EQ(calls, (std::vector<std::string>{"begin", "write", "write", "end", "begin", "write", "write", "end",
+                                               "begin", "write", "end"}));
+    EXPECT_EQ(client->messages_sent(), 5u);
+    EXPECT_EQ(client->batches_flushed(), 3u);
+}
+
+TEST_F(ChatClientAsyncMockedTest, CloseWaitsForQueuedMessages) {
+    std::vector<std::string> calls;
+    ON_CALL(*raw_mock_stream_ptr, async_write(_, _))
+        .WillByDefault(Invoke([&](const net::const_buffer& buffer, IWebSocketStream::IoHandler handler) {
+            calls.push_back("write");
+            handler({}, buffer.size());
+        }));
+    EXPECT_CALL(*raw_mock_stream_ptr, async_close(beast::websocket::close_code::normal, _))
+        .WillOnce(Invoke([&](beast::websocket::close_code, std::function<void(beast::error_code)> handler) {
+            calls.push_back("close");
+            handler({});
+        }));
+
+    client->post("a");
+    client->post("b");
+    client->async_close();
+    test_ioc.run();
+
+    EXPECT_EQ(calls, (std::vector<std::string>{"write", "write", "close"}));
+    EXPECT_FALSE(client->is_connected());
+}
+
+// Full-duplex round trip through a real server: one client streams messages
+// while another receives the broadcasts, each on its own io_context thread.
+TEST(ChatClientAsyncIntegrationTest, StreamsThousandsOfMessagesInOrder) {
+    constexpr int kMessages = 2000;
+
+    net::io_context server_ioc;
+    ChatServer server(server_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0});
+    server.run();
+    auto server_guard = net::make_work_guard(server_ioc);
+    std::thread server_thread([&] { server_ioc.run(); });
+    auto const port = std::to_string(server.local_endpoint().port());
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::string> texts;
+
+    ChatClient receiver("127.0.0.1", port);
+    ChatClient sender("127.0.0.1", port);
+    ASSERT_TRUE(receiver.is_connected());
+    ASSERT_TRUE(sender.is_connected());
+
+    receiver.start([&](const std::string& message) {
+        auto const value = json::parse(message);
+        if (value.as_object().at("type").as_string() != "server_broadcast_message") {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        texts.emplace_back(value.as_object().at("payload").as_object().at("text").as_string().c_str());
+        cv.notify_all();
+    });
+    sender.start([](const std::string&) {});
+    std::thread receiver_thread([&] { receiver.io_context().run(); });
+    std::thread sender_thread([&] { sender.io_context().run(); });
+
+    for (int i = 0; i < kMessages; ++i) {
+        sender.post("{\"type\":\"client_send_message\",\"payload\":{\"text\":\"m" + std::to_string(i) + "\"}}");
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(30), [&] { return texts.size() >= kMessages; });
+    }
+
+    sender.async_close();
+    receiver.async_close();
+    sender_thread.join();
+    receiver_thread.join();
+    server_guard.reset();
+    server_ioc.stop();
+    server_thread.join();
+
+    ASSERT_EQ(texts.size(), static_cast<std::size_t>(kMessages));
+    for (int i = 0; i < kMessages; ++i) {
+        ASSERT_EQ(texts[i], "m" + std::to_string(i));
+    }
+    EXPECT_EQ(sender.messages_sent(), static_cast<std::uint64_t>(kMessages));
+}
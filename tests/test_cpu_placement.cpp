@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "CpuPlacement.hpp"
+#include "IoContextPool.hpp"
+#include "ServerOptions.hpp"
+#include "Session.hpp"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace {
+
+ServerOptions parse(std::vector<std::string> args) {
+    std::vector<char*> argv;
+    for (auto& a : args) {
+        argv.push_back(a.data());
+    }
+    return ServerOptions::parse(static_cast<int>(argv.size()), argv.data());
+}
+
+// A CPU this process may run on
+int allowed_cpu() {
+#if defined(__linux__)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                return cpu;
+            }
+        }
+    }
+#endif
+    return -1;
+}
+
+} // namespace
+
+TEST(CpuPlacementTest, ParsesCpuLists) {
+    EXPECT_EQ(CpuPlacement::parse_list("0-3,8,10-11"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(CpuPlacement::parse_list("5"), (std::vector<int>{5}));
+    EXPECT_EQ(CpuPlacement::parse_list("2,1,2"), (std::vector<int>{2, 1})); // Order kept, duplicates dropped
+    for (auto const* bad : {"", "3-1", "a", "1,,2", "1,", "-1", "1-"}) {
+        EXPECT_THROW(CpuPlacement::parse_list(bad), std::invalid_argument) << bad;
+    }
+}
+
+TEST(CpuPlacementTest, ParsesPlacementFlags) {
+    auto const defaults = parse({"server", "8080"});
+    EXPECT_TRUE(defaults.cpu_affinity.empty());
+    EXPECT_TRUE(defaults.numa_nodes.empty());
+    EXPECT_FALSE(defaults.reuseport);
+
+    auto const pinned = parse({"server", "8080", "4", "--cpu-affinity=0-1,4", "--io-model=per-thread",
+                               "--reuseport=on"});
+    EXPECT_EQ(pinned.cpu_affinity, (std::vector<int>{0, 1, 4}));
+    EXPECT_TRUE(pinned.reuseport);
+    EXPECT_EQ(parse({"server", "8080", "--numa-nodes=1,0"}).numa_nodes, (std::vector<int>{1, 0}));
+
+    EXPECT_THROW(parse({"server", "8080", "--cpu-affinity=x"}), std::invalid_argument);
+    EXPECT_THROW(parse({"server", "8080", "--cpu-affinity=0", "--numa-nodes=0"}), std::invalid_argument);
+    EXPECT_THROW(parse({"server", "8080", "--reuseport=on"}), std::invalid_argument); // Needs per-thread
+}
+
+TEST(CpuPlacementTest, PlansThreadsOntoCpusAndNodes) {
+    ServerOptions options;
+    EXPECT_EQ(CpuPlacement::plan(options, 2), (std::vector<std::vector<int>>{{}, {}}));
+
+    options.cpu_affinity = {3, 5};
+    EXPECT_EQ(CpuPlacement::plan(options, 3), (std::vector<std::vector<int>>{{3}, {5}, {3}}));
+
+    options.cpu_affinity.clear();
+    options.numa_nodes = {4095};
+    EXPECT_THROW(CpuPlacement::plan(options, 1), std::invalid_argument);
+
+    auto const node0 = CpuPlacement::node_cpus(0);
+    if (node0.empty()) {
+        GTEST_SKIP() << "No NUMA topology in sysfs";
+    }
+    options.numa_nodes = {0};
+    EXPECT_EQ(CpuPlacement::plan(options, 2), (std::vector<std::vector<int>>{node0, node0}));
+    EXPECT_EQ(CpuPlacement::node_of_cpu(node0.front()), 0);
+}
+
+TEST(CpuPlacementTest, PinsTheCallingThread) {
+    int const cpu = allowed_cpu();
+    if (cpu < 0) {
+        GTEST_SKIP() << "Thread affinity is not available";
+    }
+    std::thread pinned([cpu] {
+        ASSERT_FALSE(CpuPlacement::pin_current_thread({cpu}));
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(CpuPlacement::current_cpu(), cpu);
+            std::this_thread::yield();
+        }
+        EXPECT_FALSE(CpuPlacement::pin_current_thread({})); // Leaves the thread as it is
+        EXPECT_TRUE(CpuPlacement::pin_current_thread({CPU_SETSIZE}));
+    });
+    pinned.join();
+}
+
+TEST(CpuPlacementTest, ReusePortListenersServeTheirOwnConnections) {
+    int const cpu = allowed_cpu();
+    if (cpu < 0) {
+        GTEST_SKIP() << "Thread affinity is not available";
+    }
+    constexpr std::size_t kClients = 32;
+    IoContextPool pool(2);
+    ServerOptions options;
+    options.io_model = ServerOptions::IoModel::per_thread;
+    options.reuseport = true;
+    options.cpu_affinity = {cpu}; // Both listeners on one CPU: the kernel hashes between them
+    options.presence_tick_ms = 0;
+    auto* const cout_buf = std::cout.rdbuf(nullptr); // Per-connection logging
+    ChatServer server(pool, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    server.run();
+    std::thread pool_thread([&pool, &options] {
+        auto const cpus = CpuPlacement::plan(options, 2);
+        pool.run([&cpus](std::size_t index) { CpuPlacement::pin_current_thread(cpus[index]); });
+    });
+
+    net::io_context client_ioc;
+    std::vector<std::unique_ptr<websocket::stream<tcp::socket>>> clients;
+    for (std::size_t i = 0; i < kClients; ++i) {
+        clients.push_back(std::make_unique<websocket::stream<tcp::socket>>(client_ioc));
+        clients.back()->next_layer().connect(server.local_endpoint());
+        clients.back()->handshake("127.0.0.1", "/");
+    }
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (server.sessions().size() < kClients && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<std::size_t> per_context(pool.size());
+    for (auto const& session : server.sessions()) {
+        ++per_context[pool.index_of(session->context())];
+    }
+    clients.clear();
+    pool.stop();
+    pool_thread.join();
+    std::cout.rdbuf(cout_buf);
+
+    EXPECT_EQ(per_context[0] + per_context[1], kClients);
+    // Each listener accepted some of the connections for its own context
+    EXPECT_GT(per_context[0], 0u);
+    EXPECT_GT(per_context[1], 0u);
+}
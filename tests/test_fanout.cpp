@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "IoContextPool.hpp"
+#include "Session.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> g_delivered{0};
+
+// Records what the per-thread fan-out hands it and on which thread.
+class RecordingSession : public Session {
+public:
+    RecordingSession(net::io_context& ioc, ChatServer& server) : Session(ioc, tcp::socket(ioc), server) {}
+
+    void send(std::shared_ptr<const std::string> ss, Lane) override {
+        ++posted;
+        record(*ss);
+    }
+
+    void deliver(std::shared_ptr<const std::string> ss, Lane) override {
+        if (!context().get_executor().running_in_this_thread()) {
+            ++foreign_thread;
+        }
+        record(*ss);
+    }
+
+    std::vector<std::string> received;
+    std::atomic<int> posted{0};
+    std::atomic<int> foreign_thread{0};
+
+private:
+    void record(const std::string& message) {
+        received.push_back(message);
+        g_delivered.fetch_add(1, std::memory_order_release);
+    }
+};
+
+} // namespace
+
+TEST(IoContextPoolTest, HandsOutContextsRoundRobin) {
+    IoContextPool pool(3);
+    ASSERT_EQ(pool.size(), 3u);
+    std::vector<std::size_t> order;
+    for (int i = 0; i < 4; ++i) {
+        order.push_back(pool.index_of(pool.next()));
+    }
+    EXPECT_EQ(order, (std::vector<std::size_t>{0, 1, 2, 0}));
+
+    net::io_context foreign;
+    EXPECT_EQ(pool.index_of(foreign), pool.size());
+}
+
+TEST(FanOutTest, PerThreadBroadcastIsDeliveredOnEachOwningThreadInOrder) {
+    constexpr std::size_t kSessions = 3000; // Several chunks per thread
+
+    IoContextPool pool(2);
+    ServerOptions options;
+    options.io_model = ServerOptions::IoModel::per_thread;
+    options.presence_tick_ms = 3600 * 1000; // Keep presence traffic out of the counts
+    ChatServer server(pool, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    std::thread pool_thread([&pool] { pool.run(); });
+
+    auto* const cout_buf = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::vector<std::shared_ptr<RecordingSession>> sessions;
+    for (std::size_t i = 0; i < kSessions; ++i) {
+        sessions.push_back(std::make_shared<RecordingSession>(pool.next(), server));
+        server.on_client_connect(sessions.back());
+    }
+
+    g_delivered = 0;
+    server.broadcast("first");
+    server.broadcast("second");
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (g_delivered.load(std::memory_order_acquire) < 2 * kSessions
+           && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (auto const& session : sessions) {
+        server.on_client_disconnect(session);
+    }
+    std::cout.rdbuf(cout_buf);
+    pool.stop();
+    pool_thread.join();
+
+    ASSERT_EQ(g_delivered.load(), 2 * kSessions);
+    for (auto const& session : sessions) {
+        EXPECT_EQ(session->received, (std::vector<std::string>{"first", "second"}));
+        EXPECT_EQ(session->posted, 0) << "Fan-out fell back to a post per session";
+        EXPECT_EQ(session->foreign_thread, 0) << "Delivered on a thread that does not own the session";
+    }
+}
+
+TEST(FanOutTest, PerThreadPublishedBatchIsDeliveredInOrderOnTheOwningThread) {
+    constexpr std::size_t kSessions = 100;
+
+    IoContextPool pool(2);
+    ServerOptions options;
+    options.io_model = ServerOptions::IoModel::per_thread;
+    options.presence_tick_ms = 3600 * 1000;
+    ChatServer server(pool, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    std::thread pool_thread([&pool] { pool.run(); });
+
+    auto* const cout_buf = std::cout.rdbuf(nullptr);
+    std::vector<std::shared_ptr<RecordingSession>> sessions;
+    for (std::size_t i = 0; i < kSessions; ++i) {
+        sessions.push_back(std::make_shared<RecordingSession>(pool.next(), server));
+        server.on_client_connect(sessions.back());
+    }
+
+    g_delivered = 0;
+    auto const seqs = server.publish_batch({{"ci", "CI", "build 1"}, {"ci", "CI", "build 2"}, {"ci", "CI", "build 3"}});
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (g_delivered.load(std::memory_order_acquire) < 3 * kSessions
+           && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (auto const& session : sessions) {
+        server.on_client_disconnect(session);
+    }
+    std::cout.rdbuf(cout_buf);
+    pool.stop();
+    pool_thread.join();
+
+    ASSERT_EQ(seqs.size(), 3u);
+    EXPECT_EQ(seqs[2], seqs[0] + 2);
+    ASSERT_EQ(g_delivered.load(), 3 * kSessions);
+    for (auto const& session : sessions) {
+        ASSERT_EQ(session->received.size(), 3u);
+        for (std::size_t i = 0; i < 3; ++i) {
+            EXPECT_NE(session->received[i].find("build " + std::to_string(i + 1)), std::string::npos);
+        }
+        EXPECT_EQ(session->posted, 0);
+        EXPECT_EQ(session->foreign_thread, 0);
+    }
+}
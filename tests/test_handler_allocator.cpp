@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+#include "HandlerAllocator.hpp"
+#include "Profiler.hpp"
+#include "Session.hpp"
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// Counts heap allocations made on the thread that enables counting, so the
+// steady-state read/write cycle of a websocket connection can be checked for
+// mallocs. The rest of the test binary is unaffected. This operator new is
+// the test binary's, so it also feeds HeapProfiler, as AllocationHooks.cpp
+// does in the server.
+namespace {
+
+std::size_t g_allocations = 0;
+thread_local bool t_count_allocations = false;
+
+struct LinkedHooks {
+    LinkedHooks() { HeapProfiler::set_hooks_linked(); }
+} const linked_hooks;
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (t_count_allocations) {
+        ++g_allocations;
+    }
+    HeapProfiler::on_allocation(size);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// One side of an echo loop wired up the way Session wires its handlers:
+// bound to a strand and to the pooled handler allocator.
+template <typename Stream>
+struct EchoLoop : std::enable_shared_from_this<EchoLoop<Stream>> {
+    Stream& ws;
+    net::strand<net::io_context::executor_type> strand;
+    beast::flat_buffer buffer;
+    std::string outbound;
+    int remaining;
+    bool writes_first;
+
+    EchoLoop(Stream& s, net::io_context& ioc, int cycles, bool first)
+        : ws(s), strand(net::make_strand(ioc.get_executor())), outbound(48, 'x'), remaining(cycles),
+          writes_first(first) {}
+
+    template <typename F>
+    auto bound(F&& f) {
+        return bind_handler_allocator(PooledHandlerAllocator<void>(), net::bind_executor(strand, std::forward<F>(f)));
+    }
+
+    void start() {
+        writes_first ? do_write() : do_read();
+    }
+
+    void do_read() {
+        ws.async_read(buffer, bound([self = this->shared_from_this()](beast::error_code ec, std::size_t) {
+            ASSERT_FALSE(ec) << ec.message();
+            self->buffer.consume(self->buffer.size());
+            if (self->writes_first && --self->remaining == 0) {
+                return;
+            }
+            self->do_write();
+        }));
+    }
+
+    void do_write() {
+        ws.async_write(net::buffer(outbound), bound([self = this->shared_from_this()](beast::error_code ec, std::size_t) {
+            ASSERT_FALSE(ec) << ec.message();
+            if (!self->writes_first && --self->remaining == 0) {
+                return;
+            }
+            self->do_read();
+        }));
+    }
+};
+
+class HandlerAllocatorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tcp::acceptor acceptor(ioc_, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+        client_.next_layer().connect(acceptor.local_endpoint());
+        server_.next_layer().socket() = acceptor.accept();
+
+        server_.async_accept([](beast::error_code ec) { ASSERT_FALSE(ec) << ec.message(); });
+        client_.async_handshake("localhost", "/", [](beast::error_code ec) { ASSERT_FALSE(ec) << ec.message(); });
+        ioc_.run();
+        ioc_.restart();
+    }
+
+    // Runs `cycles` client-write / server-read / server-write / client-read
+    // round trips and returns the number of heap allocations they made.
+    std::size_t run_cycles(int cycles) {
+        auto server = std::make_shared<EchoLoop<websocket::stream<beast::tcp_stream>>>(server_, ioc_, cycles, false);
+        auto client = std::make_shared<EchoLoop<websocket::stream<tcp::socket>>>(client_, ioc_, cycles, true);
+        g_allocations = 0;
+        t_count_allocations = true;
+        server->start();
+        client->start();
+        ioc_.run();
+        t_count_allocations = false;
+        ioc_.restart();
+        return g_allocations;
+    }
+
+    net::io_context ioc_{1};
+    websocket::stream<beast::tcp_stream> server_{ioc_};
+    websocket::stream<tcp::socket> client_{ioc_};
+};
+
+} // namespace
+
+TEST(ThreadHandlerPoolTest, ReusesFreedBlocksOfTheSameSizeClass) {
+    void* first = ThreadHandlerPool::allocate(100);
+    ThreadHandlerPool::deallocate(first, 100);
+    void* second = ThreadHandlerPool::allocate(120); // same 128-byte class
+    EXPECT_EQ(first, second);
+    ThreadHandlerPool::deallocate(second, 120);
+}
+
+TEST_F(HandlerAllocatorTest, SteadyStateReadWriteCycleDoesNotAllocate) {
+    // Warm up: sizes the flat_buffers, the websocket write buffers and the
+    // handler pool's free lists.
+    run_cycles(64);
+
+    // The loop objects themselves cost a fixed handful of allocations; the
+    // cycles must not add any.
+    std::size_t const baseline = run_cycles(1);
+    EXPECT_EQ(run_cycles(1000), baseline);
+}
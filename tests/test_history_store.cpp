@@ -0,0 +1,327 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "HistoryStore.hpp"
+#include "Utils.hpp"
+#include <boost/json.hpp>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace json = boost::json;
+namespace websocket = beast::websocket;
+
+namespace {
+
+std::vector<std::uint64_t> seqs(const std::vector<HistoryEntry>& entries) {
+    std::vector<std::uint64_t> out;
+    for (auto const& entry : entries) {
+        out.push_back(entry.seq);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(PostingListTest, DecodesTheIdsInRange) {
+    PostingList list;
+    std::vector<std::uint32_t> const ids = {0, 1, 2, 127, 128, 300, 16383, 16384, 70000, 4000000000u};
+    for (auto id : ids) {
+        list.append(id);
+    }
+    EXPECT_EQ(list.size(), ids.size());
+
+    std::vector<std::uint32_t> out;
+    list.decode(0, 0xffffffffu, out);
+    EXPECT_EQ(out, ids);
+
+    out.clear();
+    list.decode(128, 70000, out);
+    EXPECT_EQ(out, (std::vector<std::uint32_t>{128, 300, 16383, 16384}));
+
+    out.clear();
+    list.decode(4000000001u, 0xffffffffu, out);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(PostingListTest, SkipsBetweenBlocks) {
+    PostingList evens;
+    PostingList threes;
+    for (std::uint32_t id = 0; id < 1000; ++id) {
+        if (id % 2 == 0) {
+            evens.append(id);
+        }
+        if (id % 3 == 0) {
+            threes.append(id);
+        }
+    }
+    EXPECT_EQ(evens.blocks(), (500 + PostingList::kBlockSize - 1) / PostingList::kBlockSize);
+    EXPECT_EQ(evens.block_first(1), 2 * PostingList::kBlockSize);
+
+    std::vector<std::uint32_t> block;
+    evens.decode_block(evens.blocks() - 1, 0, 990, block);
+    ASSERT_FALSE(block.empty());
+    EXPECT_EQ(block.front(), evens.block_first(evens.blocks() - 1));
+    EXPECT_EQ(block.back(), 988u);
+
+    std::vector<std::uint32_t> range;
+    evens.decode(301, 311, range);
+    EXPECT_EQ(range, (std::vector<std::uint32_t>{302, 304, 306, 308, 310}));
+
+    std::vector<std::uint32_t> all_threes;
+    threes.decode(0, 1000, all_threes);
+    std::vector<std::uint32_t> sixes;
+    evens.intersect(all_threes, sixes);
+    ASSERT_EQ(sixes.size(), 167u);
+    for (std::size_t i = 0; i < sixes.size(); ++i) {
+        EXPECT_EQ(sixes[i], 6 * i);
+    }
+
+    std::vector<std::uint32_t> sparse = {1, 2, 500, 501, 998, 999, 5000};
+    std::vector<std::uint32_t> found;
+    evens.intersect(sparse, found);
+    EXPECT_EQ(found, (std::vector<std::uint32_t>{2, 500, 998}));
+}
+
+TEST(HistoryStoreTest, TokenizesIntoLowerCaseWords) {
+    std::vector<std::string> words;
+    HistoryStore::tokenize("Hello, WORLD! it's 2pm -- caf\xc3\xa9 " + std::string(65, 'x'), words);
+    EXPECT_EQ(words, (std::vector<std::string>{"hello", "world", "it", "s", "2pm", "caf\xc3\xa9"}));
+}
+
+TEST(HistoryStoreTest, FiltersByAuthorWordsAndTime) {
+    HistoryStore store(1000, 4); // Queries span several segments
+    store.append(1, 100, "alice", "Alice", "Good morning everyone");
+    store.append(2, 100, "bob", "Bob", "morning Alice");
+    store.append(3, 160, "alice", "Alice", "Coffee anyone?");
+    store.append(4, 200, "carol", "Carol", "GOOD coffee here");
+    store.append(5, 260, "bob", "Bob", "Good morning, good coffee");
+    store.append(6, 300, "alice", "Ally", "back from coffee");
+
+    HistoryQuery by_user;
+    by_user.user_id = "alice";
+    auto const alice = store.query(by_user);
+    EXPECT_EQ(seqs(alice), (std::vector<std::uint64_t>{6, 3, 1})) << "Newest first";
+    EXPECT_EQ(alice[0].nickname, "Ally") << "The nickname the message was sent under";
+    EXPECT_EQ(alice[2].nickname, "Alice");
+    EXPECT_EQ(alice[2].text, "Good morning everyone");
+    EXPECT_EQ(alice[2].time, 100);
+
+    HistoryQuery words;
+    words.text = "good COFFEE";
+    EXPECT_EQ(seqs(store.query(words)), (std::vector<std::uint64_t>{5, 4}));
+
+    HistoryQuery user_and_word;
+    user_and_word.user_id = "bob";
+    user_and_word.text = "morning";
+    EXPECT_EQ(seqs(store.query(user_and_word)), (std::vector<std::uint64_t>{5, 2}));
+
+    HistoryQuery range;
+    range.text = "coffee";
+    range.since = 160;
+    range.until = 260;
+    EXPECT_EQ(seqs(store.query(range)), (std::vector<std::uint64_t>{5, 4, 3}));
+
+    HistoryQuery nothing;
+    nothing.text = "tea";
+    EXPECT_TRUE(store.query(nothing).empty());
+    nothing.text = "!!!";
+    EXPECT_TRUE(store.query(nothing).empty());
+    nothing.text.clear();
+    nothing.user_id = "dave";
+    EXPECT_TRUE(store.query(nothing).empty());
+}
+
+TEST(HistoryStoreTest, PagesWithTheSeqCursor) {
+    HistoryStore store(1000, 3);
+    for (std::uint64_t seq = 1; seq <= 10; ++seq) {
+        store.append(seq, static_cast<std::int64_t>(seq), "u", "U", "message " + std::to_string(seq));
+    }
+    HistoryQuery page;
+    page.text = "message";
+    page.limit = 4;
+    EXPECT_EQ(seqs(store.query(page)), (std::vector<std::uint64_t>{10, 9, 8, 7}));
+    page.before_seq = 7;
+    EXPECT_EQ(seqs(store.query(page)), (std::vector<std::uint64_t>{6, 5, 4, 3}));
+    page.before_seq = 3;
+    EXPECT_EQ(seqs(store.query(page)), (std::vector<std::uint64_t>{2, 1}));
+}
+
+TEST(HistoryStoreTest, KeepsTheTimeIndexSortedAndDropsOldSegments) {
+    HistoryStore store(6, 3);
+    store.append(1, 500, "u", "U", "a");
+    store.append(2, 400, "u", "U", "b"); // The clock stepped back
+    HistoryQuery all;
+    auto const both = store.query(all);
+    ASSERT_EQ(both.size(), 2u);
+    EXPECT_EQ(both[0].time, 500);
+
+    for (std::uint64_t seq = 3; seq <= 10; ++seq) {
+        store.append(seq, 600, "u", "U", "c");
+    }
+    auto const stats = store.stats();
+    EXPECT_GE(stats.messages, 6u);
+    EXPECT_LE(stats.messages, 9u);
+    auto const kept = store.query(all);
+    EXPECT_EQ(kept.size(), stats.messages);
+    EXPECT_EQ(kept.front().seq, 10u);
+    EXPECT_GT(kept.back().seq, 1u) << "The oldest segment is gone";
+}
+
+TEST(HistoryStoreTest, IndexedQueriesMatchAScan) {
+    HistoryStore store(5000, 512);
+    std::mt19937 rng(7);
+    std::vector<std::string> const vocabulary = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"};
+    for (std::uint64_t seq = 1; seq <= 4000; ++seq) {
+        std::string text;
+        for (int i = 0; i < 3; ++i) {
+            text += vocabulary[rng() % vocabulary.size()] + " ";
+        }
+        store.append(seq, static_cast<std::int64_t>(seq / 10), "user" + std::to_string(rng() % 7), "N", text);
+    }
+    for (int i = 0; i < 200; ++i) {
+        HistoryQuery query;
+        if (rng() % 2) {
+            query.user_id = "user" + std::to_string(rng() % 8);
+        }
+        for (int w = rng() % 3; w > 0; --w) {
+            query.text += vocabulary[rng() % vocabulary.size()] + " ";
+        }
+        if (rng() % 2) {
+            query.since = rng() % 400;
+            query.until = query.since + rng() % 100;
+        }
+        if (rng() % 2) {
+            query.before_seq = rng() % 4000;
+        }
+        query.limit = 1 + rng() % 300;
+        auto const indexed = store.query(query);
+        query.indexed = false;
+        EXPECT_EQ(seqs(indexed), seqs(store.query(query))) << "Query " << i;
+    }
+}
+
+TEST(UtilsTest, ParsesTheTimestampsItFormats) {
+    EXPECT_EQ(Utils::parseTimestampISO8601("2023-10-27T10:30:00Z"), 1698402600);
+    EXPECT_EQ(Utils::parseTimestampISO8601("2023-10-27T10:30:00"), 1698402600);
+    EXPECT_EQ(Utils::formatTimestampISO8601(1698402600), "2023-10-27T10:30:00Z");
+    EXPECT_EQ(Utils::parseTimestampISO8601("yesterday"), -1);
+    EXPECT_EQ(Utils::parseTimestampISO8601("2023-10-27T10:30:00+02"), -1);
+}
+
+namespace {
+
+// History queries over a websocket against an in-process server
+class HistoryQueryTest : public ::testing::Test {
+protected:
+    using Client = websocket::stream<tcp::socket>;
+
+    void start_server(std::size_t retain) {
+        options_.presence_tick_ms = 0;
+        options_.history_retain = retain;
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+    }
+
+    void TearDown() override {
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+        std::cout.rdbuf(cout_buf_);
+    }
+
+    std::unique_ptr<Client> connect() {
+        auto client = std::make_unique<Client>(client_ioc_);
+        client->next_layer().connect(server_->local_endpoint());
+        client->handshake("127.0.0.1", "/");
+        return client;
+    }
+
+    // Reads until a message of `type` arrives
+    static json::object read_until(Client& client, const std::string& type) {
+        for (;;) {
+            beast::flat_buffer buffer;
+            client.read(buffer);
+            auto message = json::parse(beast::buffers_to_string(buffer.data())).as_object();
+            if (message.at("type").as_string() == type.c_str()) {
+                return message;
+            }
+        }
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+};
+
+} // namespace
+
+TEST_F(HistoryQueryTest, StreamsMatchesInPages) {
+    start_server(1000);
+    auto client = connect();
+    for (int i = 1; i <= 7; ++i) {
+        client->write(net::buffer("{\"type\":\"client_send_message\",\"payload\":{\"text\":\"" +
+                                  std::string(i % 2 ? "ping " : "pong ") + std::to_string(i) + "\"}}"));
+        read_until(*client, "server_broadcast_message");
+    }
+
+    client->write(net::buffer(std::string(
+        R"({"type":"client_query_history","payload":{"query_id":"q1","text":"ping","limit":3,"page_size":2}})")));
+    auto const first = read_until(*client, "server_history_page").at("payload").as_object();
+    EXPECT_EQ(first.at("query_id").as_string(), "q1");
+    EXPECT_EQ(first.at("page").to_number<int>(), 0);
+    EXPECT_FALSE(first.at("done").as_bool());
+    auto const& messages = first.at("messages").as_array();
+    ASSERT_EQ(messages.size(), 2u);
+    auto const& newest = messages[0].as_object();
+    EXPECT_EQ(newest.at("type").as_string(), "server_broadcast_message");
+    EXPECT_EQ(newest.at("payload").as_object().at("text").as_string(), "ping 7");
+    EXPECT_EQ(messages[1].as_object().at("payload").as_object().at("text").as_string(), "ping 5");
+    EXPECT_GE(Utils::parseTimestampISO8601(newest.at("payload").as_object().at("timestamp").as_string().c_str()), 0);
+
+    auto const second = read_until(*client, "server_history_page").at("payload").as_object();
+    EXPECT_EQ(second.at("page").to_number<int>(), 1);
+    EXPECT_TRUE(second.at("done").as_bool());
+    ASSERT_EQ(second.at("messages").as_array().size(), 1u);
+    auto const& oldest = second.at("messages").as_array()[0].as_object();
+    EXPECT_EQ(oldest.at("payload").as_object().at("text").as_string(), "ping 3");
+    EXPECT_EQ(second.at("next_before_seq").to_number<std::uint64_t>(), oldest.at("seq").to_number<std::uint64_t>())
+        << "The limit was reached, so there may be more";
+
+    client->write(net::buffer(std::string(
+        R"({"type":"client_query_history","payload":{"query_id":"q2","text":"ping","before_seq":)") +
+        std::to_string(oldest.at("seq").to_number<std::uint64_t>()) + "}}"));
+    auto const rest = read_until(*client, "server_history_page").at("payload").as_object();
+    EXPECT_TRUE(rest.at("done").as_bool());
+    EXPECT_TRUE(rest.at("next_before_seq").is_null());
+    ASSERT_EQ(rest.at("messages").as_array().size(), 1u);
+    EXPECT_EQ(rest.at("messages").as_array()[0].as_object().at("payload").as_object().at("text").as_string(), "ping 1");
+
+    client->write(net::buffer(std::string(
+        R"({"type":"client_query_history","payload":{"query_id":"q3","since":"last week"}})")));
+    auto const refused = read_until(*client, "server_history_page").at("payload").as_object();
+    EXPECT_EQ(refused.at("query_id").as_string(), "q3");
+    EXPECT_TRUE(refused.contains("error"));
+
+    auto const stats = json::parse(server_->stats_json()).as_object();
+    EXPECT_EQ(stats.at("history").as_object().at("messages").to_number<int>(), 7);
+}
+
+TEST_F(HistoryQueryTest, RefusedWhenHistoryIsOff) {
+    start_server(0);
+    auto client = connect();
+    client->write(net::buffer(std::string(R"({"type":"client_query_history","payload":{"query_id":"q"}})")));
+    auto const refused = read_until(*client, "server_history_page").at("payload").as_object();
+    EXPECT_TRUE(refused.contains("error"));
+    EXPECT_FALSE(json::parse(server_->stats_json()).as_object().contains("history"));
+}
@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+#include "ChatClient.hpp"
+#include "ChatServer.hpp"
+#include "LatencyTracer.hpp"
+#include <boost/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace json = boost::json;
+namespace http = beast::http;
+
+namespace {
+
+// Plain HTTP GET against the chat port.
+http::response<http::string_body> http_get(unsigned short port, const std::string& target) {
+    net::io_context ioc;
+    tcp::socket socket(ioc);
+    socket.connect(tcp::endpoint{net::ip::make_address("127.0.0.1"), port});
+    http::request<http::empty_body> req{http::verb::get, target, 11};
+    req.set(http::field::host, "127.0.0.1");
+    http::write(socket, req);
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(socket, buffer, res);
+    return res;
+}
+
+} // namespace
+
+TEST(LatencyHistogramTest, PercentilesAreWithinBucketPrecision) {
+    LatencyHistogram histogram;
+    for (std::int64_t v = 1; v <= 100000; ++v) {
+        histogram.record(v);
+    }
+    EXPECT_EQ(histogram.count(), 100000u);
+    EXPECT_EQ(histogram.max(), 100000u);
+    EXPECT_NEAR(histogram.mean(), 50000.5, 0.01);
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        double const exact = q * 100000;
+        EXPECT_NEAR(static_cast<double>(histogram.percentile(q)), exact, exact / 16) << "q=" << q;
+    }
+    EXPECT_EQ(histogram.percentile(1.0), 100000u);
+
+    histogram.reset();
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_EQ(histogram.percentile(0.5), 0u);
+}
+
+TEST(LatencyHistogramTest, BucketsTileTheValueRange) {
+    for (std::size_t i = 0; i + 1 < LatencyHistogram::kBuckets; ++i) {
+        ASSERT_EQ(LatencyHistogram::bucket_upper(i), LatencyHistogram::bucket_lower(i + 1)) << "bucket " << i;
+    }
+    for (std::uint64_t v : {0ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, 1ull << 40}) {
+        auto const b = LatencyHistogram::bucket_of(v);
+        EXPECT_LE(LatencyHistogram::bucket_lower(b), v);
+        EXPECT_GT(LatencyHistogram::bucket_upper(b), v);
+    }
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecordersLoseNothing) {
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&histogram, t] {
+            for (int i = 0; i < 100000; ++i) {
+                histogram.record(1000 * (t + 1));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(histogram.count(), 400000u);
+    EXPECT_EQ(histogram.max(), 4000u);
+}
+
+TEST(LatencyTracerTest, TracedPayloadCarriesItsStamps) {
+    MessageTrace trace;
+    trace.read_ns = 1;
+    trace.parse_ns = 2;
+    trace.enqueue_ns = 3;
+    auto const traced = LatencyTracer::make_traced("hello", trace);
+    EXPECT_EQ(*traced, "hello");
+    ASSERT_NE(LatencyTracer::trace_of(traced), nullptr);
+    EXPECT_EQ(LatencyTracer::trace_of(traced)->enqueue_ns, 3);
+
+    EXPECT_EQ(LatencyTracer::trace_of(std::make_shared<const std::string>("plain")), nullptr);
+}
+
+TEST(LatencyTracerTest, SamplesOneMessageInN) {
+    LatencyTracer off(0);
+    LatencyTracer every_fourth(4);
+    int sampled = 0;
+    for (int i = 0; i < 400; ++i) {
+        EXPECT_FALSE(off.should_sample());
+        sampled += every_fourth.should_sample() ? 1 : 0;
+    }
+    EXPECT_EQ(sampled, 100);
+}
+
+TEST(LatencyTracingIntegrationTest, StatsEndpointReportsEveryStage) {
+    constexpr int kMessages = 50;
+
+    net::io_context server_ioc;
+    ServerOptions options;
+    options.trace_sample = 1;
+    ChatServer server(server_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    server.run();
+    auto server_guard = net::make_work_guard(server_ioc);
+    std::thread server_thread([&] { server_ioc.run(); });
+    auto const port = server.local_endpoint().port();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int received = 0;
+    ChatClient receiver("127.0.0.1", std::to_string(port));
+    ChatClient sender("127.0.0.1", std::to_string(port));
+    ASSERT_TRUE(receiver.is_connected());
+    ASSERT_TRUE(sender.is_connected());
+    receiver.start([&](const std::string& message) {
+        if (message.find("server_broadcast_message") != std::string::npos) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++received;
+            cv.notify_all();
+        }
+    });
+    sender.start([](const std::string&) {});
+    std::thread receiver_thread([&] { receiver.io_context().run(); });
+    std::thread sender_thread([&] { sender.io_context().run(); });
+
+    for (int i = 0; i < kMessages; ++i) {
+        sender.post("{\"type\":\"client_send_message\",\"payload\":{\"text\":\"m" + std::to_string(i) + "\"}}");
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(10), [&] { return received >= kMessages; });
+    }
+
+    auto const stats = http_get(port, "/stats");
+    auto const missing = http_get(port, "/nope");
+
+    sender.async_close();
+    receiver.async_close();
+    sender_thread.join();
+    receiver_thread.join();
+    server_guard.reset();
+    server_ioc.stop();
+    server_thread.join();
+
+    ASSERT_EQ(received, kMessages);
+    EXPECT_EQ(missing.result(), http::status::not_found);
+    ASSERT_EQ(stats.result(), http::status::ok);
+    EXPECT_EQ(stats[http::field::content_type], "application/json");
+
+    auto const body = json::parse(stats.body()).as_object();
+    EXPECT_GE(body.at("sessions").as_int64(), 2); // The stats connection itself may be counted
+    auto const& latency = body.at("latency").as_object();
+    EXPECT_EQ(latency.at("sample_every").as_int64(), 1);
+    auto const& stages = latency.at("stages").as_object();
+    for (auto const* stage : {"read_to_parse", "parse_to_enqueue", "enqueue_to_write_start",
+                              "write_start_to_complete", "read_to_write_complete"}) {
+        ASSERT_TRUE(stages.contains(stage)) << stage;
+        EXPECT_GT(stages.at(stage).as_object().at("count").as_int64(), 0) << stage;
+    }
+    EXPECT_EQ(stages.at("read_to_parse").as_object().at("count").as_int64(), kMessages);
+}
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include "MessageEncoder.hpp"
+#include "ServerMessages.hpp"
+#include <boost/json.hpp>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace json = boost::json;
+
+namespace {
+
+// Strings that exercise every escaping rule
+std::vector<std::string> tricky_strings() {
+    std::vector<std::string> out = {
+        "",
+        "plain",
+        "quote\" backslash\\ slash/",
+        "caf\xc3\xa9 \xf0\x9f\x98\x80",
+        std::string("nul\0byte", 8),
+        "\x7f\xff", // DEL and a stray byte pass through untouched
+    };
+    std::string controls;
+    for (char c = 1; c < 0x20; ++c) {
+        controls += c;
+    }
+    out.push_back(controls);
+    return out;
+}
+
+json::object message(const char* type, json::object payload) {
+    return json::object{{"type", type}, {"payload", std::move(payload)}};
+}
+
+json::array pairs(const MessageEncoder::UserList& users) {
+    json::array out;
+    for (auto const& [user_id, nickname] : users) {
+        out.push_back(json::array{json::string(user_id), json::string(nickname)});
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(MessageEncoderTest, StringMessagesMatchTheSerializer) {
+    using namespace ServerMessages;
+    for (auto const& a : tricky_strings()) {
+        for (auto const& b : tricky_strings()) {
+            EXPECT_EQ(MessageEncoder::encode<broadcast_message>(a, b, "2024-01-01T00:00:00Z", b),
+                      json::serialize(message("server_broadcast_message", {{"user_id", a},
+                                                                           {"text", b},
+                                                                           {"timestamp", "2024-01-01T00:00:00Z"},
+                                                                           {"nickname", b}})));
+            EXPECT_EQ(MessageEncoder::encode<client_connected>(a, b, "User has connected.", a),
+                      json::serialize(message("server_client_connected", {{"user_id", a},
+                                                                          {"nickname", b},
+                                                                          {"message", "User has connected."},
+                                                                          {"timestamp", a}})));
+            EXPECT_EQ(MessageEncoder::encode<client_disconnected>(b, a, "User has disconnected.", b),
+                      json::serialize(message("server_client_disconnected", {{"user_id", b},
+                                                                             {"nickname", a},
+                                                                             {"message", "User has disconnected."},
+                                                                             {"timestamp", b}})));
+            EXPECT_EQ(MessageEncoder::encode<nickname_changed>(a, a, b, b),
+                      json::serialize(message("server_user_nickname_changed", {{"user_id", a},
+                                                                               {"old_nickname", a},
+                                                                               {"new_nickname", b},
+                                                                               {"timestamp", b}})));
+        }
+    }
+}
+
+TEST(MessageEncoderTest, NumbersAndBooleansMatchTheSerializer) {
+    using namespace ServerMessages;
+    for (std::uint64_t const seq : {std::uint64_t{0}, std::uint64_t{42}, std::numeric_limits<std::uint64_t>::max()}) {
+        for (int const grace : {0, 30000, -1, std::numeric_limits<int>::max()}) {
+            EXPECT_EQ(MessageEncoder::encode<session_welcome>("u", "n", "t", seq, grace),
+                      json::serialize(message("server_session_welcome", {{"user_id", "u"},
+                                                                         {"nickname", "n"},
+                                                                         {"resume_token", "t"},
+                                                                         {"seq", seq},
+                                                                         {"resume_grace_ms", grace}})));
+        }
+        for (bool const complete : {false, true}) {
+            std::size_t const replayed = seq % 1000;
+            EXPECT_EQ(MessageEncoder::encode<session_resumed>("u\"", "n", "t", seq, replayed, complete),
+                      json::serialize(message("server_session_resumed", {{"user_id", "u\""},
+                                                                         {"nickname", "n"},
+                                                                         {"resume_token", "t"},
+                                                                         {"seq", seq},
+                                                                         {"replayed", replayed},
+                                                                         {"complete", complete}})));
+        }
+    }
+    for (std::int64_t const value : {std::numeric_limits<std::int64_t>::min(), std::int64_t{-7}}) {
+        std::string out;
+        MessageEncoder::append_value(out, value);
+        EXPECT_EQ(out, json::serialize(json::value(value)));
+    }
+}
+
+TEST(MessageEncoderTest, UserListsMatchTheSerializer) {
+    using namespace ServerMessages;
+    MessageEncoder::UserList const none;
+    MessageEncoder::UserList users;
+    for (auto const& name : tricky_strings()) {
+        users.emplace_back("sess_" + name, name);
+    }
+    EXPECT_EQ(MessageEncoder::encode<presence_delta>(users, none, users.size(), "now"),
+              json::serialize(message("server_presence_delta",
+                                      {{"joined", pairs(users)}, {"left", json::array()}, {"online", users.size()},
+                                       {"timestamp", "now"}})));
+    EXPECT_EQ(MessageEncoder::encode<roster_snapshot>(none, "now"),
+              json::serialize(message("server_roster_snapshot", {{"users", json::array()}, {"timestamp", "now"}})));
+    EXPECT_EQ(MessageEncoder::encode<roster_snapshot>(users, "now"),
+              json::serialize(message("server_roster_snapshot", {{"users", pairs(users)}, {"timestamp", "now"}})));
+}
+
+TEST(MessageEncoderTest, ReusesThePerThreadBuffer) {
+    auto const& first = MessageEncoder::encode<ServerMessages::roster_snapshot>(MessageEncoder::UserList{}, "a");
+    auto const* storage = first.data();
+    auto const shared = MessageEncoder::encode_shared<ServerMessages::roster_snapshot>(MessageEncoder::UserList{}, "b");
+    EXPECT_EQ(*shared, R"({"type":"server_roster_snapshot","payload":{"users":[],"timestamp":"b"}})");
+    auto const& second = MessageEncoder::encode<ServerMessages::roster_snapshot>(MessageEncoder::UserList{}, "c");
+    EXPECT_EQ(&second, &first);
+    EXPECT_EQ(second.data(), storage) << "Small messages reuse the storage";
+
+    // A large message's storage is not kept once smaller ones follow
+    MessageEncoder::encode<ServerMessages::roster_snapshot>(MessageEncoder::UserList{}, std::string(1 << 20, 'x'));
+    auto const& small = MessageEncoder::encode<ServerMessages::roster_snapshot>(MessageEncoder::UserList{}, "d");
+    EXPECT_LT(small.capacity(), std::size_t{1} << 20);
+
+    // Other threads have buffers of their own
+    const std::string* other = nullptr;
+    std::thread([&] { other = &MessageEncoder::encode<ServerMessages::roster_snapshot>(MessageEncoder::UserList{}, "e"); })
+        .join();
+    EXPECT_NE(other, &small);
+    EXPECT_EQ(small, R"({"type":"server_roster_snapshot","payload":{"users":[],"timestamp":"d"}})");
+}
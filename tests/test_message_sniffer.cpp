@@ -0,0 +1,316 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "MessageSniffer.hpp"
+#include <boost/beast/websocket/detail/utf8_checker.hpp>
+#include <boost/json.hpp>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace json = boost::json;
+namespace websocket = beast::websocket;
+
+namespace {
+
+using MessageSniffer::Isa;
+using MessageSniffer::Result;
+
+// Runs a test body once per vector unit the CPU has, scalar included
+class SnifferIsaTest : public ::testing::TestWithParam<Isa> {
+protected:
+    void SetUp() override {
+        if (static_cast<int>(GetParam()) > static_cast<int>(MessageSniffer::best_isa())) {
+            GTEST_SKIP() << MessageSniffer::isa_name(GetParam()) << " is not available";
+        }
+        MessageSniffer::use_isa(GetParam());
+    }
+    void TearDown() override { MessageSniffer::use_isa(MessageSniffer::best_isa()); }
+};
+
+Result sniff(const std::string& frame) {
+    MessageSniffer::Message message;
+    return MessageSniffer::sniff(frame, message);
+}
+
+// Long enough to reach the vector loops, with `middle` at every offset of a chunk
+std::vector<std::string> padded(const std::string& middle) {
+    std::vector<std::string> out;
+    for (std::size_t pad = 0; pad < 40; ++pad) {
+        out.push_back(std::string(pad, 'a') + middle + std::string(40, 'b'));
+    }
+    return out;
+}
+
+} // namespace
+
+TEST_P(SnifferIsaTest, FindsTypeAndPayloadMembers) {
+    std::string const frame =
+        R"( {"payload": {"text": "hello world", "n": -1.5e3, "ok": true, "x": null, "list": [1, {"a": []}]},)"
+        R"( "type": "client_send_message"} )";
+    MessageSniffer::Message message;
+    ASSERT_EQ(MessageSniffer::sniff(frame, message), Result::ok);
+    EXPECT_TRUE(message.complete);
+    EXPECT_EQ(message.type.kind, MessageSniffer::Value::string);
+    EXPECT_EQ(message.type.raw, "client_send_message");
+    EXPECT_EQ(message.payload.kind, MessageSniffer::Value::object);
+    ASSERT_EQ(message.member_count, 5u);
+    EXPECT_EQ(message.member("text")->raw, "hello world");
+    EXPECT_EQ(message.member("n")->kind, MessageSniffer::Value::number);
+    EXPECT_EQ(message.member("n")->raw, "-1.5e3");
+    EXPECT_EQ(message.member("ok")->kind, MessageSniffer::Value::boolean);
+    EXPECT_EQ(message.member("x")->kind, MessageSniffer::Value::null);
+    EXPECT_EQ(message.member("list")->kind, MessageSniffer::Value::array);
+    EXPECT_EQ(message.member("list")->raw, R"([1, {"a": []}])");
+    EXPECT_EQ(message.member("missing"), nullptr);
+}
+
+TEST_P(SnifferIsaTest, FlagsFramesItCannotRouteAlone) {
+    MessageSniffer::Message message;
+    // A key spelled with escapes could be "type"
+    ASSERT_EQ(MessageSniffer::sniff(R"({"t\u0079pe":"a"})", message), Result::ok);
+    EXPECT_FALSE(message.complete);
+    EXPECT_EQ(message.type.kind, MessageSniffer::Value::none);
+
+    ASSERT_EQ(MessageSniffer::sniff(R"({"type":"a","type":"b"})", message), Result::ok);
+    EXPECT_FALSE(message.complete);
+    EXPECT_EQ(message.type.raw, "b");
+
+    ASSERT_EQ(MessageSniffer::sniff(R"({"type":"a","payload":{"text":"x","text":"y"}})", message), Result::ok);
+    EXPECT_FALSE(message.complete);
+    EXPECT_EQ(message.member("text")->raw, "y") << "Like a parser, the last one wins";
+
+    std::string many = R"({"type":"a","payload":{)";
+    for (std::size_t i = 0; i <= MessageSniffer::Message::kMaxMembers; ++i) {
+        many += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+    }
+    ASSERT_EQ(MessageSniffer::sniff(many + "}}", message), Result::ok);
+    EXPECT_FALSE(message.complete);
+    EXPECT_EQ(message.member_count, MessageSniffer::Message::kMaxMembers);
+
+    // Escapes inside values are fine; they are decoded on demand
+    ASSERT_EQ(MessageSniffer::sniff(R"({"type":"a","payload":{"text":"a\"b"}})", message), Result::ok);
+    EXPECT_TRUE(message.complete);
+    EXPECT_TRUE(message.member("text")->escaped);
+}
+
+TEST_P(SnifferIsaTest, AgreesWithTheParserOnWellFormedness) {
+    std::vector<std::string> const accepted = {
+        R"({})",
+        R"({"type":"x"})",
+        R"({"a":[1,2,[3,{}]],"b":{"c":"d"},"e":-0,"f":0.5,"g":1E+2,"h":false})",
+        " \t\r\n{\"a\" : \"b\" } \n",
+        R"({"text":"tab\tnewline\nquote\"slash\/backslash\\unicode\u00e9\ud83d\ude00"})",
+        "{\"text\":\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"}",
+    };
+    for (auto const& frame : accepted) {
+        boost::system::error_code ec;
+        json::parse(frame, ec);
+        ASSERT_FALSE(ec) << frame;
+        EXPECT_EQ(sniff(frame), Result::ok) << frame;
+    }
+
+    std::vector<std::string> const rejected = {
+        "",
+        "{",
+        R"({"a":})",
+        R"({"a":1,})",
+        R"({"a" 1})",
+        R"({a:1})",
+        R"({"a":tru})",
+        R"({"a":"unterminated})",
+        R"({"a":1}})",
+        R"({"a":1} x)",
+        R"([1,])",
+    };
+    for (auto const& frame : rejected) {
+        boost::system::error_code ec;
+        json::parse(frame, ec);
+        ASSERT_TRUE(ec) << frame;
+        EXPECT_EQ(sniff(frame), Result::malformed) << frame;
+    }
+
+    EXPECT_EQ(sniff("[1,2]"), Result::not_object);
+    EXPECT_EQ(sniff("\"text\""), Result::not_object);
+    EXPECT_EQ(sniff("42"), Result::not_object);
+}
+
+TEST_P(SnifferIsaTest, RejectsWhatStrictJsonRejects) {
+    for (std::string const number : {"01", "1.", ".5", "1e", "-", "+1"}) {
+        EXPECT_EQ(sniff("{\"a\":" + number + "}"), Result::malformed) << number;
+    }
+    // Bad string contents, at every offset of a vector chunk
+    for (std::string const contents : {
+             R"(\x)",         // Unknown escape
+             R"(\u12)",       // Short \u
+             R"(\ud83d)",     // Lone leading surrogate
+             R"(\ude00)",     // Lone trailing surrogate
+             R"(\ud83d\u0041)", // Leading surrogate, then not a trailing one
+             "line\nbreak",  // Raw control character
+         }) {
+        for (std::size_t pad = 0; pad < 40; ++pad) {
+            EXPECT_EQ(sniff("{\"a\":\"" + std::string(pad, 'x') + contents + std::string(40, 'z') + "\"}"),
+                      Result::malformed)
+                << contents << " after " << pad;
+        }
+    }
+
+    std::string deep;
+    for (int i = 0; i < MessageSniffer::kMaxDepth; ++i) {
+        deep += i ? "[" : "{\"a\":";
+    }
+    EXPECT_EQ(sniff(deep + "1" + std::string(MessageSniffer::kMaxDepth - 1, ']') + "}"), Result::ok);
+    EXPECT_EQ(sniff(deep + "[1]" + std::string(MessageSniffer::kMaxDepth - 1, ']') + "}"), Result::malformed);
+}
+
+TEST_P(SnifferIsaTest, ValidatesUtf8AtEveryOffset) {
+    std::vector<std::string> const valid = {
+        "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80", "\xed\x9f\xbf", "\xee\x80\x80", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf",
+    };
+    std::vector<std::string> const invalid = {
+        "\x80",             // Stray continuation byte
+        "\xc0\xaf",         // Overlong '/'
+        "\xc1\xbf",         // Overlong
+        "\xe0\x9f\xbf",     // Overlong
+        "\xed\xa0\x80",     // Surrogate
+        "\xf0\x8f\xbf\xbf", // Overlong
+        "\xf4\x90\x80\x80", // Above U+10FFFF
+        "\xf5\x80\x80\x80",
+        "\xff",
+        "\xc3",             // Truncated
+        "\xe2\x82",
+        "\xc3\x28",         // Bad continuation
+    };
+    for (auto const& sequence : valid) {
+        for (auto const& text : padded(sequence)) {
+            EXPECT_TRUE(MessageSniffer::validate_utf8(text));
+            EXPECT_EQ(sniff("{\"text\":\"" + text + "\"}"), Result::ok);
+        }
+    }
+    for (auto const& sequence : invalid) {
+        for (auto const& text : padded(sequence)) {
+            EXPECT_FALSE(MessageSniffer::validate_utf8(text));
+            EXPECT_EQ(sniff("{\"text\":\"" + text + "\"}"), Result::invalid_utf8);
+        }
+        // Truncated at the very end of the input too
+        EXPECT_FALSE(MessageSniffer::validate_utf8(std::string(33, 'a') + sequence));
+    }
+}
+
+TEST_P(SnifferIsaTest, ValidatesUtf8LikeBeast) {
+    // Random byte strings biased towards UTF-8 lead and continuation bytes
+    std::mt19937 rng(7);
+    static unsigned char const kBytes[] = {'a', ' ', 0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf, 0xc0, 0xc2,
+                                           0xdf, 0xe0, 0xed, 0xef, 0xf0, 0xf4, 0xf5, 0xff};
+    int valid = 0;
+    for (int i = 0; i < 20000; ++i) {
+        std::string text(rng() % 48, 'x');
+        for (auto& c : text) {
+            c = static_cast<char>(rng() % 3 ? 'x' : kBytes[rng() % sizeof(kBytes)]);
+        }
+        bool const expected = websocket::detail::check_utf8(text.data(), text.size());
+        ASSERT_EQ(MessageSniffer::validate_utf8(text), expected) << i;
+        valid += expected;
+    }
+    EXPECT_GT(valid, 1000) << "The corpus should cover both outcomes";
+}
+
+INSTANTIATE_TEST_SUITE_P(AllIsas, SnifferIsaTest, ::testing::Values(Isa::scalar, Isa::sse2, Isa::avx2),
+                         [](const ::testing::TestParamInfo<Isa>& info) {
+                             return std::string(MessageSniffer::isa_name(info.param));
+                         });
+
+TEST(MessageSnifferTest, UnescapesToUtf8) {
+    std::string out;
+    ASSERT_TRUE(MessageSniffer::unescape(R"(a\"b\\c\/d\b\f\n\r\t)", out));
+    EXPECT_EQ(out, "a\"b\\c/d\b\f\n\r\t");
+    ASSERT_TRUE(MessageSniffer::unescape(R"(\u0041\u00E9\u20ac\ud83d\ude00)", out));
+    EXPECT_EQ(out, "A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+    ASSERT_TRUE(MessageSniffer::unescape("caf\xc3\xa9", out));
+    EXPECT_EQ(out, "caf\xc3\xa9");
+    EXPECT_FALSE(MessageSniffer::unescape(R"(\ud83d)", out));
+    EXPECT_FALSE(MessageSniffer::unescape(R"(trailing\)", out));
+}
+
+TEST(MessageSnifferTest, UseIsaIsClampedToTheCpu) {
+    MessageSniffer::use_isa(Isa::avx2);
+    EXPECT_EQ(MessageSniffer::isa(), MessageSniffer::best_isa());
+    MessageSniffer::use_isa(Isa::scalar);
+    EXPECT_EQ(MessageSniffer::isa(), Isa::scalar);
+    MessageSniffer::use_isa(MessageSniffer::best_isa());
+}
+
+namespace {
+
+class IngestTest : public ::testing::Test {
+protected:
+    using Client = websocket::stream<tcp::socket>;
+
+    void SetUp() override {
+        options_.presence_tick_ms = 0;
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+        client_ = std::make_unique<Client>(client_ioc_);
+        client_->next_layer().connect(server_->local_endpoint());
+        client_->handshake("127.0.0.1", "/");
+    }
+
+    void TearDown() override {
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+        std::cout.rdbuf(cout_buf_);
+        std::cerr.rdbuf(cerr_buf_);
+    }
+
+    // Sends `frame` and returns the payload of the broadcast that follows
+    json::object send(const std::string& frame) {
+        client_->write(net::buffer(frame));
+        for (;;) {
+            beast::flat_buffer buffer;
+            client_->read(buffer);
+            auto message = json::parse(beast::buffers_to_string(buffer.data())).as_object();
+            if (message.at("type").as_string() == "server_broadcast_message") {
+                return message.at("payload").as_object();
+            }
+        }
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::streambuf* cerr_buf_ = std::cerr.rdbuf(nullptr); // Rejected frames
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+    std::unique_ptr<Client> client_;
+};
+
+} // namespace
+
+TEST_F(IngestTest, ChatMessagesTakeTheFastPathOrTheParser) {
+    auto const plain = send(R"({"type":"client_send_message","payload":{"text":"hello"}})");
+    EXPECT_EQ(plain.at("text").as_string(), "hello");
+    EXPECT_TRUE(plain.contains("user_id"));
+    EXPECT_TRUE(plain.contains("timestamp"));
+    EXPECT_TRUE(plain.contains("nickname"));
+
+    auto const escaped = send(R"({"type":"client_send_message","payload":{"text":"say \"hi\"\n\u00e9"}})");
+    EXPECT_EQ(escaped.at("text").as_string(), "say \"hi\"\n\xc3\xa9");
+
+    // Frames the sniffer rejects are dropped, and the connection carries on
+    client_->write(net::buffer(std::string(R"({"type":"client_send_message","payload":{"text":"x")")));
+    client_->write(net::buffer(std::string(R"({"type":"client_send_message","payload":{"text":1}})")));
+    client_->write(net::buffer(std::string(R"(["client_send_message"])")));
+
+    // An escaped key leaves routing to the full parser
+    auto const parsed = send(R"({"type":"client_send_message","payload":{"t\u0065xt":"via parser"}})");
+    EXPECT_EQ(parsed.at("text").as_string(), "via parser");
+}
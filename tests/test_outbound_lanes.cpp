@@ -0,0 +1,207 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "CoroSession.hpp"
+#include "OutboundLanes.hpp"
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::shared_ptr<const std::string> message(const std::string& text, std::size_t size = 0) {
+    return std::make_shared<const std::string>(size > text.size() ? text + std::string(size - text.size(), ' ') : text);
+}
+
+std::string head(const std::shared_ptr<const std::string>& message) {
+    return message->substr(0, message->find(' '));
+}
+
+} // namespace
+
+TEST(OutboundLanesTest, KeepsOrderWithinALane) {
+    OutboundLanes lanes;
+    for (int i = 0; i < 200; ++i) {
+        lanes.push(Lane::chat, message("c" + std::to_string(i)));
+    }
+    EXPECT_EQ(lanes.size(), 200u);
+    EXPECT_EQ(lanes.size(Lane::chat), 200u);
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_EQ(*lanes.pop(), "c" + std::to_string(i));
+        if (i % 3 == 0) {
+            lanes.push(Lane::chat, message("c" + std::to_string(200 + i / 3)));
+        }
+    }
+    for (int i = 0; i < 67; ++i) {
+        ASSERT_EQ(*lanes.pop(), "c" + std::to_string(200 + i));
+    }
+    EXPECT_TRUE(lanes.empty());
+    EXPECT_EQ(lanes.bytes(), 0u);
+}
+
+TEST(OutboundLanesTest, ControlJumpsTheQueue) {
+    OutboundLanes lanes;
+    for (int i = 0; i < 1000; ++i) {
+        lanes.push(Lane::chat, message("chat", 512));
+        lanes.push(Lane::bulk, message("bulk", 4096));
+    }
+    lanes.pop();
+    lanes.push(Lane::control, message("control1"));
+    lanes.push(Lane::control, message("control2"));
+    EXPECT_EQ(*lanes.pop(), "control1");
+    EXPECT_EQ(*lanes.pop(), "control2");
+    EXPECT_EQ(lanes.size(Lane::control), 0u);
+}
+
+TEST(OutboundLanesTest, SaturatedLanesShareBytesByWeight) {
+    OutboundLanes lanes;
+    std::map<std::string, std::size_t> written;
+    auto const top_up = [&] {
+        // Every lane stays saturated
+        while (lanes.size(Lane::presence) < 4) {
+            lanes.push(Lane::presence, message("presence", 300));
+        }
+        while (lanes.size(Lane::chat) < 4) {
+            lanes.push(Lane::chat, message("chat", 200));
+        }
+        while (lanes.size(Lane::bulk) < 4) {
+            lanes.push(Lane::bulk, message("bulk", 16384)); // Larger than a quantum
+        }
+    };
+    std::size_t total = 0;
+    while (total < 16 * 1024 * 1024) {
+        top_up();
+        auto const next = lanes.pop();
+        written[head(next)] += next->size();
+        total += next->size();
+    }
+    auto const share = [&](const char* lane) { return static_cast<double>(written[lane]) / static_cast<double>(total); };
+    // Weights 2:4:1 of the quantum
+    EXPECT_NEAR(share("presence"), 2.0 / 7, 0.01);
+    EXPECT_NEAR(share("chat"), 4.0 / 7, 0.01);
+    EXPECT_NEAR(share("bulk"), 1.0 / 7, 0.01) << "Bulk is slowed, not starved";
+}
+
+TEST(OutboundLanesTest, IdleLanesDoNotSaveUp) {
+    OutboundLanes lanes;
+    for (int i = 0; i < 100; ++i) {
+        lanes.push(Lane::chat, message("chat", 100));
+    }
+    while (!lanes.empty()) {
+        lanes.pop();
+    }
+    // Bulk arrives now; chat keeps its full share from here on
+    for (int i = 0; i < 100; ++i) {
+        lanes.push(Lane::bulk, message("bulk", 4096));
+        lanes.push(Lane::chat, message("chat", 4096));
+    }
+    std::size_t chat_before_second_bulk = 0;
+    std::size_t bulk = 0;
+    while (bulk < 2) {
+        auto const next = lanes.pop();
+        if (head(next) == "bulk") {
+            ++bulk;
+        } else if (bulk == 1) {
+            ++chat_before_second_bulk;
+        }
+    }
+    EXPECT_EQ(chat_before_second_bulk, 4u); // One bulk quantum per four chat quanta
+    lanes.clear();
+    EXPECT_TRUE(lanes.empty());
+    EXPECT_EQ(lanes.size(Lane::chat), 0u);
+}
+
+namespace {
+
+class LanesIntegrationTest : public ::testing::TestWithParam<ServerOptions::SessionEngine> {
+protected:
+    using Client = websocket::stream<tcp::socket>;
+
+    void SetUp() override {
+        options_.presence_tick_ms = 0;
+        options_.session_engine = GetParam();
+        options_.send_buffer_bytes = 4096; // Backs up into the session's queue early
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+    }
+
+    void TearDown() override {
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+        std::cout.rdbuf(cout_buf_);
+        std::cerr.rdbuf(cerr_buf_);
+    }
+
+    std::unique_ptr<Client> connect() {
+        auto client = std::make_unique<Client>(client_ioc_);
+        client->next_layer().open(tcp::v4());
+        client->next_layer().set_option(net::socket_base::receive_buffer_size(4096));
+        client->next_layer().connect(server_->local_endpoint());
+        client->handshake("127.0.0.1", "/");
+        return client;
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::streambuf* cerr_buf_ = std::cerr.rdbuf(nullptr); // Write errors once the clients go away
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+};
+
+} // namespace
+
+TEST_P(LanesIntegrationTest, ControlMessageOvertakesASaturatedChatLane) {
+    constexpr int kChatMessages = 300;
+    auto reader = connect(); // Does not read until the end
+    auto sender = connect();
+    std::string const text(8192, 'x');
+    for (int i = 0; i < kChatMessages; ++i) {
+        sender->write(net::buffer(R"({"type":"client_send_message","payload":{"text":")" + text + "\"}}"));
+    }
+    // Queued behind the chat backlog, but in the control lane
+    reader->write(net::buffer(std::string(R"({"type":"client_enable_batching","payload":{}})")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Let the server queue everything
+
+    int chat_before = 0;
+    int chat_total = 0;
+    bool control_seen = false;
+    while (chat_total < kChatMessages) {
+        beast::flat_buffer buffer;
+        reader->read(buffer);
+        auto const frame = beast::buffers_to_string(buffer.data());
+        if (frame.find("server_batching_status") != std::string::npos) {
+            control_seen = true;
+        }
+        // Chat that arrives after batching is on may come several to a frame
+        for (auto at = frame.find("server_broadcast_message"); at != std::string::npos;
+             at = frame.find("server_broadcast_message", at + 1)) {
+            ++chat_total;
+            chat_before += control_seen ? 0 : 1;
+        }
+    }
+    ASSERT_TRUE(control_seen);
+    // Only what had already left the queue (socket buffers, the write in
+    // flight) can be ahead of it
+    EXPECT_LT(chat_before, kChatMessages / 4) << chat_before << " chat messages came first";
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, LanesIntegrationTest,
+                         ::testing::Values(ServerOptions::SessionEngine::callback
+#if defined(CHAT_HAS_CORO_SESSION)
+                                           ,
+                                           ServerOptions::SessionEngine::coroutine
+#endif
+                                           ),
+                         [](const ::testing::TestParamInfo<ServerOptions::SessionEngine>& info) {
+                             return std::string(info.param == ServerOptions::SessionEngine::callback ? "callback"
+                                                                                                      : "coroutine");
+                         });
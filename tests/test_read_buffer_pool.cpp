@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+#include "ChatClient.hpp"
+#include "ChatServer.hpp"
+#include "CoroSession.hpp"
+#include "ReadBufferPool.hpp"
+#include <boost/asio/buffer.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+TEST(PooledReadBufferTest, BorrowsOnPrepareAndReturnsOnRelease) {
+    auto const before = ReadBufferPool::stats();
+    PooledReadBuffer buffer;
+    EXPECT_FALSE(buffer.holds_storage());
+    EXPECT_EQ(buffer.size(), 0u);
+    EXPECT_EQ(net::buffer_size(buffer.data()), 0u);
+
+    std::string const text = "hello";
+    buffer.commit(net::buffer_copy(buffer.prepare(text.size()), net::buffer(text)));
+    EXPECT_TRUE(buffer.holds_storage());
+    EXPECT_EQ(beast::buffers_to_string(buffer.data()), text);
+    EXPECT_EQ(ReadBufferPool::stats().held_buffers, before.held_buffers + 1);
+
+    buffer.release(); // Unread bytes keep the storage
+    EXPECT_TRUE(buffer.holds_storage());
+
+    buffer.consume(buffer.size());
+    buffer.release();
+    EXPECT_FALSE(buffer.holds_storage());
+    EXPECT_EQ(ReadBufferPool::stats().held_buffers, before.held_buffers);
+    EXPECT_EQ(ReadBufferPool::stats().pooled_buffers, before.pooled_buffers + 1);
+
+    // The next borrower on this thread gets the pooled storage back
+    PooledReadBuffer other;
+    auto const capacity = net::buffer_size(other.prepare(1));
+    EXPECT_GE(capacity, 1u);
+    EXPECT_EQ(ReadBufferPool::stats().pooled_buffers, before.pooled_buffers);
+}
+
+TEST(PooledReadBufferTest, OversizedStorageIsNotPooled) {
+    PooledReadBuffer buffer;
+    buffer.prepare(ReadBufferPool::kMaxPooledCapacity * 2);
+    buffer.commit(ReadBufferPool::kMaxPooledCapacity * 2);
+    buffer.consume(buffer.size());
+    buffer.release();
+
+    PooledReadBuffer next;
+    next.prepare(1);
+    EXPECT_LE(next.capacity(), ReadBufferPool::kMaxPooledCapacity);
+}
+
+namespace {
+
+// Sends a large and a small message through a low-memory server and checks
+// that both sessions hold no read buffer once they are idle again.
+void expect_idle_sessions_hold_no_buffers(ServerOptions options) {
+    options.low_memory = true;
+    net::io_context server_ioc;
+    ChatServer server(server_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    server.run();
+    auto server_guard = net::make_work_guard(server_ioc);
+    std::thread server_thread([&] { server_ioc.run(); });
+    auto const port = std::to_string(server.local_endpoint().port());
+    auto const held_before = ReadBufferPool::stats().held_buffers;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int received = 0;
+    ChatClient receiver("127.0.0.1", port);
+    ChatClient sender("127.0.0.1", port);
+    ASSERT_TRUE(receiver.is_connected());
+    ASSERT_TRUE(sender.is_connected());
+    receiver.start([&](const std::string& message) {
+        if (message.find("server_broadcast_message") != std::string::npos) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++received;
+            cv.notify_all();
+        }
+    });
+    sender.start([](const std::string&) {});
+    std::thread receiver_thread([&] { receiver.io_context().run(); });
+    std::thread sender_thread([&] { sender.io_context().run(); });
+
+    std::string const big(100000, 'x'); // Larger than anything the pool keeps
+    sender.post("{\"type\":\"client_send_message\",\"payload\":{\"text\":\"" + big + "\"}}");
+    sender.post("{\"type\":\"client_send_message\",\"payload\":{\"text\":\"small\"}}");
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(10), [&] { return received >= 2; });
+    }
+    // Each session gave its buffer back before handling the message that was
+    // broadcast, so both sessions are idle without read storage now.
+    auto const held_idle = ReadBufferPool::stats().held_buffers;
+
+    sender.async_close();
+    receiver.async_close();
+    sender_thread.join();
+    receiver_thread.join();
+    server_guard.reset();
+    server_ioc.stop();
+    server_thread.join();
+
+    ASSERT_EQ(received, 2);
+    EXPECT_EQ(held_idle, held_before);
+}
+
+} // namespace
+
+TEST(LowMemoryModeTest, IdleSessionsHoldNoReadBuffers) {
+    expect_idle_sessions_hold_no_buffers(ServerOptions());
+}
+
+#if defined(CHAT_HAS_CORO_SESSION)
+TEST(LowMemoryModeTest, IdleCoroutineSessionsHoldNoReadBuffers) {
+    ServerOptions options;
+    options.session_engine = ServerOptions::SessionEngine::coroutine;
+    expect_idle_sessions_hold_no_buffers(options);
+}
+#endif
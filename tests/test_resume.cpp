@@ -0,0 +1,241 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "MessageHistory.hpp"
+#include <boost/json.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace json = boost::json;
+namespace websocket = beast::websocket;
+
+TEST(MessageHistoryTest, ReplaysWhatIsStillHeld) {
+    MessageHistory history(4);
+    for (int i = 1; i <= 6; ++i) {
+        history.append(std::make_shared<const std::string>("m" + std::to_string(i)));
+    }
+    EXPECT_EQ(history.last_seq(), 6u);
+    EXPECT_EQ(history.next_seq(), 7u);
+
+    auto const texts = [](const std::vector<std::shared_ptr<const std::string>>& messages) {
+        std::vector<std::string> out;
+        for (auto const& m : messages) {
+            out.push_back(*m);
+        }
+        return out;
+    };
+    std::vector<std::shared_ptr<const std::string>> out;
+    EXPECT_TRUE(history.since(3, out));
+    EXPECT_EQ(texts(out), (std::vector<std::string>{"m4", "m5", "m6"}));
+
+    out.clear();
+    EXPECT_TRUE(history.since(6, out)) << "Nothing missed";
+    EXPECT_TRUE(out.empty());
+
+    out.clear();
+    EXPECT_FALSE(history.since(1, out)) << "m2 has been overwritten";
+    EXPECT_EQ(texts(out), (std::vector<std::string>{"m3", "m4", "m5", "m6"}));
+
+    MessageHistory none(0);
+    none.append(std::make_shared<const std::string>("m1"));
+    out.clear();
+    EXPECT_FALSE(none.since(0, out));
+    EXPECT_TRUE(out.empty());
+}
+
+namespace {
+
+// Sessions drop and come back against an in-process server, with per-event
+// presence so that any presence change shows up in the message stream.
+class ResumeTest : public ::testing::Test {
+protected:
+    using Client = websocket::stream<tcp::socket>;
+
+    void start_server(int grace_ms) {
+        options_.presence_tick_ms = 0;
+        options_.resume_grace_ms = grace_ms;
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+    }
+
+    void TearDown() override {
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+        std::cout.rdbuf(cout_buf_);
+    }
+
+    std::unique_ptr<Client> connect(const std::string& target = "/") {
+        auto client = std::make_unique<Client>(client_ioc_);
+        client->next_layer().connect(server_->local_endpoint());
+        client->handshake("127.0.0.1", target);
+        return client;
+    }
+
+    static json::object read(Client& client) {
+        beast::flat_buffer buffer;
+        client.read(buffer);
+        return json::parse(beast::buffers_to_string(buffer.data())).as_object();
+    }
+
+    // Reads until a message of `type` arrives; everything read is kept in `seen`
+    static json::object read_until(Client& client, const std::string& type, std::vector<json::object>& seen) {
+        for (;;) {
+            seen.push_back(read(client));
+            if (seen.back().at("type").as_string() == type.c_str()) {
+                return seen.back();
+            }
+        }
+    }
+
+    static void say(Client& client, const std::string& text) {
+        client.write(net::buffer("{\"type\":\"client_send_message\",\"payload\":{\"text\":\"" + text + "\"}}"));
+    }
+
+    json::object resume_stats() {
+        return json::parse(server_->stats_json()).as_object().at("resume").as_object();
+    }
+
+    // Polls /stats until `key` of the resume section reaches `expected`
+    std::int64_t wait_for(const std::string& key, std::int64_t expected) {
+        for (int i = 0; i < 500 && resume_stats().at(key).to_number<std::int64_t>() != expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return resume_stats().at(key).to_number<std::int64_t>();
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+};
+
+} // namespace
+
+TEST_F(ResumeTest, DroppedClientCatchesUpWithoutPresenceChanges) {
+    start_server(30000);
+    auto observer = connect();
+    std::vector<json::object> seen;
+    read_until(*observer, "server_client_connected", seen);
+
+    auto dropper = connect();
+    auto const welcome = read(*dropper).at("payload").as_object();
+    std::string const user_id = welcome.at("user_id").as_string().c_str();
+    std::string const token = welcome.at("resume_token").as_string().c_str();
+    EXPECT_EQ(token.size(), 32u);
+    auto const connected = read(*dropper);
+    EXPECT_EQ(connected.at("type").as_string(), "server_client_connected");
+    std::uint64_t const last_seq = connected.at("seq").to_number<std::uint64_t>();
+    read_until(*observer, "server_client_connected", seen); // The dropper's
+    seen.clear();
+
+    // The network drops: no close frame
+    dropper->next_layer().close();
+    EXPECT_EQ(wait_for("parked", 1), 1);
+
+    for (auto const* text : {"m1", "m2", "m3"}) {
+        say(*observer, text);
+        read_until(*observer, "server_broadcast_message", seen);
+    }
+
+    auto resumed = connect("/?resume=" + token + "&last_seq=" + std::to_string(last_seq));
+    auto const hello = read(*resumed);
+    ASSERT_EQ(hello.at("type").as_string(), "server_session_resumed");
+    auto const& payload = hello.at("payload").as_object();
+    EXPECT_EQ(payload.at("user_id").as_string(), user_id.c_str());
+    EXPECT_EQ(payload.at("resume_token").as_string(), token.c_str());
+    EXPECT_TRUE(payload.at("complete").as_bool());
+    ASSERT_EQ(payload.at("replayed").to_number<std::uint64_t>(), 3u);
+    for (std::uint64_t i = 1; i <= 3; ++i) {
+        auto const missed = read(*resumed);
+        EXPECT_EQ(missed.at("type").as_string(), "server_broadcast_message");
+        EXPECT_EQ(missed.at("seq").to_number<std::uint64_t>(), last_seq + i);
+        EXPECT_EQ(missed.at("payload").as_object().at("text").as_string(), ("m" + std::to_string(i)).c_str());
+    }
+
+    // Same user, and the observer saw chat only: no disconnect, no connect
+    say(*resumed, "back");
+    auto const back = read(*resumed);
+    EXPECT_EQ(back.at("payload").as_object().at("user_id").as_string(), user_id.c_str());
+    EXPECT_EQ(back.at("seq").to_number<std::uint64_t>(), last_seq + 4);
+    auto const observed_back = read_until(*observer, "server_broadcast_message", seen);
+    EXPECT_EQ(observed_back.at("payload").as_object().at("text").as_string(), "back");
+    for (auto const& message : seen) {
+        EXPECT_EQ(message.at("type").as_string(), "server_broadcast_message") << json::serialize(message);
+    }
+    EXPECT_EQ(resume_stats().at("resumed").to_number<std::int64_t>(), 1);
+    EXPECT_EQ(resume_stats().at("parked").to_number<std::int64_t>(), 0);
+}
+
+TEST_F(ResumeTest, ResumingReplacesAConnectionThatLooksAlive) {
+    start_server(30000);
+    auto first = connect();
+    auto const welcome = read(*first).at("payload").as_object();
+    std::string const token = welcome.at("resume_token").as_string().c_str();
+    auto const last_seq = read(*first).at("seq").to_number<std::uint64_t>(); // Its own server_client_connected
+
+    // The client gave up on `first` before the server noticed anything
+    auto second = connect("/?resume=" + token + "&last_seq=" + std::to_string(last_seq));
+    auto const hello = read(*second);
+    ASSERT_EQ(hello.at("type").as_string(), "server_session_resumed");
+    EXPECT_EQ(hello.at("payload").as_object().at("user_id").as_string(), welcome.at("user_id").as_string());
+
+    // The old connection is closed by the server, without a goodbye
+    beast::flat_buffer buffer;
+    beast::error_code ec;
+    first->read(buffer, ec);
+    EXPECT_TRUE(ec);
+    EXPECT_NE(ec, websocket::error::closed);
+
+    // ...and is not reported as a disconnect
+    say(*second, "still here");
+    EXPECT_EQ(read(*second).at("type").as_string(), "server_broadcast_message");
+    EXPECT_EQ(json::parse(server_->stats_json()).as_object().at("sessions").as_int64(), 1);
+}
+
+TEST_F(ResumeTest, AfterTheGracePeriodTheClientStartsOver) {
+    start_server(100);
+    auto observer = connect();
+    std::vector<json::object> seen;
+    read_until(*observer, "server_client_connected", seen);
+
+    auto dropper = connect();
+    auto const welcome = read(*dropper).at("payload").as_object();
+    std::string const token = welcome.at("resume_token").as_string().c_str();
+    dropper->next_layer().close();
+    EXPECT_EQ(wait_for("parked", 1), 1);
+
+    // Announced once the grace period is over
+    auto const gone = read_until(*observer, "server_client_disconnected", seen);
+    EXPECT_EQ(gone.at("payload").as_object().at("user_id").as_string(), welcome.at("user_id").as_string());
+    EXPECT_EQ(wait_for("parked", 0), 0);
+
+    auto late = connect("/?resume=" + token + "&last_seq=0");
+    auto const fresh = read(*late);
+    ASSERT_EQ(fresh.at("type").as_string(), "server_session_welcome");
+    EXPECT_NE(fresh.at("payload").as_object().at("user_id").as_string(), welcome.at("user_id").as_string());
+    EXPECT_NE(fresh.at("payload").as_object().at("resume_token").as_string(), token.c_str());
+}
+
+TEST_F(ResumeTest, CloseFrameEndsTheSessionAtOnce) {
+    start_server(30000);
+    auto observer = connect();
+    std::vector<json::object> seen;
+    read_until(*observer, "server_client_connected", seen);
+
+    auto leaver = connect();
+    read(*leaver);
+    leaver->close(websocket::close_code::normal);
+    read_until(*observer, "server_client_disconnected", seen);
+    EXPECT_EQ(resume_stats().at("parked").to_number<std::int64_t>(), 0);
+}
@@ -4,9 +4,13 @@
 #include "Session.hpp"
 #include "Utils.hpp" // For timestamp, if we match it, though it's tricky
 #include <boost/json.hpp>
+#include <algorithm>
 #include <string>
 #include <memory>
 #include <vector> // To store captured messages
+#include <iostream>
+#include <chrono>
+#include <thread>
 
 // Using declarations for GMock might be needed if we use more advanced GMock features
 using ::testing::_;
@@ -33,7 +37,7 @@ public:
     }
 
     // Override send to capture messages
-    void send(std::shared_ptr<const std::string> ss) override {
+    void send(std::shared_ptr<const std::string> ss, Lane) override {
         captured_messages.push_back(*ss);
     }
 
@@ -55,8 +59,18 @@ protected:
     // Store capturing sessions to inspect their messages
     std::vector<std::shared_ptr<CapturingSession>> capturing_sessions_list_;
 
+    // These tests cover the per-event presence broadcasts; presence
+    // coalescing has its own fixture below.
+    ServerOptions options_ = legacy_presence_options();
+
+    static ServerOptions legacy_presence_options() {
+        ServerOptions options;
+        options.presence_tick_ms = 0;
+        return options;
+    }
+
     void SetUp() override {
-        server_ = std::make_unique<ChatServer>(ioc_, endpoint_);
+        server_ = std::make_unique<ChatServer>(ioc_, endpoint_, options_);
         // ChatServer itself doesn't listen or accept in unit tests unless run() is called.
         // We will manually add sessions.
     }
@@ -228,8 +242,220 @@ TEST_F(ChatServerTest, SessionInternalNicknameLogic) {
     session_to_test_nick->set_nickname(new_nick);
     EXPECT_EQ(session_to_test_nick->get_nickname(), new_nick);
 }
-```
-tests/test_server_functionality.cpp created successfully.
-```
 
-Now, I'll modify `CMakeLists.txt` to include this new test file. I need to see its content first.
+// Counts what the server sends without keeping it, for storms with many
+// thousands of sessions.
+struct SendCounter {
+    std::size_t messages = 0;
+    std::size_t bytes = 0;
+};
+
+class CountingSession : public Session {
+public:
+    CountingSession(net::io_context& ioc, ChatServer& server, SendCounter& counter)
+        : Session(ioc, tcp::socket(ioc), server), counter_(counter) {}
+
+    void send(std::shared_ptr<const std::string> ss, Lane) override {
+        ++counter_.messages;
+        counter_.bytes += ss->size();
+    }
+
+private:
+    SendCounter& counter_;
+};
+
+class PresenceCoalescingTest : public ChatServerTest {
+protected:
+    PresenceCoalescingTest() {
+        // Long enough that the timer never fires; the tests tick by hand.
+        options_.presence_tick_ms = 60000;
+    }
+
+    static json::object payload_of(const std::string& message, const std::string& expected_type) {
+        json::object obj = json::parse(message).as_object();
+        EXPECT_EQ(obj.at("type").as_string(), expected_type.c_str());
+        return obj.at("payload").as_object();
+    }
+
+    static std::vector<std::string> nicknames(const json::value& entries) {
+        std::vector<std::string> out;
+        for (auto const& entry : entries.as_array()) {
+            out.emplace_back(entry.as_array()[1].as_string().c_str());
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    // Runs a reconnect storm of `clients` sessions: everyone connects, the
+    // network blips, and everyone disconnects and comes back as a new session.
+    // The server ticks `ticks_per_phase` times while each phase is under way.
+    // Returns the presence traffic of the blip alone.
+    SendCounter reconnect_storm(std::size_t clients, int ticks_per_phase) {
+        SendCounter counter;
+        std::vector<std::shared_ptr<Session>> sessions;
+        auto connect_all = [&] {
+            for (std::size_t i = 0; i < clients; ++i) {
+                sessions.push_back(std::make_shared<CountingSession>(ioc_, *server_, counter));
+                server_->on_client_connect(sessions.back());
+                if ((i + 1) % (clients / ticks_per_phase) == 0) {
+                    server_->flush_presence();
+                }
+            }
+            server_->flush_presence();
+        };
+
+        auto* const cout_buf = std::cout.rdbuf(nullptr); // Per-connection logging
+        connect_all();
+        counter = SendCounter{};
+
+        auto old_sessions = std::move(sessions);
+        sessions.clear();
+        for (std::size_t i = 0; i < old_sessions.size(); ++i) {
+            server_->on_client_disconnect(old_sessions[i]);
+            if ((i + 1) % (clients / ticks_per_phase) == 0) {
+                server_->flush_presence();
+            }
+        }
+        connect_all();
+        SendCounter const storm = counter;
+
+        for (auto const& session : sessions) {
+            server_->on_client_disconnect(session);
+        }
+        server_->flush_presence();
+        std::cout.rdbuf(cout_buf);
+        return storm;
+    }
+};
+
+TEST_F(PresenceCoalescingTest, NewClientGetsRosterSnapshotAndOthersOneDeltaPerTick) {
+    auto observer = add_capturing_session_to_server("Observer");
+    EXPECT_TRUE(observer->captured_messages.empty()) << "Presence waits for the tick";
+    server_->flush_presence();
+    ASSERT_EQ(observer->captured_messages.size(), 1u);
+    EXPECT_EQ(nicknames(payload_of(observer->captured_messages[0], "server_roster_snapshot").at("users")),
+              (std::vector<std::string>{"Observer"}));
+
+    auto alice = add_capturing_session_to_server("Alice");
+    auto bob = add_capturing_session_to_server("Bob");
+    EXPECT_EQ(observer->captured_messages.size(), 1u);
+    server_->flush_presence();
+
+    // The observer hears about both joins in a single delta...
+    ASSERT_EQ(observer->captured_messages.size(), 2u);
+    auto const delta = payload_of(observer->captured_messages[1], "server_presence_delta");
+    EXPECT_EQ(nicknames(delta.at("joined")), (std::vector<std::string>{"Alice", "Bob"}));
+    EXPECT_TRUE(delta.at("left").as_array().empty());
+    EXPECT_EQ(delta.at("online").as_int64(), 3);
+
+    // ...and each newcomer gets just the roster, which includes itself.
+    for (auto const& joiner : {alice, bob}) {
+        ASSERT_EQ(joiner->captured_messages.size(), 1u);
+        EXPECT_EQ(nicknames(payload_of(joiner->captured_messages[0], "server_roster_snapshot").at("users")),
+                  (std::vector<std::string>{"Alice", "Bob", "Observer"}));
+    }
+
+    // Nothing changed, so the next tick is silent.
+    server_->flush_presence();
+    EXPECT_EQ(observer->captured_messages.size(), 2u);
+}
+
+TEST_F(PresenceCoalescingTest, LeaversAreReportedInTheNextDelta) {
+    auto observer = add_capturing_session_to_server("Observer");
+    auto leaver = add_capturing_session_to_server("Leaver");
+    server_->flush_presence();
+    observer->captured_messages.clear();
+
+    std::string const leaver_id = leaver->get_id();
+    server_->on_client_disconnect(leaver);
+    server_->flush_presence();
+
+    ASSERT_EQ(observer->captured_messages.size(), 1u);
+    auto const delta = payload_of(observer->captured_messages[0], "server_presence_delta");
+    ASSERT_EQ(delta.at("left").as_array().size(), 1u);
+    auto const& gone = delta.at("left").as_array()[0].as_array();
+    EXPECT_EQ(gone[0].as_string(), leaver_id.c_str());
+    EXPECT_EQ(gone[1].as_string(), "Leaver");
+    EXPECT_EQ(delta.at("online").as_int64(), 1);
+}
+
+TEST_F(PresenceCoalescingTest, JoinAndLeaveWithinOneTickCancelOut) {
+    auto observer = add_capturing_session_to_server("Observer");
+    server_->flush_presence();
+    observer->captured_messages.clear();
+
+    auto flapper = add_capturing_session_to_server("Flapper");
+    server_->on_client_disconnect(flapper);
+    server_->flush_presence();
+
+    EXPECT_TRUE(observer->captured_messages.empty());
+    EXPECT_TRUE(flapper->captured_messages.empty());
+}
+
+// 10k clients drop and reconnect. With coalescing every client gets at most
+// one presence message per tick, so the blip costs O(N) messages; per-event
+// broadcasts cost O(N^2).
+TEST_F(PresenceCoalescingTest, ReconnectStormMessageVolumeStaysLinear) {
+    constexpr int kTicksPerPhase = 4;
+    auto const per_client = [](const SendCounter& c, std::size_t n) {
+        return static_cast<double>(c.messages) / static_cast<double>(n);
+    };
+
+    SendCounter const small = reconnect_storm(1000, kTicksPerPhase);
+    SendCounter const large = reconnect_storm(10000, kTicksPerPhase);
+    // Disconnect phase: one delta per tick to whoever is still connected.
+    // Reconnect phase: one roster snapshot per new client plus one delta per
+    // tick to those who joined in earlier ticks.
+    EXPECT_LE(large.messages, static_cast<std::size_t>(2 * kTicksPerPhase) * 10000);
+    EXPECT_DOUBLE_EQ(per_client(large, 10000), per_client(small, 1000));
+
+    // The same storm with per-event broadcasts, for scale (kept smaller: it
+    // is quadratic).
+    TearDown();
+    options_.presence_tick_ms = 0;
+    SetUp();
+    SendCounter const per_event = reconnect_storm(1000, kTicksPerPhase);
+    EXPECT_GE(per_event.messages, std::size_t{1000} * 1000);
+
+    std::cerr << "[ presence ] reconnect storm, messages per client: coalesced " << per_client(small, 1000)
+              << " (1k clients), " << per_client(large, 10000) << " (10k clients); per-event "
+              << per_client(per_event, 1000) << " (1k clients)" << std::endl;
+}
+
+// Connections join the session set (and presence) only once the websocket
+// upgrade has succeeded.
+TEST(ChatServerUpgradeTest, SessionsAreRegisteredOnlyAfterTheUpgrade) {
+    net::io_context server_ioc;
+    ChatServer server(server_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, ServerOptions());
+    server.run();
+    auto guard = net::make_work_guard(server_ioc);
+    std::thread server_thread([&] { server_ioc.run(); });
+    auto const session_count = [&server] {
+        return json::parse(server.stats_json()).as_object().at("sessions").as_int64();
+    };
+    auto const wait_for_count = [&](std::int64_t expected) {
+        for (int i = 0; i < 500 && session_count() != expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return session_count();
+    };
+
+    net::io_context client_ioc;
+    tcp::socket idle(client_ioc); // Connected, never upgrades
+    idle.connect(server.local_endpoint());
+    beast::websocket::stream<tcp::socket> ws(client_ioc);
+    ws.next_layer().connect(server.local_endpoint());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(session_count(), 0);
+
+    ws.handshake("127.0.0.1", "/");
+    EXPECT_EQ(wait_for_count(1), 1);
+
+    ws.close(beast::websocket::close_code::normal);
+    EXPECT_EQ(wait_for_count(0), 0);
+
+    idle.close();
+    guard.reset();
+    server_ioc.stop();
+    server_thread.join();
+}
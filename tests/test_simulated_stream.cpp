@@ -0,0 +1,190 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "CoroSession.hpp"
+#include "SimulatedStream.hpp"
+#include <boost/asio/use_future.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// Runs an io_context on its own thread, so a test can wait on futures
+class SimulatedStreamTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        guard_.reset();
+        ioc_.stop();
+        thread_.join();
+    }
+
+    std::pair<SimulatedStream, SimulatedStream> make_pair(const SimulatedStream::Link& link = {}) {
+        return SimulatedStream::make_pair(ioc_.get_executor(), ioc_.get_executor(), link);
+    }
+
+    static std::size_t write(SimulatedStream& stream, const std::string& bytes) {
+        return stream.async_write_some(net::buffer(bytes), net::use_future).get();
+    }
+
+    static std::string read(SimulatedStream& stream, std::size_t max = 65536) {
+        std::string bytes(max, '\0');
+        bytes.resize(stream.async_read_some(net::buffer(bytes), net::use_future).get());
+        return bytes;
+    }
+
+    net::io_context ioc_;
+    net::executor_work_guard<net::io_context::executor_type> guard_ = net::make_work_guard(ioc_);
+    std::thread thread_{[this] { ioc_.run(); }};
+};
+
+} // namespace
+
+TEST_F(SimulatedStreamTest, DeliversBytesInOrder) {
+    auto [a, b] = make_pair();
+    EXPECT_EQ(write(a, "hello"), 5u);
+    EXPECT_EQ(write(a, " world"), 6u);
+    EXPECT_EQ(write(b, "back"), 4u);
+    EXPECT_EQ(read(b), "hello world");
+    EXPECT_EQ(read(a), "back");
+}
+
+TEST_F(SimulatedStreamTest, AppliesLatency) {
+    SimulatedStream::Link link;
+    link.latency = std::chrono::milliseconds(30);
+    auto [a, b] = make_pair(link);
+    auto const start = clock_type::now();
+    write(a, "ping");
+    EXPECT_LT(clock_type::now() - start, link.latency); // The writer does not wait for it to arrive
+    EXPECT_EQ(read(b), "ping");
+    EXPECT_GE(clock_type::now() - start, link.latency);
+}
+
+TEST_F(SimulatedStreamTest, LimitsBandwidth) {
+    SimulatedStream::Link link;
+    link.bytes_per_second = 1000000;
+    auto [a, b] = make_pair(link);
+    auto const start = clock_type::now();
+    write(a, std::string(20000, 'x'));
+    write(a, std::string(20000, 'y')); // Sent after the first: 40 ms for both
+    std::string received;
+    while (received.size() < 40000) {
+        received += read(b);
+    }
+    EXPECT_GE(clock_type::now() - start, std::chrono::milliseconds(40));
+    EXPECT_EQ(received, std::string(20000, 'x') + std::string(20000, 'y'));
+}
+
+TEST_F(SimulatedStreamTest, WriterWaitsWhileTheLinkIsFull) {
+    SimulatedStream::Link link;
+    link.buffer_bytes = 1024;
+    auto [a, b] = make_pair(link);
+    EXPECT_EQ(write(a, std::string(4096, 'x')), 1024u); // Cut to the free space
+
+    std::string const more(100, 'y');
+    auto pending = a.async_write_some(net::buffer(more), net::use_future);
+    EXPECT_EQ(pending.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+    EXPECT_EQ(read(b, 512).size(), 512u);
+    EXPECT_EQ(pending.get(), 100u);
+    EXPECT_EQ(read(b), std::string(512, 'x') + more);
+}
+
+TEST_F(SimulatedStreamTest, CloseEndsTheStream) {
+    auto [a, b] = make_pair();
+    write(a, "last");
+    a.close();
+    EXPECT_FALSE(b.is_open());
+    EXPECT_EQ(read(b), "last"); // What was in flight still arrives
+    EXPECT_THROW(read(b), boost::system::system_error);
+    EXPECT_THROW(write(b, "late"), boost::system::system_error);
+}
+
+namespace {
+
+// Simulated clients of a ChatServer, across session engines
+class SimulatedClientsTest : public ::testing::TestWithParam<ServerOptions::SessionEngine> {
+protected:
+    using Client = websocket::stream<SimulatedStream>;
+
+    void SetUp() override {
+        options_.presence_tick_ms = 0;
+        options_.session_engine = GetParam();
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+        client_thread_ = std::thread([this] { client_ioc_.run(); });
+    }
+
+    void TearDown() override {
+        clients_.clear();
+        client_guard_.reset();
+        client_ioc_.stop();
+        client_thread_.join();
+        server_guard_.reset();
+        server_ioc_.stop();
+        server_thread_.join();
+        std::cout.rdbuf(cout_buf_);
+        std::cerr.rdbuf(cerr_buf_);
+    }
+
+    Client& connect() {
+        auto ends = SimulatedStream::make_pair(client_ioc_.get_executor(), net::make_strand(server_ioc_));
+        server_->connect_simulated(server_ioc_, std::move(ends.second));
+        clients_.push_back(std::make_unique<Client>(std::move(ends.first)));
+        clients_.back()->async_handshake("127.0.0.1", "/", net::use_future).get();
+        return *clients_.back();
+    }
+
+    // Reads frames until one contains `text`
+    static void read_until(Client& client, const std::string& text) {
+        for (;;) {
+            beast::flat_buffer buffer;
+            client.async_read(buffer, net::use_future).get();
+            if (beast::buffers_to_string(buffer.data()).find(text) != std::string::npos) {
+                return;
+            }
+        }
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::streambuf* cerr_buf_ = std::cerr.rdbuf(nullptr);
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> client_guard_ = net::make_work_guard(client_ioc_);
+    std::thread client_thread_;
+    std::vector<std::unique_ptr<Client>> clients_;
+};
+
+} // namespace
+
+TEST_P(SimulatedClientsTest, BroadcastReachesEveryClient) {
+    constexpr int kClients = 50;
+    for (int i = 0; i < kClients; ++i) {
+        connect();
+    }
+    std::string const message = R"({"type":"client_send_message","payload":{"text":"over the simulated link"}})";
+    clients_.front()->async_write(net::buffer(message), net::use_future).get();
+    for (auto& client : clients_) {
+        read_until(*client, "over the simulated link");
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, SimulatedClientsTest,
+                         ::testing::Values(ServerOptions::SessionEngine::callback
+#if defined(CHAT_HAS_CORO_SESSION)
+                                           ,
+                                           ServerOptions::SessionEngine::coroutine
+#endif
+                                           ),
+                         [](const ::testing::TestParamInfo<ServerOptions::SessionEngine>& info) {
+                             return std::string(info.param == ServerOptions::SessionEngine::callback ? "callback"
+                                                                                                      : "coroutine");
+                         });
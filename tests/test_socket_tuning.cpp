@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+#include "ServerOptions.hpp"
+#include "SocketTuning.hpp"
+#include <boost/asio.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Connected loopback pair; returns the accepted (server-side) socket.
+tcp::socket accept_loopback(net::io_context& ioc, tcp::socket& client) {
+    tcp::acceptor acceptor(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0});
+    client.connect(acceptor.local_endpoint());
+    return acceptor.accept();
+}
+
+ServerOptions parse(std::vector<std::string> args) {
+    std::vector<char*> argv;
+    for (auto& a : args) {
+        argv.push_back(a.data());
+    }
+    return ServerOptions::parse(static_cast<int>(argv.size()), argv.data());
+}
+
+} // namespace
+
+TEST(SocketTuningTest, AppliesConfiguredOptionsToAcceptedSocket) {
+    net::io_context ioc;
+    tcp::socket client(ioc);
+    tcp::socket accepted = accept_loopback(ioc, client);
+
+    ServerOptions options;
+    options.send_buffer_bytes = 64 * 1024;
+    options.recv_buffer_bytes = 32 * 1024;
+    options.notsent_lowat_bytes = 16 * 1024;
+    ASSERT_FALSE(SocketTuning::apply(accepted, options));
+
+    tcp::no_delay no_delay;
+    accepted.get_option(no_delay);
+    EXPECT_TRUE(no_delay.value());
+    net::socket_base::send_buffer_size send_buffer;
+    accepted.get_option(send_buffer);
+    EXPECT_GE(send_buffer.value(), options.send_buffer_bytes); // Linux reports twice the request
+    net::socket_base::receive_buffer_size recv_buffer;
+    accepted.get_option(recv_buffer);
+    EXPECT_GE(recv_buffer.value(), options.recv_buffer_bytes);
+
+    options.tcp_nodelay = false;
+    ASSERT_FALSE(SocketTuning::apply(accepted, options));
+    accepted.get_option(no_delay);
+    EXPECT_FALSE(no_delay.value());
+}
+
+TEST(SocketTuningTest, CorkTogglesWhenSupported) {
+    if (!SocketTuning::cork_supported()) {
+        GTEST_SKIP() << "TCP_CORK is not available on this platform";
+    }
+    net::io_context ioc;
+    tcp::socket client(ioc);
+    tcp::socket accepted = accept_loopback(ioc, client);
+    EXPECT_FALSE(SocketTuning::set_cork(accepted, true));
+    EXPECT_FALSE(SocketTuning::set_cork(accepted, false));
+}
+
+TEST(SocketTuningTest, ParsesTuningFlags) {
+    auto const defaults = parse({"server", "8080"});
+    EXPECT_TRUE(defaults.tcp_nodelay);
+    EXPECT_EQ(defaults.send_buffer_bytes, 0);
+    EXPECT_FALSE(defaults.cork_writes);
+
+    auto const tuned = parse({"server", "8080", "--tcp-nodelay=off", "--send-buffer=262144",
+                              "--recv-buffer=131072", "--notsent-lowat=16384", "--cork-writes=on"});
+    EXPECT_FALSE(tuned.tcp_nodelay);
+    EXPECT_EQ(tuned.send_buffer_bytes, 262144);
+    EXPECT_EQ(tuned.recv_buffer_bytes, 131072);
+    EXPECT_EQ(tuned.notsent_lowat_bytes, 16384);
+    EXPECT_TRUE(tuned.cork_writes);
+
+    EXPECT_THROW(parse({"server", "8080", "--tcp-nodelay=maybe"}), std::invalid_argument);
+    EXPECT_THROW(parse({"server", "8080", "--send-buffer=-1"}), std::invalid_argument);
+}
@@ -0,0 +1,305 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "CoroSession.hpp"
+#include "OutboundLanes.hpp"
+#include "Session.hpp"
+#include "StreamedPayload.hpp"
+#include <boost/json.hpp>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace json = boost::json;
+
+namespace {
+
+std::string pattern(std::size_t size) {
+    std::string out(size, '\0');
+    for (std::size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<char>((i * 7 + i / 251) & 0xff);
+    }
+    return out;
+}
+
+// Feeds `data` to the sink in reads of at most `fragment` bytes, as a socket would
+void feed(PayloadSink& sink, const std::string& data, std::size_t fragment) {
+    for (std::size_t offset = 0; offset < data.size();) {
+        auto const space = sink.prepare();
+        auto const n = std::min({fragment, space.size(), data.size() - offset});
+        std::memcpy(space.data(), data.data() + offset, n);
+        sink.commit(n);
+        offset += n;
+    }
+}
+
+std::string contents(const StreamedPayload& payload) {
+    std::string out;
+    for (std::size_t i = 0; i < payload.chunk_count(); ++i) {
+        out += payload.chunk(i);
+    }
+    return out;
+}
+
+// Records the messages it is sent
+class CapturingSession : public Session {
+public:
+    CapturingSession(net::io_context& ioc, ChatServer& server) : Session(ioc, tcp::socket(ioc), server) {}
+
+    void send(std::shared_ptr<const std::string> ss, Lane lane) override {
+        received.push_back(ss);
+        lanes.push_back(lane);
+    }
+
+    std::vector<std::shared_ptr<const std::string>> received;
+    std::vector<Lane> lanes;
+};
+
+} // namespace
+
+TEST(PayloadSinkTest, KeepsFragmentsInChunks) {
+    for (std::size_t const fragment : {std::size_t{1000}, std::size_t{65536}, std::size_t{100000}}) {
+        auto const data = pattern(3 * StreamedPayload::kChunkBytes + 123);
+        PayloadSink sink(data.size(), true);
+        feed(sink, data, fragment);
+        EXPECT_TRUE(sink.kept());
+        EXPECT_EQ(sink.received(), data.size());
+        auto const payload = sink.finish();
+        ASSERT_TRUE(payload);
+        EXPECT_EQ(payload->size(), data.size());
+        EXPECT_EQ(payload->chunk_count(), 4u);
+        EXPECT_EQ(payload->chunk(3).size(), 123u);
+        EXPECT_EQ(contents(*payload), data) << "fragment " << fragment;
+    }
+}
+
+TEST(PayloadSinkTest, CountsWithoutKeepingOverTheLimit) {
+    PayloadSink sink(100000, true);
+    feed(sink, pattern(300000), 4096);
+    EXPECT_FALSE(sink.kept());
+    EXPECT_EQ(sink.received(), 300000u);
+    EXPECT_EQ(sink.finish(), nullptr);
+
+    // A refused upload reads everything into the same chunk
+    PayloadSink discard(0, false);
+    auto const* storage = discard.prepare().data();
+    feed(discard, pattern(1000000), 50000);
+    EXPECT_EQ(discard.prepare().data(), storage);
+    EXPECT_EQ(discard.received(), 1000000u);
+    EXPECT_EQ(discard.finish(), nullptr);
+}
+
+TEST(StreamedPayloadTest, MessagesCarryTheirPayload) {
+    PayloadSink sink(5000, true);
+    feed(sink, pattern(5000), 5000);
+    std::shared_ptr<const StreamedPayload> payload = sink.finish();
+    auto const message = StreamedPayload::make_message("{\"type\":\"announce\"}", payload);
+    EXPECT_EQ(*message, "{\"type\":\"announce\"}");
+    EXPECT_EQ(StreamedPayload::of(message), payload.get());
+    EXPECT_EQ(StreamedPayload::wire_size(message), message->size() + 5000);
+
+    auto const plain = std::make_shared<const std::string>("plain");
+    EXPECT_EQ(StreamedPayload::of(plain), nullptr);
+    EXPECT_EQ(StreamedPayload::wire_size(plain), 5u);
+
+    OutboundLanes lanes;
+    lanes.push(Lane::bulk, message);
+    lanes.push(Lane::chat, plain);
+    EXPECT_EQ(lanes.bytes(), message->size() + 5000 + 5);
+}
+
+TEST(StreamedPayloadTest, SharedFileIsQueuedByReference) {
+    net::io_context ioc;
+    ServerOptions options;
+    options.presence_tick_ms = 3600 * 1000; // Keep presence traffic out of the way
+    ChatServer server(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options);
+    auto* const cout_buf = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::vector<std::shared_ptr<CapturingSession>> sessions;
+    for (int i = 0; i < 4; ++i) {
+        sessions.push_back(std::make_shared<CapturingSession>(ioc, server));
+        server.on_client_connect(sessions.back());
+    }
+
+    PayloadSink sink(200000, true);
+    feed(sink, pattern(200000), 8192);
+    auto const payload = sink.finish();
+    server.share_file(sessions[0], "cat.png", "image/png", payload);
+    std::cout.rdbuf(cout_buf);
+
+    EXPECT_TRUE(sessions[0]->received.empty()) << "The sender is not sent its own file";
+    for (std::size_t i = 1; i < sessions.size(); ++i) {
+        ASSERT_EQ(sessions[i]->received.size(), 1u);
+        EXPECT_EQ(sessions[i]->received[0], sessions[1]->received[0]);
+        EXPECT_EQ(StreamedPayload::of(sessions[i]->received[0]), payload.get());
+        EXPECT_EQ(sessions[i]->lanes[0], Lane::bulk);
+        auto const announcement = json::parse(*sessions[i]->received[0]).as_object();
+        EXPECT_EQ(announcement.at("type").as_string(), "server_file_shared");
+        auto const& fields = announcement.at("payload").as_object();
+        EXPECT_EQ(fields.at("user_id").as_string(), sessions[0]->get_id());
+        EXPECT_EQ(fields.at("name").as_string(), "cat.png");
+        EXPECT_EQ(fields.at("mime").as_string(), "image/png");
+        EXPECT_EQ(fields.at("size").to_number<std::size_t>(), 200000u);
+    }
+}
+
+namespace {
+
+class FileSharingTest : public ::testing::TestWithParam<ServerOptions::SessionEngine> {
+protected:
+    using Client = websocket::stream<tcp::socket>;
+
+    void SetUp() override {
+        options_.presence_tick_ms = 3600 * 1000; // Keep presence traffic out of the way
+        options_.session_engine = GetParam();
+        options_.max_file_bytes = 1024 * 1024;
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+        sender_ = connect();
+        receiver_ = connect();
+    }
+
+    void TearDown() override {
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+        std::cout.rdbuf(cout_buf_);
+        std::cerr.rdbuf(cerr_buf_);
+    }
+
+    std::unique_ptr<Client> connect() {
+        auto client = std::make_unique<Client>(client_ioc_);
+        client->next_layer().connect(server_->local_endpoint());
+        client->handshake("127.0.0.1", "/");
+        beast::flat_buffer buffer;
+        client->read(buffer); // server_session_welcome
+        return client;
+    }
+
+    void announce(const std::string& name, std::int64_t size) {
+        sender_->text(true);
+        sender_->write(net::buffer(json::serialize(json::object{
+            {"type", "client_share_file"},
+            {"payload", {{"name", name}, {"mime", "application/pdf"}, {"size", size}}}})));
+    }
+
+    // Sends `data` as one binary message in several fragments
+    void send_file(const std::string& data) {
+        sender_->binary(true);
+        std::size_t const fragment = 100000;
+        for (std::size_t offset = 0; offset < data.size(); offset += fragment) {
+            auto const n = std::min(fragment, data.size() - offset);
+            sender_->write_some(offset + n == data.size(), net::buffer(data.data() + offset, n));
+        }
+        sender_->text(true);
+    }
+
+    void chat(const std::string& text) {
+        sender_->text(true);
+        sender_->write(net::buffer(json::serialize(
+            json::object{{"type", "client_send_message"}, {"payload", {{"text", text}}}})));
+    }
+
+    // The next message for `client`, and whether it was binary
+    static std::pair<std::string, bool> read(Client& client) {
+        beast::flat_buffer buffer;
+        client.read(buffer);
+        return {beast::buffers_to_string(buffer.data()), client.got_binary()};
+    }
+
+    static std::string type_of(const std::string& message) {
+        return json::parse(message).as_object().at("type").as_string().c_str();
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::streambuf* cerr_buf_ = std::cerr.rdbuf(nullptr); // Refused files
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+    std::unique_ptr<Client> sender_;
+    std::unique_ptr<Client> receiver_;
+};
+
+} // namespace
+
+TEST_P(FileSharingTest, FileReachesTheOtherClientsAsOneBinaryMessage) {
+    auto const data = pattern(700000); // Several chunks, fragments not aligned to them
+    announce("report.pdf", static_cast<std::int64_t>(data.size()));
+    send_file(data);
+    chat("after the file");
+
+    // The file is in the bulk lane, so the chat message may overtake it, but
+    // never come between the announcement and the file
+    auto [announcement, announcement_binary] = read(*receiver_);
+    bool const chat_first = !announcement_binary && type_of(announcement) == "server_broadcast_message";
+    if (chat_first) {
+        std::tie(announcement, announcement_binary) = read(*receiver_);
+    }
+    EXPECT_FALSE(announcement_binary);
+    auto const fields = json::parse(announcement).as_object().at("payload").as_object();
+    EXPECT_EQ(type_of(announcement), "server_file_shared");
+    EXPECT_EQ(fields.at("name").as_string(), "report.pdf");
+    EXPECT_EQ(fields.at("mime").as_string(), "application/pdf");
+    EXPECT_EQ(fields.at("size").to_number<std::size_t>(), data.size());
+    auto const [file, file_binary] = read(*receiver_);
+    EXPECT_TRUE(file_binary);
+    EXPECT_TRUE(file == data);
+    if (!chat_first) {
+        EXPECT_EQ(type_of(read(*receiver_).first), "server_broadcast_message");
+    }
+
+    // The sender only sees its chat message
+    EXPECT_EQ(type_of(read(*sender_).first), "server_broadcast_message");
+}
+
+TEST_P(FileSharingTest, RefusedFileIsReadAndDiscarded) {
+    auto const data = pattern(2 * 1024 * 1024); // Over --max-file-bytes
+    announce("big.iso", static_cast<std::int64_t>(data.size()));
+    send_file(data);
+    chat("still here");
+
+    auto const refused = json::parse(read(*sender_).first).as_object();
+    EXPECT_EQ(refused.at("type").as_string(), "server_file_refused");
+    EXPECT_EQ(refused.at("payload").as_object().at("name").as_string(), "big.iso");
+    EXPECT_EQ(type_of(read(*sender_).first), "server_broadcast_message");
+    EXPECT_EQ(type_of(read(*receiver_).first), "server_broadcast_message") << "Nothing of the file was shared";
+}
+
+TEST_P(FileSharingTest, FileThatDoesNotMatchItsAnnouncementIsRefused) {
+    announce("short.bin", 500000);
+    send_file(pattern(400000));
+    announce("long.bin", 500000);
+    send_file(pattern(600000));
+    // Announced, but a text message comes instead
+    announce("never.bin", 1000);
+    chat("changed my mind");
+
+    for (char const* expected : {"short.bin", "long.bin"}) {
+        auto const refused = json::parse(read(*sender_).first).as_object();
+        EXPECT_EQ(refused.at("type").as_string(), "server_file_refused");
+        EXPECT_EQ(refused.at("payload").as_object().at("name").as_string(), expected);
+    }
+    EXPECT_EQ(type_of(read(*sender_).first), "server_broadcast_message");
+    EXPECT_EQ(type_of(read(*receiver_).first), "server_broadcast_message");
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, FileSharingTest,
+                         ::testing::Values(ServerOptions::SessionEngine::callback
+#if defined(CHAT_HAS_CORO_SESSION)
+                                           ,
+                                           ServerOptions::SessionEngine::coroutine
+#endif
+                                           ),
+                         [](const ::testing::TestParamInfo<ServerOptions::SessionEngine>& info) {
+                             return std::string(info.param == ServerOptions::SessionEngine::callback ? "callback"
+                                                                                                      : "coroutine");
+                         });
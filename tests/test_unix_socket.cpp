@@ -0,0 +1,142 @@
+#include "gtest/gtest.h"
+#include "ChatServer.hpp"
+#include "CoroSession.hpp"
+#include "Session.hpp"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+using local_stream = net::local::stream_protocol;
+
+class UnixSocketTest : public ::testing::TestWithParam<ServerOptions::SessionEngine> {
+protected:
+    using LocalClient = websocket::stream<local_stream::socket>;
+    using TcpClient = websocket::stream<tcp::socket>;
+
+    void SetUp() override {
+        options_.presence_tick_ms = 0;
+        options_.session_engine = GetParam();
+        options_.unix_socket = "/tmp/chat-uds-test-" + std::to_string(::getpid()) + ".sock";
+        server_ = std::make_unique<ChatServer>(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0},
+                                               options_);
+        server_->run();
+        server_thread_ = std::thread([this] { server_ioc_.run(); });
+    }
+
+    void TearDown() override {
+        server_guard_.reset();
+        server_ioc_.stop();
+        if (server_thread_.joinable()) {
+            server_thread_.join();
+        }
+        server_.reset();
+        std::cout.rdbuf(cout_buf_);
+        std::cerr.rdbuf(cerr_buf_);
+    }
+
+    std::unique_ptr<LocalClient> connect_local() {
+        auto client = std::make_unique<LocalClient>(client_ioc_);
+        client->next_layer().connect(local_stream::endpoint(options_.unix_socket));
+        client->handshake("localhost", "/");
+        return client;
+    }
+
+    std::unique_ptr<TcpClient> connect_tcp() {
+        auto client = std::make_unique<TcpClient>(client_ioc_);
+        client->next_layer().connect(server_->local_endpoint());
+        client->handshake("127.0.0.1", "/");
+        return client;
+    }
+
+    // Reads frames until one contains `text`
+    template <typename Client>
+    static std::string read_until(Client& client, const std::string& text) {
+        for (;;) {
+            beast::flat_buffer buffer;
+            client.read(buffer);
+            auto frame = beast::buffers_to_string(buffer.data());
+            if (frame.find(text) != std::string::npos) {
+                return frame;
+            }
+        }
+    }
+
+    std::streambuf* cout_buf_ = std::cout.rdbuf(nullptr); // Per-connection logging
+    std::streambuf* cerr_buf_ = std::cerr.rdbuf(nullptr);
+    ServerOptions options_;
+    net::io_context server_ioc_;
+    net::executor_work_guard<net::io_context::executor_type> server_guard_ = net::make_work_guard(server_ioc_);
+    std::unique_ptr<ChatServer> server_;
+    std::thread server_thread_;
+    net::io_context client_ioc_;
+};
+
+std::string chat(const std::string& text) {
+    return R"({"type":"client_send_message","payload":{"text":")" + text + "\"}}";
+}
+
+} // namespace
+
+TEST_P(UnixSocketTest, LocalAndTcpClientsShareTheRoom) {
+    ASSERT_TRUE(server_->unix_socket_listening());
+    auto local = connect_local();
+    auto remote = connect_tcp();
+
+    local->write(net::buffer(chat("over the unix socket")));
+    EXPECT_NE(read_until(*remote, "over the unix socket").find("server_broadcast_message"), std::string::npos);
+    read_until(*local, "over the unix socket"); // The sender gets its own broadcast too
+
+    remote->write(net::buffer(chat("over tcp")));
+    EXPECT_NE(read_until(*local, "over tcp").find("server_broadcast_message"), std::string::npos);
+
+    local->close(websocket::close_code::normal);
+    remote->close(websocket::close_code::normal);
+}
+
+TEST_P(UnixSocketTest, ServesStatsOverTheUnixSocket) {
+    local_stream::socket socket(client_ioc_);
+    socket.connect(local_stream::endpoint(options_.unix_socket));
+    net::write(socket, net::buffer(std::string("GET /stats HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::string reply;
+    boost::system::error_code ec;
+    net::read(socket, net::dynamic_buffer(reply), ec);
+    EXPECT_EQ(ec, net::error::eof);
+    EXPECT_NE(reply.find("200 OK"), std::string::npos) << reply;
+    EXPECT_NE(reply.find("\"sessions\""), std::string::npos) << reply;
+}
+
+TEST_P(UnixSocketTest, ReplacesAStaleSocketAndRemovesItOnShutdown) {
+    struct stat info {};
+    ASSERT_EQ(::stat(options_.unix_socket.c_str(), &info), 0);
+    EXPECT_TRUE(S_ISSOCK(info.st_mode));
+
+    {
+        // A second server on the same path takes over, as after a crash
+        ChatServer second(server_ioc_, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, options_);
+        EXPECT_TRUE(second.unix_socket_listening());
+        server_guard_.reset();
+        server_ioc_.stop();
+        server_thread_.join();
+        server_.reset();
+        // The first server leaves the second one's socket alone
+        EXPECT_EQ(::stat(options_.unix_socket.c_str(), &info), 0);
+    }
+    EXPECT_NE(::stat(options_.unix_socket.c_str(), &info), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, UnixSocketTest,
+                         ::testing::Values(ServerOptions::SessionEngine::callback
+#if defined(CHAT_HAS_CORO_SESSION)
+                                           ,
+                                           ServerOptions::SessionEngine::coroutine
+#endif
+                                           ),
+                         [](const ::testing::TestParamInfo<ServerOptions::SessionEngine>& info) {
+                             return std::string(info.param == ServerOptions::SessionEngine::callback ? "callback"
+                                                                                                      : "coroutine");
+                         });